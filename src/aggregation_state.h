@@ -0,0 +1,324 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef AGGREGATION_STATE_H
+#define AGGREGATION_STATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "view.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Combines pixel values of images that fall into the same time slice of a chunk, see cube_view::aggregation_method()
+ *
+ * update() is called for each image after warping it to the chunk's spatial grid, with img_buf
+ * containing all bands of the image (b, y, x) and t the time index within the chunk.
+ */
+struct aggregation_state {
+   public:
+    aggregation_state(coords_nd<uint32_t, 4> size_btyx) : _size_btyx(size_btyx) {}
+    virtual ~aggregation_state() {}
+
+    virtual void init() = 0;
+    virtual void update(void *chunk_buf, void *img_buf, uint32_t t) = 0;
+    virtual void finalize(void *buf) = 0;
+
+    /**
+     * @brief Create the aggregation state of an aggregation method
+     * @param method aggregation method of a data cube view
+     * @param size_btyx size of the chunk buffer
+     * @return pointer to a new aggregation state, must be deleted by the caller
+     */
+    static aggregation_state *create(aggregation::aggregation_type method, coords_nd<uint32_t, 4> size_btyx);
+
+   protected:
+    coords_nd<uint32_t, 4> _size_btyx;
+};
+
+struct aggregation_state_mean : public aggregation_state {
+    aggregation_state_mean(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx), _m_count() {}
+
+    ~aggregation_state_mean() {}
+
+    void init() override {
+        _m_count.resize(_size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]);
+    }
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
+                    _m_count[chunk_buf_offset + i] = 1;
+                } else {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] += ((double *)img_buf)[img_buf_offset + i];
+                    _m_count[chunk_buf_offset + i] += 1;
+                }
+            }
+        }
+    }
+
+    void finalize(void *buf) override {
+        for (uint32_t i = 0; i < _size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]; ++i) {
+            if (!std::isnan(((double *)buf)[i])) {
+                ((double *)buf)[i] /= (double)(_m_count[i]);
+            }
+        }
+        _m_count.clear();
+    }
+
+   private:
+    std::vector<uint32_t> _m_count;
+};
+
+struct aggregation_state_median : public aggregation_state {
+    aggregation_state_median(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {
+        _m_buckets.resize(_size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]);
+    }
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        // iterate over all pixels
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            // uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i]))
+                    continue;
+                else {
+                    _m_buckets[ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3] +
+                               i]
+                        .push_back(((double *)img_buf)[img_buf_offset + i]);
+                }
+            }
+        }
+    }
+
+    void finalize(void *buf) override {
+        for (uint32_t i = 0; i < _size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]; ++i) {
+            std::vector<double> &list = _m_buckets[i];
+            std::sort(list.begin(), list.end());
+            if (list.size() == 0) {
+                ((double *)buf)[i] = NAN;
+            } else if (list.size() % 2 == 1) {
+                ((double *)buf)[i] = list[list.size() / 2];
+            } else {
+                ((double *)buf)[i] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
+            }
+        }
+    }
+
+   private:
+    std::vector<std::vector<double>> _m_buckets;
+};
+
+struct aggregation_state_first : public aggregation_state {
+    aggregation_state_first(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset =
+                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                if (!std::isnan(((double *)chunk_buf)[chunk_buf_offset + i]))
+                    continue;
+                else {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
+                }
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_count_values : public aggregation_state {
+    aggregation_state_count_values(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset =
+                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = 0;
+                }
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                ((double *)chunk_buf)[chunk_buf_offset + i] += 1;
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_count_images : public aggregation_state {
+    aggregation_state_count_images(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset =
+                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            //uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = 0;
+                }
+                ((double *)chunk_buf)[chunk_buf_offset + i] += 1;
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_last : public aggregation_state {
+    aggregation_state_last(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_min : public aggregation_state {
+    aggregation_state_min(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
+                } else {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = std::min(((double *)chunk_buf)[chunk_buf_offset + i], ((double *)img_buf)[img_buf_offset + i]);
+                }
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_max : public aggregation_state {
+    aggregation_state_max(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            // iterate over all pixels
+            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
+                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
+                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
+                } else {
+                    ((double *)chunk_buf)[chunk_buf_offset + i] = std::max(((double *)chunk_buf)[chunk_buf_offset + i], ((double *)img_buf)[img_buf_offset + i]);
+                }
+            }
+        }
+    }
+
+    void finalize(void *buf) override {}
+};
+
+struct aggregation_state_none : public aggregation_state {
+    aggregation_state_none(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
+
+    void init() override {}
+    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
+        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
+            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
+            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
+            memcpy(((double *)chunk_buf) + chunk_buf_offset, ((double *)img_buf) + img_buf_offset, sizeof(double) * _size_btyx[2] * _size_btyx[3]);
+        }
+    }
+    void finalize(void *buf) override {}
+};
+
+inline aggregation_state *aggregation_state::create(aggregation::aggregation_type method, coords_nd<uint32_t, 4> size_btyx) {
+    if (method == aggregation::aggregation_type::AGG_MEAN) {
+        return new aggregation_state_mean(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_MIN) {
+        return new aggregation_state_min(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_MAX) {
+        return new aggregation_state_max(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_FIRST) {
+        return new aggregation_state_first(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_LAST) {
+        return new aggregation_state_last(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_MEDIAN) {
+        return new aggregation_state_median(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_IMAGE_COUNT) {
+        return new aggregation_state_count_images(size_btyx);
+    } else if (method == aggregation::aggregation_type::AGG_VALUE_COUNT) {
+        return new aggregation_state_count_values(size_btyx);
+    }
+    return new aggregation_state_none(size_btyx);
+}
+
+}  // namespace gdalcubes
+
+#endif  //AGGREGATION_STATE_H
@@ -29,6 +29,7 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("apply_pixel_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "apply_pixel", id);
 
     if (id >= count_chunks())
         return std::shared_ptr<chunk_data>();  // chunk is outside of the view, we don't need to read anything.
@@ -104,6 +105,8 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
                     sizeof(double) * in->size()[0] * in->size()[1] * in->size()[2] * in->size()[3]);
     }
 
+    trace_span span_eval("expression");
+    span_eval.arg("expressions", _expr.size());
     uint16_t outb = (_keep_bands) ? _in_cube->size_bands() : 0;
     uint16_t expr_idx = 0;
     while (outb < _bands.count()) {
@@ -153,6 +156,7 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
         ++outb;
         ++expr_idx;
     }
+    span_eval.end();
 
     // free expressions
     for (uint16_t j = 0; j < expr.size(); ++j) {
@@ -163,6 +167,7 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
         delete[] vars[i].name;  // delete only names of band variables
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -0,0 +1,137 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "../config.h"
+#include "../timer.h"
+
+namespace gdalcubes {
+namespace bench {
+
+args::args(int argc, char* argv[], int start) : _values() {
+    for (int i = start; i < argc; ++i) {
+        std::string s(argv[i]);
+        if (s.compare(0, 2, "--") != 0) {
+            throw std::string("ERROR in args::args(): unexpected argument '" + s + "'");
+        }
+        s = s.substr(2);
+        if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+            _values[s] = argv[++i];
+        } else {
+            _values[s] = "";
+        }
+    }
+}
+
+std::string args::get(std::string key, std::string def) {
+    auto it = _values.find(key);
+    return it == _values.end() ? def : it->second;
+}
+
+int64_t args::get_int(std::string key, int64_t def) {
+    auto it = _values.find(key);
+    return it == _values.end() ? def : std::stoll(it->second);
+}
+
+double args::get_double(std::string key, double def) {
+    auto it = _values.find(key);
+    return it == _values.end() ? def : std::stod(it->second);
+}
+
+std::vector<int64_t> args::get_int_list(std::string key, std::vector<int64_t> def) {
+    auto it = _values.find(key);
+    if (it == _values.end()) {
+        return def;
+    }
+    std::vector<int64_t> out;
+    std::stringstream ss(it->second);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        out.push_back(std::stoll(token));
+    }
+    return out;
+}
+
+nlohmann::json measure(std::function<void()> f, uint16_t repeat, uint16_t warmup) {
+    for (uint16_t i = 0; i < warmup; ++i) {
+        f();
+    }
+    std::vector<double> t;
+    for (uint16_t i = 0; i < std::max(uint16_t(1), repeat); ++i) {
+        timer tm;
+        f();
+        t.push_back(tm.time());
+    }
+    return summarize(t);
+}
+
+nlohmann::json summarize(std::vector<double> t) {
+    if (t.empty()) {
+        throw std::string("ERROR in summarize(): no measurements");
+    }
+    std::sort(t.begin(), t.end());
+    double sum = 0;
+    for (uint16_t i = 0; i < t.size(); ++i) sum += t[i];
+    nlohmann::json out;
+    out["runs"] = t.size();
+    out["min"] = t.front();
+    out["median"] = (t.size() % 2 == 1) ? t[t.size() / 2] : (t[t.size() / 2 - 1] + t[t.size() / 2]) / 2;
+    out["mean"] = sum / t.size();
+    out["p95"] = t[std::min(t.size() - 1, (size_t)std::ceil(0.95 * t.size()) - 1)];
+    out["max"] = t.back();
+    return out;
+}
+
+nlohmann::json environment() {
+    version_info v = config::instance()->get_version_info();
+    nlohmann::json out;
+    out["gdalcubes"] = std::to_string(v.VERSION_MAJOR) + "." + std::to_string(v.VERSION_MINOR) + "." + std::to_string(v.VERSION_PATCH);
+    out["git_commit"] = v.GIT_COMMIT;
+    out["gdal"] = config::instance()->gdal_version_info();
+    out["hardware_threads"] = std::thread::hardware_concurrency();
+    out["timestamp"] = (uint64_t)std::time(nullptr);
+    return out;
+}
+
+void write_results(nlohmann::json results, std::string path) {
+    if (path.empty() || path == "-") {
+        std::cout << results.dump(2) << std::endl;
+        return;
+    }
+    std::ofstream f(path);
+    if (!f.is_open()) {
+        throw std::string("ERROR in write_results(): cannot open output file '" + path + "'");
+    }
+    f << results.dump(2) << std::endl;
+}
+
+}  // namespace bench
+}  // namespace gdalcubes
@@ -0,0 +1,95 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "../external/json.hpp"
+
+namespace gdalcubes {
+namespace bench {
+
+/**
+ * @brief Simple command line arguments of the form --key value or --flag
+ */
+class args {
+   public:
+    /**
+     * @param argc number of arguments
+     * @param argv arguments
+     * @param start index of the first argument to parse
+     */
+    args(int argc, char* argv[], int start);
+
+    inline bool has(std::string key) { return _values.find(key) != _values.end(); }
+
+    std::string get(std::string key, std::string def);
+    int64_t get_int(std::string key, int64_t def);
+    double get_double(std::string key, double def);
+
+    /**
+     * @brief Get a comma-separated list of integers, e.g. --threads 1,2,4
+     */
+    std::vector<int64_t> get_int_list(std::string key, std::vector<int64_t> def);
+
+   private:
+    std::map<std::string, std::string> _values;
+};
+
+/**
+ * @brief Run a function repeatedly and summarize measured real elapsed times
+ * @param f function to measure
+ * @param repeat number of measured runs
+ * @param warmup number of runs before measurement, e.g. to fill the GDAL block cache
+ * @return JSON object with runs, min, median, mean, p95, and max in seconds
+ */
+nlohmann::json measure(std::function<void()> f, uint16_t repeat, uint16_t warmup = 0);
+
+/**
+ * @brief Summarize measured times in seconds, as returned by measure()
+ */
+nlohmann::json summarize(std::vector<double> t);
+
+/**
+ * @brief Describe the machine and library build, stored with all results
+ */
+nlohmann::json environment();
+
+/**
+ * @brief Write results as JSON to a file, or to stdout if path is empty or "-"
+ */
+void write_results(nlohmann::json results, std::string path);
+
+int run_pipelines(args& a);
+int run_kernels(args& a);
+int run_collection(args& a);
+
+}  // namespace bench
+}  // namespace gdalcubes
+
+#endif  //BENCH_H
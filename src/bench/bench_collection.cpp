@@ -0,0 +1,202 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include "../timer.h"
+#include "bench.h"
+#include "synthetic.h"
+
+namespace gdalcubes {
+namespace bench {
+
+/**
+ * @brief Random spatiotemporal query windows of fixed size within the extent of a synthetic index
+ */
+class query_generator {
+   public:
+    query_generator(synthetic_index_options o, double size_deg, uint32_t days, uint32_t seed)
+        : _o(o), _size_deg(size_deg), _days(days), _rng(seed) {}
+
+    bounds_st next() {
+        std::uniform_real_distribution<double> ux(-180, 180 - _size_deg);
+        std::uniform_real_distribution<double> uy(-56, 72 - _size_deg);
+        std::uniform_int_distribution<uint32_t> ut(0, std::max(1u, 365u * _o.years - _days) - 1);
+        bounds_st out;
+        out.s.left = ux(_rng);
+        out.s.bottom = uy(_rng);
+        out.s.right = out.s.left + _size_deg;
+        out.s.top = out.s.bottom + _size_deg;
+        out.t0 = datetime::from_string("2015-01-01") + duration(ut(_rng), datetime_unit::DAY);
+        out.t1 = out.t0 + duration(_days, datetime_unit::DAY);
+        return out;
+    }
+
+   private:
+    synthetic_index_options _o;
+    double _size_deg;
+    uint32_t _days;
+    std::mt19937 _rng;
+};
+
+/**
+ * @brief Measure the latency of individual find_range_st() queries
+ */
+static nlohmann::json query_latency(std::shared_ptr<image_collection> ic, query_generator &q, uint32_t nqueries) {
+    std::vector<double> t;
+    uint64_t rows = 0;
+    for (uint32_t i = 0; i < nqueries; ++i) {
+        bounds_st b = q.next();
+        timer tm;
+        rows += ic->find_range_st(b, "EPSG:4326").size();
+        t.push_back(tm.time());
+    }
+    nlohmann::json out;
+    out["seconds"] = summarize(t);
+    out["rows_per_query"] = (double)rows / nqueries;
+    return out;
+}
+
+/**
+ * @brief Measure the throughput of find_range_st() queries from multiple threads
+ * @param shared if true, all threads query the same collection (i.e. the same database connection), otherwise
+ * each thread opens its own connection
+ */
+static nlohmann::json query_throughput(std::string file, std::shared_ptr<image_collection> ic, synthetic_index_options o,
+                                       double size_deg, uint32_t days, uint16_t nthreads, uint32_t nqueries, bool shared) {
+    std::vector<std::thread> workers;
+    std::vector<std::shared_ptr<image_collection>> collections(nthreads, ic);
+    if (!shared) {
+        for (uint16_t it = 0; it < nthreads; ++it) {
+            collections[it] = std::make_shared<image_collection>(file);
+        }
+    }
+    timer tm;
+    for (uint16_t it = 0; it < nthreads; ++it) {
+        workers.push_back(std::thread([&, it]() {
+            query_generator q(o, size_deg, days, 1000 + it);
+            for (uint32_t i = it; i < nqueries; i += nthreads) {
+                collections[it]->find_range_st(q.next(), "EPSG:4326");
+            }
+        }));
+    }
+    for (uint16_t it = 0; it < nthreads; ++it) {
+        workers[it].join();
+    }
+    double t = tm.time();
+    nlohmann::json out;
+    out["threads"] = nthreads;
+    out["connections"] = shared ? "shared" : "per_thread";
+    out["seconds"] = t;
+    out["queries_per_second"] = nqueries / t;
+    return out;
+}
+
+/**
+ * @brief Measure a function that modifies the collection in place on fresh temporary copies of the collection
+ */
+static nlohmann::json measure_in_place(std::string file, std::function<void(std::shared_ptr<image_collection>)> f, uint16_t repeat) {
+    std::vector<double> t;
+    for (uint16_t i = 0; i < std::max(uint16_t(1), repeat); ++i) {
+        std::shared_ptr<image_collection> ic = std::make_shared<image_collection>(file);
+        ic->temp_copy();
+        timer tm;
+        f(ic);
+        t.push_back(tm.time());
+    }
+    return summarize(t);
+}
+
+int run_collection(args &a) {
+    std::vector<int64_t> nimages = a.get_int_list("images", {1000, 10000, 100000});
+    std::vector<int64_t> threads = a.get_int_list("threads", {1, 2, 4, 8});
+    synthetic_index_options o;
+    o.nbands = a.get_int("bands", o.nbands);
+    o.footprint = a.get_double("footprint", o.footprint);
+    o.years = a.get_int("years", o.years);
+    o.seed = a.get_int("seed", o.seed);
+    uint16_t repeat = a.get_int("repeat", 3);
+    uint32_t nqueries = a.get_int("queries", 200);
+
+    // query windows of a typical chunk (256 x 256 pixels at 10m, 16 days) and of a typical view
+    double chunk_deg = a.get_double("chunk-deg", 0.025);
+    uint32_t chunk_days = a.get_int("chunk-days", 16);
+    double view_deg = a.get_double("view-deg", 5);
+    uint32_t view_days = a.get_int("view-days", 365);
+
+    std::string dir = a.get("dir", filesystem::join(filesystem::get_tempdir(), "gdalcubes_bench"));
+    if (!filesystem::exists(dir)) {
+        filesystem::mkdir_recursive(dir);
+    }
+
+    nlohmann::json out;
+    out["benchmark"] = "collection";
+    out["environment"] = environment();
+    out["results"] = nlohmann::json::array();
+
+    for (uint16_t in = 0; in < nimages.size(); ++in) {
+        o.nimages = nimages[in];
+        std::string file = filesystem::join(dir, "index_" + std::to_string(o.nimages) + ".db");
+        std::cerr << "collection with " << o.nimages << " images" << std::endl;
+
+        nlohmann::json r;
+        r["index"] = o.to_json();
+        timer tm;
+        std::shared_ptr<image_collection> ic = synthetic_index(file, o);
+        r["open_or_generate_seconds"] = tm.time();
+        r["file_size_bytes"] = filesystem::file_size(file);
+        r["gdalrefs"] = ic->count_gdalrefs();
+
+        query_generator qchunk(o, chunk_deg, chunk_days, 1);
+        query_generator qview(o, view_deg, view_days, 2);
+        r["find_range_st_chunk"] = query_latency(ic, qchunk, nqueries);
+        r["find_range_st_view"] = query_latency(ic, qview, std::max(1u, nqueries / 10));
+        r["extent"] = measure([ic]() { ic->extent(); }, repeat);
+        r["get_gdalrefs"] = measure([ic]() { ic->get_gdalrefs(); }, repeat);
+        r["filter_datetime_range"] = measure_in_place(file, [](std::shared_ptr<image_collection> c) {
+            c->filter_datetime_range("2016-01-01T00:00:00", "2016-12-31T00:00:00");
+        }, repeat);
+        r["filter_spatial_range"] = measure_in_place(file, [](std::shared_ptr<image_collection> c) {
+            bounds_2d<double> b;
+            b.left = -10;
+            b.right = 30;
+            b.bottom = 35;
+            b.top = 60;
+            c->filter_spatial_range(b, "EPSG:4326");
+        }, repeat);
+
+        r["throughput"] = nlohmann::json::array();
+        for (uint16_t it = 0; it < threads.size(); ++it) {
+            r["throughput"].push_back(query_throughput(file, ic, o, chunk_deg, chunk_days, threads[it], nqueries, true));
+            r["throughput"].push_back(query_throughput(file, ic, o, chunk_deg, chunk_days, threads[it], nqueries, false));
+        }
+        out["results"].push_back(r);
+    }
+    write_results(out, a.get("out", "-"));
+    return 0;
+}
+
+}  // namespace bench
+}  // namespace gdalcubes
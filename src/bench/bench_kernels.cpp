@@ -0,0 +1,312 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include "../aggregation_state.h"
+#include "../apply_pixel.h"
+#include "../fill_time.h"
+#include "../image_collection_cube.h"
+#include "../reduce_space.h"
+#include "../reduce_time.h"
+#include "../window_time.h"
+#include "bench.h"
+
+namespace gdalcubes {
+namespace bench {
+
+/**
+ * @brief A data cube consisting of a single chunk that is kept in memory
+ *
+ * read_chunk() returns a copy of the chunk, such that kernels of derived cubes (reducers, window functions, ...)
+ * can be measured without any I/O. The cost of the copy is reported as kernel chunk_copy.
+ */
+class memory_cube : public cube {
+   public:
+    memory_cube(cube_view v, std::shared_ptr<chunk_data> dat) : cube(std::make_shared<cube_view>(v)), _dat(dat) {
+        for (uint16_t ib = 0; ib < dat->size()[0]; ++ib) {
+            _bands.add(band("band" + std::to_string(ib + 1)));
+        }
+        _chunk_size = {v.nt(), v.ny(), v.nx()};
+    }
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override {
+        std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+        if (id >= count_chunks()) return out;
+        out->size(_dat->size());
+        out->buf(std::malloc(_dat->total_size_bytes()));
+        std::memcpy(out->buf(), _dat->buf(), _dat->total_size_bytes());
+        return out;
+    }
+
+    nlohmann::json make_constructible_json() override {
+        throw std::string("ERROR in memory_cube::make_constructible_json(): in-memory benchmark cubes cannot be serialized");
+    }
+
+   private:
+    std::shared_ptr<chunk_data> _dat;
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+/**
+ * @brief A kernel operating on a single chunk with given number of input pixels (summed over bands)
+ */
+struct kernel {
+    std::string name;
+    uint64_t pixels;
+    std::function<void()> run;
+};
+
+/**
+ * @brief Generate a chunk with two bands of smooth random values and a given fraction of NAN pixels
+ */
+static std::shared_ptr<chunk_data> random_chunk(coords_nd<uint32_t, 4> size_btyx, double nan_fraction, uint32_t seed) {
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    uint64_t n = (uint64_t)size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
+    out->size(size_btyx);
+    out->buf(std::malloc(n * sizeof(double)));
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> u(0, 1);
+    double *buf = (double *)out->buf();
+    for (uint64_t i = 0; i < n; ++i) {
+        buf[i] = (u(rng) < nan_fraction) ? NAN : 1000 + 2000 * u(rng);
+    }
+    return out;
+}
+
+static cube_view kernel_view(uint32_t nt, uint32_t ny, uint32_t nx) {
+    cube_view v;
+    v.srs() = "EPSG:32632";
+    v.left() = 300000;
+    v.right() = 300000 + nx * 10;
+    v.bottom() = 5700000;
+    v.top() = 5700000 + ny * 10;
+    v.nx() = nx;
+    v.ny() = ny;
+    v.t0() = datetime::from_string("2020-01-01");
+    v.t1() = v.t0() + duration(nt - 1, datetime_unit::DAY);
+    v.dt(duration(1, datetime_unit::DAY));
+    return v;
+}
+
+static std::vector<kernel> standard_kernels(std::shared_ptr<memory_cube> in, std::shared_ptr<chunk_data> dat,
+                                            std::vector<std::vector<double>> &images, std::vector<double> &mask,
+                                            std::vector<double> &tmp) {
+    std::vector<kernel> out;
+    coords_nd<uint32_t, 4> s = dat->size();
+    uint64_t n = dat->total_size_bytes() / sizeof(double);
+
+    out.push_back({"chunk_copy", n, [in]() { in->read_chunk(0); }});
+
+    std::vector<aggregation::aggregation_type> methods = {
+        aggregation::aggregation_type::AGG_FIRST, aggregation::aggregation_type::AGG_LAST,
+        aggregation::aggregation_type::AGG_MIN, aggregation::aggregation_type::AGG_MAX,
+        aggregation::aggregation_type::AGG_MEAN, aggregation::aggregation_type::AGG_MEDIAN,
+        aggregation::aggregation_type::AGG_IMAGE_COUNT, aggregation::aggregation_type::AGG_VALUE_COUNT};
+    for (uint16_t i = 0; i < methods.size(); ++i) {
+        aggregation::aggregation_type m = methods[i];
+        out.push_back({"aggregation_" + aggregation::to_string(m), n, [m, s, n, &images, &tmp]() {
+                           std::unique_ptr<aggregation_state> agg(aggregation_state::create(m, s));
+                           std::fill(tmp.begin(), tmp.begin() + n, NAN);
+                           agg->init();
+                           for (uint32_t it = 0; it < images.size(); ++it) {
+                               agg->update(tmp.data(), images[it].data(), it);
+                           }
+                           agg->finalize(tmp.data());
+                       }});
+    }
+
+    std::shared_ptr<image_mask> vmask = std::make_shared<value_mask>(std::unordered_set<double>{3, 8, 9});
+    std::shared_ptr<image_mask> rmask = std::make_shared<range_mask>(8, 10);
+    out.push_back({"mask_value", n, [vmask, s, &images, &mask]() {
+                       for (uint32_t it = 0; it < images.size(); ++it) {
+                           vmask->apply(mask.data() + it * s[2] * s[3], images[it].data(), s[0], s[2], s[3]);
+                       }
+                   }});
+    out.push_back({"mask_range", n, [rmask, s, &images, &mask]() {
+                       for (uint32_t it = 0; it < images.size(); ++it) {
+                           rmask->apply(mask.data() + it * s[2] * s[3], images[it].data(), s[0], s[2], s[3]);
+                       }
+                   }});
+
+    out.push_back({"pack", n, [dat, n, &tmp]() {
+                       std::memcpy(tmp.data(), dat->buf(), n * sizeof(double));
+                       packed_export::pack(tmp.data(), n, 0.0001, 0, -9999);
+                   }});
+
+    out.push_back({"apply_pixel_ndvi", n, [in]() {
+                       apply_pixel_cube::create(in, {"(band2-band1)/(band2+band1)"}, {"ndvi"})->read_chunk(0);
+                   }});
+
+    std::vector<std::string> reducers = {"mean", "median", "min", "max", "sd", "count"};
+    for (uint16_t i = 0; i < reducers.size(); ++i) {
+        std::string r = reducers[i];
+        out.push_back({"reduce_time_" + r, n, [in, r]() {
+                           reduce_time_cube::create(in, {{r, "band1"}, {r, "band2"}})->read_chunk(0);
+                       }});
+    }
+    for (uint16_t i = 0; i < reducers.size(); ++i) {
+        std::string r = reducers[i];
+        out.push_back({"reduce_space_" + r, n, [in, r]() {
+                           std::shared_ptr<cube> c = reduce_space_cube::create(in, {{r, "band1"}, {r, "band2"}});
+                           for (chunkid_t id = 0; id < c->count_chunks(); ++id) c->read_chunk(id);
+                       }});
+    }
+
+    out.push_back({"window_time_mean", n, [in]() {
+                       window_time_cube::create(in, {{"mean", "band1"}, {"mean", "band2"}}, 2, 2)->read_chunk(0);
+                   }});
+    out.push_back({"window_time_kernel", n, [in]() {
+                       window_time_cube::create(in, {0.25, 0.5, 0.25}, 1, 1)->read_chunk(0);
+                   }});
+    out.push_back({"fill_time_near", n, [in]() { fill_time_cube::create(in, "near")->read_chunk(0); }});
+    out.push_back({"fill_time_linear", n, [in]() { fill_time_cube::create(in, "linear")->read_chunk(0); }});
+
+    // date strings as in image collection formats, pixels is the number of parsed strings
+    std::vector<std::string> dates;
+    datetime_unit units[] = {datetime_unit::SECOND, datetime_unit::MINUTE, datetime_unit::DAY, datetime_unit::MONTH};
+    for (uint32_t i = 0; i < 4096; ++i) {
+        datetime d = datetime::from_string("2020-01-01T00:00:00") + duration(i * 37, datetime_unit::HOUR);
+        dates.push_back(d.to_string(units[i % 4]));
+    }
+    out.push_back({"datetime_from_string", dates.size(), [dates]() {
+                       for (uint32_t i = 0; i < dates.size(); ++i) {
+                           datetime::from_string(dates[i]);
+                       }
+                   }});
+    return out;
+}
+
+int run_kernels(args &a) {
+    std::vector<int64_t> size = a.get_int_list("size", {16, 256, 256});
+    if (size.size() != 3) {
+        throw std::string("ERROR in run_kernels(): invalid chunk size, expected t,y,x e.g. 16,256,256");
+    }
+    uint16_t repeat = a.get_int("repeat", 5);
+    double tolerance = a.get_double("tolerance", 0.2);
+
+    std::vector<double> nan_fractions;
+    std::stringstream ss(a.get("nan", "0,0.1,0.5"));
+    std::string token;
+    while (std::getline(ss, token, ',')) nan_fractions.push_back(std::stod(token));
+
+    std::set<std::string> selected;
+    if (a.has("kernels")) {
+        std::stringstream ks(a.get("kernels", ""));
+        while (std::getline(ks, token, ',')) selected.insert(token);
+    }
+
+    nlohmann::json baseline;
+    if (a.has("baseline")) {
+        std::ifstream i(a.get("baseline", ""));
+        if (!i.good()) {
+            throw std::string("ERROR in run_kernels(): cannot read baseline file '" + a.get("baseline", "") + "'");
+        }
+        i >> baseline;
+    }
+
+    coords_nd<uint32_t, 4> s = {2, (uint32_t)size[0], (uint32_t)size[1], (uint32_t)size[2]};
+    cube_view v = kernel_view(s[1], s[2], s[3]);
+
+    nlohmann::json out;
+    out["benchmark"] = "kernels";
+    out["environment"] = environment();
+    out["chunk_size"] = {s[0], s[1], s[2], s[3]};
+    out["results"] = nlohmann::json::array();
+    nlohmann::json new_baseline = nlohmann::json::object();
+    uint32_t nregressions = 0;
+
+    for (uint16_t inan = 0; inan < nan_fractions.size(); ++inan) {
+        std::shared_ptr<chunk_data> dat = random_chunk(s, nan_fractions[inan], 42 + inan);
+        std::shared_ptr<memory_cube> in = std::make_shared<memory_cube>(v, dat);
+
+        // input of aggregation and mask kernels: individual images (b, y, x) and an integer mask band per image
+        std::vector<std::vector<double>> images(s[1], std::vector<double>(s[0] * s[2] * s[3]));
+        for (uint32_t it = 0; it < s[1]; ++it) {
+            for (uint32_t ib = 0; ib < s[0]; ++ib) {
+                std::memcpy(images[it].data() + ib * s[2] * s[3], ((double *)dat->buf()) + ib * s[1] * s[2] * s[3] + it * s[2] * s[3],
+                            s[2] * s[3] * sizeof(double));
+            }
+        }
+        std::vector<double> mask(s[1] * s[2] * s[3]);
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> u(0, 10);
+        for (uint64_t i = 0; i < mask.size(); ++i) mask[i] = u(rng);
+        std::vector<double> tmp(dat->total_size_bytes() / sizeof(double));
+
+        std::vector<kernel> kernels = standard_kernels(in, dat, images, mask, tmp);
+        for (uint16_t ik = 0; ik < kernels.size(); ++ik) {
+            if (!selected.empty() && selected.count(kernels[ik].name) == 0) continue;
+            std::stringstream key_ss;
+            key_ss << kernels[ik].name << "@" << nan_fractions[inan];
+            std::string key = key_ss.str();
+            nlohmann::json r;
+            r["kernel"] = kernels[ik].name;
+            r["nan_fraction"] = nan_fractions[inan];
+            r["seconds"] = measure(kernels[ik].run, repeat, 1);
+            double t = r["seconds"]["median"].get<double>();
+            r["ns_per_pixel"] = 1e9 * t / kernels[ik].pixels;
+            r["gb_per_second"] = kernels[ik].pixels * sizeof(double) / t / 1e9;
+            new_baseline[key] = r["ns_per_pixel"];
+            if (baseline.count(key) > 0) {
+                double b = baseline[key].get<double>();
+                r["baseline_ns_per_pixel"] = b;
+                r["regression"] = r["ns_per_pixel"].get<double>() > b * (1 + tolerance);
+                if (r["regression"].get<bool>()) {
+                    ++nregressions;
+                    std::cerr << "REGRESSION " << key << ": " << r["ns_per_pixel"].get<double>() << " ns/pixel, baseline " << b << " ns/pixel" << std::endl;
+                }
+            }
+            std::cerr << key << ": " << r["ns_per_pixel"].get<double>() << " ns/pixel" << std::endl;
+            out["results"].push_back(r);
+        }
+    }
+
+    if (a.has("save-baseline")) {
+        std::ofstream o(a.get("save-baseline", ""));
+        if (!o.good()) {
+            throw std::string("ERROR in run_kernels(): cannot write baseline file '" + a.get("save-baseline", "") + "'");
+        }
+        o << new_baseline.dump(2) << std::endl;
+    }
+    out["regressions"] = nregressions;
+    write_results(out, a.get("out", "-"));
+    return nregressions > 0 ? 1 : 0;
+}
+
+}  // namespace bench
+}  // namespace gdalcubes
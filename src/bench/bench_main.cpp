@@ -0,0 +1,111 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <iostream>
+#include "../config.h"
+#include "bench.h"
+
+using namespace gdalcubes;
+
+void print_usage() {
+    std::cout << "Usage: gdalcubes_bench COMMAND [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Commands:" << std::endl;
+    std::cout << "  pipelines                Run standard pipelines on a synthetic GeoTIFF collection" << std::endl;
+    std::cout << "  kernels                  Measure per-chunk kernels on in-memory chunks and compare against a baseline" << std::endl;
+    std::cout << "  collection               Measure image collection queries on synthetic indexes with many images" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options of pipelines:" << std::endl;
+    std::cout << "      --dir                Directory of the synthetic collection, reused if generated with the same options" << std::endl;
+    std::cout << "      --images             Number of scenes, defaults to 24" << std::endl;
+    std::cout << "      --tiles              Number of spatial tiles per date, defaults to 4" << std::endl;
+    std::cout << "      --size               Width and height of images in pixels, defaults to 512" << std::endl;
+    std::cout << "      --overlap            Fraction of overlap between neighboring tiles, defaults to 0.1" << std::endl;
+    std::cout << "      --srs-mismatch       Fraction of tiles in a different UTM zone, defaults to 0" << std::endl;
+    std::cout << "      --nodata             Fraction of nodata pixels, defaults to 0.1" << std::endl;
+    std::cout << "      --compression        GeoTIFF compression, e.g. NONE, DEFLATE, LZW, or ZSTD, defaults to DEFLATE" << std::endl;
+    std::cout << "      --blocksize          GeoTIFF tile size, defaults to 256" << std::endl;
+    std::cout << "      --resolution         Pixel size of the data cube view in meters, defaults to 20" << std::endl;
+    std::cout << "      --pipelines          Comma-separated subset of collection, apply_pixel_ndvi, reduce_time_median, window_time_mean," << std::endl;
+    std::cout << "                           fill_time_linear, query_points, export_netcdf, export_gtiff" << std::endl;
+    std::cout << "      --threads            Comma-separated thread counts, defaults to 1,2,4" << std::endl;
+    std::cout << "      --chunk-sizes        Comma-separated chunk sizes, defaults to 1x256x256,4x256x256,1x512x512" << std::endl;
+    std::cout << "      --repeat             Number of measured runs per configuration, defaults to 3" << std::endl;
+    std::cout << "      --points             Number of points of query_points, defaults to 1000" << std::endl;
+    std::cout << "      --out                Output JSON file, defaults to stdout" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options of kernels:" << std::endl;
+    std::cout << "      --size               Chunk size as t,y,x, defaults to 16,256,256" << std::endl;
+    std::cout << "      --nan                Comma-separated fractions of NAN pixels, defaults to 0,0.1,0.5" << std::endl;
+    std::cout << "      --kernels            Comma-separated subset of kernels, defaults to all" << std::endl;
+    std::cout << "      --repeat             Number of measured runs per kernel, defaults to 5" << std::endl;
+    std::cout << "      --baseline           JSON file with baseline ns per pixel, as written by --save-baseline" << std::endl;
+    std::cout << "      --tolerance          Allowed relative slowdown before a kernel counts as regression, defaults to 0.2" << std::endl;
+    std::cout << "      --save-baseline      Write ns per pixel of all kernels to a JSON file" << std::endl;
+    std::cout << "      --out                Output JSON file, defaults to stdout" << std::endl;
+    std::cout << std::endl;
+    std::cout << "kernels returns a nonzero exit code if any kernel is slower than its baseline." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options of collection:" << std::endl;
+    std::cout << "      --dir                Directory of generated index databases, reused if generated with the same options" << std::endl;
+    std::cout << "      --images             Comma-separated numbers of images, defaults to 1000,10000,100000" << std::endl;
+    std::cout << "      --bands              Number of bands per image, defaults to 4" << std::endl;
+    std::cout << "      --footprint          Width and height of image footprints in degrees, defaults to 1" << std::endl;
+    std::cout << "      --years              Temporal extent in years, defaults to 5" << std::endl;
+    std::cout << "      --queries            Number of find_range_st queries per measurement, defaults to 200" << std::endl;
+    std::cout << "      --chunk-deg          Spatial size of chunk queries in degrees, defaults to 0.025" << std::endl;
+    std::cout << "      --chunk-days         Temporal size of chunk queries in days, defaults to 16" << std::endl;
+    std::cout << "      --view-deg           Spatial size of view queries in degrees, defaults to 5" << std::endl;
+    std::cout << "      --view-days          Temporal size of view queries in days, defaults to 365" << std::endl;
+    std::cout << "      --threads            Comma-separated thread counts of throughput measurements, defaults to 1,2,4,8" << std::endl;
+    std::cout << "      --repeat             Number of measured runs of other operations, defaults to 3" << std::endl;
+    std::cout << "      --out                Output JSON file, defaults to stdout" << std::endl;
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    config::instance()->gdalcubes_init();
+    int ret = 1;
+    try {
+        bench::args a(argc, argv, 2);
+        std::string cmd(argv[1]);
+        if (cmd == "pipelines") {
+            ret = bench::run_pipelines(a);
+        } else if (cmd == "kernels") {
+            ret = bench::run_kernels(a);
+        } else if (cmd == "collection") {
+            ret = bench::run_collection(a);
+        } else {
+            print_usage();
+        }
+    } catch (std::string s) {
+        std::cerr << s << std::endl;
+    }
+    config::instance()->gdalcubes_cleanup();
+    return ret;
+}
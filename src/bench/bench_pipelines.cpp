@@ -0,0 +1,183 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include "../apply_pixel.h"
+#include "../fill_time.h"
+#include "../image_collection_cube.h"
+#include "../reduce_time.h"
+#include "../vector_queries.h"
+#include "../window_time.h"
+#include "bench.h"
+#include "synthetic.h"
+
+namespace gdalcubes {
+namespace bench {
+
+/**
+ * @brief A standard pipeline on top of an image collection cube
+ */
+struct pipeline {
+    std::string name;
+    std::function<void(std::shared_ptr<image_collection_cube>, std::shared_ptr<chunk_processor>)> run;
+};
+
+static void evaluate(std::shared_ptr<cube> c, std::shared_ptr<chunk_processor> p) {
+    p->apply(c, [](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {});
+}
+
+static std::shared_ptr<cube> ndvi(std::shared_ptr<cube> in) {
+    return apply_pixel_cube::create(in, {"(B08-B04)/(B08+B04)"}, {"NDVI"});
+}
+
+static std::vector<pipeline> standard_pipelines(std::string workdir, uint32_t npoints) {
+    std::vector<pipeline> out;
+    out.push_back({"collection", [](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       evaluate(c, p);
+                   }});
+    out.push_back({"apply_pixel_ndvi", [](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       evaluate(ndvi(c), p);
+                   }});
+    out.push_back({"reduce_time_median", [](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       evaluate(reduce_time_cube::create(ndvi(c), {{"median", "NDVI"}}), p);
+                   }});
+    out.push_back({"window_time_mean", [](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       evaluate(window_time_cube::create(ndvi(c), {{"mean", "NDVI"}}, 1, 1), p);
+                   }});
+    out.push_back({"fill_time_linear", [](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       evaluate(fill_time_cube::create(ndvi(c), "linear"), p);
+                   }});
+    out.push_back({"query_points", [npoints](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       std::mt19937 rng(1);
+                       std::uniform_real_distribution<double> ux(c->st_reference()->left(), c->st_reference()->right());
+                       std::uniform_real_distribution<double> uy(c->st_reference()->bottom(), c->st_reference()->top());
+                       std::uniform_int_distribution<uint32_t> ut(0, c->size_t() - 1);
+                       std::vector<double> x, y;
+                       std::vector<std::string> t;
+                       for (uint32_t i = 0; i < npoints; ++i) {
+                           x.push_back(ux(rng));
+                           y.push_back(uy(rng));
+                           t.push_back((c->st_reference()->t0() + c->st_reference()->dt() * ut(rng)).to_string());
+                       }
+                       config::instance()->set_default_chunk_processor(p);
+                       vector_queries::query_points(ndvi(c), x, y, t, c->st_reference()->srs());
+                   }});
+    out.push_back({"export_netcdf", [workdir](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       std::string f = filesystem::join(workdir, "bench_out.nc");
+                       ndvi(c)->write_netcdf_file(f, 1, false, true, packed_export::make_none(), false, p);
+                       filesystem::remove(f);
+                   }});
+    out.push_back({"export_gtiff", [workdir](std::shared_ptr<image_collection_cube> c, std::shared_ptr<chunk_processor> p) {
+                       std::string d = filesystem::join(workdir, "bench_out_tif");
+                       if (!filesystem::exists(d)) filesystem::mkdir(d);
+                       ndvi(c)->write_tif_collection(d, "ndvi_", false, false, std::map<std::string, std::string>(), "NEAREST", packed_export::make_none(), false, p);
+                       filesystem::iterate_directory(d, [](const std::string &f) { filesystem::remove(f); });
+                   }});
+    return out;
+}
+
+int run_pipelines(args &a) {
+    synthetic_options o;
+    o.nimages = a.get_int("images", o.nimages);
+    o.ntiles = a.get_int("tiles", o.ntiles);
+    o.size = a.get_int("size", o.size);
+    o.overlap = a.get_double("overlap", o.overlap);
+    o.srs_mismatch = a.get_double("srs-mismatch", o.srs_mismatch);
+    o.nodata = a.get_double("nodata", o.nodata);
+    o.compression = a.get("compression", o.compression);
+    o.blocksize = a.get_int("blocksize", o.blocksize);
+    o.seed = a.get_int("seed", o.seed);
+
+    std::string dir = a.get("dir", filesystem::join(filesystem::get_tempdir(), "gdalcubes_bench"));
+    double resolution = a.get_double("resolution", 2 * o.resolution);
+    std::vector<int64_t> threads = a.get_int_list("threads", {1, 2, 4});
+    uint16_t repeat = a.get_int("repeat", 3);
+    uint32_t npoints = a.get_int("points", 1000);
+
+    // chunk sizes as t x y x x, separated by commas, e.g. 16x256x256,1x512x512
+    std::vector<std::vector<uint32_t>> chunk_sizes;
+    std::stringstream ss(a.get("chunk-sizes", "1x256x256,4x256x256,1x512x512"));
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        std::vector<uint32_t> cs;
+        std::stringstream ts(token);
+        std::string v;
+        while (std::getline(ts, v, 'x')) cs.push_back(std::stoul(v));
+        if (cs.size() != 3) {
+            throw std::string("ERROR in run_pipelines(): invalid chunk size '" + token + "', expected e.g. 16x256x256");
+        }
+        chunk_sizes.push_back(cs);
+    }
+
+    std::set<std::string> selected;
+    if (a.has("pipelines")) {
+        std::stringstream ps(a.get("pipelines", ""));
+        while (std::getline(ps, token, ',')) selected.insert(token);
+    }
+
+    std::shared_ptr<image_collection> ic = synthetic_geotiff_collection(dir, o);
+    cube_view v = synthetic_view(o, resolution);
+
+    nlohmann::json out;
+    out["benchmark"] = "pipelines";
+    out["environment"] = environment();
+    out["collection"] = o.to_json();
+    out["view"] = nlohmann::json::parse(v.write_json_string());
+    out["results"] = nlohmann::json::array();
+
+    std::vector<pipeline> pipelines = standard_pipelines(dir, npoints);
+    for (uint16_t ip = 0; ip < pipelines.size(); ++ip) {
+        if (!selected.empty() && selected.count(pipelines[ip].name) == 0) continue;
+        for (uint16_t ic_size = 0; ic_size < chunk_sizes.size(); ++ic_size) {
+            for (uint16_t it = 0; it < threads.size(); ++it) {
+                std::shared_ptr<chunk_processor> p = std::make_shared<chunk_processor_multithread>(threads[it]);
+                std::shared_ptr<image_collection_cube> c = image_collection_cube::create(ic, v);
+                c->set_chunk_size(chunk_sizes[ic_size][0], chunk_sizes[ic_size][1], chunk_sizes[ic_size][2]);
+
+                std::cerr << pipelines[ip].name << " chunk_size=" << chunk_sizes[ic_size][0] << "x" << chunk_sizes[ic_size][1] << "x" << chunk_sizes[ic_size][2]
+                          << " threads=" << threads[it] << std::endl;
+                uint64_t gdal_open = metrics::instance()->gdal_open();
+                uint64_t gdal_warp = metrics::instance()->gdal_warp();
+                nlohmann::json r;
+                r["pipeline"] = pipelines[ip].name;
+                r["threads"] = threads[it];
+                r["chunk_size"] = chunk_sizes[ic_size];
+                r["chunks"] = c->count_chunks();
+                r["seconds"] = measure([&]() { pipelines[ip].run(c, p); }, repeat);
+                r["gdal_open_per_run"] = (metrics::instance()->gdal_open() - gdal_open) / r["seconds"]["runs"].get<uint32_t>();
+                r["gdal_warp_per_run"] = (metrics::instance()->gdal_warp() - gdal_warp) / r["seconds"]["runs"].get<uint32_t>();
+                r["pixels_per_second"] = (double)c->size_t() * c->size_y() * c->size_x() / r["seconds"]["median"].get<double>();
+                out["results"].push_back(r);
+            }
+        }
+    }
+    write_results(out, a.get("out", "-"));
+    return 0;
+}
+
+}  // namespace bench
+}  // namespace gdalcubes
@@ -0,0 +1,354 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "synthetic.h"
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+namespace gdalcubes {
+namespace bench {
+
+static const double ORIGIN_X = 500000;  // UTM 32N, central meridian
+static const double ORIGIN_Y = 5650000;
+static const char *START_DATE = "2020-01-01";
+
+nlohmann::json synthetic_options::to_json() {
+    nlohmann::json out;
+    out["nimages"] = nimages;
+    out["ntiles"] = ntiles;
+    out["size"] = size;
+    out["resolution"] = resolution;
+    out["overlap"] = overlap;
+    out["srs_mismatch"] = srs_mismatch;
+    out["nodata"] = nodata;
+    out["compression"] = compression;
+    out["blocksize"] = blocksize;
+    out["revisit"] = revisit;
+    out["seed"] = seed;
+    return out;
+}
+
+// number of tile columns of the grid
+static uint32_t grid_cols(synthetic_options &o) {
+    return (uint32_t)std::ceil(std::sqrt((double)o.ntiles));
+}
+
+static double tile_step(synthetic_options &o) {
+    return o.size * o.resolution * (1 - o.overlap);
+}
+
+static std::string wkt_from_epsg(int epsg) {
+    OGRSpatialReference srs;
+    srs.importFromEPSG(epsg);
+    char *wkt = nullptr;
+    srs.exportToWkt(&wkt);
+    std::string out(wkt);
+    CPLFree(wkt);
+    return out;
+}
+
+static const char *FORMAT_JSON = R"({
+  "description" : "Synthetic benchmark collection",
+  "pattern" : ".+\\.tif",
+  "images" : {
+    "pattern" : ".*SYN_([0-9]{8}_T[0-9]+)_B0[48]\\.tif"
+  },
+  "datetime" : {
+    "pattern" : ".*SYN_([0-9]{8})_.*",
+    "format" : "%Y%m%d"
+  },
+  "bands": {
+    "B04" : {
+      "pattern" : ".+_B04\\.tif",
+      "nodata" : 0
+    },
+    "B08" : {
+      "pattern" : ".+_B08\\.tif",
+      "nodata" : 0
+    }
+  }
+})";
+
+std::shared_ptr<image_collection> synthetic_geotiff_collection(std::string dir, synthetic_options o) {
+    std::string db = filesystem::join(dir, "collection.db");
+    std::string params = filesystem::join(dir, "params.json");
+    if (filesystem::exists(db) && filesystem::exists(params)) {
+        std::ifstream f(params);
+        nlohmann::json j;
+        f >> j;
+        if (j == o.to_json()) {
+            return std::make_shared<image_collection>(db);
+        }
+    }
+    if (!filesystem::exists(dir)) {
+        filesystem::mkdir_recursive(dir);
+    }
+
+    GDALDriver *drv = GetGDALDriverManager()->GetDriverByName("GTiff");
+    if (!drv) {
+        throw std::string("ERROR in synthetic_geotiff_collection(): GDAL GTiff driver is not available");
+    }
+    CPLStringList co;
+    co.AddNameValue("TILED", "YES");
+    co.AddNameValue("BLOCKXSIZE", std::to_string(o.blocksize).c_str());
+    co.AddNameValue("BLOCKYSIZE", std::to_string(o.blocksize).c_str());
+    if (o.compression != "NONE") {
+        co.AddNameValue("COMPRESS", o.compression.c_str());
+    }
+
+    std::mt19937 rng(o.seed);
+    std::uniform_real_distribution<double> unif(0, 1);
+    std::normal_distribution<double> noise(0, 50);
+
+    // choose projection of each tile once, such that all dates of a tile have the same grid
+    std::vector<int> epsg(o.ntiles, 32632);
+    std::vector<double> tile_x(o.ntiles), tile_y(o.ntiles);
+    uint32_t ncols = grid_cols(o);
+    OGRSpatialReference srs_32632, srs_32633;
+    srs_32632.importFromEPSG(32632);
+    srs_32633.importFromEPSG(32633);
+    srs_32632.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    srs_32633.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+    OGRCoordinateTransformation *ct = OGRCreateCoordinateTransformation(&srs_32632, &srs_32633);
+    for (uint32_t k = 0; k < o.ntiles; ++k) {
+        tile_x[k] = ORIGIN_X + (k % ncols) * tile_step(o);
+        tile_y[k] = ORIGIN_Y - (k / ncols) * tile_step(o);
+        if (unif(rng) < o.srs_mismatch && ct) {
+            epsg[k] = 32633;
+            ct->Transform(1, &tile_x[k], &tile_y[k]);
+        }
+    }
+    if (ct) OGRCoordinateTransformation::DestroyCT(ct);
+    std::string wkt_32632 = wkt_from_epsg(32632);
+    std::string wkt_32633 = wkt_from_epsg(32633);
+
+    std::vector<uint16_t> buf(o.size * o.size);
+    std::vector<std::string> files;
+    datetime t0 = datetime::from_string(START_DATE);
+    for (uint32_t i = 0; i < o.nimages; ++i) {
+        uint32_t k = i % o.ntiles;
+        uint32_t idate = i / o.ntiles;
+        std::string date = (t0 + duration(idate * o.revisit, datetime_unit::DAY)).to_string(datetime_unit::DAY);
+        date.erase(std::remove(date.begin(), date.end(), '-'), date.end());
+        double season = std::sin(2 * M_PI * idate * o.revisit / 365.0);
+
+        // nodata blocks are shared by both bands of a scene, like clouds
+        uint32_t nblocks = (o.size + 31) / 32;
+        std::vector<bool> nodata_block(nblocks * nblocks);
+        for (uint32_t ib = 0; ib < nodata_block.size(); ++ib) {
+            nodata_block[ib] = unif(rng) < o.nodata;
+        }
+
+        for (uint16_t b = 0; b < 2; ++b) {
+            std::string name = filesystem::join(dir, "SYN_" + date + "_T" + std::to_string(k) + (b == 0 ? "_B04.tif" : "_B08.tif"));
+            for (uint32_t iy = 0; iy < o.size; ++iy) {
+                for (uint32_t ix = 0; ix < o.size; ++ix) {
+                    if (nodata_block[(iy / 32) * nblocks + ix / 32]) {
+                        buf[iy * o.size + ix] = 0;
+                        continue;
+                    }
+                    double pattern = std::sin(ix * 0.05) * std::cos(iy * 0.03);
+                    double v = (b == 0) ? 600 + 200 * pattern - 150 * season : 2500 + 800 * pattern + 700 * season;
+                    buf[iy * o.size + ix] = (uint16_t)std::max(1.0, std::min(65535.0, v + noise(rng)));
+                }
+            }
+            GDALDataset *ds = drv->Create(name.c_str(), o.size, o.size, 1, GDT_UInt16, co.List());
+            if (!ds) {
+                throw std::string("ERROR in synthetic_geotiff_collection(): cannot create '" + name + "'");
+            }
+            double affine[6] = {tile_x[k], o.resolution, 0, tile_y[k], 0, -o.resolution};
+            ds->SetGeoTransform(affine);
+            ds->SetProjection(epsg[k] == 32632 ? wkt_32632.c_str() : wkt_32633.c_str());
+            ds->GetRasterBand(1)->SetNoDataValue(0);
+            if (ds->GetRasterBand(1)->RasterIO(GF_Write, 0, 0, o.size, o.size, buf.data(), o.size, o.size, GDT_UInt16, 0, 0, NULL) != CE_None) {
+                GDALClose(ds);
+                throw std::string("ERROR in synthetic_geotiff_collection(): cannot write '" + name + "'");
+            }
+            GDALClose(ds);
+            files.push_back(name);
+        }
+    }
+
+    collection_format f;
+    f.load_string(FORMAT_JSON);
+    std::shared_ptr<image_collection> ic = image_collection::create(f, files, true);
+    ic->write(db);
+
+    std::ofstream fp(params);
+    fp << o.to_json().dump(2);
+    return std::make_shared<image_collection>(db);
+}
+
+cube_view synthetic_view(synthetic_options o, double resolution, uint32_t revisit_factor) {
+    uint32_t ncols = grid_cols(o);
+    uint32_t nrows = (o.ntiles + ncols - 1) / ncols;
+    uint32_t ndates = (o.nimages + o.ntiles - 1) / o.ntiles;
+
+    cube_view v;
+    v.srs() = "EPSG:32632";
+    v.left() = ORIGIN_X;
+    v.top() = ORIGIN_Y;
+    v.right() = ORIGIN_X + (ncols - 1) * tile_step(o) + o.size * o.resolution;
+    v.bottom() = ORIGIN_Y - (nrows - 1) * tile_step(o) - o.size * o.resolution;
+    v.dx(resolution);
+    v.dy(resolution);
+    v.t0() = datetime::from_string(START_DATE);
+    v.t1() = v.t0() + duration((ndates - 1) * o.revisit, datetime_unit::DAY);
+    v.dt(duration(o.revisit * revisit_factor, datetime_unit::DAY));
+    v.aggregation_method() = aggregation::aggregation_type::AGG_FIRST;
+    v.resampling_method() = resampling::resampling_type::RSMPL_NEAR;
+    return v;
+}
+
+nlohmann::json synthetic_index_options::to_json() {
+    nlohmann::json out;
+    out["nimages"] = nimages;
+    out["nbands"] = nbands;
+    out["footprint"] = footprint;
+    out["years"] = years;
+    out["seed"] = seed;
+    return out;
+}
+
+static void exec_sql(sqlite3 *db, std::string sql) {
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in synthetic_index(): cannot execute '" + sql + "': " + sqlite3_errmsg(db));
+    }
+}
+
+std::shared_ptr<image_collection> synthetic_index(std::string file, synthetic_index_options o) {
+    std::string params = file + ".json";
+    if (filesystem::exists(file) && filesystem::exists(params)) {
+        std::ifstream f(params);
+        nlohmann::json j;
+        f >> j;
+        if (j == o.to_json()) {
+            return std::make_shared<image_collection>(file);
+        }
+    }
+    if (filesystem::exists(file)) {
+        filesystem::remove(file);
+    }
+
+    // create an empty collection with the expected schema
+    nlohmann::json format;
+    format["description"] = "Synthetic benchmark collection index";
+    format["pattern"] = ".+";
+    format["images"]["pattern"] = "(.+)/B[0-9]+\\.tif";
+    format["datetime"]["pattern"] = ".*_([0-9]{8})/.*";
+    format["datetime"]["format"] = "%Y%m%d";
+    std::vector<std::string> band_names;
+    for (uint16_t ib = 0; ib < o.nbands; ++ib) {
+        std::string name = (ib + 1 < 10 ? "B0" : "B") + std::to_string(ib + 1);
+        format["bands"][name]["pattern"] = ".+/" + name + "\\.tif";
+        format["bands"][name]["nodata"] = 0;
+        band_names.push_back(name);
+    }
+    collection_format cf;
+    cf.load_string(format.dump());
+    {
+        image_collection ic(cf);
+        ic.write(file);
+    }
+
+    sqlite3 *db;
+    if (sqlite3_open_v2(file.c_str(), &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        throw std::string("ERROR in synthetic_index(): cannot open database file '" + file + "'");
+    }
+    exec_sql(db, "PRAGMA synchronous=OFF;");
+    exec_sql(db, "UPDATE bands SET type='uint16';");
+    exec_sql(db, "BEGIN TRANSACTION;");
+
+    sqlite3_stmt *stmt_image;
+    sqlite3_stmt *stmt_gdalref;
+    sqlite3_prepare_v2(db, "INSERT INTO images(id, name, datetime, left, top, bottom, right, proj) VALUES(?,?,?,?,?,?,?,?);", -1, &stmt_image, NULL);
+    sqlite3_prepare_v2(db, "INSERT INTO gdalrefs(descriptor, image_id, band_id, band_num) VALUES(?,?,?,1);", -1, &stmt_gdalref, NULL);
+    if (!stmt_image || !stmt_gdalref) {
+        throw std::string("ERROR in synthetic_index(): cannot prepare insert statements");
+    }
+
+    std::mt19937_64 rng(o.seed);
+    uint32_t ncols = std::max(1, (int)std::floor(360.0 / o.footprint));
+    uint32_t nrows = std::max(1, (int)std::floor(128.0 / o.footprint));
+    std::uniform_int_distribution<uint32_t> ucol(0, ncols - 1);
+    std::uniform_int_distribution<uint32_t> urow(0, nrows - 1);
+    std::uniform_int_distribution<uint32_t> uday(0, 365 * o.years - 1);
+    std::uniform_real_distribution<double> ujitter(-0.05 * o.footprint, 0.05 * o.footprint);
+    datetime t0 = datetime::from_string("2015-01-01");
+
+    for (uint64_t i = 0; i < o.nimages; ++i) {
+        uint32_t col = ucol(rng);
+        uint32_t row = urow(rng);
+        double left = -180 + col * o.footprint + ujitter(rng);
+        double bottom = -56 + row * o.footprint + ujitter(rng);
+        datetime t = t0 + duration(uday(rng), datetime_unit::DAY);
+        int utm_zone = std::min(60, (int)((left + 180) / 6) + 1);
+
+        std::stringstream name;
+        name << "T" << std::setfill('0') << std::setw(4) << col << std::setw(3) << row << "_" << t.to_string(datetime_unit::DAY) << "_" << i;
+        std::string dt = t.to_string(datetime_unit::SECOND);
+        std::string proj = "EPSG:326" + std::string(utm_zone < 10 ? "0" : "") + std::to_string(utm_zone);
+
+        sqlite3_bind_int64(stmt_image, 1, i + 1);
+        sqlite3_bind_text(stmt_image, 2, name.str().c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt_image, 3, dt.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(stmt_image, 4, left);
+        sqlite3_bind_double(stmt_image, 5, bottom + o.footprint);
+        sqlite3_bind_double(stmt_image, 6, bottom);
+        sqlite3_bind_double(stmt_image, 7, left + o.footprint);
+        sqlite3_bind_text(stmt_image, 8, proj.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt_image) != SQLITE_DONE) {
+            throw std::string("ERROR in synthetic_index(): cannot insert image: " + std::string(sqlite3_errmsg(db)));
+        }
+        sqlite3_reset(stmt_image);
+
+        for (uint16_t ib = 0; ib < o.nbands; ++ib) {
+            std::string descriptor = "/vsicurl/https://example.com/" + name.str() + "/" + band_names[ib] + ".tif";
+            sqlite3_bind_text(stmt_gdalref, 1, descriptor.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt_gdalref, 2, i + 1);
+            sqlite3_bind_int(stmt_gdalref, 3, ib);
+            if (sqlite3_step(stmt_gdalref) != SQLITE_DONE) {
+                throw std::string("ERROR in synthetic_index(): cannot insert gdalref: " + std::string(sqlite3_errmsg(db)));
+            }
+            sqlite3_reset(stmt_gdalref);
+        }
+    }
+    sqlite3_finalize(stmt_image);
+    sqlite3_finalize(stmt_gdalref);
+    exec_sql(db, "COMMIT;");
+    sqlite3_close(db);
+
+    std::ofstream f(params);
+    f << o.to_json().dump(2);
+    return std::make_shared<image_collection>(file);
+}
+
+}  // namespace bench
+}  // namespace gdalcubes
@@ -0,0 +1,103 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include "../image_collection.h"
+#include "../view.h"
+
+namespace gdalcubes {
+namespace bench {
+
+/**
+ * @brief Parameters of a synthetic GeoTIFF image collection
+ *
+ * Scenes are placed on a regular grid of spatial tiles in UTM zone 32N and are repeated every revisit days. Each scene
+ * consists of two single-band UInt16 files (bands B04 and B08), such that NDVI-like pipelines can be computed.
+ */
+struct synthetic_options {
+    uint32_t nimages = 24;               // number of scenes, i.e. tiles x dates
+    uint32_t ntiles = 4;                 // number of spatial tiles per date
+    uint32_t size = 512;                 // width and height of images in pixels
+    double resolution = 10;              // pixel size in meters
+    double overlap = 0.1;                // fraction of overlap between neighboring tiles
+    double srs_mismatch = 0;             // fraction of tiles stored in UTM zone 33N instead of 32N
+    double nodata = 0.1;                 // fraction of nodata pixels, in 32x32 pixel blocks
+    std::string compression = "DEFLATE";  // GeoTIFF compression, or "NONE"
+    uint32_t blocksize = 256;            // GeoTIFF tile size
+    uint32_t revisit = 5;                // days between acquisitions of the same tile
+    uint32_t seed = 42;
+
+    nlohmann::json to_json();
+};
+
+/**
+ * @brief Generate (or reuse) a synthetic collection of GeoTIFF files and its image collection index
+ * @details If the directory already contains a collection that has been generated with identical options, it is
+ * reused without writing any files.
+ * @param dir output directory, created if needed
+ * @param o options
+ * @return image collection
+ */
+std::shared_ptr<image_collection> synthetic_geotiff_collection(std::string dir, synthetic_options o);
+
+/**
+ * @brief Create a data cube view that covers all tiles and dates of a synthetic collection
+ * @param o options of the synthetic collection
+ * @param resolution pixel size of the view in meters
+ * @param revisit_factor temporal resolution of the view, as multiple of the revisit interval
+ */
+cube_view synthetic_view(synthetic_options o, double resolution, uint32_t revisit_factor = 1);
+
+/**
+ * @brief Parameters of a synthetic image collection index without any image files
+ *
+ * Images have footprints of footprint x footprint degrees on a global grid of tiles between 56°S and 72°N,
+ * acquisition dates are uniformly distributed over the given number of years starting in 2015.
+ */
+struct synthetic_index_options {
+    uint64_t nimages = 100000;  // number of image records
+    uint16_t nbands = 4;        // number of bands, i.e. gdalrefs per image
+    double footprint = 1.0;     // width and height of footprints in degrees
+    uint16_t years = 5;         // temporal extent in years
+    uint32_t seed = 42;
+
+    nlohmann::json to_json();
+};
+
+/**
+ * @brief Generate (or reuse) an image collection database with synthetic image records
+ * @details Records are inserted directly into the SQLite database in a single transaction, without opening any
+ * images with GDAL. If the file already exists and has been generated with identical options, it is reused.
+ * @param file output database file
+ * @param o options
+ * @return image collection
+ */
+std::shared_ptr<image_collection> synthetic_index(std::string file, synthetic_index_options o);
+
+}  // namespace bench
+}  // namespace gdalcubes
+
+#endif  //SYNTHETIC_H
@@ -0,0 +1,250 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "chunk_cache.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace gdalcubes {
+
+chunk_cache* chunk_cache::_instance = nullptr;
+std::mutex chunk_cache::_singleton_mutex;
+
+void chunk_cache::check_dir() {
+    std::string dir = config::instance()->get_chunk_cache_dir();
+    if (dir == _dir) return;
+
+    _dir = dir;
+    _entries.clear();
+    _lru.clear();
+    _size_bytes = 0;
+    if (_dir.empty()) return;
+
+    if (!filesystem::exists(_dir)) {
+        filesystem::mkdir_recursive(_dir);
+    }
+
+    // restore order of usage from file modification times
+    std::vector<std::pair<time_t, std::string>> files;
+    filesystem::iterate_directory(_dir, [&files](const std::string& p) {
+        if (filesystem::is_regular_file(p) && filesystem::extension(p) == "chunk") {
+            files.push_back(std::make_pair(filesystem::last_write_time(p), p));
+        }
+    });
+    std::sort(files.begin(), files.end());
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        std::string key = filesystem::stem(it->second);
+        _lru.push_front(key);
+        entry e;
+        e.lru_it = _lru.begin();
+        e.size = filesystem::file_size(it->second);
+        _entries[key] = e;
+        _size_bytes += e.size;
+    }
+    evict();
+}
+
+void chunk_cache::evict() {
+    while (_size_bytes > config::instance()->get_chunk_cache_max() && !_lru.empty()) {
+        std::string key = _lru.back();
+        auto it = _entries.find(key);
+        if (it != _entries.end()) {
+            _size_bytes -= it->second.size;
+            _entries.erase(it);
+        }
+        _lru.pop_back();
+        filesystem::remove(path(key));
+        ++_stats.evictions;
+    }
+}
+
+std::shared_ptr<chunk_data> chunk_cache::get(std::string key) {
+    std::string p;
+    {
+        std::lock_guard<std::mutex> lck(_m);
+        check_dir();
+        auto it = _entries.find(key);
+        if (it == _entries.end()) {
+            ++_stats.misses;
+            return nullptr;
+        }
+        _lru.splice(_lru.begin(), _lru, it->second.lru_it);
+        p = path(key);
+    }
+
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    std::ifstream is(p, std::ios::in | std::ios::binary);
+    chunk_size_btyx size = {{0, 0, 0, 0}};
+    is.read((char*)size.data(), sizeof(uint32_t) * 4);
+    bool ok = is.good();
+    if (ok && size[0] * size[1] * size[2] * size[3] > 0) {
+        void* buf = std::malloc(sizeof(double) * size[0] * size[1] * size[2] * size[3]);
+        is.read((char*)buf, sizeof(double) * size[0] * size[1] * size[2] * size[3]);
+        ok = is.good();
+        out->size(size);
+        out->buf(buf);
+    }
+    is.close();
+
+    std::lock_guard<std::mutex> lck(_m);
+    if (!ok) {
+        // file has been removed or is corrupt
+        GCBS_DEBUG("Failed to read chunk cache file '" + p + "'");
+        auto it = _entries.find(key);
+        if (it != _entries.end()) {
+            _size_bytes -= it->second.size;
+            _lru.erase(it->second.lru_it);
+            _entries.erase(it);
+        }
+        ++_stats.misses;
+        return nullptr;
+    }
+    utime(p.c_str(), NULL);  // persist order of usage
+    ++_stats.hits;
+    _stats.bytes_saved += out->total_size_bytes();
+    return out;
+}
+
+void chunk_cache::put(std::string key, std::shared_ptr<chunk_data> value) {
+    std::string p;
+    {
+        std::lock_guard<std::mutex> lck(_m);
+        check_dir();
+        if (_dir.empty()) return;
+        if (_entries.find(key) != _entries.end()) return;
+        p = path(key);
+    }
+
+    // write to a temporary file first such that concurrent readers never see incomplete files
+    std::string p_tmp = p + utils::generate_unique_filename(8, ".", ".tmp");
+    std::ofstream os(p_tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    chunk_size_btyx size = value->empty() ? chunk_size_btyx{{0, 0, 0, 0}} : value->size();
+    os.write((char*)size.data(), sizeof(uint32_t) * 4);
+    if (!value->empty()) {
+        os.write((char*)value->buf(), value->total_size_bytes());
+    }
+    os.close();
+    if (os.fail() || std::rename(p_tmp.c_str(), p.c_str()) != 0) {
+        GCBS_WARN("Failed to write chunk cache file '" + p + "'");
+        filesystem::remove(p_tmp);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lck(_m);
+    if (_entries.find(key) != _entries.end()) return;  // added concurrently
+    _lru.push_front(key);
+    entry e;
+    e.lru_it = _lru.begin();
+    e.size = sizeof(uint32_t) * 4 + value->total_size_bytes();
+    _entries[key] = e;
+    _size_bytes += e.size;
+    _stats.bytes_written += value->total_size_bytes();
+    evict();
+}
+
+void chunk_cache::clear() {
+    std::lock_guard<std::mutex> lck(_m);
+    check_dir();
+    for (auto it = _lru.begin(); it != _lru.end(); ++it) {
+        filesystem::remove(path(*it));
+    }
+    _entries.clear();
+    _lru.clear();
+    _size_bytes = 0;
+}
+
+std::string cached_cube::key_prefix() {
+    nlohmann::json j = _in_cube->make_constructible_json();
+    std::string s = j.dump();
+
+    // Add modification state of referenced files, such that cache entries
+    // are invalidated when image collections or chunk stores change
+    std::function<void(nlohmann::json&)> add_file_state;
+    add_file_state = [&s, &add_file_state](nlohmann::json& x) {
+        if (x.is_object() && x.count("cube_type") > 0) {
+            std::string f;
+            if (x["cube_type"] == "image_collection" && x.count("file") > 0) {
+                f = x["file"].get<std::string>();
+            } else if (x["cube_type"] == "chunk_store" && x.count("path") > 0) {
+                f = x["path"].get<std::string>();
+            }
+            if (!f.empty()) {
+                s += "|" + f + ":" + std::to_string(filesystem::last_write_time(f)) + ":" + std::to_string(filesystem::file_size(f));
+            }
+        }
+        if (x.is_structured()) {
+            for (auto it = x.begin(); it != x.end(); ++it) {
+                add_file_state(it.value());
+            }
+        }
+    };
+    add_file_state(j);
+
+    // keys persist across runs and builds, so a hash function with a fixed definition is needed (unlike std::hash);
+    // two 64 bit hashes with different seeds make collisions unlikely
+    xxhash64 h1(0), h2(0x9e3779b97f4a7c15ULL);
+    h1.update(s.data(), s.size());
+    h2.update(s.data(), s.size());
+    return h1.hexdigest() + "_" + h2.hexdigest();
+}
+
+std::shared_ptr<chunk_data> cached_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("cached_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "cached", id);
+    if (id >= count_chunks())
+        return std::make_shared<chunk_data>();  // chunk is outside of the view, we don't need to read anything.
+
+    if (!chunk_cache::enabled()) {
+        return _in_cube->read_chunk(id);
+    }
+
+    std::string key = cache_key(id);
+    if (key.empty()) {
+        return _in_cube->read_chunk(id);
+    }
+
+    std::shared_ptr<chunk_data> out = chunk_cache::instance()->get(key);
+    if (out) {
+        // cache files contain values only, validity information as provided by source cubes is computed on first use
+        out->defer_validity();
+        tm.bytes(out->total_size_bytes());
+        return out;
+    }
+    out = _in_cube->read_chunk(id);
+    if (out) {
+        chunk_cache::instance()->put(key, out);
+        tm.bytes(out->total_size_bytes());
+    }
+    return out;
+}
+
+}  // namespace gdalcubes
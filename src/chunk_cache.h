@@ -0,0 +1,255 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Statistics of the persistent chunk cache
+ */
+struct chunk_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytes_saved;    // size of chunks that have been served from the cache instead of being computed
+    uint64_t bytes_written;  // size of chunks that have been added to the cache
+    uint64_t evictions;
+
+    /**
+     * @brief Fraction of chunk reads that have been served from the cache
+     * @return hit ratio in [0,1], or 0 if the cache has not been used yet
+     */
+    double hit_ratio() {
+        return (hits + misses) > 0 ? (double)hits / (double)(hits + misses) : 0.0;
+    }
+};
+
+/**
+ * @brief A persistent, content-addressed singleton cache for chunk data on disk
+ *
+ * Chunks are stored as individual files in the directory returned by config::get_chunk_cache_dir(). Keys
+ * are derived from the JSON representation of a cube and the chunk id (see cached_cube), such that identical
+ * cubes share cache entries across runs. If the total size exceeds config::get_chunk_cache_max(), least recently used
+ * entries are removed. Usage is tracked by the modification time of files.
+ */
+class chunk_cache {
+   public:
+    /**
+     * @brief Get the singleton instance
+     * @return pointer to the singleton instance
+     */
+    static chunk_cache* instance() {
+        static GC g;
+        _singleton_mutex.lock();
+        if (!_instance) {
+            _instance = new chunk_cache();
+        }
+        _singleton_mutex.unlock();
+        return _instance;
+    }
+
+    /**
+     * @brief Check whether the cache is enabled in the global configuration
+     * @return true, if a cache directory has been set
+     */
+    static bool enabled() {
+        return !config::instance()->get_chunk_cache_dir().empty();
+    }
+
+    /**
+     * @brief Get chunk data from the cache
+     * @param key cache key
+     * @return chunk data, or a null pointer if the key is not in the cache
+     */
+    std::shared_ptr<chunk_data> get(std::string key);
+
+    /**
+     * @brief Add chunk data to the cache
+     * @param key cache key
+     * @param value chunk data, may be empty
+     */
+    void put(std::string key, std::shared_ptr<chunk_data> value);
+
+    /**
+     * @brief Remove all entries from the cache and delete corresponding files
+     */
+    void clear();
+
+    /**
+     * @brief Get the current total size of cached chunks on disk
+     * @return size in bytes
+     */
+    uint64_t size_bytes() {
+        std::lock_guard<std::mutex> lck(_m);
+        return _size_bytes;
+    }
+
+    /**
+     * @brief Get hit / miss statistics since program start or the last call of reset_stats()
+     */
+    chunk_cache_stats stats() {
+        std::lock_guard<std::mutex> lck(_m);
+        return _stats;
+    }
+
+    void reset_stats() {
+        std::lock_guard<std::mutex> lck(_m);
+        _stats = chunk_cache_stats{0, 0, 0, 0, 0};
+    }
+
+   private:
+    chunk_cache() : _dir(), _entries(), _lru(), _size_bytes(0), _stats{0, 0, 0, 0, 0}, _m() {}
+    ~chunk_cache() {}
+    chunk_cache(const chunk_cache&) = delete;
+
+    static chunk_cache* _instance;
+    static std::mutex _singleton_mutex;
+
+    struct entry {
+        std::list<std::string>::iterator lru_it;
+        uint64_t size;
+    };
+
+    std::string _dir;
+    std::unordered_map<std::string, entry> _entries;
+    std::list<std::string> _lru;  // most recently used at front
+    uint64_t _size_bytes;
+    chunk_cache_stats _stats;
+    std::mutex _m;
+
+    // (re)scan the cache directory if the configured directory has changed, _m must be locked
+    void check_dir();
+    void evict();
+    std::string path(std::string key) {
+        return filesystem::join(_dir, key + ".chunk");
+    }
+
+    class GC {
+       public:
+        ~GC() {
+            if (chunk_cache::_instance) {
+                delete chunk_cache::_instance;
+                chunk_cache::_instance = nullptr;
+            }
+        }
+    };
+};
+
+/**
+ * @brief A data cube that serves chunks of its input cube from the persistent chunk cache
+ *
+ * The cube is transparent, i.e., it has the same shape, bands, and JSON representation as its input cube. Cache keys
+ * combine a hash of the input cube's JSON representation, the modification state of referenced image collection and
+ * chunk store files, and the chunk id.
+ *
+ * @note If the cache is enabled in the global configuration, cube_factory wraps created root cubes and image collection
+ * cubes automatically (see cube_factory::create_from_json()).
+ * Chunk size, bands, and the cache key are derived from the input cube at construction, so the input cube must not be
+ * modified afterwards. Use unwrap() to inspect the type of the input cube.
+ */
+class cached_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube that caches chunks of another cube on disk
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<cached_cube> create(std::shared_ptr<cube> in) {
+        std::shared_ptr<cached_cube> out = std::make_shared<cached_cube>(in);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+   public:
+    cached_cube(std::shared_ptr<cube> in) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _key_prefix() {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
+        _chunk_size[0] = _in_cube->chunk_size()[0];
+        _chunk_size[1] = _in_cube->chunk_size()[1];
+        _chunk_size[2] = _in_cube->chunk_size()[2];
+        for (uint16_t ib = 0; ib < _in_cube->bands().count(); ++ib) {
+            _bands.add(_in_cube->bands().get(ib));
+        }
+        try {
+            _key_prefix = key_prefix();
+        } catch (std::string s) {
+            // e.g. cubes from temporary image collections cannot be serialized
+            GCBS_DEBUG("Cannot derive chunk cache key, chunks will not be cached: " + s);
+        }
+    }
+
+   public:
+    ~cached_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    chunk_status_type chunk_status(chunkid_t id) override {
+        return _in_cube->chunk_status(id);
+    }
+
+    nlohmann::json make_constructible_json() override {
+        return _in_cube->make_constructible_json();
+    }
+
+    std::shared_ptr<cube> unwrap() override {
+        return _in_cube->unwrap();
+    }
+
+    /**
+     * @brief Get the cache key of a chunk
+     * @param id chunk id
+     * @return key string, or an empty string if chunks of the input cube cannot be cached
+     */
+    std::string cache_key(chunkid_t id) {
+        return _key_prefix.empty() ? "" : _key_prefix + "_" + std::to_string(id);
+    }
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::string _key_prefix;  // computed once, the JSON representation of the input cube does not change
+
+    // hash of the input cube's JSON representation and the modification state of referenced files
+    std::string key_prefix();
+
+    virtual void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        // copy fields from st_reference type
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //CHUNK_CACHE_H
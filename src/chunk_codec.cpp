@@ -0,0 +1,220 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "chunk_codec.h"
+#include <cpl_conv.h>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+
+namespace gdalcubes {
+
+const std::string chunk_codec::MIME_TYPE = "application/x-gdalcubes-chunk";
+
+namespace {
+const uint8_t CHUNK_CODEC_VERSION = 2;
+const uint64_t CHUNK_CODEC_HEADER_SIZE = 4 + 4 + 4 * sizeof(uint32_t) + sizeof(uint64_t);
+}  // namespace
+
+std::vector<uint8_t> chunk_codec::encode(std::shared_ptr<chunk_data> dat, uint8_t compression_level, bool float32) {
+    uint8_t flags = 0;
+    std::array<uint32_t, 4> size = {0, 0, 0, 0};
+    uint64_t n = 0;
+    if (dat && !dat->empty()) {
+        size = dat->size();
+        n = uint64_t(size[0]) * size[1] * size[2] * size[3];
+    }
+
+    // the bitmask is taken from the chunk's validity information, chunks without are not modified because they may be
+    // shared by other threads (e.g. in the server chunk cache), a non-owning view of the buffer is used instead
+    std::shared_ptr<chunk_data> v = dat;
+    if (n > 0 && !dat->has_validity()) {
+        v = std::make_shared<chunk_data>();
+        v->size(size);
+        v->buf(dat->buf(), [](void *) {});
+        v->compute_validity();
+    }
+
+    uint64_t nvalid = 0;
+    for (uint16_t ib = 0; ib < size[0]; ++ib) {
+        v->for_each_valid(ib, [&nvalid](uint32_t, uint32_t, double) { ++nvalid; });
+    }
+    uint8_t value_size = float32 ? sizeof(float) : sizeof(double);
+    uint32_t nmasks = (n > 0 && v->validity_shared()) ? 1 : size[0];
+    uint64_t nwords = uint64_t(size[2]) * size[3] > 0 ? (uint64_t(size[2]) * size[3] + 63) / 64 : 0;
+    uint64_t mask_size = uint64_t(nmasks) * size[1] * nwords * sizeof(uint64_t);
+    bool use_mask = (n - nvalid) * value_size > mask_size;
+    if (float32) flags |= FLAG_FLOAT32;
+    if (use_mask) flags |= FLAG_MASK;
+    if (use_mask && nmasks == 1 && size[0] > 1) flags |= FLAG_MASK_SHARED;
+
+    // build uncompressed payload
+    std::vector<uint8_t> payload((use_mask ? mask_size : 0) + (use_mask ? nvalid : n) * value_size, 0);
+    uint8_t *out = payload.data() + (use_mask ? mask_size : 0);
+    uint64_t k = 0;
+    auto put = [&out, &k, float32](double x) {
+        if (float32) {
+            float f = x;
+            std::memcpy(out + k * sizeof(float), &f, sizeof(float));
+        } else {
+            std::memcpy(out + k * sizeof(double), &x, sizeof(double));
+        }
+        ++k;
+    };
+    if (use_mask) {
+        for (uint32_t im = 0; im < nmasks; ++im) {
+            for (uint32_t it = 0; it < size[1]; ++it) {
+                std::memcpy(payload.data() + (uint64_t(im) * size[1] + it) * nwords * sizeof(uint64_t), v->validity_mask(im, it), nwords * sizeof(uint64_t));
+            }
+        }
+        for (uint16_t ib = 0; ib < size[0]; ++ib) {
+            v->for_each_valid(ib, [&put](uint32_t, uint32_t, double x) { put(x); });
+        }
+    } else {
+        const double *values = n > 0 ? (const double *)dat->buf() : nullptr;
+        for (uint64_t i = 0; i < n; ++i) {
+            put(values[i]);
+        }
+    }
+
+    void *zbuf = nullptr;
+    const uint8_t *payload_ptr = payload.data();
+    uint64_t payload_length = payload.size();
+    if (compression_level > 0 && !payload.empty()) {
+        std::size_t nout = 0;
+        zbuf = CPLZLibDeflate(payload.data(), payload.size(), compression_level > 9 ? 9 : compression_level, nullptr, 0, &nout);
+        if (zbuf && nout < payload.size()) {
+            flags |= FLAG_DEFLATE;
+            payload_ptr = (const uint8_t *)zbuf;
+            payload_length = nout;
+        }
+    }
+
+    std::vector<uint8_t> res(CHUNK_CODEC_HEADER_SIZE + payload_length);
+    std::memcpy(res.data(), "GCCH", 4);
+    res[4] = CHUNK_CODEC_VERSION;
+    res[5] = flags;
+    res[6] = 0;
+    res[7] = 0;
+    std::memcpy(res.data() + 8, size.data(), 4 * sizeof(uint32_t));
+    std::memcpy(res.data() + 8 + 4 * sizeof(uint32_t), &payload_length, sizeof(uint64_t));
+    if (payload_length > 0) {
+        std::memcpy(res.data() + CHUNK_CODEC_HEADER_SIZE, payload_ptr, payload_length);
+    }
+    if (zbuf) VSIFree(zbuf);
+    return res;
+}
+
+std::shared_ptr<chunk_data> chunk_codec::decode(const void *data, uint64_t length) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    if (length < CHUNK_CODEC_HEADER_SIZE || std::memcmp(bytes, "GCCH", 4) != 0) {
+        throw std::string("ERROR in chunk_codec::decode(): invalid chunk encoding");
+    }
+    if (bytes[4] != CHUNK_CODEC_VERSION) {
+        throw std::string("ERROR in chunk_codec::decode(): unsupported chunk encoding version " + std::to_string(bytes[4]));
+    }
+    uint8_t flags = bytes[5];
+    std::array<uint32_t, 4> size;
+    std::memcpy(size.data(), bytes + 8, 4 * sizeof(uint32_t));
+    uint64_t payload_length;
+    std::memcpy(&payload_length, bytes + 8 + 4 * sizeof(uint32_t), sizeof(uint64_t));
+    if (length < CHUNK_CODEC_HEADER_SIZE + payload_length) {
+        throw std::string("ERROR in chunk_codec::decode(): incomplete chunk data");
+    }
+
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    out->size(size);
+    uint64_t n = uint64_t(size[0]) * size[1] * size[2] * size[3];
+    if (n == 0) {
+        return out;
+    }
+
+    const uint8_t *payload = bytes + CHUNK_CODEC_HEADER_SIZE;
+    void *inflated = nullptr;
+    if (flags & FLAG_DEFLATE) {
+        // the uncompressed size is not stored, the upper bound is a dense float64 array plus masks of all slices
+        std::size_t max_length = uint64_t(size[0]) * size[1] * ((uint64_t(size[2]) * size[3] + 63) / 64) * sizeof(uint64_t) + n * sizeof(double);
+        inflated = std::malloc(max_length);
+        std::size_t nout = 0;
+        if (!CPLZLibInflate(payload, payload_length, inflated, max_length, &nout)) {
+            std::free(inflated);
+            throw std::string("ERROR in chunk_codec::decode(): cannot decompress chunk data");
+        }
+        payload = (const uint8_t *)inflated;
+        payload_length = nout;
+    }
+
+    uint8_t value_size = (flags & FLAG_FLOAT32) ? sizeof(float) : sizeof(double);
+    uint32_t nxy = size[2] * size[3];
+    uint64_t nwords = (uint64_t(nxy) + 63) / 64;
+    uint32_t nmasks = (flags & FLAG_MASK_SHARED) ? 1 : size[0];
+    uint64_t mask_size = (flags & FLAG_MASK) ? uint64_t(nmasks) * size[1] * nwords * sizeof(uint64_t) : 0;
+    std::vector<uint64_t> mask;
+    uint64_t nvalues = (flags & FLAG_MASK) ? 0 : n;
+    if (flags & FLAG_MASK) {
+        if (payload_length < mask_size) {
+            if (inflated) std::free(inflated);
+            throw std::string("ERROR in chunk_codec::decode(): incomplete chunk data");
+        }
+        mask.resize(mask_size / sizeof(uint64_t));
+        std::memcpy(mask.data(), payload, mask_size);
+        for (uint64_t iw = 0; iw < mask.size(); ++iw) {
+            nvalues += std::bitset<64>(mask[iw]).count();
+        }
+        nvalues *= size[0] / nmasks;
+    }
+    const uint8_t *values = payload + mask_size;
+    if (payload_length < mask_size + nvalues * value_size) {
+        if (inflated) std::free(inflated);
+        throw std::string("ERROR in chunk_codec::decode(): incomplete chunk data");
+    }
+
+    double *buf = (double *)std::malloc(n * sizeof(double));
+    uint64_t k = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (flags & FLAG_MASK) {
+            // i = (b * nt + t) * nxy + ixy, masks are stored per band (or shared) and time slice
+            uint64_t slice = i / nxy;
+            uint64_t ixy = i % nxy;
+            if (flags & FLAG_MASK_SHARED) slice %= size[1];
+            if (!((mask[slice * nwords + ixy / 64] >> (ixy % 64)) & 1)) {
+                buf[i] = NAN;
+                continue;
+            }
+        }
+        if (flags & FLAG_FLOAT32) {
+            float v;
+            std::memcpy(&v, values + k * sizeof(float), sizeof(float));
+            buf[i] = v;
+        } else {
+            std::memcpy(&buf[i], values + k * sizeof(double), sizeof(double));
+        }
+        ++k;
+    }
+    if (inflated) std::free(inflated);
+    out->buf(buf);
+    return out;
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,77 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef CHUNK_CODEC_H
+#define CHUNK_CODEC_H
+
+#include <vector>
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Compact binary encoding of chunk data for network transfer
+ *
+ * Encoded chunks start with a 32 byte header containing the magic bytes "GCCH", a format version, flags,
+ * the chunk size (4 x uint32), and the length of the following payload (uint64). The payload contains
+ * optional validity bitmasks and all values (or only valid values if masks are present) as float64 or float32.
+ * The whole payload is optionally deflate compressed.
+ *
+ * Bitmasks are the validity masks of chunk_data (see chunk_data::compute_validity()) as 64 bit words in host byte order,
+ * one per band and time slice, or one per time slice if all bands share the same missing values. They are only added if
+ * they are smaller than the omitted NaN values, i.e. chunks with no or very few NaNs are stored as dense arrays.
+ */
+class chunk_codec {
+   public:
+    /**
+     * @brief MIME type of encoded chunks
+     */
+    static const std::string MIME_TYPE;
+
+    static const uint8_t FLAG_DEFLATE = 1;
+    static const uint8_t FLAG_FLOAT32 = 2;
+    static const uint8_t FLAG_MASK = 4;
+    static const uint8_t FLAG_MASK_SHARED = 8;
+
+    /**
+     * @brief Encode chunk data
+     * @param dat chunk data
+     * @param compression_level deflate compression level (0 = no compression, 1-9)
+     * @param float32 if true, values are converted to float32 (lossy)
+     * @return encoded bytes
+     */
+    static std::vector<uint8_t> encode(std::shared_ptr<chunk_data> dat, uint8_t compression_level = 1, bool float32 = false);
+
+    /**
+     * @brief Decode chunk data
+     * @param data pointer to encoded bytes
+     * @param length number of bytes
+     * @return decoded chunk data
+     */
+    static std::shared_ptr<chunk_data> decode(const void *data, uint64_t length);
+};
+
+}  // namespace gdalcubes
+
+#endif  //CHUNK_CODEC_H
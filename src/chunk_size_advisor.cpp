@@ -0,0 +1,162 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "chunk_size_advisor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace gdalcubes {
+
+namespace {
+
+template <typename T>
+T median(std::vector<T> x) {
+    if (x.empty()) return T();
+    std::sort(x.begin(), x.end());
+    return x[x.size() / 2];
+}
+
+// spatial chunk size along one axis in view pixels, covering a whole number of source blocks if possible
+uint32_t spatial_size(uint32_t block, double src_res, uint16_t overviews, double view_res, uint32_t n) {
+    const double target = 256;
+    double size = target;
+
+    // very small blocks (e.g. single-row strips of untiled GeoTIFFs) do not constrain the chunk size
+    if (block > 16 && src_res > 0 && view_res > 0) {
+        // GDAL reads from the overview level with resolution closest to but not coarser than the view
+        double eff_res = src_res;
+        double level = std::floor(std::log2(view_res / src_res));
+        if (level > 0) {
+            eff_res = src_res * std::pow(2.0, std::min(level, (double)overviews));
+        }
+        double footprint = block * eff_res / view_res;  // size of one block in view pixels
+        if (footprint >= 1) {
+            if (footprint > 4 * target) {
+                // blocks are much larger than useful chunks, split blocks evenly
+                size = footprint / std::ceil(footprint / (2 * target));
+            } else {
+                size = std::max(1.0, std::round(target / footprint)) * footprint;
+            }
+        }
+    }
+    return std::max((uint32_t)1, std::min(n, (uint32_t)std::round(size)));
+}
+
+}  // namespace
+
+source_layout chunk_size_advisor::sample_layout(std::shared_ptr<image_collection> ic, std::string srs, uint16_t n) {
+    source_layout out;
+    std::vector<uint32_t> bx, by, ov;
+    std::vector<double> rx, ry;
+
+    std::vector<image_collection::gdalrefs_row> refs = ic->get_gdalrefs_sample(n);
+    for (uint16_t i = 0; i < refs.size(); ++i) {
+        GDALDataset *g = (GDALDataset *)GDALOpen(refs[i].descriptor.c_str(), GA_ReadOnly);
+        if (!g) {
+            GCBS_DEBUG("Cannot open '" + refs[i].descriptor + "' to sample the layout of images");
+            continue;
+        }
+        if (refs[i].band_num < 1 || refs[i].band_num > g->GetRasterCount()) {
+            GDALClose(g);
+            continue;
+        }
+        GDALRasterBand *b = g->GetRasterBand(refs[i].band_num);
+        int bsx = 0, bsy = 0;
+        b->GetBlockSize(&bsx, &bsy);
+        bx.push_back(bsx);
+        by.push_back(bsy);
+        ov.push_back(b->GetOverviewCount());
+
+        double affine[6];
+        int nx = g->GetRasterXSize();
+        int ny = g->GetRasterYSize();
+        std::string s_srs = g->GetProjectionRef();
+        if (g->GetGeoTransform(affine) == CE_None && affine[2] == 0 && affine[4] == 0 && !s_srs.empty() && nx > 0 && ny > 0) {
+            bounds_2d<double> e;
+            e.left = affine[0];
+            e.right = affine[0] + nx * affine[1];
+            e.top = affine[3];
+            e.bottom = affine[3] + ny * affine[5];
+            try {
+                e = e.transform(s_srs, srs);
+                rx.push_back(std::fabs(e.right - e.left) / nx);
+                ry.push_back(std::fabs(e.top - e.bottom) / ny);
+            } catch (std::string s) {
+                GCBS_DEBUG(s);
+            }
+        }
+        GDALClose(g);
+    }
+
+    out.samples = bx.size();
+    out.block_x = median(bx);
+    out.block_y = median(by);
+    out.overviews = median(ov);
+    out.res_x = median(rx);
+    out.res_y = median(ry);
+    return out;
+}
+
+cube_size_tyx chunk_size_advisor::suggest(source_layout src, cube_view v, uint16_t nbands, std::vector<std::string> downstream, uint64_t memory_budget) {
+    bool time_series = false;
+    for (uint16_t i = 0; i < downstream.size(); ++i) {
+        if (downstream[i] == "reduce_time" || downstream[i] == "reduce" || downstream[i] == "stream_reduce_time" ||
+            downstream[i] == "stream_reduce_time_cube" ||
+            downstream[i] == "window_time" || downstream[i] == "fill_time") {
+            time_series = true;
+        }
+    }
+
+    cube_size_tyx out;
+    out[0] = time_series ? v.nt() : std::min(v.nt(), (uint32_t)16);
+    if (src.samples == 0) {
+        out[1] = std::min(v.ny(), (uint32_t)256);
+        out[2] = std::min(v.nx(), (uint32_t)256);
+    } else {
+        out[1] = spatial_size(src.block_y, src.res_y, src.overviews, v.dy(), v.ny());
+        out[2] = spatial_size(src.block_x, src.res_x, src.overviews, v.dx(), v.nx());
+    }
+    out[0] = std::max((uint32_t)1, out[0]);
+
+    if (memory_budget > 0) {
+        // time series operations profit more from long chunks than from large spatial chunks
+        const uint32_t min_spatial = 64;
+        if (time_series) {
+            while (chunk_memory(out, nbands) > memory_budget && (out[1] > min_spatial || out[2] > min_spatial)) {
+                if (out[1] > min_spatial) out[1] = std::max(min_spatial, out[1] / 2);
+                if (out[2] > min_spatial) out[2] = std::max(min_spatial, out[2] / 2);
+            }
+        }
+        while (chunk_memory(out, nbands) > memory_budget && out[0] > 1) {
+            out[0] = (out[0] + 1) / 2;
+        }
+        while (chunk_memory(out, nbands) > memory_budget && (out[1] > 1 || out[2] > 1)) {
+            out[1] = std::max((uint32_t)1, out[1] / 2);
+            out[2] = std::max((uint32_t)1, out[2] / 2);
+        }
+    }
+    return out;
+}
+
+}  // namespace gdalcubes
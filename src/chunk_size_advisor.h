@@ -0,0 +1,106 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef CHUNK_SIZE_ADVISOR_H
+#define CHUNK_SIZE_ADVISOR_H
+
+#include "cube.h"
+#include "image_collection.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Internal layout of images in a collection, as sampled from a few representative images
+ *
+ * Resolutions are given in units of the target spatial reference system, i.e. they are directly
+ * comparable to cube_view::dx() and cube_view::dy(). A value of 0 means unknown.
+ */
+struct source_layout {
+    uint32_t block_x = 0;
+    uint32_t block_y = 0;
+    uint16_t overviews = 0;
+    double res_x = 0;
+    double res_y = 0;
+    uint16_t samples = 0;
+
+    nlohmann::json as_json() {
+        nlohmann::json out;
+        out["block_size"] = {block_y, block_x};
+        out["overviews"] = overviews;
+        out["resolution"] = {res_y, res_x};
+        out["samples"] = samples;
+        return out;
+    }
+};
+
+/**
+ * @brief Suggests chunk sizes of image collection cubes
+ *
+ * The spatial chunk size is chosen such that a chunk covers a whole number of source blocks
+ * (e.g. GeoTIFF tiles) at the overview level GDAL will read for the resolution of the view, which avoids
+ * reading blocks that are shared by neighboring chunks multiple times. The temporal chunk size is the
+ * full time series if downstream operations work on complete time series (e.g. reduce_time, window_time,
+ * or fill_time), because otherwise each chunk of such cubes needs to read several input chunks. Finally,
+ * the chunk size is reduced until a chunk and the temporary buffers needed to read it fit into the memory
+ * budget of one worker thread.
+ */
+class chunk_size_advisor {
+   public:
+    /**
+     * @brief Inspect block sizes, overviews, and resolution of the first few images in a collection
+     * @param ic image collection
+     * @param srs target spatial reference system, resolutions are converted to this SRS
+     * @param n maximum number of images to open
+     * @return median block size, overview count, and resolution of the sampled images, samples is 0 if no image could be opened
+     */
+    static source_layout sample_layout(std::shared_ptr<image_collection> ic, std::string srs, uint16_t n = 5);
+
+    /**
+     * @brief Suggest a chunk size for an image collection cube
+     * @param src layout of images in the collection, see sample_layout()
+     * @param v data cube view
+     * @param nbands number of bands of the cube
+     * @param downstream cube types of operations that consume the cube, e.g. {"window_time", "reduce_time"}
+     * @param memory_budget maximum number of bytes per chunk including temporary buffers, 0 means unlimited
+     * @return chunk size (t, y, x)
+     */
+    static cube_size_tyx suggest(source_layout src, cube_view v, uint16_t nbands, std::vector<std::string> downstream, uint64_t memory_budget);
+
+    /**
+     * @brief Estimate the memory needed to read one chunk of an image collection cube
+     *
+     * This includes the chunk buffer itself and one image buffer with all bands plus mask of a single time slice.
+     * Chunk buffers always store doubles, independent of the data type of the images.
+     * @param size chunk size (t, y, x)
+     * @param nbands number of bands
+     * @return number of bytes
+     */
+    static uint64_t chunk_memory(cube_size_tyx size, uint16_t nbands) {
+        return sizeof(double) * ((uint64_t)nbands * size[0] * size[1] * size[2] + (uint64_t)(nbands + 1) * size[1] * size[2]);
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //CHUNK_SIZE_ADVISOR_H
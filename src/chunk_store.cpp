@@ -0,0 +1,205 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "chunk_store.h"
+
+#include <cstring>
+#include <fstream>
+#include "filesystem.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace gdalcubes {
+
+chunk_store_cube::chunk_store_cube(std::string path) : cube(), _path(filesystem::make_absolute(path)), _data_type("float64"), _compression_level(0), _source(), _index(), _fd(-1), _mutex() {
+    if (!filesystem::is_regular_file(path)) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): chunk store file '" + path + "' does not exist.");
+    }
+
+    std::ifstream is(path, std::ios::in | std::ios::binary);
+    if (!is.good()) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): cannot open chunk store file '" + path + "'.");
+    }
+    is.seekg(0, std::ios::end);
+    uint64_t file_size = is.tellg();
+    const uint64_t trailer_size = 3 * sizeof(uint64_t) + 8;
+    if (file_size < 8 + trailer_size) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): '" + path + "' is not a valid chunk store file.");
+    }
+
+    char magic[8];
+    is.seekg(0, std::ios::beg);
+    is.read(magic, 8);
+    if (std::strncmp(magic, CHUNK_STORE_MAGIC, 8) != 0) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): '" + path + "' is not a valid chunk store file.");
+    }
+
+    uint64_t json_offset, json_length, index_offset;
+    is.seekg(file_size - trailer_size, std::ios::beg);
+    is.read((char *)&json_offset, sizeof(uint64_t));
+    is.read((char *)&json_length, sizeof(uint64_t));
+    is.read((char *)&index_offset, sizeof(uint64_t));
+    is.read(magic, 8);
+    if (!is.good() || std::strncmp(magic, CHUNK_STORE_MAGIC, 8) != 0) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): '" + path + "' is incomplete or corrupt.");
+    }
+
+    std::string json_str(json_length, '\0');
+    is.seekg(json_offset, std::ios::beg);
+    is.read(&json_str[0], json_length);
+    nlohmann::json j = nlohmann::json::parse(json_str);
+
+    _st_ref = std::make_shared<cube_view>(cube_view::read_json_string(j["view"].dump()));
+    _chunk_size = {j["chunk_size"][0].get<uint32_t>(), j["chunk_size"][1].get<uint32_t>(), j["chunk_size"][2].get<uint32_t>()};
+    for (auto &jb : j["bands"]) {
+        band b(jb["name"].get<std::string>());
+        b.type = jb["type"].get<std::string>();
+        b.offset = jb["offset"].get<double>();
+        b.scale = jb["scale"].get<double>();
+        b.unit = jb["unit"].get<std::string>();
+        b.no_data_value = jb["no_data_value"].get<std::string>();
+        _bands.add(b);
+    }
+    _data_type = j["data_type"].get<std::string>();
+    _compression_level = j["compression_level"].get<uint8_t>();
+    if (j.count("source") > 0) {
+        _source = j["source"];
+    }
+
+    uint32_t nchunks = j["nchunks"].get<uint32_t>();
+    if (nchunks != count_chunks()) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): number of stored chunks does not match the cube geometry.");
+    }
+    _index.resize(nchunks);
+    is.seekg(index_offset, std::ios::beg);
+    is.read((char *)_index.data(), nchunks * sizeof(chunk_store_entry));
+    if (!is.good()) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): cannot read chunk index from '" + path + "'.");
+    }
+    is.close();
+
+#ifndef _WIN32
+    _fd = open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        throw std::string("ERROR in chunk_store_cube::chunk_store_cube(): cannot open chunk store file '" + path + "'.");
+    }
+#endif
+}
+
+chunk_store_cube::~chunk_store_cube() {
+#ifndef _WIN32
+    if (_fd >= 0) close(_fd);
+#endif
+}
+
+void chunk_store_cube::read_bytes(uint64_t offset, uint64_t length, void *dst) {
+#ifndef _WIN32
+    uint64_t nread = 0;
+    while (nread < length) {
+        ssize_t res = pread(_fd, (char *)dst + nread, length - nread, offset + nread);
+        if (res <= 0) {
+            throw std::string("ERROR in chunk_store_cube::read_bytes(): cannot read from chunk store file '" + _path + "'.");
+        }
+        nread += res;
+    }
+#else
+    std::lock_guard<std::mutex> lck(_mutex);
+    std::ifstream is(_path, std::ios::in | std::ios::binary);
+    is.seekg(offset, std::ios::beg);
+    is.read((char *)dst, length);
+    if (!is.good()) {
+        throw std::string("ERROR in chunk_store_cube::read_bytes(): cannot read from chunk store file '" + _path + "'.");
+    }
+#endif
+}
+
+std::shared_ptr<chunk_data> chunk_store_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("chunk_store_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "chunk_store", id);
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id >= count_chunks() || id >= _index.size())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    chunk_store_entry &e = _index[id];
+    if (e.length == 0) {
+        return out;  // empty chunk
+    }
+    uint64_t nvalues = (uint64_t)e.size[0] * e.size[1] * e.size[2] * e.size[3];
+
+#ifndef _WIN32
+    if (_data_type == "float64" && _compression_level == 0) {
+        // Map the chunk directly instead of copying data. The mapping is private (copy on write), i.e.
+        // consumers may still modify the buffer without changing the file.
+        uint64_t pagesize = sysconf(_SC_PAGESIZE);
+        uint64_t map_offset = e.offset - (e.offset % pagesize);
+        std::size_t map_length = e.length + (e.offset - map_offset);
+        void *base = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, _fd, map_offset);
+        if (base == MAP_FAILED) {
+            throw std::string("ERROR in chunk_store_cube::read_chunk(): cannot map chunk " + std::to_string(id) + " of '" + _path + "'.");
+        }
+        out->size(e.size);
+        out->buf((void *)((char *)base + (e.offset - map_offset)), [base, map_length](void *) {
+            munmap(base, map_length);
+        });
+        tm.bytes(out->total_size_bytes());
+        return out;
+    }
+#endif
+
+    void *buf = std::malloc(e.length);
+    read_bytes(e.offset, e.length, buf);
+
+    if (_compression_level > 0) {
+        std::size_t expected_length = nvalues * ((_data_type == "float32") ? sizeof(float) : sizeof(double));
+        void *inflated = std::malloc(expected_length);
+        std::size_t nout = 0;
+        if (!CPLZLibInflate(buf, e.length, inflated, expected_length, &nout) || nout != expected_length) {
+            std::free(buf);
+            std::free(inflated);
+            throw std::string("ERROR in chunk_store_cube::read_chunk(): cannot decompress chunk " + std::to_string(id) + " of '" + _path + "'.");
+        }
+        std::free(buf);
+        buf = inflated;
+    }
+
+    if (_data_type == "float32") {
+        double *dbuf = (double *)std::malloc(nvalues * sizeof(double));
+        for (uint64_t i = 0; i < nvalues; ++i) {
+            dbuf[i] = ((float *)buf)[i];
+        }
+        std::free(buf);
+        buf = dbuf;
+    }
+
+    out->size(e.size);
+    out->buf(buf);
+    tm.bytes(out->total_size_bytes());
+    return out;
+}
+
+}  // namespace gdalcubes
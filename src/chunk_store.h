@@ -0,0 +1,124 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef CHUNK_STORE_H
+#define CHUNK_STORE_H
+
+#include "cube.h"
+
+/*
+ * A chunk store file consists of
+ * 1. the magic bytes CHUNK_STORE_MAGIC,
+ * 2. chunk data (one record per non-empty chunk in arbitrary order, each starting at a multiple of 8 bytes),
+ * 3. a JSON metadata string (view, bands, chunk size, data type, compression),
+ * 4. the binary chunk index (one chunk_store_entry per chunk id), and
+ * 5. a trailer with offset and length of the JSON string, offset of the index, and CHUNK_STORE_MAGIC again.
+ *
+ * All numbers are stored in native byte order.
+ */
+#define CHUNK_STORE_MAGIC "GCBSCS01"
+
+namespace gdalcubes {
+
+/**
+ * @brief Index entry of a single chunk in a chunk store file
+ */
+struct chunk_store_entry {
+    uint64_t offset;
+    uint64_t length;  // number of stored bytes, 0 for empty chunks
+    chunk_size_btyx size;
+};
+
+/**
+ * @brief A data cube that reads chunks from a chunk store file as written by cube::materialize()
+ */
+class chunk_store_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube from a chunk store file
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param path path to the chunk store file
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<chunk_store_cube> create(std::string path) {
+        std::shared_ptr<chunk_store_cube> out = std::make_shared<chunk_store_cube>(path);
+        return out;
+    }
+
+   public:
+    chunk_store_cube(std::string path);
+
+   public:
+    ~chunk_store_cube();
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    /**
+     * @brief Chunks that have been stored without data are empty, all other chunks have unknown status
+     */
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (id >= count_chunks() || id >= _index.size() || _index[id].length == 0) return chunk_status_type::EMPTY;
+        return chunk_status_type::UNKNOWN;
+    }
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "chunk_store";
+        out["path"] = _path;  // absolute, JSON may be loaded from a different working directory
+        return out;
+    }
+
+    /**
+     * @brief Get the JSON representation of the cube that has been materialized
+     * @return JSON object as created by make_constructible_json() of the original cube, may be null
+     */
+    inline nlohmann::json source() { return _source; }
+
+   private:
+    std::string _path;
+    std::string _data_type;
+    uint8_t _compression_level;
+    nlohmann::json _source;
+    std::vector<chunk_store_entry> _index;
+    int _fd;
+    std::mutex _mutex;
+
+    void read_bytes(uint64_t offset, uint64_t length, void *dst);
+
+    virtual void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        // copy fields from st_reference type
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  //CHUNK_STORE_H
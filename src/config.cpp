@@ -38,6 +38,11 @@ config::config() : _chunk_processor(std::make_shared<chunk_processor_singlethrea
                    _swarm_curl_verbose(false),
                    _gdal_num_threads(1),
                    _streaming_dir(filesystem::get_tempdir()),
+                   _streaming_shm_max((uint64_t)1024 * 1024 * 256),  // 256 MiB
+                   _chunk_cache_dir(""),
+                   _chunk_cache_max((uint64_t)1024 * 1024 * 1024 * 4),  // 4 GiB
+                   _auto_chunk_size(true),
+                   _chunk_memory_budget((uint64_t)1024 * 1024 * 256),  // 256 MiB
                    _collection_format_preset_dirs() {}
 
 version_info config::get_version_info() {
@@ -32,6 +32,7 @@
 #include "error.h"
 #include "filesystem.h"
 #include "progress.h"
+#include "trace.h"
 
 namespace gdalcubes {
 
@@ -140,6 +141,34 @@ class config {
     inline std::string get_streaming_dir() { return _streaming_dir; }
     inline void set_streaming_dir(std::string dir) { _streaming_dir = dir; }
 
+    // Get / set the shared memory that streaming input files of all worker threads may use, larger inputs are written to the streaming directory
+    inline void set_streaming_shm_max(uint64_t size_bytes) { _streaming_shm_max = size_bytes; }
+    inline uint64_t get_streaming_shm_max() { return _streaming_shm_max; }
+
+    // Get / set directory of the persistent chunk cache, the cache is disabled if the directory is empty
+    inline std::string get_chunk_cache_dir() { return _chunk_cache_dir; }
+    inline void set_chunk_cache_dir(std::string dir) { _chunk_cache_dir = dir; }
+
+    inline void set_chunk_cache_max(uint64_t size_bytes) { _chunk_cache_max = size_bytes; }
+    inline uint64_t get_chunk_cache_max() { return _chunk_cache_max; }
+
+    // Enable / disable automatic selection of chunk sizes for image collection cubes that cube_factory creates from JSON without chunk_size, see chunk_size_advisor
+    inline void set_auto_chunk_size(bool enabled) { _auto_chunk_size = enabled; }
+    inline bool get_auto_chunk_size() { return _auto_chunk_size; }
+
+    // Get / set the memory a single worker thread may use for one chunk including temporary buffers, used to limit automatically selected chunk sizes
+    inline void set_chunk_memory_budget(uint64_t size_bytes) { _chunk_memory_budget = size_bytes; }
+    inline uint64_t get_chunk_memory_budget() { return _chunk_memory_budget; }
+
+    // Enable / disable recording of trace spans, see trace
+    inline void set_trace(bool enabled) {
+        if (enabled)
+            trace::start();
+        else
+            trace::stop();
+    }
+    inline bool get_trace() { return trace::enabled(); }
+
     inline bool get_gdal_debug() { return _gdal_debug; }
     inline void set_gdal_debug(bool debug) {
         _gdal_debug = debug;
@@ -261,6 +290,11 @@ class config {
     uint16_t _gdal_num_threads;
     bool _gdal_debug;
     std::string _streaming_dir;
+    uint64_t _streaming_shm_max;
+    std::string _chunk_cache_dir;
+    uint64_t _chunk_cache_max;
+    bool _auto_chunk_size;
+    uint64_t _chunk_memory_budget;
     std::vector<std::string> _collection_format_preset_dirs;
 
    private:
@@ -28,8 +28,13 @@ SOFTWARE.
 #include <gdal_utils.h>  // for GDAL translate
 #include <netcdf.h>
 #include <algorithm>  // std::transform
+#include <fstream>
+#include <functional>
+#include <map>
 #include "build_info.h"
+#include "chunk_store.h"
 #include "filesystem.h"
+#include "hash.h"
 
 #if defined(R_PACKAGE) && defined(__sun) && defined(__SVR4)
 #define USE_NCDF4 0
@@ -41,6 +46,425 @@ SOFTWARE.
 
 namespace gdalcubes {
 
+void chunk_data::build_validity() {
+    reset_validity();
+    if (empty()) return;
+    uint32_t nt = _size[1];
+    uint32_t nxy = _size[2] * _size[3];
+    uint32_t nw = validity_words();
+    _slice_validity.resize((uint64_t)_size[0] * nt);
+    _validity_mask.assign((uint64_t)_size[0] * nt * nw, 0);
+
+    double *x = (double *)_buf;
+    for (uint16_t ib = 0; ib < _size[0]; ++ib) {
+        for (uint32_t it = 0; it < nt; ++it) {
+            uint64_t *m = _validity_mask.data() + ((uint64_t)ib * nt + it) * nw;
+            uint32_t nvalid = 0;
+            for (uint32_t ixy = 0; ixy < nxy; ++ixy, ++x) {
+                if (!std::isnan(*x)) {
+                    m[ixy / 64] |= (uint64_t)1 << (ixy % 64);
+                    ++nvalid;
+                }
+            }
+            slice_validity s = slice_validity::MIXED;
+            if (nvalid == 0) {
+                s = slice_validity::ALL_MISSING;
+            } else if (nvalid == nxy) {
+                s = slice_validity::ALL_VALID;
+            }
+            _slice_validity[(uint64_t)ib * nt + it] = (uint8_t)s;
+        }
+    }
+
+    // keep only one bitmask if all bands have the same missing values
+    if (_size[0] > 1) {
+        uint64_t n = (uint64_t)nt * nw;
+        for (uint16_t ib = 1; ib < _size[0]; ++ib) {
+            if (!std::equal(_validity_mask.begin(), _validity_mask.begin() + n, _validity_mask.begin() + ib * n)) return;
+        }
+        _validity_mask.resize(n);
+        _slice_validity.resize(nt);
+        _validity_shared = true;
+    }
+}
+
+namespace {
+
+/**
+ * @brief Sidecar journal of chunks that have been completely written by an export
+ *
+ * The first line identifies the export (cube and export parameters), all following lines
+ * contain ids of completed chunks. The journal is removed after an export has finished
+ * successfully.
+ */
+class export_journal {
+   public:
+    export_journal(std::string path, std::string key) : _path(path), _key(key), _os(), _m() {}
+
+    /**
+     * @brief Open the journal for writing
+     * @param resume if true and the journal refers to the same export, completed chunks are kept
+     * @return set of chunk ids that have been completed by a previous run
+     */
+    std::set<chunkid_t> open(bool resume) {
+        std::set<chunkid_t> done;
+        if (resume && filesystem::is_regular_file(_path)) {
+            std::ifstream is(_path);
+            std::string line;
+            if (std::getline(is, line) && line == _key) {
+                while (std::getline(is, line)) {
+                    if (line.empty()) continue;  // incomplete last line
+                    try {
+                        done.insert(std::stoul(line));
+                    } catch (...) {
+                        break;
+                    }
+                }
+            } else {
+                GCBS_INFO("Journal '" + _path + "' does not match the current export, starting from scratch");
+            }
+        }
+        if (_os.is_open()) {
+            _os.close();
+        }
+        if (done.empty()) {
+            _os.open(_path, std::ios::out | std::ios::trunc);
+            _os << _key << std::endl;
+        } else {
+            _os.open(_path, std::ios::out | std::ios::app);
+            _os << std::endl;  // terminate a possibly incomplete last line
+        }
+        if (!_os.good()) {
+            GCBS_WARN("Failed to open journal '" + _path + "', interrupted exports cannot be resumed");
+        }
+        return done;
+    }
+
+    /**
+     * @brief Mark a chunk as completed, output data of the chunk must already be flushed to disk
+     * @param id chunk id
+     */
+    void add(chunkid_t id) {
+        std::lock_guard<std::mutex> lck(_m);
+        _os << id << std::endl;
+    }
+
+    /**
+     * @brief Close and remove the journal after a successful export
+     */
+    void finish() {
+        _os.close();
+        filesystem::remove(_path);
+    }
+
+   private:
+    std::string _path;
+    std::string _key;
+    std::ofstream _os;
+    std::mutex _m;
+};
+
+/**
+ * @brief Derive a key that identifies an export of a cube from its JSON representation and export parameters
+ * @return key string, or an empty string if the cube cannot be serialized
+ */
+std::string export_key(std::shared_ptr<cube> c, std::string params) {
+    try {
+        std::string s = c->make_constructible_json().dump() + "|" + params + "|" +
+                        std::to_string(c->chunk_size()[0]) + "," + std::to_string(c->chunk_size()[1]) + "," + std::to_string(c->chunk_size()[2]);
+        // journals must still match after rebuilding or upgrading gdalcubes, so std::hash cannot be used here
+        xxhash64 h1(0), h2(0x9e3779b97f4a7c15ULL);
+        h1.update(s.data(), s.size());
+        h2.update(s.data(), s.size());
+        return "gdalcubes_export " + h1.hexdigest() + "_" + h2.hexdigest();
+    } catch (std::string s) {
+        GCBS_WARN("Cannot derive JSON representation of the cube, export cannot be resumed: " + s);
+        return "";
+    }
+}
+
+/**
+ * @brief A cube that does not compute chunks that have been written by a previous export
+ *
+ * Skipped chunks are returned as empty chunks, all other chunks are read from the input cube.
+ */
+class resume_cube : public cube {
+   public:
+    resume_cube(std::shared_ptr<cube> in, std::set<chunkid_t> skip) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _skip(skip) {
+        _chunk_size[0] = _in_cube->chunk_size()[0];
+        _chunk_size[1] = _in_cube->chunk_size()[1];
+        _chunk_size[2] = _in_cube->chunk_size()[2];
+        for (uint16_t ib = 0; ib < _in_cube->bands().count(); ++ib) {
+            _bands.add(_in_cube->bands().get(ib));
+        }
+    }
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override {
+        if (_skip.count(id) > 0) {
+            return std::make_shared<chunk_data>();
+        }
+        return _in_cube->read_chunk(id);
+    }
+
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (_skip.count(id) > 0) {
+            return chunk_status_type::EMPTY;
+        }
+        return _in_cube->chunk_status(id);
+    }
+
+    nlohmann::json make_constructible_json() override {
+        return _in_cube->make_constructible_json();
+    }
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::set<chunkid_t> _skip;
+
+    void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+    }
+};
+
+/**
+ * @brief Create a netCDF file with dimensions, coordinate variables, and one variable per band of a cube
+ * @param c cube to export
+ * @param path output file, existing files are overwritten
+ * @param ot netCDF data type of band variables
+ * @param v_bands ids of created band variables
+ * @return netCDF id of the opened file
+ */
+int create_netcdf_file(std::shared_ptr<cube> c, std::string path, int ot, uint8_t compression_level, bool write_bounds,
+                       const packed_export &packing, std::vector<int> &v_bands) {
+    int ncout;
+    double *dim_x = (double *)std::calloc(c->size_x(), sizeof(double));
+    double *dim_y = (double *)std::calloc(c->size_y(), sizeof(double));
+    int *dim_t = (int *)std::calloc(c->size_t(), sizeof(int));
+
+    double *dim_x_bnds = nullptr;
+    double *dim_y_bnds = nullptr;
+    int *dim_t_bnds = nullptr;
+
+    if (write_bounds) {
+        dim_x_bnds = (double *)std::calloc(c->size_x() * 2, sizeof(double));
+        dim_y_bnds = (double *)std::calloc(c->size_y() * 2, sizeof(double));
+        dim_t_bnds = (int *)std::calloc(c->size_t() * 2, sizeof(int));
+    }
+
+    for (uint32_t i = 0; i < c->size_t(); ++i) {
+        dim_t[i] = (i * c->st_reference()->dt().dt_interval);
+    }
+    for (uint32_t i = 0; i < c->size_y(); ++i) {
+        dim_y[i] = c->st_reference()->win().bottom + c->size_y() * c->st_reference()->dy() - (i + 0.5) * c->st_reference()->dy();  // cell center
+    }
+    for (uint32_t i = 0; i < c->size_x(); ++i) {
+        dim_x[i] = c->st_reference()->win().left + (i + 0.5) * c->st_reference()->dx();
+    }
+
+    if (write_bounds) {
+        for (uint32_t i = 0; i < c->size_t(); ++i) {
+            dim_t_bnds[2 * i] = (i * c->st_reference()->dt().dt_interval);
+            dim_t_bnds[2 * i + 1] = ((i + 1) * c->st_reference()->dt().dt_interval);
+        }
+        for (uint32_t i = 0; i < c->size_y(); ++i) {
+            dim_y_bnds[2 * i] = c->st_reference()->win().bottom + c->size_y() * c->st_reference()->dy() - (i)*c->st_reference()->dy();
+            dim_y_bnds[2 * i + 1] = c->st_reference()->win().bottom + c->size_y() * c->st_reference()->dy() - (i + 1) * c->st_reference()->dy();
+        }
+        for (uint32_t i = 0; i < c->size_x(); ++i) {
+            dim_x_bnds[2 * i] = c->st_reference()->win().left + (i + 0) * c->st_reference()->dx();
+            dim_x_bnds[2 * i + 1] = c->st_reference()->win().left + (i + 1) * c->st_reference()->dx();
+        }
+    }
+
+    OGRSpatialReference srs = c->st_reference()->srs_ogr();
+    std::string yname = srs.IsProjected() ? "y" : "latitude";
+    std::string xname = srs.IsProjected() ? "x" : "longitude";
+
+#if USE_NCDF4 == 1
+    nc_create(path.c_str(), NC_NETCDF4, &ncout);
+#else
+    nc_create(path.c_str(), NC_CLASSIC_MODEL, &ncout);
+#endif
+
+    int d_t, d_y, d_x;
+    nc_def_dim(ncout, "time", c->size_t(), &d_t);
+    nc_def_dim(ncout, yname.c_str(), c->size_y(), &d_y);
+    nc_def_dim(ncout, xname.c_str(), c->size_x(), &d_x);
+
+    int d_bnds = -1;
+    if (write_bounds) {
+        nc_def_dim(ncout, "nv", 2, &d_bnds);
+    }
+
+    int v_t, v_y, v_x;
+    nc_def_var(ncout, "time", NC_INT, 1, &d_t, &v_t);
+    nc_def_var(ncout, yname.c_str(), NC_DOUBLE, 1, &d_y, &v_y);
+    nc_def_var(ncout, xname.c_str(), NC_DOUBLE, 1, &d_x, &v_x);
+
+    int v_tbnds, v_ybnds, v_xbnds;
+    int d_tbnds[] = {d_t, d_bnds};
+    int d_ybnds[] = {d_y, d_bnds};
+    int d_xbnds[] = {d_x, d_bnds};
+    if (write_bounds) {
+        nc_def_var(ncout, "time_bnds", NC_INT, 2, d_tbnds, &v_tbnds);
+        nc_def_var(ncout, "y_bnds", NC_DOUBLE, 2, d_ybnds, &v_ybnds);
+        nc_def_var(ncout, "x_bnds", NC_DOUBLE, 2, d_xbnds, &v_xbnds);
+    }
+
+    std::string att_source = "gdalcubes " + std::to_string(GDALCUBES_VERSION_MAJOR) + "." + std::to_string(GDALCUBES_VERSION_MINOR) + "." + std::to_string(GDALCUBES_VERSION_PATCH);
+
+    nc_put_att_text(ncout, NC_GLOBAL, "Conventions", strlen("CF-1.6"), "CF-1.6");
+    nc_put_att_text(ncout, NC_GLOBAL, "source", strlen(att_source.c_str()), att_source.c_str());
+
+    // write json graph as metadata
+    //    std::string j = make_constructible_json().dump();
+    //    nc_put_att_text(ncout, NC_GLOBAL, "process_graph", j.length(), j.c_str());
+
+    char *wkt;
+    srs.exportToWkt(&wkt);
+
+    double geoloc_array[6] = {c->st_reference()->left(), c->st_reference()->dx(), 0.0, c->st_reference()->top(), 0.0, c->st_reference()->dy()};
+    nc_put_att_text(ncout, NC_GLOBAL, "spatial_ref", strlen(wkt), wkt);
+    nc_put_att_double(ncout, NC_GLOBAL, "GeoTransform", NC_DOUBLE, 6, geoloc_array);
+
+    std::string dtunit_str;
+    if (c->st_reference()->dt().dt_unit == datetime_unit::YEAR) {
+        dtunit_str = "years";  // WARNING: UDUNITS defines a year as 365.2425 days
+    } else if (c->st_reference()->dt().dt_unit == datetime_unit::MONTH) {
+        dtunit_str = "months";  // WARNING: UDUNITS defines a month as 1/12 year
+    } else if (c->st_reference()->dt().dt_unit == datetime_unit::DAY) {
+        dtunit_str = "days";
+    } else if (c->st_reference()->dt().dt_unit == datetime_unit::HOUR) {
+        dtunit_str = "hours";
+    } else if (c->st_reference()->dt().dt_unit == datetime_unit::MINUTE) {
+        dtunit_str = "minutes";
+    } else if (c->st_reference()->dt().dt_unit == datetime_unit::SECOND) {
+        dtunit_str = "seconds";
+    }
+    dtunit_str += " since ";
+    dtunit_str += c->st_reference()->t0().to_string(datetime_unit::SECOND);
+
+    nc_put_att_text(ncout, v_t, "units", strlen(dtunit_str.c_str()), dtunit_str.c_str());
+    nc_put_att_text(ncout, v_t, "calendar", strlen("gregorian"), "gregorian");
+    nc_put_att_text(ncout, v_t, "long_name", strlen("time"), "time");
+    nc_put_att_text(ncout, v_t, "standard_name", strlen("time"), "time");
+
+    if (srs.IsProjected()) {
+        // GetLinearUnits(char **) is deprecated since GDAL 2.3.0
+#if GDAL_VERSION_MAJOR >= 2 && GDAL_VERSION_MINOR >= 3 && GDAL_VERSION_REV >= 0
+        const char *unit = nullptr;
+#else
+        char *unit = nullptr;
+#endif
+        srs.GetLinearUnits(&unit);
+
+        nc_put_att_text(ncout, v_y, "units", strlen(unit), unit);
+        nc_put_att_text(ncout, v_x, "units", strlen(unit), unit);
+
+        int v_crs;
+        nc_def_var(ncout, "crs", NC_INT, 0, NULL, &v_crs);
+        nc_put_att_text(ncout, v_crs, "grid_mapping_name", strlen("easting_northing"), "easting_northing");
+        nc_put_att_text(ncout, v_crs, "crs_wkt", strlen(wkt), wkt);
+
+    } else {
+        // char* unit;
+        // double scale = srs.GetAngularUnits(&unit);
+        nc_put_att_text(ncout, v_y, "units", strlen("degrees_north"), "degrees_north");
+        nc_put_att_text(ncout, v_y, "long_name", strlen("latitude"), "latitude");
+        nc_put_att_text(ncout, v_y, "standard_name", strlen("latitude"), "latitude");
+
+        nc_put_att_text(ncout, v_x, "units", strlen("degrees_east"), "degrees_east");
+        nc_put_att_text(ncout, v_x, "long_name", strlen("longitude"), "longitude");
+        nc_put_att_text(ncout, v_x, "standard_name", strlen("longitude"), "longitude");
+
+        int v_crs;
+        nc_def_var(ncout, "crs", NC_INT, 0, NULL, &v_crs);
+        nc_put_att_text(ncout, v_crs, "grid_mapping_name", strlen("latitude_longitude"), "latitude_longitude");
+        nc_put_att_text(ncout, v_crs, "crs_wkt", strlen(wkt), wkt);
+    }
+    CPLFree(wkt);
+    int d_all[] = {d_t, d_y, d_x};
+
+    for (uint16_t i = 0; i < c->bands().count(); ++i) {
+        int v;
+        nc_def_var(ncout, c->bands().get(i).name.c_str(), ot, 3, d_all, &v);
+        std::size_t csize[3] = {c->chunk_size()[0], c->chunk_size()[1], c->chunk_size()[2]};
+#if USE_NCDF4 == 1
+        nc_def_var_chunking(ncout, v, NC_CHUNKED, csize);
+#endif
+        if (compression_level > 0) {
+#if USE_NCDF4 == 1
+            nc_def_var_deflate(ncout, v, 1, 1, compression_level);  // TODO: experiment with shuffling
+#else
+            GCBS_WARN("gdalcubes has been built to write netCDF-3 classic model files, compression will be ignored.");
+#endif
+        }
+
+        if (!c->bands().get(i).unit.empty())
+            nc_put_att_text(ncout, v, "units", strlen(c->bands().get(i).unit.c_str()), c->bands().get(i).unit.c_str());
+
+        double pscale = c->bands().get(i).scale;
+        double poff = c->bands().get(i).offset;
+        double pNAN = NAN;
+
+        if (packing.type != packed_export::packing_type::PACK_NONE) {
+            if (packing.scale.size() > 1) {
+                pscale = packing.scale[i];
+                poff = packing.offset[i];
+                pNAN = packing.nodata[i];
+            } else {
+                pscale = packing.scale[0];
+                poff = packing.offset[0];
+                pNAN = packing.nodata[0];
+            }
+        }
+
+        nc_put_att_double(ncout, v, "scale_factor", NC_DOUBLE, 1, &pscale);
+        nc_put_att_double(ncout, v, "add_offset", NC_DOUBLE, 1, &poff);
+        nc_put_att_text(ncout, v, "type", strlen(c->bands().get(i).type.c_str()), c->bands().get(i).type.c_str());
+        nc_put_att_text(ncout, v, "grid_mapping", strlen("crs"), "crs");
+
+        // this doesn't seem to solve missing spatial reference for multitemporal nc files
+        //        nc_put_att_text(ncout, v, "spatial_ref", strlen(wkt), wkt);
+        //        nc_put_att_double(ncout, v, "GeoTransform", NC_DOUBLE, 6, geoloc_array);
+
+        nc_put_att_double(ncout, v, "_FillValue", ot, 1, &pNAN);
+
+        v_bands.push_back(v);
+    }
+
+    nc_enddef(ncout);  ////////////////////////////////////////////////////
+
+    nc_put_var(ncout, v_t, (void *)dim_t);
+    nc_put_var(ncout, v_y, (void *)dim_y);
+    nc_put_var(ncout, v_x, (void *)dim_x);
+
+    if (write_bounds) {
+        nc_put_var(ncout, v_tbnds, (void *)dim_t_bnds);
+        nc_put_var(ncout, v_ybnds, (void *)dim_y_bnds);
+        nc_put_var(ncout, v_xbnds, (void *)dim_x_bnds);
+    }
+
+    if (dim_t) std::free(dim_t);
+    if (dim_y) std::free(dim_y);
+    if (dim_x) std::free(dim_x);
+
+    if (write_bounds) {
+        if (dim_t_bnds) std::free(dim_t_bnds);
+        if (dim_y_bnds) std::free(dim_y_bnds);
+        if (dim_x_bnds) std::free(dim_x_bnds);
+    }
+    return ncout;
+}
+
+}  // namespace
+
 void cube::write_chunks_gtiff(std::string dir, std::shared_ptr<chunk_processor> p) {
     if (!filesystem::exists(dir)) {
         filesystem::mkdir_recursive(dir);
@@ -108,7 +532,8 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
                                 std::string overview_resampling,
                                 packed_export packing,
                                 bool drop_empty_slices,
-                                std::shared_ptr<chunk_processor> p) {
+                                std::shared_ptr<chunk_processor> p,
+                                bool resume) {
     if (!overviews && cog) {
         overviews = true;
     }
@@ -184,6 +609,10 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
     } else {
         out_co.AddNameValue("BLOCKYSIZE", "256");
     }
+    // empty chunks are not written, their blocks remain sparse and are read as NoData
+    if (creation_options.find("SPARSE_OK") == creation_options.end()) {
+        out_co.AddNameValue("SPARSE_OK", "TRUE");
+    }
 
     for (auto it = creation_options.begin(); it != creation_options.end(); ++it) {
         std::string key = it->first;
@@ -196,10 +625,40 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         out_co.AddNameValue(it->first.c_str(), it->second.c_str());
     }
 
+    // for resumable exports, written chunks are tracked in a journal
+    std::shared_ptr<export_journal> journal = nullptr;
+    std::set<chunkid_t> done;
+    std::string key;
+    if (resume) {
+        std::string params = "tif|" + prefix + "|" + std::to_string(overviews) + "|" + std::to_string(cog) + "|" + std::to_string((int)packing.type);
+        for (auto it = creation_options.begin(); it != creation_options.end(); ++it) {
+            params += "|" + it->first + "=" + it->second;
+        }
+        key = export_key(shared_from_this(), params);
+    }
+    if (!key.empty()) {
+        journal = std::make_shared<export_journal>(filesystem::join(dir, prefix + "gdalcubes_export.journal"), key);
+        done = journal->open(resume);
+        for (uint32_t it = 0; it < size_t() && !done.empty(); ++it) {
+            std::string name = cog ? filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * it).to_string() + "_temp.tif") : filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * it).to_string() + ".tif");
+            if (!filesystem::is_regular_file(name)) {
+                GCBS_INFO("Output file '" + name + "' of previous export is missing, starting from scratch");
+                done = journal->open(false);
+            }
+        }
+        if (!done.empty()) {
+            GCBS_INFO("Resuming export, " + std::to_string(done.size()) + " of " + std::to_string(count_chunks()) + " chunks have already been written");
+        }
+    }
+
     // create all datasets
     for (uint32_t it = 0; it < size_t(); ++it) {
         std::string name = cog ? filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * it).to_string() + "_temp.tif") : filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * it).to_string() + ".tif");
 
+        if (!done.empty()) {
+            continue;  // datasets exist and already contain data of completed chunks
+        }
+
         GDALDataset *gdal_out = gtiff_driver->Create(name.c_str(), size_x(), size_y(), size_bands(), ot, out_co.List());
         char *wkt_out;
         OGRSpatialReference srs_out;
@@ -217,10 +676,10 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         GDALSetGeoTransform(gdal_out, affine);
         CPLFree(wkt_out);
 
-        // Setting NoData value seems to be not needed for Float64 GeoTIFFs
-        //gdal_out->GetRasterBand(1)->SetNoDataValue(NAN); // GeoTIFF supports only one NoData value for all bands
-
-        if (packing.type != packed_export::packing_type::PACK_NONE) {
+        if (packing.type == packed_export::packing_type::PACK_NONE) {
+            // needed to read sparse blocks of empty chunks as NAN instead of 0
+            gdal_out->GetRasterBand(1)->SetNoDataValue(NAN);  // GeoTIFF supports only one NoData value for all bands
+        } else {
             if (packing.scale.size() > 1) {
                 for (uint16_t ib = 0; ib < size_bands(); ++ib) {
                     gdal_out->GetRasterBand(ib + 1)->SetNoDataValue(packing.nodata[ib]);
@@ -238,11 +697,24 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         GDALClose((GDALDatasetH)gdal_out);
     }
 
-    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, dir, prg, &mtx, &prefix, &packing, cog, overviews](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, dir, prg, &mtx, &prefix, &packing, cog, overviews, &done, journal](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (done.count(id) > 0) {
+            prg->increment((overviews ? (double)0.5 : (double)1) / (double)this->count_chunks());
+            return;
+        }
         for (uint32_t it = 0; it < dat->size()[1]; ++it) {
             uint32_t cur_t_index = chunk_limits(id).low[0] + it;
             std::string name = cog ? filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * cur_t_index).to_string() + "_temp.tif") : filesystem::join(dir, prefix + (st_reference()->t0() + st_reference()->dt() * cur_t_index).to_string() + ".tif");
 
+            // slices without any data are not written, blocks of sparse files are read as NoData
+            std::vector<bool> skip_band(size_bands(), false);
+            bool skip_all = true;
+            for (uint16_t ib = 0; ib < size_bands(); ++ib) {
+                skip_band[ib] = dat->validity(ib, it) == chunk_data::slice_validity::ALL_MISSING;
+                skip_all = skip_all && skip_band[ib];
+            }
+            if (skip_all) continue;
+
             mtx[cur_t_index].lock();
             GDALDataset *gdal_out = (GDALDataset *)GDALOpen(name.c_str(), GA_Update);
             if (!gdal_out) {
@@ -254,6 +726,7 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
             // apply packing
             if (packing.type != packed_export::packing_type::PACK_NONE) {
                 for (uint16_t ib = 0; ib < size_bands(); ++ib) {
+                    if (skip_band[ib]) continue;
                     double cur_scale;
                     double cur_offset;
                     double cur_nodata;
@@ -282,19 +755,13 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
                         }
                     } */
 
-                    for (uint32_t i = 0; i < dat->size()[2] * dat->size()[3]; ++i) {
-                        double &v = ((double *)(dat->buf()))[ib * dat->size()[1] * dat->size()[2] * dat->size()[3] +
-                                                             it * dat->size()[2] * dat->size()[3] + i];
-                        if (std::isnan(v)) {
-                            v = cur_nodata;
-                        } else {
-                            v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                        }
-                    }
+                    packed_export::pack(((double *)(dat->buf())) + ib * dat->size()[1] * dat->size()[2] * dat->size()[3] + it * dat->size()[2] * dat->size()[3],
+                                        dat->size()[2] * dat->size()[3], cur_scale, cur_offset, cur_nodata);
                 }
             }  // if packing
 
             for (uint16_t ib = 0; ib < size_bands(); ++ib) {
+                if (skip_band[ib]) continue;
                 CPLErr res = gdal_out->GetRasterBand(ib + 1)->RasterIO(GF_Write, chunk_limits(id).low[2], size_y() - chunk_limits(id).high[1] - 1, dat->size()[3], dat->size()[2],
                                                                        ((double *)dat->buf()) + (ib * dat->size()[1] * dat->size()[2] * dat->size()[3] + it * dat->size()[2] * dat->size()[3]),
                                                                        dat->size()[3], dat->size()[2], GDT_Float64, 0, 0, NULL);
@@ -307,6 +774,9 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
             GDALClose(gdal_out);
             mtx[cur_t_index].unlock();
         }
+        if (journal) {
+            journal->add(id);
+        }
         if (overviews) {
             prg->increment((double)0.5 / (double)this->count_chunks());
         } else {
@@ -314,7 +784,11 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         }
     };
 
-    p->apply(shared_from_this(), f);
+    if (done.empty()) {
+        p->apply(shared_from_this(), f);
+    } else {
+        p->apply(std::make_shared<resume_cube>(shared_from_this(), done), f);
+    }
 
     // build overviews and convert to COG (with IFDs of overviews at the beginning of the file)
     // TODO: use multiple threads
@@ -401,18 +875,21 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         }
     }
 
+    if (journal) {
+        journal->finish();
+    }
     prg->set(1.0);
     prg->finalize();
 }
 
 void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool with_VRT, bool write_bounds,
-                             packed_export packing, bool drop_empty_slices, std::shared_ptr<chunk_processor> p) {
+                             packed_export packing, bool drop_empty_slices, std::shared_ptr<chunk_processor> p, bool resume) {
     std::string op = filesystem::make_absolute(path);
 
     if (filesystem::is_directory(op)) {
         throw std::string("ERROR in cube::write_netcdf_file(): output already exists and is a directory.");
     }
-    if (filesystem::is_regular_file(op)) {
+    if (filesystem::is_regular_file(op) && !resume) {
         GCBS_INFO("Existing file '" + op + "' will be overwritten for NetCDF export");
     }
 
@@ -464,240 +941,71 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
         }
     }
 
-    double *dim_x = (double *)std::calloc(size_x(), sizeof(double));
-    double *dim_y = (double *)std::calloc(size_y(), sizeof(double));
-    int *dim_t = (int *)std::calloc(size_t(), sizeof(int));
-
-    double *dim_x_bnds = nullptr;
-    double *dim_y_bnds = nullptr;
-    int *dim_t_bnds = nullptr;
-
-    if (write_bounds) {
-        dim_x_bnds = (double *)std::calloc(size_x() * 2, sizeof(double));
-        dim_y_bnds = (double *)std::calloc(size_y() * 2, sizeof(double));
-        dim_t_bnds = (int *)std::calloc(size_t() * 2, sizeof(int));
-    }
-
     if (_st_ref->dt().dt_unit == datetime_unit::WEEK) {
         _st_ref->dt_unit() = datetime_unit::DAY;
         _st_ref->dt_interval() *= 7;  // UDUNIT does not support week
     }
 
-    for (uint32_t i = 0; i < size_t(); ++i) {
-        dim_t[i] = (i * st_reference()->dt().dt_interval);
-    }
-    for (uint32_t i = 0; i < size_y(); ++i) {
-        dim_y[i] = st_reference()->win().bottom + size_y() * st_reference()->dy() - (i + 0.5) * st_reference()->dy();  // cell center
+    // for resumable exports, written chunks are tracked in a journal and data is synced to disk after each chunk
+    std::shared_ptr<export_journal> journal = nullptr;
+    std::set<chunkid_t> done;
+    std::string key;
+    if (resume) {
+        key = export_key(shared_from_this(), "netcdf|" + std::to_string(compression_level) + "|" + std::to_string(write_bounds) + "|" + std::to_string((int)packing.type));
     }
-    for (uint32_t i = 0; i < size_x(); ++i) {
-        dim_x[i] = st_reference()->win().left + (i + 0.5) * st_reference()->dx();
+    if (!key.empty()) {
+        journal = std::make_shared<export_journal>(op + ".journal", key);
+        done = journal->open(resume);
     }
 
-    if (write_bounds) {
-        for (uint32_t i = 0; i < size_t(); ++i) {
-            dim_t_bnds[2 * i] = (i * st_reference()->dt().dt_interval);
-            dim_t_bnds[2 * i + 1] = ((i + 1) * st_reference()->dt().dt_interval);
-        }
-        for (uint32_t i = 0; i < size_y(); ++i) {
-            dim_y_bnds[2 * i] = st_reference()->win().bottom + size_y() * st_reference()->dy() - (i)*st_reference()->dy();
-            dim_y_bnds[2 * i + 1] = st_reference()->win().bottom + size_y() * st_reference()->dy() - (i + 1) * st_reference()->dy();
-        }
-        for (uint32_t i = 0; i < size_x(); ++i) {
-            dim_x_bnds[2 * i] = st_reference()->win().left + (i + 0) * st_reference()->dx();
-            dim_x_bnds[2 * i + 1] = st_reference()->win().left + (i + 1) * st_reference()->dx();
-        }
-    }
-
-    OGRSpatialReference srs = st_reference()->srs_ogr();
-    std::string yname = srs.IsProjected() ? "y" : "latitude";
-    std::string xname = srs.IsProjected() ? "x" : "longitude";
-
     int ncout;
-
-#if USE_NCDF4 == 1
-    nc_create(op.c_str(), NC_NETCDF4, &ncout);
-#else
-    nc_create(op.c_str(), NC_CLASSIC_MODEL, &ncout);
-#endif
-
-    int d_t, d_y, d_x;
-    nc_def_dim(ncout, "time", size_t(), &d_t);
-    nc_def_dim(ncout, yname.c_str(), size_y(), &d_y);
-    nc_def_dim(ncout, xname.c_str(), size_x(), &d_x);
-
-    int d_bnds = -1;
-    if (write_bounds) {
-        nc_def_dim(ncout, "nv", 2, &d_bnds);
-    }
-
-    int v_t, v_y, v_x;
-    nc_def_var(ncout, "time", NC_INT, 1, &d_t, &v_t);
-    nc_def_var(ncout, yname.c_str(), NC_DOUBLE, 1, &d_y, &v_y);
-    nc_def_var(ncout, xname.c_str(), NC_DOUBLE, 1, &d_x, &v_x);
-
-    int v_tbnds, v_ybnds, v_xbnds;
-    int d_tbnds[] = {d_t, d_bnds};
-    int d_ybnds[] = {d_y, d_bnds};
-    int d_xbnds[] = {d_x, d_bnds};
-    if (write_bounds) {
-        nc_def_var(ncout, "time_bnds", NC_INT, 2, d_tbnds, &v_tbnds);
-        nc_def_var(ncout, "y_bnds", NC_DOUBLE, 2, d_ybnds, &v_ybnds);
-        nc_def_var(ncout, "x_bnds", NC_DOUBLE, 2, d_xbnds, &v_xbnds);
-    }
-
-    std::string att_source = "gdalcubes " + std::to_string(GDALCUBES_VERSION_MAJOR) + "." + std::to_string(GDALCUBES_VERSION_MINOR) + "." + std::to_string(GDALCUBES_VERSION_PATCH);
-
-    nc_put_att_text(ncout, NC_GLOBAL, "Conventions", strlen("CF-1.6"), "CF-1.6");
-    nc_put_att_text(ncout, NC_GLOBAL, "source", strlen(att_source.c_str()), att_source.c_str());
-
-    // write json graph as metadata
-    //    std::string j = make_constructible_json().dump();
-    //    nc_put_att_text(ncout, NC_GLOBAL, "process_graph", j.length(), j.c_str());
-
-    char *wkt;
-    srs.exportToWkt(&wkt);
-
-    double geoloc_array[6] = {st_reference()->left(), st_reference()->dx(), 0.0, st_reference()->top(), 0.0, st_reference()->dy()};
-    nc_put_att_text(ncout, NC_GLOBAL, "spatial_ref", strlen(wkt), wkt);
-    nc_put_att_double(ncout, NC_GLOBAL, "GeoTransform", NC_DOUBLE, 6, geoloc_array);
-
-    std::string dtunit_str;
-    if (_st_ref->dt().dt_unit == datetime_unit::YEAR) {
-        dtunit_str = "years";  // WARNING: UDUNITS defines a year as 365.2425 days
-    } else if (_st_ref->dt().dt_unit == datetime_unit::MONTH) {
-        dtunit_str = "months";  // WARNING: UDUNITS defines a month as 1/12 year
-    } else if (_st_ref->dt().dt_unit == datetime_unit::DAY) {
-        dtunit_str = "days";
-    } else if (_st_ref->dt().dt_unit == datetime_unit::HOUR) {
-        dtunit_str = "hours";
-    } else if (_st_ref->dt().dt_unit == datetime_unit::MINUTE) {
-        dtunit_str = "minutes";
-    } else if (_st_ref->dt().dt_unit == datetime_unit::SECOND) {
-        dtunit_str = "seconds";
-    }
-    dtunit_str += " since ";
-    dtunit_str += _st_ref->t0().to_string(datetime_unit::SECOND);
-
-    nc_put_att_text(ncout, v_t, "units", strlen(dtunit_str.c_str()), dtunit_str.c_str());
-    nc_put_att_text(ncout, v_t, "calendar", strlen("gregorian"), "gregorian");
-    nc_put_att_text(ncout, v_t, "long_name", strlen("time"), "time");
-    nc_put_att_text(ncout, v_t, "standard_name", strlen("time"), "time");
-
-    if (srs.IsProjected()) {
-        // GetLinearUnits(char **) is deprecated since GDAL 2.3.0
-#if GDAL_VERSION_MAJOR >= 2 && GDAL_VERSION_MINOR >= 3 && GDAL_VERSION_REV >= 0
-        const char *unit = nullptr;
-#else
-        char *unit = nullptr;
-#endif
-        srs.GetLinearUnits(&unit);
-
-        nc_put_att_text(ncout, v_y, "units", strlen(unit), unit);
-        nc_put_att_text(ncout, v_x, "units", strlen(unit), unit);
-
-        int v_crs;
-        nc_def_var(ncout, "crs", NC_INT, 0, NULL, &v_crs);
-        nc_put_att_text(ncout, v_crs, "grid_mapping_name", strlen("easting_northing"), "easting_northing");
-        nc_put_att_text(ncout, v_crs, "crs_wkt", strlen(wkt), wkt);
-
-    } else {
-        // char* unit;
-        // double scale = srs.GetAngularUnits(&unit);
-        nc_put_att_text(ncout, v_y, "units", strlen("degrees_north"), "degrees_north");
-        nc_put_att_text(ncout, v_y, "long_name", strlen("latitude"), "latitude");
-        nc_put_att_text(ncout, v_y, "standard_name", strlen("latitude"), "latitude");
-
-        nc_put_att_text(ncout, v_x, "units", strlen("degrees_east"), "degrees_east");
-        nc_put_att_text(ncout, v_x, "long_name", strlen("longitude"), "longitude");
-        nc_put_att_text(ncout, v_x, "standard_name", strlen("longitude"), "longitude");
-
-        int v_crs;
-        nc_def_var(ncout, "crs", NC_INT, 0, NULL, &v_crs);
-        nc_put_att_text(ncout, v_crs, "grid_mapping_name", strlen("latitude_longitude"), "latitude_longitude");
-        nc_put_att_text(ncout, v_crs, "crs_wkt", strlen(wkt), wkt);
-    }
-    CPLFree(wkt);
-    int d_all[] = {d_t, d_y, d_x};
-
     std::vector<int> v_bands;
 
-    for (uint16_t i = 0; i < bands().count(); ++i) {
-        int v;
-        nc_def_var(ncout, bands().get(i).name.c_str(), ot, 3, d_all, &v);
-        std::size_t csize[3] = {_chunk_size[0], _chunk_size[1], _chunk_size[2]};
-#if USE_NCDF4 == 1
-        nc_def_var_chunking(ncout, v, NC_CHUNKED, csize);
-#endif
-        if (compression_level > 0) {
-#if USE_NCDF4 == 1
-            nc_def_var_deflate(ncout, v, 1, 1, compression_level);  // TODO: experiment with shuffling
-#else
-            GCBS_WARN("gdalcubes has been built to write netCDF-3 classic model files, compression will be ignored.");
-#endif
+    if (!done.empty()) {
+        // continue writing to the existing file, which must contain all band variables
+        bool opened = filesystem::is_regular_file(op) && nc_open(op.c_str(), NC_WRITE, &ncout) == NC_NOERR;
+        bool ok = opened;
+        for (uint16_t i = 0; i < bands().count() && ok; ++i) {
+            int v;
+            ok = nc_inq_varid(ncout, bands().get(i).name.c_str(), &v) == NC_NOERR;
+            v_bands.push_back(v);
         }
-
-        if (!bands().get(i).unit.empty())
-            nc_put_att_text(ncout, v, "units", strlen(bands().get(i).unit.c_str()), bands().get(i).unit.c_str());
-
-        double pscale = bands().get(i).scale;
-        double poff = bands().get(i).offset;
-        double pNAN = NAN;
-
-        if (packing.type != packed_export::packing_type::PACK_NONE) {
-            if (packing.scale.size() > 1) {
-                pscale = packing.scale[i];
-                poff = packing.offset[i];
-                pNAN = packing.nodata[i];
-            } else {
-                pscale = packing.scale[0];
-                poff = packing.offset[0];
-                pNAN = packing.nodata[0];
-            }
+        if (ok) {
+            GCBS_INFO("Resuming export, " + std::to_string(done.size()) + " of " + std::to_string(count_chunks()) + " chunks have already been written");
+        } else {
+            GCBS_INFO("Existing file '" + op + "' cannot be opened for resuming the export, starting from scratch");
+            if (opened) nc_close(ncout);
+            v_bands.clear();
+            done = journal->open(false);
         }
-
-        nc_put_att_double(ncout, v, "scale_factor", NC_DOUBLE, 1, &pscale);
-        nc_put_att_double(ncout, v, "add_offset", NC_DOUBLE, 1, &poff);
-        nc_put_att_text(ncout, v, "type", strlen(bands().get(i).type.c_str()), bands().get(i).type.c_str());
-        nc_put_att_text(ncout, v, "grid_mapping", strlen("crs"), "crs");
-
-        // this doesn't seem to solve missing spatial reference for multitemporal nc files
-        //        nc_put_att_text(ncout, v, "spatial_ref", strlen(wkt), wkt);
-        //        nc_put_att_double(ncout, v, "GeoTransform", NC_DOUBLE, 6, geoloc_array);
-
-        nc_put_att_double(ncout, v, "_FillValue", ot, 1, &pNAN);
-
-        v_bands.push_back(v);
     }
 
-    nc_enddef(ncout);  ////////////////////////////////////////////////////
-
-    nc_put_var(ncout, v_t, (void *)dim_t);
-    nc_put_var(ncout, v_y, (void *)dim_y);
-    nc_put_var(ncout, v_x, (void *)dim_x);
-
-    if (write_bounds) {
-        nc_put_var(ncout, v_tbnds, (void *)dim_t_bnds);
-        nc_put_var(ncout, v_ybnds, (void *)dim_y_bnds);
-        nc_put_var(ncout, v_xbnds, (void *)dim_x_bnds);
-    }
-
-    if (dim_t) std::free(dim_t);
-    if (dim_y) std::free(dim_y);
-    if (dim_x) std::free(dim_x);
-
-    if (write_bounds) {
-        if (dim_t_bnds) std::free(dim_t_bnds);
-        if (dim_y_bnds) std::free(dim_y_bnds);
-        if (dim_x_bnds) std::free(dim_x_bnds);
+    if (done.empty()) {
+        ncout = create_netcdf_file(shared_from_this(), op, ot, compression_level, write_bounds, packing, v_bands);
     }
 
-    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, op, prg, &v_bands, ncout, &packing](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, op, prg, &v_bands, ncout, &packing, &done, journal](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (done.count(id) > 0) {
+            prg->increment((double)1 / (double)this->count_chunks());
+            return;
+        }
+        if (dat->empty()) {
+            // cells of empty chunks are never written and keep the _FillValue of variables
+            if (journal) {
+                journal->add(id);
+            }
+            prg->increment((double)1 / (double)this->count_chunks());
+            return;
+        }
         chunk_size_btyx csize = dat->size();
         bounds_nd<uint32_t, 3> climits = chunk_limits(id);
         std::size_t startp[] = {climits.low[0], size_y() - climits.high[1] - 1, climits.low[2]};
         std::size_t countp[] = {csize[1], csize[2], csize[3]};
 
         for (uint16_t i = 0; i < bands().count(); ++i) {
+            if (dat->band_all_missing(i)) {
+                continue;  // keep _FillValue
+            }
             if (packing.type != packed_export::packing_type::PACK_NONE) {
                 double cur_scale;
                 double cur_offset;
@@ -815,11 +1123,25 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
                 m.unlock();
             }
         }
+        if (journal) {
+            // make sure that data of the chunk is on disk before it is marked as completed
+            m.lock();
+            nc_sync(ncout);
+            m.unlock();
+            journal->add(id);
+        }
         prg->increment((double)1 / (double)this->count_chunks());
     };
 
-    p->apply(shared_from_this(), f);
+    if (done.empty()) {
+        p->apply(shared_from_this(), f);
+    } else {
+        p->apply(std::make_shared<resume_cube>(shared_from_this(), done), f);
+    }
     nc_close(ncout);
+    if (journal) {
+        journal->finish();
+    }
     prg->finalize();
 
     // netCDF is now written, write additional per-time-slice VRT datasets if needed
@@ -862,12 +1184,156 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
     }
 }
 
+void cube::materialize(std::string path, std::string data_type, uint8_t compression_level, std::shared_ptr<chunk_processor> p) {
+    std::string op = filesystem::make_absolute(path);
+
+    if (filesystem::is_directory(op)) {
+        throw std::string("ERROR in cube::materialize(): output already exists and is a directory.");
+    }
+    if (filesystem::is_regular_file(op)) {
+        GCBS_INFO("Existing file '" + op + "' will be overwritten by chunk store");
+    }
+    if (!filesystem::exists(filesystem::parent(op))) {
+        filesystem::mkdir_recursive(filesystem::parent(op));
+    }
+    if (data_type != "float64" && data_type != "float32") {
+        throw std::string("ERROR in cube::materialize(): invalid data type '" + data_type + "', expected float64 or float32.");
+    }
+    if (compression_level > 9) {
+        compression_level = 9;
+    }
+
+    std::ofstream os(op, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os.good()) {
+        throw std::string("ERROR in cube::materialize(): cannot create output file '" + op + "'.");
+    }
+    os.write(CHUNK_STORE_MAGIC, 8);
+    uint64_t cur_offset = 8;
+
+    chunk_store_entry empty_entry;
+    empty_entry.offset = 0;
+    empty_entry.length = 0;
+    empty_entry.size = {{0, 0, 0, 0}};
+    std::vector<chunk_store_entry> index(count_chunks(), empty_entry);
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);  // explicitly set to zero to show progress bar immediately
+
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, prg, &data_type, compression_level, &os, &cur_offset, &index](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat || dat->empty()) {
+            prg->increment((double)1 / (double)this->count_chunks());
+            return;
+        }
+        uint64_t nvalues = (uint64_t)dat->size()[0] * dat->size()[1] * dat->size()[2] * dat->size()[3];
+
+        // convert and compress before acquiring the lock
+        void *outbuf = dat->buf();
+        uint64_t length = nvalues * sizeof(double);
+        void *floatbuf = nullptr;
+        void *zbuf = nullptr;
+        if (data_type == "float32") {
+            floatbuf = std::malloc(nvalues * sizeof(float));
+            for (uint64_t i = 0; i < nvalues; ++i) {
+                ((float *)floatbuf)[i] = ((double *)dat->buf())[i];
+            }
+            outbuf = floatbuf;
+            length = nvalues * sizeof(float);
+        }
+        if (compression_level > 0) {
+            std::size_t nout = 0;
+            zbuf = CPLZLibDeflate(outbuf, length, compression_level, nullptr, 0, &nout);
+            if (!zbuf) {
+                if (floatbuf) std::free(floatbuf);
+                throw std::string("ERROR in cube::materialize(): compression of chunk " + std::to_string(id) + " failed.");
+            }
+            outbuf = zbuf;
+            length = nout;
+        }
+
+        m.lock();
+        uint64_t padding = (8 - (cur_offset % 8)) % 8;  // chunks start at multiples of 8 bytes
+        if (padding > 0) {
+            const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            os.write(zeros, padding);
+            cur_offset += padding;
+        }
+        os.write((char *)outbuf, length);
+        index[id].offset = cur_offset;
+        index[id].length = length;
+        index[id].size = dat->size();
+        cur_offset += length;
+        m.unlock();
+
+        if (floatbuf) std::free(floatbuf);
+        if (zbuf) VSIFree(zbuf);
+        prg->increment((double)1 / (double)this->count_chunks());
+    };
+
+    p->apply(shared_from_this(), f);
+
+    cube_view v;
+    v.win() = _st_ref->win();
+    v.srs() = _st_ref->srs();
+    v.nx() = _st_ref->nx();
+    v.ny() = _st_ref->ny();
+    v.t0() = _st_ref->t0();
+    v.t1() = _st_ref->t1();
+    v.dt(_st_ref->dt());
+    v.aggregation_method() = aggregation::aggregation_type::AGG_NONE;
+    v.resampling_method() = resampling::resampling_type::RSMPL_NEAR;
+
+    nlohmann::json j;
+    j["view"] = nlohmann::json::parse(v.write_json_string());
+    j["chunk_size"] = _chunk_size;
+    j["bands"] = nlohmann::json::array();
+    for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
+        band b = _bands.get(ib);
+        j["bands"].push_back({{"name", b.name}, {"type", b.type}, {"offset", b.offset}, {"scale", b.scale}, {"unit", b.unit}, {"no_data_value", b.no_data_value}});
+    }
+    j["data_type"] = data_type;
+    j["compression_level"] = compression_level;
+    j["nchunks"] = count_chunks();
+    j["source"] = make_constructible_json();
+    std::string json_str = j.dump();
+
+    uint64_t json_offset = cur_offset;
+    uint64_t json_length = json_str.size();
+    uint64_t index_offset = json_offset + json_length;
+    os.write(json_str.c_str(), json_length);
+    os.write((char *)index.data(), index.size() * sizeof(chunk_store_entry));
+    os.write((char *)&json_offset, sizeof(uint64_t));
+    os.write((char *)&json_length, sizeof(uint64_t));
+    os.write((char *)&index_offset, sizeof(uint64_t));
+    os.write(CHUNK_STORE_MAGIC, 8);
+    os.close();
+    if (os.fail()) {
+        throw std::string("ERROR in cube::materialize(): failed to write chunk store file '" + op + "'.");
+    }
+    prg->finalize();
+}
+
+namespace {
+
+// chunks that are known to be empty are passed as empty chunk_data objects without reading them
+std::shared_ptr<chunk_data> read_chunk_unless_empty(std::shared_ptr<cube> c, chunkid_t id) {
+    if (c->chunk_is_empty(id)) {
+        metrics::instance()->count_empty_chunk_skipped();
+        return std::make_shared<chunk_data>();
+    }
+    return c->read_chunk(id);
+}
+
+}  // namespace
+
 void chunk_processor_singlethread::apply(std::shared_ptr<cube> c,
                                          std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
     std::mutex mutex;
     uint32_t nchunks = c->count_chunks();
     for (uint32_t i = 0; i < nchunks; ++i) {
-        std::shared_ptr<chunk_data> dat = c->read_chunk(i);
+        std::shared_ptr<chunk_data> dat = read_chunk_unless_empty(c, i);
+        trace_span span_write("write");
+        span_write.arg("chunk", i);
+        span_write.arg("bytes", dat ? dat->total_size_bytes() : 0);
         f(i, dat, mutex);
     }
 }
@@ -880,7 +1346,10 @@ void chunk_processor_multithread::apply(std::shared_ptr<cube> c,
         workers.push_back(std::thread([this, &c, f, it, &mutex](void) {
             for (uint32_t i = it; i < c->count_chunks(); i += _nthreads) {
                 try {
-                    std::shared_ptr<chunk_data> dat = c->read_chunk(i);
+                    std::shared_ptr<chunk_data> dat = read_chunk_unless_empty(c, i);
+                    trace_span span_write("write");
+                    span_write.arg("chunk", i);
+                    span_write.arg("bytes", dat ? dat->total_size_bytes() : 0);
                     f(i, dat, mutex);
                 } catch (std::string s) {
                     GCBS_ERROR(s);
@@ -897,4 +1366,102 @@ void chunk_processor_multithread::apply(std::shared_ptr<cube> c,
     }
 }
 
+nlohmann::json cube::explain_node() {
+    nlohmann::json out;
+    try {
+        out["cube_type"] = make_constructible_json()["cube_type"];
+    } catch (...) {
+        out["cube_type"] = "unknown";
+    }
+    out["size"] = {size_bands(), size_t(), size_y(), size_x()};
+    out["chunk_size"] = {_chunk_size[0], _chunk_size[1], _chunk_size[2]};
+    out["chunks"] = count_chunks();
+    out["chunk_bytes"] = (uint64_t)size_bands() * _chunk_size[0] * _chunk_size[1] * _chunk_size[2] * sizeof(double);
+    return out;
+}
+
+nlohmann::json cube::explain(uint64_t memory_budget) {
+    // collect all cubes of the graph such that every cube comes before its inputs
+    std::vector<std::shared_ptr<cube>> order;
+    std::map<cube *, uint32_t> index;
+    std::function<void(std::shared_ptr<cube>)> visit = [&](std::shared_ptr<cube> c) {
+        c = c->unwrap();  // wrappers have the same chunks as their input and are not reported
+        if (index.count(c.get()) > 0) return;
+        index[c.get()] = 0;
+        for (uint16_t i = 0; i < c->_pre.size(); ++i) {
+            std::shared_ptr<cube> p = c->_pre[i].lock();
+            if (p) visit(p);
+        }
+        order.push_back(c);  // post-order: inputs first
+    };
+    visit(shared_from_this());
+    std::reverse(order.begin(), order.end());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        index[order[i].get()] = i;
+    }
+
+    nlohmann::json cubes = nlohmann::json::array();
+    std::vector<double> chunk_reads(order.size(), 0.0);
+    chunk_reads[0] = count_chunks();
+    uint64_t memory_per_chunk = 0;
+    uint32_t source_chunks = 0;
+    uint32_t source_empty_chunks = 0;
+    double source_chunk_reads = 0;
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        nlohmann::json n = order[i]->explain_node();
+        n["id"] = i;
+        n["inputs"] = nlohmann::json::array();
+        n["chunk_reads"] = chunk_reads[i];
+        n["reread_factor"] = n["chunks"].get<uint32_t>() > 0 ? chunk_reads[i] / n["chunks"].get<uint32_t>() : 0.0;
+
+        uint32_t in_memory = n.count("input_chunks_in_memory") ? n["input_chunks_in_memory"].get<uint32_t>() : 1;
+        for (uint16_t ip = 0; ip < order[i]->_pre.size(); ++ip) {
+            std::shared_ptr<cube> p = order[i]->_pre[ip].lock();
+            if (!p) continue;
+            p = p->unwrap();
+            uint32_t j = index[p.get()];
+            n["inputs"].push_back(j);
+
+            // chunk reads of the input per computed chunk of this cube, distributed proportionally
+            double reads = n.count("input_reads") ? n["input_reads"].get<double>() : (double)p->count_chunks();
+            if (order[i]->count_chunks() > 0) {
+                chunk_reads[j] += chunk_reads[i] * reads / order[i]->count_chunks();
+            }
+            memory_per_chunk += (uint64_t)in_memory * p->size_bands() * p->_chunk_size[0] * p->_chunk_size[1] * p->_chunk_size[2] * sizeof(double);
+        }
+        if (n.count("extra_bytes")) {
+            memory_per_chunk += n["extra_bytes"].get<uint64_t>();
+        }
+        if (n.count("sources")) {
+            source_chunks += n["chunks"].get<uint32_t>();
+            source_empty_chunks += n["sources"]["empty_chunks"].get<uint32_t>();
+            source_chunk_reads += chunk_reads[i];
+        }
+        cubes.push_back(n);
+    }
+    memory_per_chunk += cubes[0]["chunk_bytes"].get<uint64_t>();
+
+    nlohmann::json summary;
+    summary["chunks"] = count_chunks();
+    summary["source_chunks"] = source_chunks;
+    summary["source_empty_chunks"] = source_empty_chunks;
+    summary["source_chunk_reads"] = source_chunk_reads;
+    summary["reread_factor"] = source_chunks > 0 ? source_chunk_reads / source_chunks : 1.0;
+    summary["memory_per_chunk_bytes"] = memory_per_chunk;
+
+    // parallelism is limited by the number of result chunks, available cores, and the memory of in-flight chunks
+    uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max(1u, count_chunks()));
+    if (memory_budget > 0 && memory_per_chunk > 0) {
+        threads = std::max(uint64_t(1), std::min((uint64_t)threads, memory_budget / memory_per_chunk));
+        summary["memory_budget_bytes"] = memory_budget;
+    }
+    summary["recommended_threads"] = threads;
+
+    nlohmann::json out;
+    out["cubes"] = cubes;
+    out["summary"] = summary;
+    return out;
+}
+
 }  // namespace gdalcubes
@@ -25,9 +25,13 @@
 #ifndef CUBE_H
 #define CUBE_H
 
+#include <atomic>
+#include <cmath>
 #include <mutex>
 #include <set>
+#include <unordered_map>
 #include "config.h"
+#include "metrics.h"
 #include "view.h"
 
 namespace gdalcubes {
@@ -83,6 +87,21 @@ struct packed_export {
      */
     std::vector<double> nodata;
 
+    /**
+     * @brief Pack values in place, i.e. apply offset and scale and replace NAN with the nodata value
+     * @param buf values
+     * @param n number of values
+     */
+    static inline void pack(double *buf, uint64_t n, double scale, double offset, double nodata) {
+        for (uint64_t i = 0; i < n; ++i) {
+            if (std::isnan(buf[i])) {
+                buf[i] = nodata;
+            } else {
+                buf[i] = std::round((buf[i] - offset) / scale);  // use std::round to avoid truncation bias
+            }
+        }
+    }
+
     static packed_export make_none() {
         packed_export out;
         out.type = packing_type::PACK_NONE;
@@ -316,13 +335,23 @@ class band_collection {
  */
 class chunk_data {
    public:
+    /**
+     * @brief Summary of missing (NAN) values in one band and time slice of a chunk, see compute_validity()
+     */
+    enum class slice_validity {
+        UNKNOWN,
+        ALL_MISSING,
+        ALL_VALID,
+        MIXED
+    };
+
     /**
      * @brief Default constructor that creates an empty chunk
      */
-    chunk_data() : _buf(nullptr), _size({{0, 0, 0, 0}}) {}
+    chunk_data() : _buf(nullptr), _size({{0, 0, 0, 0}}), _release(), _slice_validity(), _validity_mask(), _validity_shared(false), _validity_pending(false), _mutex_validity() {}
 
     ~chunk_data() {
-        if (_buf && _size[0] * _size[1] * _size[2] * _size[3] > 0) std::free(_buf);
+        release_buf();
     }
 
     /**
@@ -373,8 +402,25 @@ class chunk_data {
      * @param b new buffer object, this class takes the ownership, i.e., eventually std::frees memory automatically in the destructor.
      */
     inline void buf(void *b) {
-        if (_buf && _size[0] * _size[1] * _size[2] * _size[3] > 0) std::free(_buf);
+        release_buf();
+        _buf = b;
+        clear_validity();
+    }
+
+    /**
+     * @brief (Re)set the raw buffer with a custom function to release its memory
+     *
+     * This is used for buffers that have not been allocated with std::malloc / std::calloc, e.g., memory mapped
+     * regions of chunk store files.
+     *
+     * @param b new buffer object
+     * @param release function that is called with b instead of std::free when the buffer is released
+     */
+    inline void buf(void *b, std::function<void(void *)> release) {
+        release_buf();
         _buf = b;
+        _release = release;
+        clear_validity();
     }
 
     /**
@@ -392,11 +438,197 @@ class chunk_data {
      *
      * @param s new size
      */
-    inline void size(coords_nd<uint32_t, 4> s) { _size = s; }
+    inline void size(coords_nd<uint32_t, 4> s) {
+        _size = s;
+        clear_validity();
+    }
+
+    /**
+     * @brief Compute a packed validity bitmask and summaries of missing values per band and time slice
+     *
+     * The bitmask has one bit per value and each time slice starts at a new 64 bit word. If all bands have identical
+     * missing values (e.g. after applying a cloud mask), only one bitmask is stored and shared by all bands.
+     * Consumers use validity() to skip time slices without data and for_each_valid() to iterate over valid values only.
+     * Changing the buffer or size discards the validity information, whereas modifying values in the buffer directly
+     * does not; call compute_validity() again or clear_validity() in this case.
+     */
+    inline void compute_validity() {
+        build_validity();
+        _validity_pending.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Compute validity information on first use instead of immediately, see compute_validity()
+     *
+     * Sources call this for completely written chunks, consumers that never query the validity do not pay for it.
+     * The computation is thread-safe, i.e., chunks may be shared by threads (e.g. in caches) afterwards.
+     */
+    inline void defer_validity() {
+        clear_validity();
+        if (!empty()) _validity_pending.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Discard the validity bitmask and summaries
+     */
+    inline void clear_validity() {
+        reset_validity();
+        _validity_pending.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check whether validity information is available for the current buffer, possibly not yet computed
+     */
+    inline bool has_validity() { return _validity_pending.load(std::memory_order_acquire) || !_slice_validity.empty(); }
+
+    /**
+     * @brief Check whether all bands share the same validity bitmask
+     */
+    inline bool validity_shared() {
+        ensure_validity();
+        return _validity_shared;
+    }
+
+    /**
+     * @brief Get the summary of missing values of a band and time slice
+     * @param b band index
+     * @param t time index within the chunk
+     * @return summary, slice_validity::UNKNOWN if compute_validity() has not been called
+     */
+    inline slice_validity validity(uint16_t b, uint32_t t) {
+        ensure_validity();
+        if (_slice_validity.empty()) return slice_validity::UNKNOWN;
+        return (slice_validity)_slice_validity[(_validity_shared ? 0 : b) * _size[1] + t];
+    }
+
+    /**
+     * @brief Check whether a band has missing values only
+     * @param b band index
+     * @return true if all time slices of the band are known to have missing values only
+     */
+    bool band_all_missing(uint16_t b) {
+        ensure_validity();
+        if (_slice_validity.empty()) return false;
+        for (uint32_t it = 0; it < _size[1]; ++it) {
+            if (validity(b, it) != slice_validity::ALL_MISSING) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Get the validity bitmask of a band and time slice
+     *
+     * Bit i % 64 of word i / 64 is set if the i-th value of the slice (in y, x order) is not NAN.
+     * @param b band index
+     * @param t time index within the chunk
+     * @return pointer to (ny * nx + 63) / 64 words or nullptr if compute_validity() has not been called
+     */
+    inline const uint64_t *validity_mask(uint16_t b, uint32_t t) {
+        ensure_validity();
+        if (_validity_mask.empty()) return nullptr;
+        return _validity_mask.data() + ((uint64_t)(_validity_shared ? 0 : b) * _size[1] + t) * validity_words();
+    }
+
+    /**
+     * @brief Call a function for all values of a band that are not NAN
+     *
+     * Slices without data are skipped, and only set bits of the validity bitmask are visited in slices with missing
+     * values. Without validity information, all values are checked with std::isnan.
+     * @param b band index
+     * @param f function called as f(t, ixy, value) with t the time index within the chunk and ixy the index of the value
+     * within the time slice
+     */
+    template <typename F>
+    void for_each_valid(uint16_t b, F f) {
+        if (empty()) return;
+        uint32_t nxy = _size[2] * _size[3];
+        double *x = ((double *)_buf) + (uint64_t)b * _size[1] * nxy;
+        for (uint32_t it = 0; it < _size[1]; ++it, x += nxy) {
+            slice_validity s = validity(b, it);
+            if (s == slice_validity::ALL_MISSING) {
+                continue;
+            } else if (s == slice_validity::ALL_VALID) {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    f(it, ixy, x[ixy]);
+                }
+            } else if (s == slice_validity::MIXED) {
+                const uint64_t *m = validity_mask(b, it);
+                for (uint32_t iw = 0; iw < validity_words(); ++iw) {
+                    for (uint64_t w = m[iw]; w != 0; w &= w - 1) {  // clear lowest set bit
+                        uint32_t ixy = iw * 64 + count_trailing_zeros(w);
+                        f(it, ixy, x[ixy]);
+                    }
+                }
+            } else {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    if (!std::isnan(x[ixy])) f(it, ixy, x[ixy]);
+                }
+            }
+        }
+    }
 
    private:
     void *_buf;
     chunk_size_btyx _size;
+    std::function<void(void *)> _release;
+    std::vector<uint8_t> _slice_validity;  // slice_validity per band (or shared) and time slice
+    std::vector<uint64_t> _validity_mask;
+    bool _validity_shared;
+    std::atomic<bool> _validity_pending;  // see defer_validity()
+    std::mutex _mutex_validity;
+
+    void build_validity();
+
+    inline void reset_validity() {
+        _slice_validity.clear();
+        _validity_mask.clear();
+        _validity_shared = false;
+    }
+
+    inline void ensure_validity() {
+        if (!_validity_pending.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lck(_mutex_validity);
+        if (_validity_pending.load(std::memory_order_relaxed)) {
+            build_validity();
+            _validity_pending.store(false, std::memory_order_release);
+        }
+    }
+
+    inline uint32_t validity_words() { return (_size[2] * _size[3] + 63) / 64; }
+
+    static inline uint8_t count_trailing_zeros(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(w);
+#else
+        uint8_t n = 0;
+        while ((w & 1) == 0) {
+            w >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    inline void release_buf() {
+        if (_buf && _size[0] * _size[1] * _size[2] * _size[3] > 0) {
+            if (_release) {
+                _release(_buf);
+            } else {
+                std::free(_buf);
+            }
+        }
+        _release = nullptr;
+    }
+};
+
+/**
+ * @brief Whether a chunk contains data, as far as this can be decided without reading pixel values
+ * @see cube::chunk_status()
+ */
+enum class chunk_status_type {
+    UNKNOWN,   // the chunk must be read to find out
+    EMPTY,     // the chunk contains no values other than NAN, read_chunk() may return an empty chunk_data object
+    NON_EMPTY  // the chunk contains at least one value other than NAN
 };
 
 /**
@@ -417,7 +649,7 @@ class cube : public std::enable_shared_from_this<cube> {
     /**
      * @brief Create an empty data cube
      */
-    cube() : _st_ref(nullptr), _chunk_size(), _bands() {
+    cube() : _st_ref(nullptr), _chunk_size(), _bands(), _chunk_empty(), _mutex_chunk_empty() {
         _chunk_size = {16, 256, 256};
     }
 
@@ -425,7 +657,7 @@ class cube : public std::enable_shared_from_this<cube> {
      * @brief Create an empty data cube with given spacetime reference
      * @param st_ref space time reference (extent, size, SRS) of the cube
      */
-    cube(std::shared_ptr<cube_st_reference> st_ref) : _st_ref(st_ref), _chunk_size(), _bands(), _pre(), _succ() {
+    cube(std::shared_ptr<cube_st_reference> st_ref) : _st_ref(st_ref), _chunk_size(), _bands(), _pre(), _succ(), _chunk_empty(), _mutex_chunk_empty() {
         _chunk_size = {16, 256, 256};
 
         // TODO: add bands
@@ -730,6 +962,41 @@ class cube : public std::enable_shared_from_this<cube> {
      */
     virtual std::shared_ptr<chunk_data> read_chunk(chunkid_t id) = 0;
 
+    /**
+     * @brief Find out whether a chunk contains data without reading it
+     *
+     * Source cubes answer this from their index, derived cubes from the status of the input chunks needed to compute the
+     * chunk. This is much cheaper than read_chunk() and allows chunk processors, operators, and writers to skip empty chunks.
+     * The default implementation returns chunk_status_type::UNKNOWN for all chunks within the cube.
+     *
+     * @param id the id of the chunk
+     * @return status of the chunk, chunks outside of the cube are empty
+     */
+    virtual chunk_status_type chunk_status(chunkid_t id) {
+        if (id >= count_chunks()) return chunk_status_type::EMPTY;
+        return chunk_status_type::UNKNOWN;
+    }
+
+    /**
+     * @brief Check whether a chunk is known to contain no data, see chunk_status()
+     *
+     * Results are memoised per chunk, such that repeated checks (e.g. before and within read_chunk()) do not query
+     * sources again.
+     * @param id the id of the chunk
+     * @return true, if the chunk contains no values other than NAN; false if it does or if this is unknown
+     */
+    bool chunk_is_empty(chunkid_t id) {
+        {
+            std::lock_guard<std::mutex> lck(_mutex_chunk_empty);
+            auto it = _chunk_empty.find(id);
+            if (it != _chunk_empty.end()) return it->second;
+        }
+        bool out = chunk_status(id) == chunk_status_type::EMPTY;
+        std::lock_guard<std::mutex> lck(_mutex_chunk_empty);
+        _chunk_empty[id] = out;
+        return out;
+    }
+
     /**
      * @brief Update the spatiotemporal reference of this and all connected cubes
      * @param stref new spatiotemporal reference / data cube view
@@ -762,12 +1029,16 @@ class cube : public std::enable_shared_from_this<cube> {
      * @param packing reduce size of output tile with packing (apply scale + offset and use smaller integer data types)
      * @param drop_empty_slices if true, empty time slices will be skipped; not yet implemented
      * @param p chunk processor instance, defaults to the global configuration
+     * @param resume if true, continue an interrupted resumable export to the same directory and only write missing chunks
      *
      * @note Overview levels will be chosen by halving the number of pixels until the larger dimension
      * has less than 256 pixels.
      *
      * @note argument `drop_empty_slices` is not yet implemented.
      *
+     * @note If resume is true, completed chunks are recorded in a journal file `<prefix>gdalcubes_export.journal` in the
+     * output directory, which is removed after the export has finished.
+     *
      * @note Depending on `overviews` and `cog` GeoTIFFs created and postprocessed stepwise:
      * 1. time slices of cubes of the cube are exported as tiled normal GeoTIFFs
      * 2. Overviews are generated (internal)
@@ -781,7 +1052,8 @@ class cube : public std::enable_shared_from_this<cube> {
                               std::string overview_resampling = "NEAREST",
                               packed_export packing = packed_export::make_none(),
                               bool drop_empty_slices = false,
-                              std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
+                              std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor(),
+                              bool resume = false);
 
     /**
      * Write a data cube as a single netCDF file
@@ -792,13 +1064,35 @@ class cube : public std::enable_shared_from_this<cube> {
      * @param packing reduce size of output tile with packing (apply scale + offset and use smaller integer data types)
      * @param drop_empty_slices if true, empty time slices will be skipped
      * @param p chunk processor instance, defaults to the global configuration
+     * @param resume if true, continue an interrupted resumable export to the same file and only write missing chunks
      *
      * @note argument `drop_empty_slices` is not yet implemented.
+     *
+     * @note If resume is true, completed chunks are recorded in a journal file `<path>.journal`, which is removed after the
+     * export has finished, and the file is synced to disk after each chunk.
      */
     void write_netcdf_file(std::string path, uint8_t compression_level = 0,
                            bool with_VRT = false, bool write_bounds = true, packed_export packing = packed_export::make_none(),
                            bool drop_empty_slices = false,
-                           std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
+                           std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor(),
+                           bool resume = false);
+
+    /**
+     * @brief Materialize a data cube as a chunk store file
+     *
+     * All chunks are written in a compact binary format to a single file with an index of chunk offsets. The result can be
+     * read with chunk_store_cube, e.g., to avoid recomputing expensive intermediate results of long pipelines.
+     *
+     * @param path path of the target file
+     * @param data_type data type of stored values, either "float64" or "float32"
+     * @param compression_level deflate level, 0 = no compression, 1 = fast, 9 = small
+     * @param p chunk processor instance, defaults to the global configuration
+     *
+     * @note Uncompressed float64 chunk stores can be read without any copies by memory mapping the chunk data.
+     * @see chunk_store_cube
+     */
+    void materialize(std::string path, std::string data_type = "float64", uint8_t compression_level = 0,
+                     std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
 
     /**
      * Get the cube's bands
@@ -831,7 +1125,37 @@ class cube : public std::enable_shared_from_this<cube> {
      */
     virtual nlohmann::json make_constructible_json() = 0;
 
+    /**
+     * @brief Get the cube that actually computes chunks, skipping transparent wrappers such as cached_cube
+     *
+     * Code that inspects the type of cubes (e.g. with std::dynamic_pointer_cast) should call this first.
+     * @return this cube, or the innermost input cube of a wrapper
+     */
+    virtual std::shared_ptr<cube> unwrap() { return shared_from_this(); }
+
+    /**
+     * @brief Estimate the cost of computing all chunks of the cube without reading any pixel values
+     *
+     * Walks the graph of input cubes and reports for each cube the number of chunks, how often its chunks are read, and
+     * the size of chunk buffers. Cubes that read from image collections additionally query the collection index for the
+     * number of images and bytes intersecting each chunk.
+     *
+     * @param memory_budget memory in bytes available for chunk buffers, used to recommend the number of threads, 0 = unlimited
+     * @return JSON object with "cubes" (one entry per cube of the graph, starting with this cube) and "summary"
+     */
+    nlohmann::json explain(uint64_t memory_budget = 0);
+
    protected:
+    /**
+     * @brief Describe this cube for explain(), without reading any pixel values
+     *
+     * The default reports size, chunk size, and number of chunks and assumes that each chunk of input cubes is read once
+     * to compute all chunks of this cube. Derived classes may add "input_reads" (number of chunk reads per input cube),
+     * "input_chunks_in_memory" (input chunks held at the same time while computing a chunk), "extra_bytes" (additional
+     * buffers per chunk), or "sources" (statistics of source images).
+     */
+    virtual nlohmann::json explain_node();
+
     /**
      * Spacetime reference of a cube, including extent, size, and projection
      */
@@ -857,6 +1181,20 @@ class cube : public std::enable_shared_from_this<cube> {
      */
     std::vector<std::weak_ptr<cube>> _succ;
 
+    /**
+     * @brief Memoised results of chunk_is_empty() per chunk id
+     */
+    std::unordered_map<chunkid_t, bool> _chunk_empty;
+    std::mutex _mutex_chunk_empty;
+
+    /**
+     * @brief Forget memoised results of chunk_is_empty(), must be called if the chunk layout changes
+     */
+    void reset_chunk_empty() {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_empty);
+        _chunk_empty.clear();
+    }
+
     /**
      * @brief Set the spatiotemporal reference for this instance only (but not for connected cubes)
      * @param stref new spatiotemporal reference / data cube view
@@ -874,6 +1212,7 @@ class cube : public std::enable_shared_from_this<cube> {
     update_st_reference_recursion(std::shared_ptr<cube_st_reference> stref, std::set<std::shared_ptr<cube>> &cset) {
         if (cset.count(shared_from_this()) > 0) return;
         this->set_st_reference(stref);
+        reset_chunk_empty();
         cset.insert(shared_from_this());
 
         for (uint16_t i = 0; i < _pre.size(); ++i) {
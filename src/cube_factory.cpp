@@ -25,6 +25,8 @@
 #include "cube_factory.h"
 
 #include "apply_pixel.h"
+#include "chunk_cache.h"
+#include "chunk_store.h"
 #include "dummy.h"
 #include "external/json.hpp"
 #include "filesystem.h"
@@ -32,7 +34,9 @@
 #include "filter_pixel.h"
 #include "image_collection_cube.h"
 #include "join_bands.h"
+#include "partial_reduce.h"
 #include "reduce.h"
+#include "reduce_space.h"
 #include "reduce_time.h"
 #include "select_bands.h"
 #include "stream.h"
@@ -44,14 +48,42 @@ namespace gdalcubes {
 
 cube_factory* cube_factory::_instance = 0;
 
-std::shared_ptr<cube> cube_factory::create_from_json(nlohmann::json j) {
+std::shared_ptr<cube> cube_factory::create_from_json(nlohmann::json j, bool cache) {
     if (!j.count("cube_type")) {
         throw std::string("ERROR in cube_factory::create_from_json(): invalid object, missing cube_type key.");
     }
 
     std::string cube_type = j["cube_type"];
 
-    return (cube_generators[cube_type](j));  //recursive creation
+    // pass types of consuming cubes down to input cubes, image collection cubes use these to choose chunk sizes
+    std::vector<std::string> downstream;
+    if (j.count("downstream") > 0) {
+        downstream = j["downstream"].get<std::vector<std::string>>();
+    }
+    std::string consumer = downstream.empty() ? "" : downstream.back();
+    downstream.push_back(cube_type);
+    for (std::string key : {"in_cube", "A", "B"}) {
+        if (j.count(key) > 0 && j[key].is_object()) {
+            j[key]["downstream"] = downstream;
+        }
+    }
+
+    std::shared_ptr<cube> out = cube_generators[cube_type](j);  //recursive creation, see below for cached input cubes
+
+    // Besides the requested cube, sources are cached such that pipelines sharing the same sources (e.g. with a different
+    // last step) read warped chunks from disk. Band selections are pushed into image collection cubes, so these are
+    // cached together with the selection. Further nodes can be cached with "cache": true in their JSON representation.
+    // Chunk stores and dummy cubes are cheap to read, there is no need to cache them.
+    bool wrap = cache || (j.count("cache") > 0 && j["cache"].get<bool>());
+    if (cube_type == "image_collection" && consumer != "select_bands") {
+        wrap = true;
+    } else if (cube_type == "select_bands" && j["in_cube"].count("cube_type") > 0 && j["in_cube"]["cube_type"] == "image_collection") {
+        wrap = true;
+    }
+    if (wrap && chunk_cache::enabled() && cube_type != "chunk_store" && cube_type != "dummy") {
+        return cached_cube::create(out);
+    }
+    return out;
 }
 
 void cube_factory::register_cube_type(std::string type_name,
@@ -63,69 +95,84 @@ void cube_factory::register_default() {
     /* register data cube types */
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "reduce", [](nlohmann::json& j) {
-            auto x = reduce_cube::create(instance()->create_from_json(j["in_cube"]), j["reducer"].get<std::string>());
+            auto x = reduce_cube::create(instance()->create_from_json(j["in_cube"], false), j["reducer"].get<std::string>());
             return x;
         }));
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "reduce_time", [](nlohmann::json& j) {
             // std::vector<std::pair<std::string, std::string>> band_reducers = j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>();
-            auto x = reduce_time_cube::create(instance()->create_from_json(j["in_cube"]), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>());
+            auto x = reduce_time_cube::create(instance()->create_from_json(j["in_cube"], false), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>());
             return x;
         }));
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "reduce_space", [](nlohmann::json& j) {
             // std::vector<std::pair<std::string, std::string>> band_reducers = j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>();
-            auto x = reduce_time_cube::create(instance()->create_from_json(j["in_cube"]), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>());
+            auto x = reduce_space_cube::create(instance()->create_from_json(j["in_cube"], false), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>());
             return x;
         }));
 
+    cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
+        "partial_reduce", [](nlohmann::json& j) {
+            return partial_reduce_cube::create(instance()->create_from_json(j["in_cube"], false), j["along"].get<std::string>(),
+                                               j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>(), j["nparts"].get<uint32_t>());
+        }));
+
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "window_time", [](nlohmann::json& j) {
             if (j.count("kernel") > 0) {
-                return window_time_cube::create(instance()->create_from_json(j["in_cube"]), j["kernel"].get<std::vector<double>>(),
+                return window_time_cube::create(instance()->create_from_json(j["in_cube"], false), j["kernel"].get<std::vector<double>>(),
                                                 j["win_size_l"].get<uint16_t>(), j["win_size_r"].get<std::uint16_t>());
             } else {
-                return window_time_cube::create(instance()->create_from_json(j["in_cube"]), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>(),
+                return window_time_cube::create(instance()->create_from_json(j["in_cube"], false), j["reducer_bands"].get<std::vector<std::pair<std::string, std::string>>>(),
                                                 j["win_size_l"].get<uint16_t>(), j["win_size_r"].get<std::uint16_t>());
             }
         }));
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "select_bands", [](nlohmann::json& j) {
-            auto x = select_bands_cube::create(instance()->create_from_json(j["in_cube"]), j["bands"].get<std::vector<std::string>>());
+            std::shared_ptr<cube> in = instance()->create_from_json(j["in_cube"], false);
+            std::shared_ptr<image_collection_cube> ic = std::dynamic_pointer_cast<image_collection_cube>(in);
+            if (ic && j["in_cube"].count("chunk_size") == 0 && config::instance()->get_auto_chunk_size()) {
+                // the band selection is pushed down into the image collection cube anyway, choose its chunk size for
+                // the selected bands only (see "image_collection" below)
+                ic->select_bands(j["bands"].get<std::vector<std::string>>());
+                ic->auto_chunk_size(j["in_cube"]["downstream"].get<std::vector<std::string>>());
+            }
+            auto x = select_bands_cube::create(in, j["bands"].get<std::vector<std::string>>());
             return x;
         }));
 
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "filter_pixel", [](nlohmann::json& j) {
-            auto x = filter_pixel_cube::create(instance()->create_from_json(j["in_cube"]), j["predicate"].get<std::string>());
+            auto x = filter_pixel_cube::create(instance()->create_from_json(j["in_cube"], false), j["predicate"].get<std::string>());
             return x;
         }));
 
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "fill_time", [](nlohmann::json& j) {
-            auto x = fill_time_cube::create(instance()->create_from_json(j["in_cube"]), j["method"].get<std::string>());
+            auto x = fill_time_cube::create(instance()->create_from_json(j["in_cube"], false), j["method"].get<std::string>());
             return x;
         }));
 
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "apply_pixel", [](nlohmann::json& j) {
             if (j.count("band_names") > 0) {
-                auto x = apply_pixel_cube::create(instance()->create_from_json(j["in_cube"]), j["expr"].get<std::vector<std::string>>(), j["band_names"].get<std::vector<std::string>>(), j["keep_bands"].get<bool>());
+                auto x = apply_pixel_cube::create(instance()->create_from_json(j["in_cube"], false), j["expr"].get<std::vector<std::string>>(), j["band_names"].get<std::vector<std::string>>(), j["keep_bands"].get<bool>());
                 return x;
             } else {
-                auto x = apply_pixel_cube::create(instance()->create_from_json(j["in_cube"]), j["expr"].get<std::vector<std::string>>(), {}, j["keep_bands"].get<bool>());
+                auto x = apply_pixel_cube::create(instance()->create_from_json(j["in_cube"], false), j["expr"].get<std::vector<std::string>>(), {}, j["keep_bands"].get<bool>());
                 return x;
             }
         }));
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "join_bands", [](nlohmann::json& j) {
-            auto x = join_bands_cube::create(instance()->create_from_json(j["A"]), instance()->create_from_json(j["B"]), j["prefix_A"].get<std::string>(), j["prefix_B"].get<std::string>());
+            auto x = join_bands_cube::create(instance()->create_from_json(j["A"], false), instance()->create_from_json(j["B"], false), j["prefix_A"].get<std::string>(), j["prefix_B"].get<std::string>());
             return x;
         }));
 
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "stream", [](nlohmann::json& j) {
-            auto x = stream_cube::create(instance()->create_from_json(j["in_cube"]), j["command"].get<std::string>(), j["file_streaming"].get<bool>());
+            bool persistent = j.count("persistent") > 0 ? j["persistent"].get<bool>() : false;
+            auto x = stream_cube::create(instance()->create_from_json(j["in_cube"], false), j["command"].get<std::string>(), j["file_streaming"].get<bool>(), persistent);
             return x;
         }));
 
@@ -136,7 +183,6 @@ void cube_factory::register_default() {
             }
             cube_view v = cube_view::read_json_string(j["view"].dump());
             auto x = image_collection_cube::create(j["file"].get<std::string>(), v);
-            x->set_chunk_size(j["chunk_size"][0].get<uint32_t>(), j["chunk_size"][1].get<uint32_t>(), j["chunk_size"][2].get<uint32_t>());
 
             if (j.count("mask") > 0) {
                 if (j["mask"].count("mask_type") == 0) {
@@ -157,6 +203,16 @@ void cube_factory::register_default() {
                 x->set_warp_args(j["warp_args"].get<std::vector<std::string>>());
             }
 
+            if (j.count("chunk_size") > 0) {
+                x->set_chunk_size(j["chunk_size"][0].get<uint32_t>(), j["chunk_size"][1].get<uint32_t>(), j["chunk_size"][2].get<uint32_t>());
+            } else if (config::instance()->get_auto_chunk_size()) {
+                std::vector<std::string> downstream = j.count("downstream") > 0 ? j["downstream"].get<std::vector<std::string>>() : std::vector<std::string>();
+                // band selections are pushed down later, the select_bands generator chooses the chunk size then
+                if (downstream.empty() || downstream.back() != "select_bands") {
+                    x->auto_chunk_size(downstream);
+                }
+            }
+
             return x;
         }));
 
@@ -168,15 +224,24 @@ void cube_factory::register_default() {
             return x;
         }));
 
+    cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
+        "chunk_store", [](nlohmann::json& j) {
+            if (!filesystem::exists(j["path"].get<std::string>())) {
+                throw std::string("ERROR in cube_generators[\"chunk_store\"](): chunk store file does not exist.");
+            }
+            auto x = chunk_store_cube::create(j["path"].get<std::string>());
+            return x;
+        }));
+
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "stream_reduce_time", [](nlohmann::json& j) {
-            auto x = stream_reduce_time_cube::create(instance()->create_from_json(j["in_cube"]), j["cmd"].get<std::string>(), j["nbands"].get<uint16_t>(), j["names"].get<std::vector<std::string>>());
+            auto x = stream_reduce_time_cube::create(instance()->create_from_json(j["in_cube"], false), j["cmd"].get<std::string>(), j["nbands"].get<uint16_t>(), j["names"].get<std::vector<std::string>>());
             return x;
         }));
 
     cube_generators.insert(std::make_pair<std::string, std::function<std::shared_ptr<cube>(nlohmann::json&)>>(
         "stream_apply_pixel", [](nlohmann::json& j) {
-            auto x = stream_apply_pixel_cube::create(instance()->create_from_json(j["in_cube"]), j["cmd"].get<std::string>(), j["nbands"].get<uint16_t>(), j["names"].get<std::vector<std::string>>(), j["keep_bands"].get<bool>());
+            auto x = stream_apply_pixel_cube::create(instance()->create_from_json(j["in_cube"], false), j["cmd"].get<std::string>(), j["nbands"].get<uint16_t>(), j["names"].get<std::vector<std::string>>(), j["keep_bands"].get<bool>());
             return x;
         }));
 }
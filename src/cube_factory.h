@@ -46,10 +46,16 @@ class cube_factory {
 
     /**
      * Create a cube from its JSON representation
+     *
+     * If the persistent chunk cache is enabled (see config::set_chunk_cache_dir()), the created cube
+     * is wrapped by a cached_cube. Within the graph, image collection cubes (including a band selection directly applied
+     * to them) and cubes with "cache": true in their JSON representation are wrapped, too.
+     *
      * @param j
+     * @param cache if false, the created cube will only be wrapped by a cached_cube if one of the rules above applies
      * @return
      */
-    std::shared_ptr<cube> create_from_json(nlohmann::json j);
+    std::shared_ptr<cube> create_from_json(nlohmann::json j, bool cache = true);
 
     /**
      * @brief Registers a cube type with a function to create objects of this type from a JSON description.
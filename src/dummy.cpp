@@ -28,6 +28,7 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> dummy_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("dummy_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "dummy", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
@@ -42,6 +43,7 @@ std::shared_ptr<chunk_data> dummy_cube::read_chunk(chunkid_t id) {
     double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
     std::fill(begin, end, _fill);
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -61,6 +61,7 @@ class dummy_cube : public cube {
 
     void set_chunk_size(uint32_t t, uint32_t y, uint32_t x) {
         _chunk_size = {t, y, x};
+        reset_chunk_empty();
     }
 
    public:
@@ -68,6 +69,11 @@ class dummy_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (id >= count_chunks() || std::isnan(_fill)) return chunk_status_type::EMPTY;
+        return chunk_status_type::NON_EMPTY;
+    }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "dummy";
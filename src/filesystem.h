@@ -190,12 +190,19 @@ class filesystem {
 #endif
     };
 
-    static uint32_t file_size(std::string p) {
+    static uint64_t file_size(std::string p) {
         VSIStatBufL s;
         if (VSIStatL(p.c_str(), &s) != 0)
             return 0;  // File / directory does not exist
         return s.st_size;
     }
+
+    static time_t last_write_time(std::string p) {
+        VSIStatBufL s;
+        if (VSIStatL(p.c_str(), &s) != 0)
+            return 0;  // File / directory does not exist
+        return s.st_mtime;
+    }
 };
 
 }  // namespace gdalcubes
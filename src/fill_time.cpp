@@ -4,9 +4,12 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("fill_time_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "fill_time", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
+    if (chunk_is_empty(id))
+        return out;
 
     coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
 
@@ -32,6 +35,19 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
         std::fill((double*)(in_chunks[id]->buf()), ((double*)(in_chunks[id]->buf())) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], NAN);
     }
 
+    // nothing to fill if the input chunk is known to have no missing values
+    bool all_valid = in_chunks[id]->has_validity();
+    for (uint32_t ib = 0; ib < size_btyx[0] && all_valid; ++ib) {
+        for (uint32_t it = 0; it < size_btyx[1] && all_valid; ++it) {
+            all_valid = in_chunks[id]->validity(ib, it) == chunk_data::slice_validity::ALL_VALID;
+        }
+    }
+    if (all_valid) {
+        std::memcpy(out->buf(), in_chunks[id]->buf(), size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double));
+        tm.bytes(out->total_size_bytes());
+        return out;
+    }
+
     // iterate over all pixel time series
     for (uint32_t ixy = 0; ixy < size_btyx[2] * size_btyx[3]; ++ixy) {
         // and all bands...
@@ -202,6 +218,7 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
         }
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
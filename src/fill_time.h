@@ -49,6 +49,16 @@ class fill_time_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (id >= count_chunks()) return chunk_status_type::EMPTY;
+        // values are filled from the complete time series
+        chunk_coordinate_tyx c = chunk_coords_from_id(id);
+        for (uint32_t it = 0; it < _in_cube->count_chunks_t(); ++it) {
+            if (!_in_cube->chunk_is_empty(_in_cube->chunk_id_from_coords({it, c[1], c[2]}))) return chunk_status_type::UNKNOWN;
+        }
+        return chunk_status_type::EMPTY;
+    }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "fill_time";
@@ -57,6 +67,16 @@ class fill_time_cube : public cube {
         return out;
     }
 
+   protected:
+    nlohmann::json explain_node() override {
+        nlohmann::json out = cube::explain_node();
+        // chunks are read until a non-NAN value is found for all time series, in the worst case the complete time series
+        out["input_reads"] = (uint64_t)count_chunks() * _in_cube->count_chunks_t();
+        out["input_chunks_in_memory"] = _in_cube->count_chunks_t();
+        out["input_reads_upper_bound"] = true;
+        return out;
+    }
+
    private:
     std::shared_ptr<cube> _in_cube;
     std::string _method;
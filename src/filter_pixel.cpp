@@ -29,6 +29,7 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("filter_pixel_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "filter_pixel", id);
 
     if (id >= count_chunks())
         return std::shared_ptr<chunk_data>();  // chunk is outside of the view, we don't need to read anything.
@@ -69,17 +70,32 @@ std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
     //double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
     // std::fill(begin, end, NAN);
 
-    for (uint32_t i = 0; i < in->size()[1] * in->size()[2] * in->size()[3]; ++i) {
-        for (uint16_t inb = 0; inb < in->size()[0]; ++inb) {
-            values[inb] = ((double*)in->buf())[inb * in->size()[1] * in->size()[2] * in->size()[3] + i];
+    uint32_t nxy = in->size()[2] * in->size()[3];
+    for (uint32_t it = 0; it < in->size()[1]; ++it) {
+        // time slices without any data in all bands stay empty, whatever the predicate says
+        bool all_missing = true;
+        for (uint16_t inb = 0; inb < in->size()[0] && all_missing; ++inb) {
+            all_missing = in->validity(inb, it) == chunk_data::slice_validity::ALL_MISSING;
         }
-        if (te_eval(expr) != 0) {
+        if (all_missing) {
             for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
-                ((double*)out->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i] = ((double*)in->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i];
+                double* begin = ((double*)out->buf()) + ib * in->size()[1] * nxy + it * nxy;
+                std::fill(begin, begin + nxy, NAN);
             }
-        } else {
-            for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
-                ((double*)out->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i] = NAN;
+            continue;
+        }
+        for (uint32_t i = it * nxy; i < (it + 1) * nxy; ++i) {
+            for (uint16_t inb = 0; inb < in->size()[0]; ++inb) {
+                values[inb] = ((double*)in->buf())[inb * in->size()[1] * nxy + i];
+            }
+            if (te_eval(expr) != 0) {
+                for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
+                    ((double*)out->buf())[ib * in->size()[1] * nxy + i] = ((double*)in->buf())[ib * in->size()[1] * nxy + i];
+                }
+            } else {
+                for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
+                    ((double*)out->buf())[ib * in->size()[1] * nxy + i] = NAN;
+                }
             }
         }
     }
@@ -90,6 +106,7 @@ std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
         delete[] vars[i].name;
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -29,6 +29,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
 #include "build_info.h"
+#include "chunk_cache.h"
 #include "cube_factory.h"
 #include "filesystem.h"
 #include "image_collection.h"
@@ -73,7 +74,7 @@ void print_usage(std::string command = "") {
         std::cout << "Print information about a specified GDAL image collection (SOURCE)." << std::endl;
         std::cout << std::endl;
     } else if (command == "exec") {
-        std::cout << "Usage: gdalcubes exec [options] SOURCE DEST" << std::endl;
+        std::cout << "Usage: gdalcubes exec [options] SOURCE [DEST]" << std::endl;
         std::cout << std::endl;
         std::cout << "Evaluate a JSON-serialized SOURCE data cube and store the result as a NetCDF file (DEST)."
                   << std::endl;
@@ -82,6 +83,13 @@ void print_usage(std::string command = "") {
         std::cout << "    , --deflate            Deflate compression level for output NetCDF file (0=no compression, 9=max compression), defaults to 1" << std::endl;
         std::cout << "  -t, --threads            Number of threads used for parallel chunk processing, defaults to 1" << std::endl;
         std::cout << "      --swarm              Filename of a simple text file where each line points to a gdalcubes server API endpoint" << std::endl;
+        std::cout << "      --materialize        Store the result as a gdalcubes chunk store file instead of a NetCDF file" << std::endl;
+        std::cout << "      --resume             Continue an interrupted netCDF export to the same output file, only missing chunks are computed" << std::endl;
+        std::cout << "      --cache              Directory of a persistent chunk cache that is reused across runs" << std::endl;
+        std::cout << "      --cache-max          Maximum size of the chunk cache in MiB, defaults to 4096" << std::endl;
+        std::cout << "      --trace              Record chunk reads and internal phases and write them as Chrome trace JSON to the given file" << std::endl;
+        std::cout << "      --explain            Estimate the cost of computing the cube without reading any pixels and print it as JSON, DEST is not needed" << std::endl;
+        std::cout << "      --memory             Memory available for chunk buffers in MiB, used by --explain to recommend the number of threads" << std::endl;
         std::cout << "  -d, --debug              Print debug messages" << std::endl;
         std::cout << std::endl;
     } else if (command == "addo") {
@@ -277,6 +285,13 @@ int main(int argc, char* argv[]) {
             exec_desc.add_options()("threads,t", po::value<uint16_t>()->default_value(1), "");
             exec_desc.add_options()("swarm", po::value<std::string>(), "");
             exec_desc.add_options()("deflate", po::value<uint8_t>()->default_value(1), "");
+            exec_desc.add_options()("materialize", "");
+            exec_desc.add_options()("resume", "");
+            exec_desc.add_options()("cache", po::value<std::string>(), "");
+            exec_desc.add_options()("cache-max", po::value<uint64_t>()->default_value(4096), "");
+            exec_desc.add_options()("trace", po::value<std::string>(), "");
+            exec_desc.add_options()("explain", "");
+            exec_desc.add_options()("memory", po::value<uint64_t>()->default_value(0), "");
 
             po::positional_options_description exec_pos;
             exec_pos.add("input", 1);
@@ -293,7 +308,27 @@ int main(int argc, char* argv[]) {
             }
 
             std::string input = vm["input"].as<std::string>();
+
+            if (vm.count("explain")) {
+                std::ifstream i(input);
+                nlohmann::json j;
+                i >> j;
+                std::shared_ptr<cube> c = cube_factory::instance()->create_from_json(j);
+                std::cout << c->explain(vm["memory"].as<uint64_t>() * 1024 * 1024).dump(2) << std::endl;
+                config::instance()->gdalcubes_cleanup();
+                return 0;
+            }
+            if (!vm.count("output")) {
+                std::cout << "ERROR in gdalcubes exec: missing output file." << std::endl;
+                print_usage("exec");
+                return 1;
+            }
             std::string output = vm["output"].as<std::string>();
+            if (vm.count("materialize") && vm.count("resume")) {
+                std::cout << "ERROR in gdalcubes exec: --resume is only supported for netCDF exports and cannot be combined with --materialize." << std::endl;
+                print_usage("exec");
+                return 1;
+            }
 
             uint16_t nthreads = vm["threads"].as<uint16_t>();
             uint8_t deflate = vm["deflate"].as<uint8_t>();
@@ -308,12 +343,36 @@ int main(int argc, char* argv[]) {
                 }
             }
 
+            if (vm.count("cache")) {
+                config::instance()->set_chunk_cache_dir(vm["cache"].as<std::string>());
+                config::instance()->set_chunk_cache_max(vm["cache-max"].as<uint64_t>() * 1024 * 1024);
+            }
+
+            if (vm.count("trace")) {
+                config::instance()->set_trace(true);
+            }
+
             std::ifstream i(input);
             nlohmann::json j;
             i >> j;
 
             std::shared_ptr<cube> c = cube_factory::instance()->create_from_json(j);
-            c->write_netcdf_file(output, deflate);
+            if (vm.count("materialize")) {
+                c->materialize(output, "float64", vm["deflate"].defaulted() ? 0 : deflate);  // uncompressed chunk stores can be memory mapped
+            } else {
+                c->write_netcdf_file(output, deflate, false, true, packed_export::make_none(), false, config::instance()->get_default_chunk_processor(), vm.count("resume") > 0);
+            }
+
+            if (vm.count("trace")) {
+                config::instance()->set_trace(false);
+                trace::write_chrome_json(vm["trace"].as<std::string>());
+            }
+
+            if (vm.count("cache")) {
+                chunk_cache_stats s = chunk_cache::instance()->stats();
+                std::cout << "Chunk cache: " << s.hits << " hits, " << s.misses << " misses (hit ratio " << s.hit_ratio() << "), "
+                          << s.bytes_saved / (1024 * 1024) << " MiB saved, " << s.bytes_written / (1024 * 1024) << " MiB written" << std::endl;
+            }
 
         } else if (cmd == "addo") {
             po::options_description addo_desc("addo arguments");
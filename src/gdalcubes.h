@@ -29,6 +29,9 @@
 
 #include "apply_pixel.h"
 #include "build_info.h"
+#include "chunk_cache.h"
+#include "chunk_codec.h"
+#include "chunk_store.h"
 #include "config.h"
 #include "cube.h"
 #include "dummy.h"
@@ -36,6 +39,9 @@
 #include "filter_pixel.h"
 #include "image_collection_cube.h"
 #include "join_bands.h"
+#include "map_tiles.h"
+#include "metrics.h"
+#include "partial_reduce.h"
 #include "progress.h"
 #include "reduce.h"
 #include "reduce_space.h"
@@ -45,6 +51,7 @@
 #include "stream_apply_pixel.h"
 #include "stream_reduce_time.h"
 #include "swarm.h"
+#include "trace.h"
 #include "utils.h"
 #include "vector_queries.h"
 #include "window_time.h"
@@ -0,0 +1,168 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "hash.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace gdalcubes {
+
+namespace {
+const uint64_t P1 = 11400714785074694791ULL;
+const uint64_t P2 = 14029467366897019727ULL;
+const uint64_t P3 = 1609587929392839161ULL;
+const uint64_t P4 = 9650029242287828579ULL;
+const uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const uint8_t *p) {
+    uint64_t x;
+    std::memcpy(&x, p, 8);  // assumes little endian
+    return x;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+    uint32_t x;
+    std::memcpy(&x, p, 4);
+    return x;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * P1 + P4;
+}
+}  // namespace
+
+xxhash64::xxhash64(uint64_t seed) : _seed(seed), _v(), _buf(), _buf_size(0), _total(0) {
+    _v[0] = seed + P1 + P2;
+    _v[1] = seed + P2;
+    _v[2] = seed;
+    _v[3] = seed - P1;
+}
+
+void xxhash64::update(const void *data, uint64_t n) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + n;
+    _total += n;
+
+    if (_buf_size + n < 32) {
+        std::memcpy(_buf + _buf_size, p, n);
+        _buf_size += n;
+        return;
+    }
+    if (_buf_size > 0) {
+        uint32_t fill = 32 - _buf_size;
+        std::memcpy(_buf + _buf_size, p, fill);
+        for (uint16_t i = 0; i < 4; ++i) {
+            _v[i] = round(_v[i], read64(_buf + 8 * i));
+        }
+        p += fill;
+        _buf_size = 0;
+    }
+    while (p + 32 <= end) {
+        for (uint16_t i = 0; i < 4; ++i) {
+            _v[i] = round(_v[i], read64(p + 8 * i));
+        }
+        p += 32;
+    }
+    if (p < end) {
+        std::memcpy(_buf, p, end - p);
+        _buf_size = end - p;
+    }
+}
+
+uint64_t xxhash64::digest() const {
+    uint64_t h;
+    if (_total >= 32) {
+        h = rotl(_v[0], 1) + rotl(_v[1], 7) + rotl(_v[2], 12) + rotl(_v[3], 18);
+        for (uint16_t i = 0; i < 4; ++i) {
+            h = merge_round(h, _v[i]);
+        }
+    } else {
+        h = _seed + P5;
+    }
+    h += _total;
+
+    const uint8_t *p = _buf;
+    const uint8_t *end = _buf + _buf_size;
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string xxhash64::hexdigest() const {
+    static const char HEX[] = "0123456789abcdef";
+    uint64_t h = digest();
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        out[i] = HEX[h & 0xF];
+        h >>= 4;
+    }
+    return out;
+}
+
+std::string xxhash64::file(std::string path) {
+    std::ifstream is(path, std::ifstream::in | std::ifstream::binary);
+    if (!is.is_open()) {
+        throw std::string("ERROR in xxhash64::file(): cannot open file '" + path + "'");
+    }
+    xxhash64 h;
+    std::vector<char> buf(1024 * 1024 * 4);
+    while (is) {
+        is.read(buf.data(), buf.size());
+        h.update(buf.data(), is.gcount());
+    }
+    return h.hexdigest();
+}
+
+}  // namespace gdalcubes
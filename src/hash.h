@@ -0,0 +1,79 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <string>
+
+namespace gdalcubes {
+
+/**
+ * @brief Streaming implementation of the 64 bit xxHash (XXH64) function
+ *
+ * The hash is not cryptographic but very fast and is used to detect whether files have the same content, e.g.
+ * before uploading files to gdalcubes_server instances.
+ *
+ * @see https://github.com/Cyan4973/xxHash
+ */
+class xxhash64 {
+   public:
+    xxhash64(uint64_t seed = 0);
+
+    /**
+     * @brief Add data to the hash
+     * @param data pointer to input data
+     * @param n number of bytes
+     */
+    void update(const void *data, uint64_t n);
+
+    /**
+     * @brief Compute the hash of all data added so far
+     */
+    uint64_t digest() const;
+
+    /**
+     * @brief Compute the hash of all data added so far as a 16 characters hexadecimal string
+     */
+    std::string hexdigest() const;
+
+    /**
+     * @brief Compute the hash of a file's content
+     * @param path path of the file
+     * @return 16 characters hexadecimal string
+     */
+    static std::string file(std::string path);
+
+   private:
+    uint64_t _seed;
+    uint64_t _v[4];
+    uint8_t _buf[32];
+    uint32_t _buf_size;
+    uint64_t _total;
+};
+
+}  // namespace gdalcubes
+
+#endif  //HASH_H
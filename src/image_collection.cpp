@@ -30,10 +30,27 @@
 #include "config.h"
 #include "external/date.h"
 #include "filesystem.h"
+#include "metrics.h"
 #include "utils.h"
 
 namespace gdalcubes {
 
+#if SQLITE_VERSION_NUMBER >= 3014000
+// records the duration of executed SQL statements in metrics::sqlite_query() and as trace spans
+static int sqlite_profile_callback(unsigned int type, void *ctx, void *stmt, void *x) {
+    if (type == SQLITE_TRACE_PROFILE) {
+        sqlite3_int64 ns = *((sqlite3_int64 *)x);
+        metrics::instance()->sqlite_query().observe((double)ns * 1e-9);
+        if (trace::enabled()) {
+            // the callback is invoked when the statement has finished
+            uint64_t dur = ns / 1000;
+            trace::add(trace_event{"SQL", "phase", trace::now() - dur, dur, std::this_thread::get_id(), nlohmann::json()});
+        }
+    }
+    return 0;
+}
+#endif
+
 image_collection::image_collection(collection_format format) : _format(format), _filename(""), _db(nullptr) {
     if (sqlite3_open_v2("", &_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
         std::string msg = "ERROR in image_collection::create(): cannot create temporary image collection file.";
@@ -42,6 +59,9 @@ image_collection::image_collection(collection_format format) : _format(format),
 
     // Enable foreign key constraints
     sqlite3_db_config(_db, SQLITE_DBCONFIG_ENABLE_FKEY, 1, NULL);
+#if SQLITE_VERSION_NUMBER >= 3014000
+    sqlite3_trace_v2(_db, SQLITE_TRACE_PROFILE, sqlite_profile_callback, NULL);
+#endif
 
     // Create tables
 
@@ -132,6 +152,9 @@ image_collection::image_collection(std::string filename) : _format(), _filename(
     }
     // Enable foreign key constraints
     sqlite3_db_config(_db, SQLITE_DBCONFIG_ENABLE_FKEY, 1, NULL);
+#if SQLITE_VERSION_NUMBER >= 3014000
+    sqlite3_trace_v2(_db, SQLITE_TRACE_PROFILE, sqlite_profile_callback, NULL);
+#endif
 
     // load format from database
     std::string sql_select_format = "SELECT value FROM \"collection_md\" WHERE key='collection_format';";
@@ -592,7 +615,7 @@ uint32_t image_collection::count_images() {
         throw std::string("ERROR in image_collection::count_images(): cannot read query result");
     }
     sqlite3_step(stmt);
-    uint16_t out = sqlite3_column_int(stmt, 0);
+    uint32_t out = sqlite3_column_int(stmt, 0);
     sqlite3_finalize(stmt);
     return out;
 }
@@ -606,7 +629,7 @@ uint32_t image_collection::count_gdalrefs() {
         throw std::string("ERROR in image_collection::count_gdalrefs(): cannot read query result");
     }
     sqlite3_step(stmt);
-    uint16_t out = sqlite3_column_int(stmt, 0);
+    uint32_t out = sqlite3_column_int(stmt, 0);
     sqlite3_finalize(stmt);
     return out;
 }
@@ -656,7 +679,7 @@ void image_collection::filter_datetime_range(date::sys_seconds start, date::sys_
 
     os << date::format("%Y-%m-%dT%H:%M:%S", start);
     std::string start_str = os.str();
-    os.clear();
+    os.str("");
     os << date::format("%Y-%m-%dT%H:%M:%S", end);
     std::string end_str = os.str();
 
@@ -849,6 +872,29 @@ std::vector<image_collection::gdalrefs_row> image_collection::get_gdalrefs() {
     return out;
 }
 
+std::vector<image_collection::gdalrefs_row> image_collection::get_gdalrefs_sample(uint16_t n) {
+    std::vector<image_collection::gdalrefs_row> out;
+
+    // SQLite takes bare columns from the row where min(band_id) is found
+    std::string sql = "SELECT image_id, min(band_id), descriptor, band_num FROM gdalrefs WHERE image_id IN (SELECT id FROM images ORDER BY id LIMIT " + std::to_string(n) + ") GROUP BY image_id";
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(_db, sql.c_str(), -1, &stmt, NULL);
+    if (!stmt) {
+        throw std::string("ERROR in image_collection::get_gdalrefs_sample(): cannot prepare query statement");
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        image_collection::gdalrefs_row row;
+        row.image_id = sqlite3_column_int(stmt, 0);
+        row.band_id = sqlite3_column_int(stmt, 1);
+        row.descriptor = sqlite_as_string(stmt, 2);
+        row.band_num = sqlite3_column_int(stmt, 3);
+        out.push_back(row);
+    }
+    sqlite3_finalize(stmt);
+    return out;
+}
+
 std::vector<image_collection::images_row> image_collection::get_images() {
     std::vector<image_collection::images_row> out;
     std::string sql = "SELECT id, name, left, top, bottom, right, datetime, proj FROM images";
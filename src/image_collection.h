@@ -319,6 +319,16 @@ class image_collection {
 
     std::vector<image_collection::gdalrefs_row> get_gdalrefs();
 
+    /**
+     * @brief Get one GDAL dataset reference for each of the first n images in the collection
+     *
+     * This is much cheaper than get_gdalrefs() for large collections and can be used to inspect the
+     * internal layout (e.g. block sizes and overviews) of a few representative images.
+     * @param n maximum number of images
+     * @return references to the band with smallest id per image
+     */
+    std::vector<image_collection::gdalrefs_row> get_gdalrefs_sample(uint16_t n);
+
     std::vector<image_collection::images_row> get_images();
 
     /**
@@ -24,6 +24,9 @@
 #include "image_collection_cube.h"
 
 #include <gdal_utils.h>
+#include "aggregation_state.h"
+#include "chunk_size_advisor.h"
+#include <limits>
 #include <map>
 #include "error.h"
 #include "utils.h"
@@ -44,6 +47,24 @@ image_collection_cube::image_collection_cube(std::string icfile) : cube(), _coll
     load_bands();
 }
 
+void image_collection_cube::auto_chunk_size(std::vector<std::string> downstream) {
+    source_layout src = chunk_size_advisor::sample_layout(_collection, view()->srs());
+    _chunk_size = chunk_size_advisor::suggest(src, *view(), _bands.count(), downstream, config::instance()->get_chunk_memory_budget());
+    reset_chunk_empty();
+    GCBS_DEBUG("Automatic chunk size (" + std::to_string(_chunk_size[0]) + "," + std::to_string(_chunk_size[1]) + "," + std::to_string(_chunk_size[2]) + ") from source layout " + src.as_json().dump());
+}
+
+chunk_status_type image_collection_cube::chunk_status(chunkid_t id) {
+    if (id >= count_chunks()) return chunk_status_type::EMPTY;
+    std::vector<std::string> bands;
+    for (uint16_t i = 0; i < _bands.count(); ++i) {
+        bands.push_back(_bands.get(i).name);
+    }
+    std::vector<image_collection::find_range_st_row> datasets = _collection->find_range_st(bounds_from_chunk(id), _st_ref->srs(), bands, std::vector<std::string>());
+    if (datasets.empty()) return chunk_status_type::EMPTY;
+    return chunk_status_type::UNKNOWN;  // images may contain NoData only
+}
+
 std::string image_collection_cube::to_string() {
     std::stringstream out;
     std::shared_ptr<cube_view> x = std::dynamic_pointer_cast<cube_view>(_st_ref);
@@ -51,255 +72,57 @@ std::string image_collection_cube::to_string() {
     return out.str();
 }
 
-struct aggregation_state {
-   public:
-    aggregation_state(coords_nd<uint32_t, 4> size_btyx) : _size_btyx(size_btyx) {}
-    virtual ~aggregation_state() {}
-
-    virtual void init() = 0;
-    virtual void update(void *chunk_buf, void *img_buf, uint32_t t) = 0;
-    virtual void finalize(void *buf) = 0;
+nlohmann::json image_collection_cube::explain_node() {
+    nlohmann::json out = cube::explain_node();
 
-   protected:
-    coords_nd<uint32_t, 4> _size_btyx;
-};
-
-struct aggregation_state_mean : public aggregation_state {
-    aggregation_state_mean(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx), _m_count() {}
-
-    ~aggregation_state_mean() {}
-
-    void init() override {
-        _m_count.resize(_size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]);
+    std::map<std::string, uint16_t> band_bytes;
+    std::vector<image_collection::bands_row> bands = _collection->get_all_bands();
+    for (uint16_t ib = 0; ib < bands.size(); ++ib) {
+        band_bytes[bands[ib].name] = GDALGetDataTypeSizeBytes(bands[ib].type);
     }
 
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
-                    _m_count[chunk_buf_offset + i] = 1;
-                } else {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] += ((double *)img_buf)[img_buf_offset + i];
-                    _m_count[chunk_buf_offset + i] += 1;
-                }
-            }
+    uint32_t empty_chunks = 0;
+    uint64_t image_reads = 0;
+    uint64_t bytes_total = 0;
+    uint32_t images_min = std::numeric_limits<uint32_t>::max();
+    uint32_t images_max = 0;
+    uint64_t bytes_min = std::numeric_limits<uint64_t>::max();
+    uint64_t bytes_max = 0;
+    std::set<uint32_t> distinct_images;
+    for (chunkid_t id = 0; id < count_chunks(); ++id) {
+        std::vector<image_collection::find_range_st_row> datasets = _collection->find_range_st(bounds_from_chunk(id), _st_ref->srs(), std::vector<std::string>(), std::vector<std::string>());
+        coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+        std::set<uint32_t> images;
+        uint64_t bytes = 0;
+        for (uint32_t i = 0; i < datasets.size(); ++i) {
+            if (!_bands.has(datasets[i].band_name) && datasets[i].band_name != _mask_band) continue;
+            images.insert(datasets[i].image_id);
+            bytes += (uint64_t)size_tyx[1] * size_tyx[2] * band_bytes[datasets[i].band_name];
         }
+        if (images.empty()) ++empty_chunks;
+        image_reads += images.size();
+        bytes_total += bytes;
+        images_min = std::min(images_min, (uint32_t)images.size());
+        images_max = std::max(images_max, (uint32_t)images.size());
+        bytes_min = std::min(bytes_min, bytes);
+        bytes_max = std::max(bytes_max, bytes);
+        distinct_images.insert(images.begin(), images.end());
     }
 
-    void finalize(void *buf) override {
-        for (uint32_t i = 0; i < _size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]; ++i) {
-            if (!std::isnan(((double *)buf)[i])) {
-                ((double *)buf)[i] /= (double)(_m_count[i]);
-            }
-        }
-        _m_count.clear();
-    }
-
-   private:
-    std::vector<uint32_t> _m_count;
-};
-
-struct aggregation_state_median : public aggregation_state {
-    aggregation_state_median(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {
-        _m_buckets.resize(_size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]);
-    }
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        // iterate over all pixels
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            // uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i]))
-                    continue;
-                else {
-                    _m_buckets[ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3] +
-                               i]
-                        .push_back(((double *)img_buf)[img_buf_offset + i]);
-                }
-            }
-        }
-    }
-
-    void finalize(void *buf) override {
-        for (uint32_t i = 0; i < _size_btyx[0] * _size_btyx[1] * _size_btyx[2] * _size_btyx[3]; ++i) {
-            std::vector<double> &list = _m_buckets[i];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                ((double *)buf)[i] = NAN;
-            } else if (list.size() % 2 == 1) {
-                ((double *)buf)[i] = list[list.size() / 2];
-            } else {
-                ((double *)buf)[i] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
-            }
-        }
-    }
-
-   private:
-    std::vector<std::vector<double>> _m_buckets;
-};
-
-struct aggregation_state_first : public aggregation_state {
-    aggregation_state_first(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset =
-                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                if (!std::isnan(((double *)chunk_buf)[chunk_buf_offset + i]))
-                    continue;
-                else {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
-                }
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_count_values : public aggregation_state {
-    aggregation_state_count_values(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset =
-                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = 0;
-                }
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                ((double *)chunk_buf)[chunk_buf_offset + i] += 1;
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_count_images : public aggregation_state {
-    aggregation_state_count_images(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset =
-                ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            //uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = 0;
-                }
-                ((double *)chunk_buf)[chunk_buf_offset + i] += 1;
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_last : public aggregation_state {
-    aggregation_state_last(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_min : public aggregation_state {
-    aggregation_state_min(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
-                } else {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = std::min(((double *)chunk_buf)[chunk_buf_offset + i], ((double *)img_buf)[img_buf_offset + i]);
-                }
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_max : public aggregation_state {
-    aggregation_state_max(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            // iterate over all pixels
-            for (uint32_t i = 0; i < _size_btyx[2] * _size_btyx[3]; ++i) {
-                if (std::isnan(((double *)img_buf)[img_buf_offset + i])) continue;
-                if (std::isnan(((double *)chunk_buf)[chunk_buf_offset + i])) {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = ((double *)img_buf)[img_buf_offset + i];
-                } else {
-                    ((double *)chunk_buf)[chunk_buf_offset + i] = std::max(((double *)chunk_buf)[chunk_buf_offset + i], ((double *)img_buf)[img_buf_offset + i]);
-                }
-            }
-        }
-    }
-
-    void finalize(void *buf) override {}
-};
-
-struct aggregation_state_none : public aggregation_state {
-    aggregation_state_none(coords_nd<uint32_t, 4> size_btyx) : aggregation_state(size_btyx) {}
-
-    void init() override {}
-    void update(void *chunk_buf, void *img_buf, uint32_t t) override {
-        for (uint32_t ib = 0; ib < _size_btyx[0]; ++ib) {
-            uint32_t chunk_buf_offset = ib * _size_btyx[1] * _size_btyx[2] * _size_btyx[3] + t * _size_btyx[2] * _size_btyx[3];
-            uint32_t img_buf_offset = ib * _size_btyx[2] * _size_btyx[3];
-            memcpy(((double *)chunk_buf) + chunk_buf_offset, ((double *)img_buf) + img_buf_offset, sizeof(double) * _size_btyx[2] * _size_btyx[3]);
-        }
-    }
-    void finalize(void *buf) override {}
-};
+    nlohmann::json sources;
+    sources["empty_chunks"] = empty_chunks;
+    sources["images"] = distinct_images.size();
+    sources["image_reads"] = image_reads;
+    sources["image_reread_factor"] = distinct_images.empty() ? 0.0 : (double)image_reads / distinct_images.size();
+    sources["images_per_chunk"] = {{"min", count_chunks() > 0 ? images_min : 0}, {"mean", count_chunks() > 0 ? (double)image_reads / count_chunks() : 0.0}, {"max", images_max}};
+    sources["bytes_per_chunk"] = {{"min", count_chunks() > 0 ? bytes_min : 0}, {"mean", count_chunks() > 0 ? (double)bytes_total / count_chunks() : 0.0}, {"max", bytes_max}};
+    sources["bytes"] = bytes_total;
+    out["sources"] = sources;
+
+    // warped image and mask buffers in addition to the chunk buffer
+    out["extra_bytes"] = (uint64_t)(_bands.count() + (_mask ? 1 : 0)) * _chunk_size[1] * _chunk_size[2] * sizeof(double);
+    return out;
+}
 
 /*
  * The procedure to read data for a chunk is the following:
@@ -310,6 +133,7 @@ struct aggregation_state_none : public aggregation_state {
  */
 std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("image_collection_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "image_collection", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks()) {
         // chunk is outside of the cube, we don't need to read anything.
@@ -320,7 +144,10 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     // Find intersecting images from collection and iterate over these
     // Note that these are ordered by image id and descriptor
     bounds_st cextent = bounds_from_chunk(id);
+    trace_span span_find("find_range_st");
     std::vector<image_collection::find_range_st_row> datasets = _collection->find_range_st(cextent, _st_ref->srs(), std::vector<std::string>(), std::vector<std::string>{"gdalrefs.image_id", "gdalrefs.descriptor"});
+    span_find.arg("datasets", datasets.size());
+    span_find.end();
 
     if (datasets.empty()) {
         GCBS_DEBUG("Chunk " + std::to_string(id) + " does not intersect with any image from the image_collection_cube");
@@ -344,26 +171,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     OGRSpatialReference proj_out;
     proj_out.SetFromUserInput(_st_ref->srs().c_str());
 
-    aggregation_state *agg = nullptr;
-    if (view()->aggregation_method() == aggregation::aggregation_type::AGG_MEAN) {
-        agg = new aggregation_state_mean(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_MIN) {
-        agg = new aggregation_state_min(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_MAX) {
-        agg = new aggregation_state_max(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_FIRST) {
-        agg = new aggregation_state_first(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_LAST) {
-        agg = new aggregation_state_last(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_MEDIAN) {
-        agg = new aggregation_state_median(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_IMAGE_COUNT) {
-        agg = new aggregation_state_count_images(size_btyx);
-    } else if (view()->aggregation_method() == aggregation::aggregation_type::AGG_VALUE_COUNT) {
-        agg = new aggregation_state_count_values(size_btyx);
-    } else
-        agg = new aggregation_state_none(size_btyx);
-
+    aggregation_state *agg = aggregation_state::create(view()->aggregation_method(), size_btyx);
     agg->init();
 
     void *img_buf = std::calloc(size_btyx[0] * size_btyx[3] * size_btyx[2], sizeof(double));
@@ -413,7 +221,11 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
         std::fill((double *)img_buf, ((double *)img_buf) + size_btyx[0] * size_btyx[3] * size_btyx[2], NAN);
 
         for (auto it = image_datasets.begin(); it != image_datasets.end(); ++it) {
+            trace_span span_open("GDALOpen");
+            span_open.arg("file", it->first);
             GDALDataset *g = (GDALDataset *)GDALOpen(it->first.c_str(), GA_ReadOnly);
+            metrics::instance()->count_gdal_open();
+            span_open.end();
             if (!g) {
                 throw std::string("ERROR in image_collection_cube::read_chunk(): GDAL cannot open'" + it->first + "'");
             }
@@ -493,12 +305,17 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
             //            ss << it->first;
             //            GCBS_TRACE(ss.str());
 
+            trace_span span_warp("GDALWarp");
             GDALDataset *gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&g), warp_opts, NULL);
+            metrics::instance()->count_gdal_warp();
+            span_warp.end();
 
             // GDALDataset *gdal_out = (GDALDataset *)GDALWarp(("/vsimem/" + std::to_string(id) + "_" + std::to_string(i) + ".tif").c_str(), NULL, 1, (GDALDatasetH *)(&g), warp_opts, NULL);
             GDALWarpAppOptionsFree(warp_opts);
 
             // For each band, call RasterIO to read and copy data to the right position in the buffers
+            trace_span span_rasterio("RasterIO");
+            span_rasterio.arg("bands", it->second.size());
             for (uint16_t b = 0; b < it->second.size(); ++b) {
                 uint16_t b_internal = _bands.get_index(std::get<0>(it->second[b]));
 
@@ -512,6 +329,8 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                 }
             }
 
+            span_rasterio.end();
+
             GDALClose(g);
             GDALClose(gdal_out);
         }
@@ -519,6 +338,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
         // now, we have filled img_buf with data from all available bands
 
         if (_mask) {
+            trace_span span_mask("mask");
             // if we apply a mask, we again read the mask band with NN / MODE resampling
             // read mask again (with NN
 
@@ -527,6 +347,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                 GCBS_WARN("Missing mask band for image '" + image_name + "', mask will be ignored");
             } else {
                 GDALDataset *g = (GDALDataset *)GDALOpen(mask_dataset_band.first.c_str(), GA_ReadOnly);
+                metrics::instance()->count_gdal_open();
                 if (!g) {
                     throw std::string("ERROR in image_collection_cube::read_chunk(): GDAL cannot open'" + mask_dataset_band.first + "'");
                 }
@@ -591,6 +412,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                 //                GCBS_DEBUG(ss.str());
 
                 GDALDataset *gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&g), warp_opts, NULL);
+                metrics::instance()->count_gdal_warp();
 
                 GDALWarpAppOptionsFree(warp_opts);
 
@@ -605,6 +427,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
         }
 
         // feed the aggregator
+        trace_span span_agg("aggregation");
         agg->update(out->buf(), img_buf, itime);
     }
 
@@ -614,6 +437,11 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     std::free(img_buf);
     if (mask_buf) std::free(mask_buf);
 
+    // masked and partially covered chunks often contain large regions of missing values,
+    // downstream operations use the validity summaries to skip these
+    out->defer_validity();
+
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
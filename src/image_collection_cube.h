@@ -284,12 +284,29 @@ class image_collection_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    /**
+     * @copydoc cube::chunk_status()
+     * @note Queries the image collection index, chunks that do not intersect with any image of the selected bands are empty.
+     */
+    chunk_status_type chunk_status(chunkid_t id) override;
+
     // image_collection_cube is the only class that supports changing chunk sizes from outside!
     // This is important for e.g. streaming.
     void set_chunk_size(uint32_t t, uint32_t y, uint32_t x) {
         _chunk_size = {t, y, x};
+        reset_chunk_empty();
     }
 
+    /**
+     * @brief Choose the chunk size based on the layout of images in the collection, the view, and the downstream operations
+     *
+     * Opens a few images of the collection to derive block sizes, overviews, and resolution and limits the size of chunks
+     * by config::get_chunk_memory_budget(). Bands and masks should be set before calling this function.
+     * @param downstream cube types of operations that consume this cube, e.g. {"reduce_time"}
+     * @see chunk_size_advisor
+     */
+    void auto_chunk_size(std::vector<std::string> downstream = {});
+
     nlohmann::json make_constructible_json() override {
         if (_collection->is_temporary()) {
             throw std::string("ERROR in image_collection_cube::make_constructible_json(): image collection is temporary, please export as file using write() first.");
@@ -310,6 +327,13 @@ class image_collection_cube : public cube {
     static cube_view default_view(std::shared_ptr<image_collection> ic);
 
    protected:
+    /**
+     * @copydoc cube::explain_node()
+     * @note Queries the image collection index once per chunk to count intersecting images and to estimate the bytes
+     * read per chunk, assuming that images are read at the resolution of the view.
+     */
+    nlohmann::json explain_node() override;
+
     virtual void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
         // _st_ref has always type cube_view, whereas stref can have types st_reference or cube_view
 
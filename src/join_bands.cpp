@@ -28,9 +28,12 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> join_bands_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("join_bands_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "join_bands", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
+    if (chunk_is_empty(id))
+        return out;
 
     coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
     coords_nd<uint32_t, 4> size_btyx = {_bands.count(), size_tyx[0], size_tyx[1], size_tyx[2]};
@@ -46,8 +49,10 @@ std::shared_ptr<chunk_data> join_bands_cube::read_chunk(chunkid_t id) {
     std::fill(begin, end, NAN);
 
     memcpy(((double *)out->buf()), ((double *)dat_A->buf()), dat_A->size()[0] * dat_A->size()[1] * dat_A->size()[2] * dat_A->size()[3] * sizeof(double));
-    memcpy(((double *)out->buf()) + dat_A->size()[0] * dat_A->size()[1] * dat_A->size()[2] * dat_A->size()[3], ((double *)dat_B->buf()), dat_B->size()[0] * dat_B->size()[1] * dat_B->size()[2] * dat_B->size()[3] * sizeof(double));
+    // bands of B always start after all bands of A, even if the chunk of A is empty
+    memcpy(((double *)out->buf()) + _in_A->size_bands() * size_btyx[1] * size_btyx[2] * size_btyx[3], ((double *)dat_B->buf()), dat_B->size()[0] * dat_B->size()[1] * dat_B->size()[2] * dat_B->size()[3] * sizeof(double));
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -110,6 +110,13 @@ class join_bands_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (id >= count_chunks()) return chunk_status_type::EMPTY;
+        if (_in_A->chunk_status(id) == chunk_status_type::NON_EMPTY || _in_B->chunk_status(id) == chunk_status_type::NON_EMPTY) return chunk_status_type::NON_EMPTY;
+        if (_in_A->chunk_is_empty(id) && _in_B->chunk_is_empty(id)) return chunk_status_type::EMPTY;
+        return chunk_status_type::UNKNOWN;
+    }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "join_bands";
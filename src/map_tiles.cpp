@@ -0,0 +1,145 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "map_tiles.h"
+#include <gdal_priv.h>
+#include "utils.h"
+
+namespace gdalcubes {
+
+namespace {
+bool set_tile_views(nlohmann::json &j, uint32_t z, uint32_t x, uint32_t y) {
+    bool found = false;
+    if (j.is_object()) {
+        if (j.count("cube_type") > 0 && j["cube_type"] == "image_collection") {
+            j["view"].erase("space");
+            j["view"]["tile"] = {{"x", x}, {"y", y}, {"z", z}};
+            j["chunk_size"] = {1, map_tiles::TILE_SIZE, map_tiles::TILE_SIZE};
+            found = true;
+        }
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            if (it.value().is_structured()) {
+                found = set_tile_views(it.value(), z, x, y) || found;
+            }
+        }
+    } else if (j.is_array()) {
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            found = set_tile_views(*it, z, x, y) || found;
+        }
+    }
+    return found;
+}
+}  // namespace
+
+const uint16_t map_tiles::TILE_SIZE;
+
+nlohmann::json map_tiles::tile_cube_json(nlohmann::json cube_json, uint32_t z, uint32_t x, uint32_t y) {
+    if (z > 30 || x >= (uint32_t(1) << z) || y >= (uint32_t(1) << z)) {
+        throw std::string("ERROR in map_tiles::tile_cube_json(): invalid tile coordinates");
+    }
+    if (!set_tile_views(cube_json, z, x, y)) {
+        throw std::string("ERROR in map_tiles::tile_cube_json(): cube is not derived from an image collection");
+    }
+    return cube_json;
+}
+
+std::vector<uint8_t> map_tiles::render_png(std::shared_ptr<chunk_data> dat, std::vector<uint16_t> bands, double min, double max) {
+    if (bands.size() != 1 && bands.size() != 3) {
+        throw std::string("ERROR in map_tiles::render_png(): expected either one or three bands");
+    }
+    uint32_t nx = TILE_SIZE;
+    uint32_t ny = TILE_SIZE;
+    uint32_t nxy = nx * ny;
+    std::vector<uint8_t> rgba(4 * nxy, 0);  // band interleaved, empty chunks result in transparent tiles
+
+    if (!dat->empty()) {
+        if (dat->size()[2] != ny || dat->size()[3] != nx) {
+            throw std::string("ERROR in map_tiles::render_png(): chunk data does not have the size of a tile");
+        }
+        for (uint16_t i = 0; i < bands.size(); ++i) {
+            if (bands[i] >= dat->size()[0]) {
+                throw std::string("ERROR in map_tiles::render_png(): invalid band index");
+            }
+        }
+        const double *buf = (const double *)dat->buf();  // only the first time slice is used
+
+        if (min >= max) {
+            min = std::numeric_limits<double>::max();
+            max = std::numeric_limits<double>::lowest();
+            for (uint16_t i = 0; i < bands.size(); ++i) {
+                const double *v = buf + bands[i] * dat->size()[1] * nxy;
+                for (uint32_t k = 0; k < nxy; ++k) {
+                    if (!std::isnan(v[k])) {
+                        min = std::min(min, v[k]);
+                        max = std::max(max, v[k]);
+                    }
+                }
+            }
+            if (min >= max) max = min + 1;
+        }
+
+        double scale = 255.0 / (max - min);
+        for (uint16_t ic = 0; ic < 3; ++ic) {
+            const double *v = buf + bands[bands.size() == 1 ? 0 : ic] * dat->size()[1] * nxy;
+            for (uint32_t k = 0; k < nxy; ++k) {
+                double s = (v[k] - min) * scale;
+                rgba[ic * nxy + k] = std::isnan(s) ? 0 : (uint8_t)std::max(0.0, std::min(255.0, s));
+            }
+        }
+        for (uint32_t k = 0; k < nxy; ++k) {
+            bool valid = true;
+            for (uint16_t i = 0; i < bands.size(); ++i) {
+                if (std::isnan(buf[bands[i] * dat->size()[1] * nxy + k])) valid = false;
+            }
+            rgba[3 * nxy + k] = valid ? 255 : 0;
+        }
+    }
+
+    GDALDriver *mem_driver = (GDALDriver *)GDALGetDriverByName("MEM");
+    GDALDriver *png_driver = (GDALDriver *)GDALGetDriverByName("PNG");
+    if (!mem_driver || !png_driver) {
+        throw std::string("ERROR in map_tiles::render_png(): GDAL MEM or PNG driver is not available");
+    }
+    GDALDataset *mem = mem_driver->Create("", nx, ny, 4, GDT_Byte, NULL);
+    if (mem->RasterIO(GF_Write, 0, 0, nx, ny, rgba.data(), nx, ny, GDT_Byte, 4, NULL, 0, 0, 0, NULL) != CE_None) {
+        GDALClose(mem);
+        throw std::string("ERROR in map_tiles::render_png(): cannot write tile to in-memory dataset");
+    }
+
+    std::string vsi_path = "/vsimem/" + utils::generate_unique_filename(12, "tile_", ".png");
+    GDALDataset *png = png_driver->CreateCopy(vsi_path.c_str(), mem, false, NULL, NULL, NULL);
+    GDALClose(mem);
+    if (!png) {
+        throw std::string("ERROR in map_tiles::render_png(): cannot create PNG image");
+    }
+    GDALClose(png);
+
+    vsi_l_offset length = 0;
+    GByte *bytes = VSIGetMemFileBuffer(vsi_path.c_str(), &length, true);  // takes ownership and removes the file
+    std::vector<uint8_t> out(bytes, bytes + length);
+    VSIFree(bytes);
+    return out;
+}
+
+}  // namespace gdalcubes
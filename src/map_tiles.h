@@ -0,0 +1,74 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef MAP_TILES_H
+#define MAP_TILES_H
+
+#include <vector>
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Helper functions to serve data cubes as XYZ web map tiles
+ *
+ * Tiles follow the common XYZ scheme in the WebMercator projection (EPSG:3857) with 256 x 256 pixels. A tile is
+ * computed from a derived cube, where the views of all image collection cubes in the process graph are replaced by
+ * the tile's extent and resolution. Pixels are hence computed only at the resolution of the zoom level, and GDAL
+ * automatically reads from overviews of the source images where available.
+ */
+class map_tiles {
+   public:
+    static const uint16_t TILE_SIZE = 256;
+
+    /**
+     * @brief Derive the JSON representation of a cube that covers exactly one tile
+     *
+     * Chunks of the derived cube have size 1 x 256 x 256, i.e. the chunk id equals the time index.
+     *
+     * @param cube_json JSON representation of the original cube, see cube::make_constructible_json()
+     * @param z zoom level
+     * @param x tile column
+     * @param y tile row, starting at the top
+     * @return JSON representation of the derived cube
+     */
+    static nlohmann::json tile_cube_json(nlohmann::json cube_json, uint32_t z, uint32_t x, uint32_t y);
+
+    /**
+     * @brief Render chunk data of a tile as RGBA PNG image
+     *
+     * Values are linearly scaled from [min, max] to [0, 255], NaN values are transparent.
+     *
+     * @param dat chunk data with size (bands, 1, ny, nx)
+     * @param bands one band index (grayscale) or three band indexes (red, green, blue)
+     * @param min value mapped to 0, if min >= max, the range is derived from the data
+     * @param max value mapped to 255
+     * @return PNG file content
+     */
+    static std::vector<uint8_t> render_png(std::shared_ptr<chunk_data> dat, std::vector<uint16_t> bands, double min = 0, double max = 0);
+};
+
+}  // namespace gdalcubes
+
+#endif  //MAP_TILES_H
@@ -0,0 +1,109 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "metrics.h"
+
+#include <algorithm>
+#include "chunk_cache.h"
+
+namespace gdalcubes {
+
+metrics *metrics::_instance = nullptr;
+std::mutex metrics::_singleton_mutex;
+
+const uint8_t histogram::NBUCKETS;
+const double histogram::BOUNDS[histogram::NBUCKETS] = {0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+void histogram::observe(double seconds) {
+    uint8_t i = 0;
+    while (i < NBUCKETS && seconds > BOUNDS[i]) ++i;
+    _buckets[i].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum_ns.fetch_add((uint64_t)(std::max(0.0, seconds) * 1e9), std::memory_order_relaxed);
+}
+
+void histogram::write_prometheus(std::ostream &os, std::string name, std::string labels) const {
+    std::string sep = labels.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    for (uint8_t i = 0; i < NBUCKETS; ++i) {
+        cumulative += _buckets[i].load(std::memory_order_relaxed);
+        os << name << "_bucket{" << labels << sep << "le=\"" << BOUNDS[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += _buckets[NBUCKETS].load(std::memory_order_relaxed);
+    os << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << cumulative << "\n";
+    std::string l = labels.empty() ? "" : "{" + labels + "}";
+    os << name << "_sum" << l << " " << std::to_string(sum()) << "\n";
+    os << name << "_count" << l << " " << count() << "\n";
+}
+
+histogram &metrics::chunk_read(std::string cube_type) {
+    std::lock_guard<std::mutex> lck(_mutex_chunk_read);
+    auto it = _chunk_read.find(cube_type);
+    if (it == _chunk_read.end()) {
+        it = _chunk_read.insert(std::make_pair(cube_type, std::unique_ptr<histogram>(new histogram()))).first;
+    }
+    return *(it->second);
+}
+
+void metrics::write_prometheus(std::ostream &os) {
+    os << "# HELP gdalcubes_chunk_read_seconds Duration of chunk reads including input cubes\n";
+    os << "# TYPE gdalcubes_chunk_read_seconds histogram\n";
+    {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_read);
+        for (auto it = _chunk_read.begin(); it != _chunk_read.end(); ++it) {
+            it->second->write_prometheus(os, "gdalcubes_chunk_read_seconds", "cube_type=\"" + it->first + "\"");
+        }
+    }
+
+    os << "# HELP gdalcubes_sqlite_query_seconds Duration of SQLite statements on image collections\n";
+    os << "# TYPE gdalcubes_sqlite_query_seconds histogram\n";
+    _sqlite_query.write_prometheus(os, "gdalcubes_sqlite_query_seconds", "");
+
+    os << "# HELP gdalcubes_gdal_open_total Number of opened GDAL datasets\n";
+    os << "# TYPE gdalcubes_gdal_open_total counter\n";
+    os << "gdalcubes_gdal_open_total " << gdal_open() << "\n";
+    os << "# HELP gdalcubes_gdal_warp_total Number of GDALWarp calls\n";
+    os << "# TYPE gdalcubes_gdal_warp_total counter\n";
+    os << "gdalcubes_gdal_warp_total " << gdal_warp() << "\n";
+    os << "# HELP gdalcubes_downloaded_bytes_total Number of bytes of chunk data transferred over the network\n";
+    os << "# TYPE gdalcubes_downloaded_bytes_total counter\n";
+    os << "gdalcubes_downloaded_bytes_total " << bytes_downloaded() << "\n";
+    os << "# HELP gdalcubes_empty_chunks_skipped_total Number of chunks that chunk processors did not read because they are known to be empty\n";
+    os << "# TYPE gdalcubes_empty_chunks_skipped_total counter\n";
+    os << "gdalcubes_empty_chunks_skipped_total " << empty_chunks_skipped() << "\n";
+
+    if (chunk_cache::enabled()) {
+        chunk_cache_stats s = chunk_cache::instance()->stats();
+        os << "# TYPE gdalcubes_chunk_cache_size_bytes gauge\n";
+        os << "gdalcubes_chunk_cache_size_bytes " << chunk_cache::instance()->size_bytes() << "\n";
+        os << "# TYPE gdalcubes_chunk_cache_hits_total counter\n";
+        os << "gdalcubes_chunk_cache_hits_total " << s.hits << "\n";
+        os << "# TYPE gdalcubes_chunk_cache_misses_total counter\n";
+        os << "gdalcubes_chunk_cache_misses_total " << s.misses << "\n";
+        os << "# TYPE gdalcubes_chunk_cache_evictions_total counter\n";
+        os << "gdalcubes_chunk_cache_evictions_total " << s.evictions << "\n";
+    }
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,204 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "timer.h"
+#include "trace.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief A lock-free histogram of durations with fixed buckets
+ *
+ * Bucket upper bounds range from 10 microseconds to 30 seconds, which covers cache hits and SQLite queries as well
+ * as expensive chunk reads.
+ */
+class histogram {
+   public:
+    static const uint8_t NBUCKETS = 18;
+    static const double BOUNDS[NBUCKETS];
+
+    histogram() : _count(0), _sum_ns(0) {
+        for (uint8_t i = 0; i <= NBUCKETS; ++i) {
+            _buckets[i].store(0);
+        }
+    }
+
+    /**
+     * @brief Record a single observation
+     * @param seconds duration in seconds
+     */
+    void observe(double seconds);
+
+    /**
+     * @brief Number of observations
+     */
+    inline uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sum of all observations in seconds
+     */
+    inline double sum() const { return (double)_sum_ns.load(std::memory_order_relaxed) * 1e-9; }
+
+    /**
+     * @brief Write the histogram in the Prometheus text exposition format
+     * @param os output stream
+     * @param name metric name without _bucket, _sum, and _count suffixes
+     * @param labels additional labels, e.g. 'cube_type="reduce_time"', may be empty
+     */
+    void write_prometheus(std::ostream &os, std::string name, std::string labels) const;
+
+   private:
+    std::atomic<uint64_t> _buckets[NBUCKETS + 1];  // last bucket counts observations > BOUNDS[NBUCKETS - 1]
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum_ns;
+};
+
+/**
+ * @brief Singleton class for process-wide performance counters
+ *
+ * Counters are updated with relaxed atomic operations and are cheap enough to be always enabled. The server exposes
+ * them at GET /metrics, other applications may use write_prometheus() or the individual getters.
+ */
+class metrics {
+   public:
+    /**
+     * @brief Get the singleton instance
+     * @return pointer to the singleton instance
+     */
+    static metrics *instance() {
+        static GC g;
+        _singleton_mutex.lock();
+        if (!_instance) {
+            _instance = new metrics();
+        }
+        _singleton_mutex.unlock();
+        return _instance;
+    }
+
+    /**
+     * @brief Get the histogram of chunk read durations of a cube type
+     * @details Durations include reading chunks of input cubes, i.e., the time spent in a pipeline stage itself is
+     * the difference to the durations of its inputs.
+     * @param cube_type cube type as in the JSON representation of cubes, e.g. "reduce_time"
+     * @return reference to the histogram, which remains valid until program exit
+     */
+    histogram &chunk_read(std::string cube_type);
+
+    inline histogram &sqlite_query() { return _sqlite_query; }
+
+    inline void count_gdal_open() { _gdal_open.fetch_add(1, std::memory_order_relaxed); }
+    inline void count_gdal_warp() { _gdal_warp.fetch_add(1, std::memory_order_relaxed); }
+    inline void count_bytes_downloaded(uint64_t n) { _bytes_downloaded.fetch_add(n, std::memory_order_relaxed); }
+    inline void count_empty_chunk_skipped() { _empty_chunks_skipped.fetch_add(1, std::memory_order_relaxed); }
+
+    inline uint64_t gdal_open() { return _gdal_open.load(std::memory_order_relaxed); }
+    inline uint64_t gdal_warp() { return _gdal_warp.load(std::memory_order_relaxed); }
+    inline uint64_t bytes_downloaded() { return _bytes_downloaded.load(std::memory_order_relaxed); }
+    inline uint64_t empty_chunks_skipped() { return _empty_chunks_skipped.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Write all counters in the Prometheus text exposition format
+     * @details This includes statistics of the persistent chunk cache, if enabled.
+     * @param os output stream
+     */
+    void write_prometheus(std::ostream &os);
+
+   private:
+    metrics() : _chunk_read(), _mutex_chunk_read(), _sqlite_query(), _gdal_open(0), _gdal_warp(0), _bytes_downloaded(0), _empty_chunks_skipped(0) {}
+    ~metrics() {}
+    metrics(const metrics &) = delete;
+
+    static metrics *_instance;
+    static std::mutex _singleton_mutex;
+
+    std::map<std::string, std::unique_ptr<histogram>> _chunk_read;
+    std::mutex _mutex_chunk_read;
+    histogram _sqlite_query;
+    std::atomic<uint64_t> _gdal_open;
+    std::atomic<uint64_t> _gdal_warp;
+    std::atomic<uint64_t> _bytes_downloaded;
+    std::atomic<uint64_t> _empty_chunks_skipped;
+
+    class GC {
+       public:
+        ~GC() {
+            if (metrics::_instance) {
+                delete metrics::_instance;
+                metrics::_instance = nullptr;
+            }
+        }
+    };
+};
+
+/**
+ * @brief Records the duration of a chunk read in the histogram of the cube type when going out of scope
+ *
+ * If tracing is enabled (see trace), the chunk read is additionally recorded as a trace span.
+ * Use GCBS_CHUNK_READ_TIMER at the beginning of cube::read_chunk() implementations, which looks up the histogram
+ * only once per call site instead of locking the metrics singleton on every read.
+ */
+class chunk_read_timer {
+   public:
+    /**
+     * @param h histogram of the cube type, see metrics::chunk_read()
+     * @param cube_type cube type, must remain valid until program exit (e.g. a string literal)
+     * @param id chunk id
+     */
+    chunk_read_timer(histogram &h, const char *cube_type, uint32_t id) : _h(h), _t(), _span(cube_type, "read_chunk") {
+        _span.arg("chunk", id);
+    }
+    ~chunk_read_timer() { _h.observe(_t.time()); }
+
+    /**
+     * @brief Add the size of the resulting chunk to the trace span
+     * @param n size of the output chunk in bytes, see chunk_data::total_size_bytes()
+     */
+    inline void bytes(uint64_t n) { _span.arg("bytes", n); }
+
+   private:
+    histogram &_h;
+    timer _t;
+    trace_span _span;
+};
+
+/**
+ * Declares a chunk_read_timer named TIMER; CUBE_TYPE must be a string literal. The histogram is resolved once in
+ * a function-local static, whose initialization is thread-safe.
+ */
+#define GCBS_CHUNK_READ_TIMER(TIMER, CUBE_TYPE, ID)                                   \
+    static histogram &TIMER##_histogram = metrics::instance()->chunk_read(CUBE_TYPE); \
+    chunk_read_timer TIMER(TIMER##_histogram, CUBE_TYPE, ID)
+
+}  // namespace gdalcubes
+
+#endif  //METRICS_H
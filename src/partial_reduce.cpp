@@ -0,0 +1,362 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "partial_reduce.h"
+#include "reduce_space.h"
+#include "reduce_time.h"
+
+namespace gdalcubes {
+
+namespace {
+
+enum class reducer_kind { SUM,
+                          PROD,
+                          MEAN,
+                          MIN,
+                          MAX,
+                          COUNT,
+                          VAR,
+                          SD };
+
+reducer_kind reducer_kind_from_string(std::string reducer) {
+    if (reducer == "sum") return reducer_kind::SUM;
+    if (reducer == "prod") return reducer_kind::PROD;
+    if (reducer == "mean") return reducer_kind::MEAN;
+    if (reducer == "min") return reducer_kind::MIN;
+    if (reducer == "max") return reducer_kind::MAX;
+    if (reducer == "count") return reducer_kind::COUNT;
+    if (reducer == "var") return reducer_kind::VAR;
+    if (reducer == "sd") return reducer_kind::SD;
+    throw std::string("ERROR in partial_reduce_cube: reducer '" + reducer + "' is not mergeable");
+}
+
+/**
+ * @brief Pointers to the three state rows of one reducer in a partial state chunk
+ */
+struct partial_state {
+    partial_state(std::shared_ptr<chunk_data> dat, uint16_t ireducer) {
+        uint32_t ncells = dat->size()[1] * dat->size()[2] * dat->size()[3];
+        n = ((double *)dat->buf()) + (3 * ireducer) * ncells;
+        s1 = n + ncells;
+        s2 = s1 + ncells;
+    }
+    double *n;   // number of non-NaN values
+    double *s1;  // sum, product, minimum, maximum, or mean
+    double *s2;  // sum of squared differences from the mean (var and sd only)
+};
+
+inline void accumulate(reducer_kind k, partial_state &s, uint32_t i, double v) {
+    s.n[i] += 1;
+    switch (k) {
+        case reducer_kind::SUM:
+        case reducer_kind::MEAN:
+            s.s1[i] += v;
+            break;
+        case reducer_kind::PROD:
+            s.s1[i] *= v;
+            break;
+        case reducer_kind::MIN:
+            if (std::isnan(s.s1[i]) || v < s.s1[i]) s.s1[i] = v;
+            break;
+        case reducer_kind::MAX:
+            if (std::isnan(s.s1[i]) || v > s.s1[i]) s.s1[i] = v;
+            break;
+        case reducer_kind::VAR:
+        case reducer_kind::SD: {
+            // Welford's online algorithm
+            double delta = v - s.s1[i];
+            s.s1[i] += delta / s.n[i];
+            s.s2[i] += delta * (v - s.s1[i]);
+            break;
+        }
+        case reducer_kind::COUNT:
+            break;
+    }
+}
+
+}  // namespace
+
+bool partial_reduce_cube::is_mergeable(std::string reducer) {
+    return reducer == "min" || reducer == "max" || reducer == "mean" || reducer == "sum" ||
+           reducer == "count" || reducer == "prod" || reducer == "var" || reducer == "sd";
+}
+
+std::shared_ptr<partial_reduce_cube> partial_reduce_cube::from_reduction(std::shared_ptr<cube> c, uint32_t min_chunks) {
+    std::shared_ptr<cube> in;
+    std::string along;
+    std::vector<std::pair<std::string, std::string>> reducer_bands;
+    uint32_t n_in;  // number of input chunks per result chunk
+    c = c->unwrap();
+    if (std::dynamic_pointer_cast<reduce_space_cube>(c)) {
+        std::shared_ptr<reduce_space_cube> r = std::dynamic_pointer_cast<reduce_space_cube>(c);
+        in = r->in_cube();
+        reducer_bands = r->reducer_bands();
+        along = "space";
+        n_in = in->count_chunks_x() * in->count_chunks_y();
+    } else if (std::dynamic_pointer_cast<reduce_time_cube>(c)) {
+        std::shared_ptr<reduce_time_cube> r = std::dynamic_pointer_cast<reduce_time_cube>(c);
+        in = r->in_cube();
+        reducer_bands = r->reducer_bands();
+        along = "time";
+        n_in = in->count_chunks_t();
+    } else {
+        return nullptr;
+    }
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        if (!is_mergeable(reducer_bands[i].first)) return nullptr;
+    }
+    uint32_t nparts = std::min(n_in, (min_chunks + c->count_chunks() - 1) / c->count_chunks());
+    if (nparts <= 1) return nullptr;
+    return create(in, along, reducer_bands, nparts);
+}
+
+partial_reduce_cube::partial_reduce_cube(std::shared_ptr<cube> in, std::string along, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t nparts) : cube(std::make_shared<cube_st_reference>(*(in->st_reference()))), _in_cube(in), _along(along), _reducer_bands(reducer_bands), _nparts(nparts) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
+    if (_along != "space" && _along != "time") {
+        throw std::string("ERROR in partial_reduce_cube::partial_reduce_cube(): invalid dimension '" + _along + "', expected 'space' or 'time'");
+    }
+    if (_nparts == 0) {
+        throw std::string("ERROR in partial_reduce_cube::partial_reduce_cube(): number of parts must be greater than zero");
+    }
+    set_parts_dimension();
+
+    for (uint16_t i = 0; i < reducer_bands.size(); ++i) {
+        std::string reducerstr = reducer_bands[i].first;
+        std::string bandstr = reducer_bands[i].second;
+        if (!is_mergeable(reducerstr)) {
+            throw std::string("ERROR in partial_reduce_cube::partial_reduce_cube(): reducer '" + reducerstr + "' is not mergeable");
+        }
+        if (!(in->bands().has(bandstr))) {
+            throw std::string("ERROR in partial_reduce_cube::partial_reduce_cube(): Input data cube has no band '" + bandstr + "'");
+        }
+        band b = in->bands().get(bandstr);
+        std::string prefix = b.name + "_" + reducerstr;
+        b.name = prefix + "_n";
+        _bands.add(b);
+        b.name = prefix + "_s1";
+        _bands.add(b);
+        b.name = prefix + "_s2";
+        _bands.add(b);
+    }
+}
+
+void partial_reduce_cube::set_parts_dimension() {
+    if (_along == "space") {
+        // one cell in x direction per part, see reduce_space_cube
+        _st_ref->nx() = _nparts;
+        _st_ref->ny() = 1;
+        _chunk_size[0] = _in_cube->chunk_size()[0];
+        _chunk_size[1] = 1;
+        _chunk_size[2] = 1;
+    } else {
+        // one cell in time per part, see reduce_time_cube
+        duration dt = (_st_ref->t1() - _st_ref->t0()) + 1;
+        _st_ref->dt(dt);
+        _st_ref->t1() = _st_ref->t0() + dt * (int)(_nparts - 1);
+        _chunk_size[0] = 1;
+        _chunk_size[1] = _in_cube->chunk_size()[1];
+        _chunk_size[2] = _in_cube->chunk_size()[2];
+    }
+}
+
+std::shared_ptr<chunk_data> partial_reduce_cube::read_chunk(chunkid_t id) {
+    GCBS_TRACE("partial_reduce_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "partial_reduce", id);
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (id >= count_chunks())
+        return out;  // chunk is outside of the view, we don't need to read anything.
+
+    coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
+    coords_nd<uint32_t, 4> size_btyx = {uint32_t(3 * _reducer_bands.size()), size_tyx[0], size_tyx[1], size_tyx[2]};
+    out->size(size_btyx);
+    uint32_t ncells = size_tyx[0] * size_tyx[1] * size_tyx[2];
+    out->buf(std::calloc(size_btyx[0] * ncells, sizeof(double)));
+
+    std::vector<reducer_kind> kinds;
+    std::vector<uint16_t> band_idx_in;
+    std::vector<partial_state> states;
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        kinds.push_back(reducer_kind_from_string(_reducer_bands[i].first));
+        band_idx_in.push_back(_in_cube->bands().get_index(_reducer_bands[i].second));
+        states.push_back(partial_state(out, i));
+        double init = 0;
+        if (kinds[i] == reducer_kind::PROD) {
+            init = 1;
+        } else if (kinds[i] == reducer_kind::MIN || kinds[i] == reducer_kind::MAX) {
+            init = NAN;
+        }
+        std::fill(states[i].s1, states[i].s1 + ncells, init);
+    }
+
+    // input chunks of this part
+    uint32_t part;
+    uint32_t n_in;
+    std::vector<chunkid_t> in_ids;
+    if (_along == "space") {
+        chunkid_t t_idx = id / _nparts;
+        part = id % _nparts;
+        n_in = _in_cube->count_chunks_x() * _in_cube->count_chunks_y();
+        for (uint32_t i = (uint64_t(part) * n_in) / _nparts; i < (uint64_t(part + 1) * n_in) / _nparts; ++i) {
+            in_ids.push_back(t_idx * n_in + i);
+        }
+    } else {
+        uint32_t nxy = count_chunks_x() * count_chunks_y();
+        part = id / nxy;
+        n_in = _in_cube->count_chunks_t();
+        for (uint32_t i = (uint64_t(part) * n_in) / _nparts; i < (uint64_t(part + 1) * n_in) / _nparts; ++i) {
+            in_ids.push_back(i * nxy + id % nxy);
+        }
+    }
+
+    for (uint32_t ic = 0; ic < in_ids.size(); ++ic) {
+        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(in_ids[ic]);
+        if (x->empty()) continue;
+        uint32_t nt = x->size()[1];
+        uint32_t nxy = x->size()[2] * x->size()[3];
+        if (_along == "time" && nxy != ncells) {
+            throw std::string("ERROR in partial_reduce_cube::read_chunk(): input chunk has unexpected size");
+        }
+        for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
+            const double *v = ((double *)x->buf()) + band_idx_in[ib] * nt * nxy;
+            for (uint32_t it = 0; it < nt; ++it) {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    if (!std::isnan(v[it * nxy + ixy])) {
+                        accumulate(kinds[ib], states[ib], _along == "space" ? it : ixy, v[it * nxy + ixy]);
+                    }
+                }
+            }
+        }
+    }
+    tm.bytes(out->total_size_bytes());
+    return out;
+}
+
+void partial_reduce_cube::merge(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b) {
+    if (b->empty()) return;
+    if (a->empty()) {
+        // take over b's buffer
+        void *buf = std::malloc(b->total_size_bytes());
+        std::memcpy(buf, b->buf(), b->total_size_bytes());
+        a->size(b->size());
+        a->buf(buf);
+        return;
+    }
+    if (a->size() != b->size()) {
+        throw std::string("ERROR in partial_reduce_cube::merge(): partial states have different sizes");
+    }
+    uint32_t ncells = a->size()[1] * a->size()[2] * a->size()[3];
+    for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
+        reducer_kind k = reducer_kind_from_string(_reducer_bands[ib].first);
+        partial_state sa(a, ib);
+        partial_state sb(b, ib);
+        for (uint32_t i = 0; i < ncells; ++i) {
+            if (sb.n[i] == 0) continue;
+            switch (k) {
+                case reducer_kind::SUM:
+                case reducer_kind::MEAN:
+                    sa.s1[i] += sb.s1[i];
+                    break;
+                case reducer_kind::PROD:
+                    sa.s1[i] *= sb.s1[i];
+                    break;
+                case reducer_kind::MIN:
+                    if (std::isnan(sa.s1[i]) || sb.s1[i] < sa.s1[i]) sa.s1[i] = sb.s1[i];
+                    break;
+                case reducer_kind::MAX:
+                    if (std::isnan(sa.s1[i]) || sb.s1[i] > sa.s1[i]) sa.s1[i] = sb.s1[i];
+                    break;
+                case reducer_kind::VAR:
+                case reducer_kind::SD: {
+                    // parallel algorithm of Chan et al.
+                    double n = sa.n[i] + sb.n[i];
+                    double delta = sb.s1[i] - sa.s1[i];
+                    sa.s1[i] += delta * sb.n[i] / n;
+                    sa.s2[i] += sb.s2[i] + delta * delta * sa.n[i] * sb.n[i] / n;
+                    break;
+                }
+                case reducer_kind::COUNT:
+                    break;
+            }
+            sa.n[i] += sb.n[i];
+        }
+    }
+}
+
+std::shared_ptr<chunk_data> partial_reduce_cube::finalize(std::shared_ptr<chunk_data> state) {
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    if (state->empty()) return out;
+
+    uint32_t ncells = state->size()[1] * state->size()[2] * state->size()[3];
+
+    // like reduce_time_cube and reduce_space_cube, return an empty chunk if there is no input data, unless count, sum,
+    // or prod are computed, which return values also without any data
+    bool empty = true;
+    for (uint16_t ib = 0; ib < _reducer_bands.size() && empty; ++ib) {
+        reducer_kind k = reducer_kind_from_string(_reducer_bands[ib].first);
+        if (k == reducer_kind::COUNT || k == reducer_kind::SUM || k == reducer_kind::PROD) {
+            empty = false;
+            break;
+        }
+        partial_state s(state, ib);
+        for (uint32_t i = 0; i < ncells; ++i) {
+            if (s.n[i] > 0) {
+                empty = false;
+                break;
+            }
+        }
+    }
+    if (empty) return out;
+
+    out->size({uint32_t(_reducer_bands.size()), state->size()[1], state->size()[2], state->size()[3]});
+    out->buf(std::malloc(_reducer_bands.size() * ncells * sizeof(double)));
+    for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
+        reducer_kind k = reducer_kind_from_string(_reducer_bands[ib].first);
+        partial_state s(state, ib);
+        double *w = ((double *)out->buf()) + ib * ncells;
+        for (uint32_t i = 0; i < ncells; ++i) {
+            switch (k) {
+                case reducer_kind::SUM:
+                case reducer_kind::PROD:
+                case reducer_kind::MIN:
+                case reducer_kind::MAX:
+                    w[i] = s.s1[i];
+                    break;
+                case reducer_kind::MEAN:
+                    w[i] = s.n[i] > 0 ? s.s1[i] / s.n[i] : NAN;
+                    break;
+                case reducer_kind::COUNT:
+                    w[i] = s.n[i];
+                    break;
+                case reducer_kind::VAR:
+                    w[i] = s.n[i] > 1 ? s.s2[i] / (s.n[i] - 1) : NAN;
+                    break;
+                case reducer_kind::SD:
+                    w[i] = s.n[i] > 1 ? std::sqrt(s.s2[i] / (s.n[i] - 1)) : NAN;
+                    break;
+            }
+        }
+    }
+    return out;
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,150 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef PARTIAL_REDUCE_H
+#define PARTIAL_REDUCE_H
+
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief A data cube of mergeable partial states of a reduction over space or time
+ *
+ * The input chunks that contribute to one output chunk of a reduce_space_cube or reduce_time_cube are split into
+ * nparts groups. Each chunk of this cube contains the partial state of the reduction over one group of input chunks.
+ * Partial states can be merged in any order and the merged state of all parts can be finalized to the result chunk
+ * of the reduction. This allows to distribute a reduction to several gdalcubes_server instances, which only send
+ * the small partial states instead of input chunks.
+ *
+ * Partial states store three values per reducer and output cell: the number of non-NaN values, and two
+ * reducer-specific values (e.g. sum, minimum, or mean and the sum of squared differences for var and sd).
+ * Chunks have 3 * (number of reducers) bands and the shape of the result chunks.
+ * Only the reducers min, max, mean, sum, count, prod, var, and sd are mergeable.
+ *
+ * Partial chunk ids are mapped to result chunk ids by result_chunk(). For reductions over space, the x dimension
+ * of this cube has nparts cells and chunks of size 1, for reductions over time, the time dimension of this cube
+ * has nparts cells and chunks of size 1.
+ */
+class partial_reduce_cube : public cube {
+   public:
+    /**
+     * @brief Create a data cube of partial reduction states
+     * @note This static creation method should preferably be used instead of the constructors as
+     * the constructors will not set connections between cubes properly.
+     * @param in input data cube of the reduction
+     * @param along "space" or "time"
+     * @param reducer_bands pairs of reducers and input band names
+     * @param nparts number of partial states per result chunk
+     * @return a shared pointer to the created data cube instance
+     */
+    static std::shared_ptr<partial_reduce_cube> create(std::shared_ptr<cube> in, std::string along, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t nparts) {
+        std::shared_ptr<partial_reduce_cube> out = std::make_shared<partial_reduce_cube>(in, along, reducer_bands, nparts);
+        in->add_child_cube(out);
+        out->add_parent_cube(in);
+        return out;
+    }
+
+    /**
+     * @brief Create a data cube of partial reduction states for a reduce_space_cube or reduce_time_cube
+     *
+     * The number of parts per result chunk is chosen such that the partial cube has at least min_chunks chunks if
+     * possible.
+     *
+     * @param c reduction cube
+     * @param min_chunks desired minimum number of chunks
+     * @return partial reduction cube or nullptr if c is not a reduction, uses reducers that are not mergeable, or
+     * cannot be split into more than one part per result chunk
+     */
+    static std::shared_ptr<partial_reduce_cube> from_reduction(std::shared_ptr<cube> c, uint32_t min_chunks);
+
+    /**
+     * @brief Check whether partial states of a reducer can be merged
+     */
+    static bool is_mergeable(std::string reducer);
+
+   public:
+    partial_reduce_cube(std::shared_ptr<cube> in, std::string along, std::vector<std::pair<std::string, std::string>> reducer_bands, uint32_t nparts);
+
+   public:
+    ~partial_reduce_cube() {}
+
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
+
+    /**
+     * @brief Get the id of the result chunk, a partial chunk contributes to
+     */
+    inline chunkid_t result_chunk(chunkid_t id) {
+        return _along == "space" ? id / _nparts : id % (count_chunks_x() * count_chunks_y());
+    }
+
+    /**
+     * @brief Get the number of partial chunks per result chunk
+     */
+    inline uint32_t nparts() { return _nparts; }
+
+    /**
+     * @brief Merge partial state b into partial state a
+     */
+    void merge(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b);
+
+    /**
+     * @brief Compute the result chunk from the merged partial states of all parts
+     */
+    std::shared_ptr<chunk_data> finalize(std::shared_ptr<chunk_data> state);
+
+    nlohmann::json make_constructible_json() override {
+        nlohmann::json out;
+        out["cube_type"] = "partial_reduce";
+        out["along"] = _along;
+        out["reducer_bands"] = _reducer_bands;
+        out["nparts"] = _nparts;
+        out["in_cube"] = _in_cube->make_constructible_json();
+        return out;
+    }
+
+   private:
+    std::shared_ptr<cube> _in_cube;
+    std::string _along;
+    std::vector<std::pair<std::string, std::string>> _reducer_bands;
+    uint32_t _nparts;
+
+    virtual void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
+        // copy fields from st_reference type
+        _st_ref->win() = stref->win();
+        _st_ref->srs() = stref->srs();
+        _st_ref->ny() = stref->ny();
+        _st_ref->nx() = stref->nx();
+        _st_ref->t0() = stref->t0();
+        _st_ref->t1() = stref->t1();
+        _st_ref->dt(stref->dt());
+        set_parts_dimension();
+    }
+
+    void set_parts_dimension();
+};
+
+}  // namespace gdalcubes
+
+#endif  // PARTIAL_REDUCE_H
@@ -324,6 +324,7 @@ struct sd_reducer : public var_reducer {
 
 std::shared_ptr<chunk_data> reduce_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("reduce_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "reduce", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
@@ -370,12 +371,16 @@ std::shared_ptr<chunk_data> reduce_cube::read_chunk(chunkid_t id) {
     // iterate over all chunks that must be read from the input cube to compute this chunk
     for (chunkid_t i = id; i < _in_cube->count_chunks(); i += _in_cube->count_chunks_x() * _in_cube->count_chunks_y()) {
         std::shared_ptr<chunk_data> x = _in_cube->read_chunk(i);
+        trace_span span_agg("aggregation");
         r->combine(out, x);
     }
 
+    trace_span span_finalize("aggregation");
     r->finalize(out);
+    span_finalize.end();
     if (r) delete r;
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -349,8 +349,25 @@ struct sd_reducer_singleband_s : public var_reducer_singleband_s {
     }
 };
 
+chunk_status_type reduce_space_cube::chunk_status(chunkid_t id) {
+    if (id >= count_chunks()) return chunk_status_type::EMPTY;
+    if (_in_cube->size_y() == 1 && _in_cube->size_x() == 1) return _in_cube->chunk_status(id);
+
+    // count, sum, and prod return values also for time slices without any data
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        if (_reducer_bands[i].first == "count" || _reducer_bands[i].first == "sum" || _reducer_bands[i].first == "prod") {
+            return chunk_status_type::UNKNOWN;
+        }
+    }
+    for (chunkid_t i = id * _in_cube->count_chunks_x() * _in_cube->count_chunks_y(); i < (id + 1) * _in_cube->count_chunks_x() * _in_cube->count_chunks_y(); ++i) {
+        if (!_in_cube->chunk_is_empty(i)) return chunk_status_type::UNKNOWN;
+    }
+    return chunk_status_type::EMPTY;
+}
+
 std::shared_ptr<chunk_data> reduce_space_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("reduce_space_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "reduce_space", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
@@ -360,6 +377,10 @@ std::shared_ptr<chunk_data> reduce_space_cube::read_chunk(chunkid_t id) {
         return _in_cube->read_chunk(id);
     }
 
+    if (chunk_is_empty(id)) {
+        return out;
+    }
+
     coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
     coords_nd<uint32_t, 4> size_btyx = {uint32_t(_reducer_bands.size()), size_tyx[0], 1, 1};
     out->size(size_btyx);
@@ -403,18 +424,22 @@ std::shared_ptr<chunk_data> reduce_space_cube::read_chunk(chunkid_t id) {
     // iterate over all chunks that must be read from the input cube to compute this chunk
     for (chunkid_t i = id * _in_cube->count_chunks_x() * _in_cube->count_chunks_y(); i < (id + 1) * _in_cube->count_chunks_x() * _in_cube->count_chunks_y(); ++i) {
         std::shared_ptr<chunk_data> x = _in_cube->read_chunk(i);
+        trace_span span_agg("aggregation");
         for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
             reducers[ib]->combine(out, x, i);
         }
     }
+    trace_span span_finalize("aggregation");
     for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
         reducers[i]->finalize(out);
     }
+    span_finalize.end();
 
     for (uint16_t i = 0; i < reducers.size(); ++i) {
         if (reducers[i] != nullptr) delete reducers[i];
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
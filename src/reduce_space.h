@@ -92,6 +92,8 @@ class reduce_space_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override;
+
     /**
  * Combines all chunks and produces a single GDAL image
  * @param path path to output image file
@@ -100,6 +102,16 @@ class reduce_space_cube : public cube {
      * @param p chunk processor instance, defaults to the current global configuration in config::instance()->get_default_chunk_processor()
  */
 
+    /**
+     * @brief Get the input data cube of the reduction
+     */
+    inline std::shared_ptr<cube> in_cube() { return _in_cube; }
+
+    /**
+     * @brief Get the pairs of reducers and input band names
+     */
+    inline std::vector<std::pair<std::string, std::string>> reducer_bands() { return _reducer_bands; }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "reduce_space";
@@ -63,14 +63,10 @@ struct sum_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += v;
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            out[ixy] += v;
+        });
     }
     void finalize(std::shared_ptr<chunk_data> a) override {}
 
@@ -92,14 +88,10 @@ struct prod_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] *= v;
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            out[ixy] *= v;
+        });
     }
     void finalize(std::shared_ptr<chunk_data> a) override {}
 
@@ -123,15 +115,11 @@ struct mean_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += v;
-                    ++_count[ixy];
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            out[ixy] += v;
+            ++_count[ixy];
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {
@@ -161,18 +149,13 @@ struct min_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    if (std::isnan(*w))
-                        *w = v;
-                    else
-                        *w = std::min(*w, v);
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            if (std::isnan(out[ixy]))
+                out[ixy] = v;
+            else
+                out[ixy] = std::min(out[ixy], v);
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {}
@@ -203,25 +186,15 @@ struct which_min_reducer_singleband : public reducer_singleband {
         std::shared_ptr<cube> in = _in_cube.lock();
         // we don't check if pointer is expired here since the reducers live only within the read_chunk function of the reducer cube object that has shared ownership with the input cube
 
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    //double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    double *w = &(_cur_min[ixy]);
-                    if (std::isnan(*w)) {
-                        *w = v;
-                        // set date in output chunk
-                        ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
-                    } else {
-                        if (v < *w) {
-                            *w = v;
-                            ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
-                        }
-                    }
-                }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            double *w = &(_cur_min[ixy]);
+            if (std::isnan(*w) || v < *w) {
+                *w = v;
+                // set date in output chunk
+                out[ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
             }
-        }
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {
@@ -248,18 +221,13 @@ struct max_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    if (std::isnan(*w))
-                        *w = v;
-                    else
-                        *w = std::max(*w, v);
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            if (std::isnan(out[ixy]))
+                out[ixy] = v;
+            else
+                out[ixy] = std::max(out[ixy], v);
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {}
@@ -290,25 +258,15 @@ struct which_max_reducer_singleband : public reducer_singleband {
         std::shared_ptr<cube> in = _in_cube.lock();
         // we don't check if pointer is expired here since the reducers live only within the read_chunk function of the reducer cube object that has shared ownership with the input cube
 
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    //double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    double *w = &(_cur_max[ixy]);
-                    if (std::isnan(*w)) {
-                        *w = v;
-                        // set date in output chunk
-                        ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
-                    } else {
-                        if (v > *w) {
-                            *w = v;
-                            ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
-                        }
-                    }
-                }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            double *w = &(_cur_max[ixy]);
+            if (std::isnan(*w) || v > *w) {
+                *w = v;
+                // set date in output chunk
+                out[ixy] = (in->bounds_from_chunk(chunk_id).t0 + (in->st_reference()->dt() * it)).to_double();
             }
-        }
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {
@@ -332,15 +290,10 @@ struct count_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    *w += 1;
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            out[ixy] += 1;
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {}
@@ -362,14 +315,9 @@ struct median_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    _m_buckets[ixy].push_back(v);
-                }
-            }
-        }
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            _m_buckets[ixy].push_back(v);
+        });
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {
@@ -409,19 +357,15 @@ struct var_reducer_singleband : public reducer_singleband {
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double &v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double &mean = _mean[ixy];
-                    uint32_t &count = _count[ixy];
-                    ++count;
-                    double delta = v - mean;
-                    mean += delta / count;
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += delta * (v - mean);
-                }
-            }
-        }
+        double *out = ((double *)a->buf()) + _band_idx_out * a->size()[2] * a->size()[3];
+        b->for_each_valid(_band_idx_in, [&](uint32_t it, uint32_t ixy, double v) {
+            double &mean = _mean[ixy];
+            uint32_t &count = _count[ixy];
+            ++count;
+            double delta = v - mean;
+            mean += delta / count;
+            out[ixy] += delta * (v - mean);
+        });
     }
 
     virtual void finalize(std::shared_ptr<chunk_data> a) override {
@@ -454,8 +398,25 @@ struct sd_reducer_singleband : public var_reducer_singleband {
     }
 };
 
+chunk_status_type reduce_time_cube::chunk_status(chunkid_t id) {
+    if (id >= count_chunks()) return chunk_status_type::EMPTY;
+    if (_in_cube->size_t() == 1) return _in_cube->chunk_status(id);
+
+    // count, sum, and prod return values also for time series without any data
+    for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        if (_reducer_bands[i].first == "count" || _reducer_bands[i].first == "sum" || _reducer_bands[i].first == "prod") {
+            return chunk_status_type::UNKNOWN;
+        }
+    }
+    for (chunkid_t i = id; i < _in_cube->count_chunks(); i += _in_cube->count_chunks_x() * _in_cube->count_chunks_y()) {
+        if (!_in_cube->chunk_is_empty(i)) return chunk_status_type::UNKNOWN;
+    }
+    return chunk_status_type::EMPTY;
+}
+
 std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("reduce_time_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "reduce_time", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
@@ -465,6 +426,10 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
         return _in_cube->read_chunk(id);
     }
 
+    if (chunk_is_empty(id)) {
+        return out;
+    }
+
     coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
     coords_nd<uint32_t, 4> size_btyx = {uint32_t(_reducer_bands.size()), 1, size_tyx[1], size_tyx[2]};
     out->size(size_btyx);
@@ -512,18 +477,22 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
     // iterate over all chunks that must be read from the input cube to compute this chunk
     for (chunkid_t i = id; i < _in_cube->count_chunks(); i += _in_cube->count_chunks_x() * _in_cube->count_chunks_y()) {
         std::shared_ptr<chunk_data> x = _in_cube->read_chunk(i);
+        trace_span span_agg("aggregation");
         for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
             reducers[ib]->combine(out, x, i);
         }
     }
+    trace_span span_finalize("aggregation");
     for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
         reducers[i]->finalize(out);
     }
+    span_finalize.end();
 
     for (uint16_t i = 0; i < reducers.size(); ++i) {
         if (reducers[i] != nullptr) delete reducers[i];
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
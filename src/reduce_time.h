@@ -94,6 +94,8 @@ class reduce_time_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override;
+
     /**
  * Combines all chunks and produces a single GDAL image
  * @param path path to output image file
@@ -103,6 +105,16 @@ class reduce_time_cube : public cube {
  */
     void write_gdal_image(std::string path, std::string format = "GTiff", std::vector<std::string> co = std::vector<std::string>(), std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
 
+    /**
+     * @brief Get the input data cube of the reduction
+     */
+    inline std::shared_ptr<cube> in_cube() { return _in_cube; }
+
+    /**
+     * @brief Get the pairs of reducers and input band names
+     */
+    inline std::vector<std::pair<std::string, std::string>> reducer_bands() { return _reducer_bands; }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "reduce_time";
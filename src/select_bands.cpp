@@ -28,6 +28,7 @@ namespace gdalcubes {
 
 std::shared_ptr<chunk_data> select_bands_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("select_bands::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "select_bands", id);
     if (id >= count_chunks())
         return std::shared_ptr<chunk_data>();  // chunk is outside of the view, we don't need to read anything.
 
@@ -53,6 +54,7 @@ std::shared_ptr<chunk_data> select_bands_cube::read_chunk(chunkid_t id) {
         memcpy(((double*)out->buf()) + i * in->size()[1] * in->size()[2] * in->size()[3], ((double*)in->buf()) + orig_idx * in->size()[1] * in->size()[2] * in->size()[3], in->size()[1] * in->size()[2] * in->size()[3] * sizeof(double));
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -121,6 +121,12 @@ class select_bands_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override {
+        if (id >= count_chunks()) return chunk_status_type::EMPTY;
+        // empty input chunks result in empty output chunks
+        return _in_cube->chunk_is_empty(id) ? chunk_status_type::EMPTY : chunk_status_type::UNKNOWN;
+    }
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "select_bands";
@@ -27,18 +27,37 @@
 #include <cpprest/rawptrstream.h>
 #include <boost/program_options.hpp>
 #include <condition_variable>
+#include <iterator>
 #include "build_info.h"
+#include "chunk_codec.h"
 #include "cube_factory.h"
+#include "hash.h"
 #include "image_collection.h"
+#include "map_tiles.h"
 #include "utils.h"
 /**
 GET  /version
+GET  /cache (chunk cache statistics)
+GET  /queue (number of queued and running chunk reads)
+GET  /metrics (counters and histograms in the Prometheus text format, see metrics)
 POST /file (name query, body file)
-POST /cube (json process descr), return cube_id
+POST /file?name={name}&hash={hash}&size={size}&offset={offset} (resumable upload, body is the part of the file starting
+     at offset, returns 202 and header X-Gdalcubes-Upload-Offset until all bytes have been received, 200 if the
+     content hash of the complete file matches)
+HEAD /file?name={name}&size={size}[&hash={hash}] (200 if the file exists with the same size and hash, 409 if it differs,
+     204 if it does not exist, header X-Gdalcubes-Upload-Offset contains the number of bytes of an unfinished upload)
+POST /cube (json process descr), return cube_id, identical cubes share the same cube_id
 GET /cube/{cube_id}
-POST /cube/{cube_id}/{chunk_id}/start
+DELETE /cube/{cube_id} (release a cube, idle cubes are removed after some time)
+POST /cube/{cube_id}/{chunk_id}/start (optional query parameters priority, higher values first, and client)
+POST /cube/{cube_id}/{chunk_id}/cancel
+POST /cube/{cube_id}/start (body: JSON array of chunk ids, same query parameters as above)
+GET  /cube/{cube_id}/finished?since={n}&wait={ms} (long-poll, returns {"next": n, "finished": [ids], "failed": [ids]}
+     as soon as chunks finished after the n-th completion event of the cube, or after the timeout)
 GET /cube/{cube_id}/{chunk_id}/status status= "notrequested", "submitted" "queued" "running" "canceled" "finished" "error"
-GET /cube/{cube_id}/{chunk_id}/download
+GET /cube/{cube_id}/{chunk_id}/download (optional header X-Gdalcubes-Chunk-Encoding, see chunk_codec)
+GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}.png (XYZ web mercator map tile of the t-th time slice, optional query
+     parameters bands=name[,name,name], min, max, and priority; .raw instead of .png returns the tile as chunk data)
 
 
  TODO:
@@ -51,6 +70,710 @@ namespace gdalcubes {
 
 server_chunk_cache* server_chunk_cache::_instance = nullptr;
 std::mutex server_chunk_cache::_singleton_mutex;
+const uint16_t server_chunk_cache::NSHARDS;
+
+void server_chunk_cache::erase_locked(shard& s, std::list<entry>::iterator it) {
+    uint64_t value_size = it->value ? it->value->total_size_bytes() : 0;
+    _size_bytes -= value_size;
+    s.index.erase(it->key);
+    s.lru.erase(it);
+}
+
+void server_chunk_cache::remove(key_type key) {
+    shard& s = shard_of(key);
+    std::lock_guard<std::mutex> lck(s.m);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+        erase_locked(s, it->second);
+    }
+}
+
+void server_chunk_cache::remove_cube(uint32_t cube_id) {
+    for (uint16_t i = 0; i < NSHARDS; ++i) {
+        std::lock_guard<std::mutex> lck(_shards[i].m);
+        for (auto it = _shards[i].lru.begin(); it != _shards[i].lru.end();) {
+            auto cur = it++;
+            if (cur->key.first == cube_id) {
+                erase_locked(_shards[i], cur);
+            }
+        }
+    }
+}
+
+void server_chunk_cache::add_locked(shard& s, key_type key, std::shared_ptr<chunk_data> value) {
+    uint64_t value_size = value ? value->total_size_bytes() : 0;
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+        erase_locked(s, it->second);
+    }
+    s.lru.push_front(entry{key, value, ++_clock});
+    s.index[key] = s.lru.begin();
+    _size_bytes += value_size;
+}
+
+void server_chunk_cache::evict(key_type keep) {
+    uint64_t max_size = config::instance()->get_server_chunkcache_max();
+    while (_size_bytes > max_size) {
+        // find the shard with the least recently used entry, shards are locked one at a time
+        int32_t oldest = -1;
+        uint64_t oldest_use = std::numeric_limits<uint64_t>::max();
+        for (uint16_t i = 0; i < NSHARDS; ++i) {
+            std::lock_guard<std::mutex> lck(_shards[i].m);
+            if (!_shards[i].lru.empty() && _shards[i].lru.back().key != keep && _shards[i].lru.back().last_use < oldest_use) {
+                oldest = i;
+                oldest_use = _shards[i].lru.back().last_use;
+            }
+        }
+        if (oldest < 0) {
+            return;  // nothing left to evict
+        }
+        std::lock_guard<std::mutex> lck(_shards[oldest].m);
+        if (!_shards[oldest].lru.empty() && _shards[oldest].lru.back().key != keep) {  // might have changed in the meantime
+            erase_locked(_shards[oldest], std::prev(_shards[oldest].lru.end()));
+            ++_evictions;
+        }
+    }
+}
+
+void server_chunk_cache::add(key_type key, std::shared_ptr<chunk_data> value) {
+    shard& s = shard_of(key);
+    {
+        std::lock_guard<std::mutex> lck(s.m);
+        add_locked(s, key, value);
+    }
+    evict(key);
+}
+
+bool server_chunk_cache::has(key_type key) {
+    shard& s = shard_of(key);
+    std::lock_guard<std::mutex> lck(s.m);
+    return s.index.find(key) != s.index.end();
+}
+
+std::shared_ptr<chunk_data> server_chunk_cache::find(key_type key, bool count_stats) {
+    shard& s = shard_of(key);
+    std::lock_guard<std::mutex> lck(s.m);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) {
+        if (count_stats) ++_misses;
+        return nullptr;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second);  // mark as most recently used, iterators remain valid
+    it->second->last_use = ++_clock;
+    if (count_stats) ++_hits;
+    return it->second->value;
+}
+
+std::shared_ptr<chunk_data> server_chunk_cache::get(key_type key) {
+    std::shared_ptr<chunk_data> out = find(key);
+    if (!out) {
+        throw std::string("ERROR: in server_chunk_cache::get(): requested chunk is not available");
+    }
+    return out;
+}
+
+std::shared_ptr<chunk_data> server_chunk_cache::get_or_compute(key_type key, std::function<std::shared_ptr<chunk_data>()> f) {
+    shard& s = shard_of(key);
+    std::unique_lock<std::mutex> lck(s.m);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        it->second->last_use = ++_clock;
+        ++_hits;
+        return it->second->value;
+    }
+    auto it_inflight = s.inflight.find(key);
+    if (it_inflight != s.inflight.end()) {
+        // chunk is currently computed by another thread, wait for the result
+        std::shared_future<std::shared_ptr<chunk_data>> res = it_inflight->second;
+        lck.unlock();
+        ++_hits;
+        return res.get();
+    }
+    ++_misses;
+    std::promise<std::shared_ptr<chunk_data>> p;
+    s.inflight[key] = p.get_future().share();
+    lck.unlock();
+
+    std::shared_ptr<chunk_data> out;
+    try {
+        out = f();
+    } catch (...) {
+        lck.lock();
+        s.inflight.erase(key);
+        lck.unlock();
+        p.set_exception(std::current_exception());
+        throw;
+    }
+    lck.lock();
+    add_locked(s, key, out);
+    s.inflight.erase(key);
+    lck.unlock();
+    evict(key);
+    p.set_value(out);
+    return out;
+}
+
+uint64_t server_chunk_cache::total_size_bytes() {
+    return _size_bytes.load();
+}
+
+uint64_t server_chunk_cache::count() {
+    uint64_t out = 0;
+    for (uint16_t i = 0; i < NSHARDS; ++i) {
+        std::lock_guard<std::mutex> lck(_shards[i].m);
+        out += _shards[i].index.size();
+    }
+    return out;
+}
+
+nlohmann::json server_chunk_cache::stats() {
+    nlohmann::json out;
+    uint64_t count = 0;
+    uint64_t inflight = 0;
+    for (uint16_t i = 0; i < NSHARDS; ++i) {
+        std::lock_guard<std::mutex> lck(_shards[i].m);
+        count += _shards[i].index.size();
+        inflight += _shards[i].inflight.size();
+    }
+    out["size_bytes"] = _size_bytes.load();
+    out["max_bytes"] = config::instance()->get_server_chunkcache_max();
+    out["count"] = count;
+    out["computing"] = inflight;
+    out["shards"] = NSHARDS;
+    out["hits"] = _hits.load();
+    out["misses"] = _misses.load();
+    out["evictions"] = _evictions.load();
+    return out;
+}
+
+uint32_t gdalcubes_server::find_cube(std::string json) {
+    xxhash64 h;
+    h.update(json.data(), json.size());
+    auto it = _cube_ids_by_hash.find(h.hexdigest());
+    if (it == _cube_ids_by_hash.end()) {
+        return NO_CUBE;
+    }
+    cube_entry &e = _cubestore[it->second];
+    if (e.json != json && e.aliases.count(json) == 0) {
+        return NO_CUBE;  // hash collision
+    }
+    ++e.refs;
+    e.last_access = std::chrono::steady_clock::now();
+    return it->second;
+}
+
+void gdalcubes_server::add_cube_hash(uint32_t cube_id, std::string json) {
+    xxhash64 h;
+    h.update(json.data(), json.size());
+    _cube_ids_by_hash[h.hexdigest()] = cube_id;  // a hash collision only prevents sharing with the older cube
+    _cubestore[cube_id].hashes.push_back(h.hexdigest());
+}
+
+uint32_t gdalcubes_server::register_cube(std::string json) {
+    // JSON objects are serialized with sorted keys, so the submitted JSON of identical cubes is usually identical
+    std::string submitted = nlohmann::json::parse(json).dump();
+    {
+        std::lock_guard<std::mutex> lck(_mutex_cubestore);
+        uint32_t id = find_cube(submitted);
+        if (id != NO_CUBE) {
+            return id;
+        }
+    }
+
+    // canonicalize by creating the cube, which e.g. fills default values
+    std::shared_ptr<cube> c = cube_factory::instance()->create_from_json(nlohmann::json::parse(submitted));
+    std::string canonical = c->make_constructible_json().dump();
+
+    expire_cubes();
+    std::lock_guard<std::mutex> lck(_mutex_cubestore);
+    uint32_t id = find_cube(canonical);
+    if (id != NO_CUBE) {
+        GCBS_DEBUG("Reusing existing cube " + std::to_string(id));
+    } else {
+        id = get_unique_id();
+        cube_entry e;
+        e.c = c;
+        e.json = canonical;
+        e.refs = 1;
+        e.last_access = std::chrono::steady_clock::now();
+        _cubestore.insert(std::make_pair(id, e));
+        add_cube_hash(id, canonical);
+    }
+    if (submitted != canonical && _cubestore[id].aliases.insert(submitted).second) {
+        add_cube_hash(id, submitted);
+    }
+    return id;
+}
+
+bool gdalcubes_server::release_cube(uint32_t cube_id, bool purge_chunks) {
+    {
+        std::lock_guard<std::mutex> lck(_mutex_cubestore);
+        auto it = _cubestore.find(cube_id);
+        if (it == _cubestore.end()) {
+            return false;
+        }
+        if (it->second.refs > 0) {
+            --it->second.refs;
+        }
+        it->second.last_access = std::chrono::steady_clock::now();
+        if (it->second.refs > 0) {
+            return true;
+        }
+    }
+    {
+        // no client listens for completion events anymore
+        std::lock_guard<std::mutex> lck(_mutex_chunk_finished);
+        _chunk_finished.erase(cube_id);
+    }
+    if (purge_chunks) {
+        server_chunk_cache::instance()->remove_cube(cube_id);
+    }
+    return true;
+}
+
+std::shared_ptr<cube> gdalcubes_server::get_cube(uint32_t cube_id) {
+    std::lock_guard<std::mutex> lck(_mutex_cubestore);
+    auto it = _cubestore.find(cube_id);
+    if (it == _cubestore.end()) {
+        return nullptr;
+    }
+    it->second.last_access = std::chrono::steady_clock::now();
+    return it->second.c;
+}
+
+void gdalcubes_server::expire_cubes() {
+    std::vector<uint32_t> expired;
+    {
+        std::lock_guard<std::mutex> lck(_mutex_cubestore);
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = _cubestore.begin(); it != _cubestore.end();) {
+            uint32_t idle = std::chrono::duration_cast<std::chrono::seconds>(now - it->second.last_access).count();
+            if (idle > _cube_ttl || (it->second.refs == 0 && idle > std::min(_cube_ttl, (uint32_t)60))) {
+                for (uint16_t i = 0; i < it->second.hashes.size(); ++i) {
+                    auto ih = _cube_ids_by_hash.find(it->second.hashes[i]);
+                    if (ih != _cube_ids_by_hash.end() && ih->second == it->first) {
+                        _cube_ids_by_hash.erase(ih);
+                    }
+                }
+                expired.push_back(it->first);
+                it = _cubestore.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (!expired.empty()) {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_finished);
+        for (uint32_t i = 0; i < expired.size(); ++i) {
+            GCBS_DEBUG("Removing idle cube " + std::to_string(expired[i]));
+            _chunk_finished.erase(expired[i]);
+        }
+    }
+    for (uint32_t i = 0; i < expired.size(); ++i) {
+        server_chunk_cache::instance()->remove_cube(expired[i]);
+    }
+}
+
+bool gdalcubes_server::enqueue(std::pair<uint32_t, uint32_t> key, std::string client, int32_t priority) {
+    if (server_chunk_cache::instance()->has(key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+    if (_chunk_read_requests_index.find(key) != _chunk_read_requests_index.end()) {
+        _chunk_read_requesters[key].insert(client);
+        return false;
+    }
+    if (_chunk_read_executing.find(key) != _chunk_read_executing.end()) {
+        return false;
+    }
+    chunk_request r;
+    r.key = key;
+    r.client = client;
+    r.priority = priority;
+    r.round = std::max(_client_round[client], _cur_round);
+    r.seq = _cur_seq++;
+    _client_round[client] = r.round + 1;
+    _chunk_read_requests_index[key] = _chunk_read_requests.insert(r).first;
+    _chunk_read_requesters[key].insert(client);
+    _worker_cond.notify_one();
+    return true;
+}
+
+bool gdalcubes_server::cancel(std::pair<uint32_t, uint32_t> key, std::string client) {
+    {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+        auto it = _chunk_read_requests_index.find(key);
+        if (it == _chunk_read_requests_index.end()) {
+            return false;
+        }
+        std::set<std::string>& requesters = _chunk_read_requesters[key];
+        requesters.erase(client);
+        if (!requesters.empty()) {
+            return false;  // still requested by other clients
+        }
+        _chunk_read_requesters.erase(key);
+        _chunk_read_requests.erase(it->second);
+        _chunk_read_requests_index.erase(it);
+    }
+    // wake up pending downloads and listeners
+    notify_finished(key, false);
+    return true;
+}
+
+void gdalcubes_server::notify_finished(std::pair<uint32_t, uint32_t> key, bool success) {
+    {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_finished);
+        chunk_events& ev = _chunk_finished[key.first];
+        // a chunk finishes successfully only once, failures are reported per attempt
+        if (!success || ev.finished.insert(key.second).second) {
+            ev.events.push_back(std::make_pair(key.second, success));
+        }
+    }
+    _chunk_finished_cond.notify_all();
+}
+
+nlohmann::json gdalcubes_server::wait_finished(uint32_t cube_id, uint64_t since, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lck(_mutex_chunk_finished);
+    _chunk_finished_cond.wait_for(lck, std::chrono::milliseconds(timeout_ms), [this, cube_id, since]() {
+        auto it = _chunk_finished.find(cube_id);
+        return it != _chunk_finished.end() && it->second.events.size() > since;
+    });
+    std::vector<uint32_t> finished;
+    std::vector<uint32_t> failed;
+    uint64_t nevents = 0;
+    auto it = _chunk_finished.find(cube_id);
+    if (it != _chunk_finished.end()) {
+        const std::vector<std::pair<uint32_t, bool>>& events = it->second.events;
+        for (uint64_t i = since; i < events.size(); ++i) {
+            if (events[i].second) {
+                finished.push_back(events[i].first);
+            } else {
+                failed.push_back(events[i].first);
+            }
+        }
+        nevents = events.size();
+    }
+    nlohmann::json out;
+    out["next"] = std::max(since, nevents);
+    out["finished"] = finished;
+    out["failed"] = failed;
+    return out;
+}
+
+void gdalcubes_server::start(std::pair<uint32_t, uint32_t> key, std::string client, int32_t priority) {
+    if (!enqueue(key, client, priority) && chunk_status(key) == "finished") {
+        // listeners may have missed the original event, e.g. if the chunk has been computed for another client
+        notify_finished(key, true);
+    }
+}
+
+std::string gdalcubes_server::chunk_status(std::pair<uint32_t, uint32_t> key) {
+    if (server_chunk_cache::instance()->has(key)) {
+        return "finished";
+    }
+    std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+    if (_chunk_read_executing.find(key) != _chunk_read_executing.end()) {
+        return "running";
+    }
+    if (_chunk_read_requests_index.find(key) != _chunk_read_requests_index.end()) {
+        return "queued";
+    }
+    // the chunk might have been finished in the meantime
+    return server_chunk_cache::instance()->has(key) ? "finished" : "notrequested";
+}
+
+nlohmann::json gdalcubes_server::queue_stats() {
+    std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+    nlohmann::json out;
+    out["queued"] = _chunk_read_requests.size();
+    out["running"] = _chunk_read_executing.size();
+    out["workers"] = _worker_threads.size();
+    std::map<std::string, uint32_t> queued_per_client;
+    for (auto it = _chunk_read_requests.begin(); it != _chunk_read_requests.end(); ++it) {
+        queued_per_client[it->client]++;
+    }
+    out["clients"] = queued_per_client;
+    return out;
+}
+
+std::string gdalcubes_server::prometheus_metrics() {
+    std::stringstream out;
+    metrics::instance()->write_prometheus(out);
+
+    nlohmann::json q = queue_stats();
+    out << "# HELP gdalcubes_server_queued_chunks Number of queued chunk read requests\n";
+    out << "# TYPE gdalcubes_server_queued_chunks gauge\n";
+    out << "gdalcubes_server_queued_chunks " << q["queued"].get<uint64_t>() << "\n";
+    out << "# HELP gdalcubes_server_running_chunks Number of chunk reads currently executed by worker threads\n";
+    out << "# TYPE gdalcubes_server_running_chunks gauge\n";
+    out << "gdalcubes_server_running_chunks " << q["running"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_workers gauge\n";
+    out << "gdalcubes_server_workers " << q["workers"].get<uint64_t>() << "\n";
+
+    nlohmann::json c = server_chunk_cache::instance()->stats();
+    out << "# HELP gdalcubes_server_cache_size_bytes Size of chunks in the in-memory chunk cache\n";
+    out << "# TYPE gdalcubes_server_cache_size_bytes gauge\n";
+    out << "gdalcubes_server_cache_size_bytes " << c["size_bytes"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_cache_max_bytes gauge\n";
+    out << "gdalcubes_server_cache_max_bytes " << c["max_bytes"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_cache_chunks gauge\n";
+    out << "gdalcubes_server_cache_chunks " << c["count"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_cache_hits_total counter\n";
+    out << "gdalcubes_server_cache_hits_total " << c["hits"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_cache_misses_total counter\n";
+    out << "gdalcubes_server_cache_misses_total " << c["misses"].get<uint64_t>() << "\n";
+    out << "# TYPE gdalcubes_server_cache_evictions_total counter\n";
+    out << "gdalcubes_server_cache_evictions_total " << c["evictions"].get<uint64_t>() << "\n";
+
+    std::size_t ncubes;
+    {
+        std::lock_guard<std::mutex> lck(_mutex_cubestore);
+        ncubes = _cubestore.size();
+    }
+    out << "# HELP gdalcubes_server_cubes Number of registered cubes\n";
+    out << "# TYPE gdalcubes_server_cubes gauge\n";
+    out << "gdalcubes_server_cubes " << ncubes << "\n";
+    return out.str();
+}
+
+std::string gdalcubes_server::file_hash(std::string fname) {
+    uint64_t size = filesystem::file_size(fname);
+    time_t mtime = filesystem::last_write_time(fname);
+    {
+        std::lock_guard<std::mutex> lck(_mutex_files);
+        auto it = _file_hashes.find(fname);
+        if (it != _file_hashes.end() && it->second.size == size && it->second.mtime == mtime) {
+            return it->second.hash;
+        }
+    }
+    // hashing large files takes a while and should not block other requests
+    file_hash_entry e;
+    e.size = size;
+    e.mtime = mtime;
+    e.hash = xxhash64::file(fname);
+    std::lock_guard<std::mutex> lck(_mutex_files);
+    _file_hashes[fname] = e;
+    return e.hash;
+}
+
+void gdalcubes_server::start_workers(uint16_t n) {
+    std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+    if (!_worker_threads.empty()) {
+        return;
+    }
+    _worker_shutdown = false;
+    if (n == 0) n = 1;
+    for (uint16_t i = 0; i < n; ++i) {
+        _worker_threads.push_back(std::thread(&gdalcubes_server::worker_loop, this));
+    }
+}
+
+void gdalcubes_server::stop_workers() {
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lck(_mutex_chunk_read_requests);
+        _worker_shutdown = true;
+        workers.swap(_worker_threads);
+        _worker_cond.notify_all();
+    }
+    for (uint16_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+}
+
+void gdalcubes_server::worker_loop() {
+    while (true) {
+        std::unique_lock<std::mutex> lck(_mutex_chunk_read_requests);
+        _worker_cond.wait(lck, [this]() { return _worker_shutdown || !_chunk_read_requests.empty(); });
+        if (_worker_shutdown) {
+            return;
+        }
+        chunk_request r = *_chunk_read_requests.begin();
+        _chunk_read_requests.erase(_chunk_read_requests.begin());
+        _chunk_read_requests_index.erase(r.key);
+        _chunk_read_requesters.erase(r.key);
+        _chunk_read_executing.insert(r.key);
+        _cur_round = std::max(_cur_round, r.round);
+        lck.unlock();
+
+        std::shared_ptr<cube> c = get_cube(r.key.first);
+
+        uint32_t chunk_id = r.key.second;
+        bool success = false;
+        try {
+            if (!c) {
+                throw std::string("cube is not available");
+            }
+            server_chunk_cache::instance()->get_or_compute(r.key, [c, chunk_id]() {
+                return c->read_chunk(chunk_id);
+            });
+            success = true;
+        } catch (std::string s) {
+            GCBS_ERROR("Reading chunk " + std::to_string(chunk_id) + " of cube " + std::to_string(r.key.first) + " failed: " + s);
+        } catch (...) {
+            GCBS_ERROR("Reading chunk " + std::to_string(chunk_id) + " of cube " + std::to_string(r.key.first) + " failed");
+        }
+
+        lck.lock();
+        _chunk_read_executing.erase(r.key);
+        lck.unlock();
+
+        // notify waiting download requests and listeners
+        notify_finished(r.key, success);
+    }
+}
+
+std::shared_ptr<chunk_data> gdalcubes_server::wait_chunk(std::pair<uint32_t, uint32_t> key) {
+    std::shared_ptr<chunk_data> dat;
+    while (!(dat = server_chunk_cache::instance()->find(key, false))) {  // polling must not count as cache misses
+        if (chunk_status(key) == "notrequested") {
+            break;  // canceled or failed
+        }
+        std::unique_lock<std::mutex> lck(_mutex_chunk_finished);
+        _chunk_finished_cond.wait_for(lck, std::chrono::seconds(1));
+    }
+    return dat;
+}
+
+void gdalcubes_server::reply_chunk(web::http::http_request req, std::shared_ptr<chunk_data> dat) {
+    // Clients may ask for encoded chunks (see chunk_codec) with a header like
+    // "X-Gdalcubes-Chunk-Encoding: deflate=1,float32", otherwise raw chunk data is sent
+    if (req.headers().has("X-Gdalcubes-Chunk-Encoding")) {
+        uint8_t compression_level = 0;
+        bool float32 = false;
+        std::stringstream ss(req.headers()["X-Gdalcubes-Chunk-Encoding"]);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            token.erase(0, token.find_first_not_of(' '));
+            if (token.compare(0, 7, "deflate") == 0) {
+                compression_level = (token.size() > 8 && token[7] == '=') ? std::min(9, std::stoi(token.substr(8))) : 1;
+            } else if (token == "float32") {
+                float32 = true;
+            }
+        }
+        web::http::http_response resp(web::http::status_codes::OK);
+        std::vector<uint8_t> body = chunk_codec::encode(dat, compression_level, float32);
+        metrics::instance()->count_bytes_downloaded(body.size());
+        resp.set_body(std::move(body));
+        resp.headers().set_content_type(chunk_codec::MIME_TYPE);
+        req.reply(resp);
+        return;
+    }
+
+    metrics::instance()->count_bytes_downloaded(4 * sizeof(uint32_t) + dat->total_size_bytes());
+    uint8_t* rawdata = (uint8_t*)std::malloc(4 * sizeof(uint32_t) + dat->total_size_bytes());
+    memcpy((void*)rawdata, (void*)(dat->size().data()), 4 * sizeof(uint32_t));
+    if (!dat->empty()) {
+        memcpy(rawdata + 4 * sizeof(uint32_t), dat->buf(), dat->total_size_bytes());
+    }
+
+    concurrency::streams::basic_istream<uint8_t> is = concurrency::streams::rawptr_stream<uint8_t>::open_istream(rawdata, 4 * sizeof(uint32_t) + dat->total_size_bytes());
+    req.reply(web::http::status_codes::OK, is, 4 * sizeof(uint32_t) + dat->total_size_bytes(), "application/octet-stream").then([is, rawdata]() mutable {
+        is.close();
+        std::free(rawdata); });
+}
+
+void gdalcubes_server::handle_tile(web::http::http_request req, uint32_t cube_id, std::vector<std::string> path, std::map<std::string, std::string> query_pars) {
+    // path is cube/{cube_id}/tiles/{t}/{z}/{x}/{y}.{png|raw}
+    std::size_t dot = path[6].find('.');
+    std::string ext = (dot == std::string::npos) ? "png" : path[6].substr(dot + 1);
+    if (ext != "png" && ext != "raw") {
+        req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: unsupported format, use .png or .raw", "text/plain");
+        return;
+    }
+
+    std::shared_ptr<cube> c = get_cube(cube_id);
+    if (!c) {
+        req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: cube is not available", "text/plain");
+        return;
+    }
+
+    // interactive requests should not wait behind batch computations
+    int32_t priority = 100;
+    if (query_pars.find("priority") != query_pars.end()) {
+        try {
+            priority = std::stoi(query_pars["priority"]);
+        } catch (...) {
+            req.reply(web::http::status_codes::BadRequest, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: invalid priority", "text/plain");
+            return;
+        }
+    }
+
+    // Tiles are computed as chunks of a derived cube with a web mercator view, which is deduplicated by register_cube()
+    // such that computed tiles are shared via the chunk cache and concurrent requests for the same tile are coalesced.
+    uint32_t t, tile_cube_id;
+    try {
+        t = std::stoi(path[3]);
+        nlohmann::json tj = map_tiles::tile_cube_json(c->make_constructible_json(), std::stoi(path[4]), std::stoi(path[5]), std::stoi(path[6].substr(0, dot)));
+        tile_cube_id = register_cube(tj.dump());
+    } catch (std::string s) {
+        req.reply(web::http::status_codes::BadRequest, s, "text/plain");
+        return;
+    } catch (...) {
+        req.reply(web::http::status_codes::BadRequest, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: invalid tile", "text/plain");
+        return;
+    }
+
+    std::shared_ptr<cube> tc = get_cube(tile_cube_id);
+    if (!tc || t >= tc->count_chunks()) {
+        release_cube(tile_cube_id);
+        req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: invalid time index given", "text/plain");
+        return;
+    }
+
+    std::pair<uint32_t, uint32_t> key = std::make_pair(tile_cube_id, t);
+    start(key, req.remote_address(), priority);
+    std::shared_ptr<chunk_data> dat = wait_chunk(key);
+    release_cube(tile_cube_id);
+    if (!dat) {
+        req.reply(web::http::status_codes::InternalError, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: computing the tile failed", "text/plain");
+        return;
+    }
+
+    if (ext == "raw") {
+        reply_chunk(req, dat);
+        return;
+    }
+
+    std::vector<uint16_t> bands;
+    if (query_pars.find("bands") != query_pars.end()) {
+        std::stringstream ss(query_pars["bands"]);
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            if (!tc->bands().has(name)) {
+                req.reply(web::http::status_codes::BadRequest, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: unknown band '" + name + "'", "text/plain");
+                return;
+            }
+            bands.push_back(tc->bands().get_index(name));
+        }
+    }
+    if (bands.empty()) {
+        bands.push_back(0);
+    }
+    double min = 0, max = 0;
+    try {
+        if (query_pars.find("min") != query_pars.end()) {
+            min = std::stod(query_pars["min"]);
+        }
+        if (query_pars.find("max") != query_pars.end()) {
+            max = std::stod(query_pars["max"]);
+        }
+    } catch (...) {
+        req.reply(web::http::status_codes::BadRequest, "ERROR in /GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}: invalid min or max", "text/plain");
+        return;
+    }
+
+    try {
+        web::http::http_response resp(web::http::status_codes::OK);
+        resp.set_body(map_tiles::render_png(dat, bands, min, max));
+        resp.headers().set_content_type("image/png");
+        resp.headers().add("Cache-Control", "max-age=3600");
+        req.reply(resp);
+    } catch (std::string s) {
+        req.reply(web::http::status_codes::BadRequest, s, "text/plain");
+    }
+}
 
 void gdalcubes_server::handle_get(web::http::http_request req) {
     if (!_whitelist.empty()) {
@@ -58,6 +781,7 @@ void gdalcubes_server::handle_get(web::http::http_request req) {
         if (_whitelist.find(remote) == _whitelist.end()) {
             GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been blocked according to whitelist rule");
             req.reply(web::http::status_codes::NotFound);
+            return;
         }
         GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been accepted according to whitelist rule");
     } else {
@@ -75,17 +799,54 @@ void gdalcubes_server::handle_get(web::http::http_request req) {
             std::stringstream ss;
             ss << "gdalcubes_server " << v.VERSION_MAJOR << "." << v.VERSION_MINOR << "." << v.VERSION_PATCH << " (" << v.GIT_COMMIT << ") built on " << v.BUILD_DATE << " " << v.BUILD_TIME;
             req.reply(web::http::status_codes::OK, ss.str().c_str(), "text/plain");
+        } else if (path[0] == "queue") {
+            GCBS_DEBUG("GET /queue");
+            req.reply(web::http::status_codes::OK, queue_stats().dump(2).c_str(), "application/json");
+        } else if (path[0] == "metrics") {
+            GCBS_DEBUG("GET /metrics");
+            req.reply(web::http::status_codes::OK, prometheus_metrics(), "text/plain; version=0.0.4");
+        } else if (path[0] == "cache") {
+            GCBS_DEBUG("GET /cache");
+            req.reply(web::http::status_codes::OK, server_chunk_cache::instance()->stats().dump(2).c_str(), "application/json");
         } else if (path[0] == "cube") {
             if (path.size() == 2) {
                 uint32_t cube_id = std::stoi(path[1]);
                 GCBS_DEBUG("GET /cube" + std::to_string(cube_id));
 
-                if (_cubestore.find(cube_id) == _cubestore.end()) {
+                std::shared_ptr<cube> c = get_cube(cube_id);
+
+                if (!c) {
                     req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}: cube with given id is not available.", "text/plain");
                 } else {
-                    req.reply(web::http::status_codes::OK, _cubestore[cube_id]->make_constructible_json().dump(2).c_str(),
+                    req.reply(web::http::status_codes::OK, c->make_constructible_json().dump(2).c_str(),
                               "application/json");
                 }
+            } else if (path.size() == 3 && path[2] == "finished") {
+                uint32_t cube_id = std::stoi(path[1]);
+                GCBS_DEBUG("GET /cube/" + std::to_string(cube_id) + "/finished");
+                std::shared_ptr<cube> c = get_cube(cube_id);
+                if (!c) {
+                    req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/finished: cube is not available", "text/plain");
+                } else {
+                    uint64_t since = 0;
+                    uint32_t timeout_ms = 30000;
+                    try {
+                        if (query_pars.find("since") != query_pars.end()) {
+                            since = std::stoull(query_pars["since"]);
+                        }
+                        if (query_pars.find("wait") != query_pars.end()) {
+                            timeout_ms = std::max(0, std::min(300000, std::stoi(query_pars["wait"])));
+                        }
+                    } catch (...) {
+                        req.reply(web::http::status_codes::BadRequest, "ERROR in /GET /cube/{cube_id}/finished: invalid since or wait parameter", "text/plain");
+                        return;
+                    }
+                    req.reply(web::http::status_codes::OK, wait_finished(cube_id, since, timeout_ms).dump().c_str(), "application/json");
+                }
+            } else if (path.size() == 7 && path[2] == "tiles") {
+                uint32_t cube_id = std::stoi(path[1]);
+                GCBS_DEBUG("GET /cube/" + std::to_string(cube_id) + "/tiles/" + path[3] + "/" + path[4] + "/" + path[5] + "/" + path[6]);
+                handle_tile(req, cube_id, path, query_pars);
             } else if (path.size() == 4) {
                 uint32_t cube_id = std::stoi(path[1]);
                 uint32_t chunk_id = std::stoi(path[2]);
@@ -93,53 +854,33 @@ void gdalcubes_server::handle_get(web::http::http_request req) {
                 std::string cmd = path[3];
                 if (cmd == "download") {
                     GCBS_DEBUG("GET /cube/" + std::to_string(cube_id) + "/" + std::to_string(chunk_id) + "/download");
-                    if (_cubestore.find(cube_id) == _cubestore.end()) {
+                    std::shared_ptr<cube> c = get_cube(cube_id);
+                    if (!c) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/download: cube is not available", "text/plain");
-                    } else if (chunk_id >= _cubestore[cube_id]->count_chunks()) {
+                    } else if (chunk_id >= c->count_chunks()) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/download: invalid chunk_id given", "text/plain");
                     }
                     // if not in queue, executing, or finished, return 404
-                    else if (!server_chunk_cache::instance()->has(std::make_pair(cube_id, chunk_id)) &&
-                             _chunk_read_requests_set.find(std::make_pair(cube_id, chunk_id)) == _chunk_read_requests_set.end() &&
-                             _chunk_read_executing.find(std::make_pair(cube_id, chunk_id)) == _chunk_read_executing.end()) {
+                    else if (chunk_status(std::make_pair(cube_id, chunk_id)) == "notrequested") {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/download: chunk read has not been requested yet", "text/plain");
                     } else {
-                        while (!server_chunk_cache::instance()->has(std::make_pair(cube_id, chunk_id))) {
-                            // req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/download: chunk is not available.", "text/plain");
-                            std::unique_lock<std::mutex> lck(_chunk_cond[std::make_pair(cube_id, chunk_id)].second);
-                            _chunk_cond[std::make_pair(cube_id, chunk_id)].first.wait(lck);
-                        }
-                        std::shared_ptr<chunk_data> dat = server_chunk_cache::instance()->get(std::make_pair(cube_id, chunk_id));
-
-                        uint8_t* rawdata = (uint8_t*)std::malloc(4 * sizeof(uint32_t) + dat->total_size_bytes());
-                        memcpy((void*)rawdata, (void*)(dat->size().data()), 4 * sizeof(uint32_t));
-                        if (!dat->empty()) {
-                            memcpy(rawdata + 4 * sizeof(uint32_t), dat->buf(), dat->total_size_bytes());
+                        std::shared_ptr<chunk_data> dat = wait_chunk(std::make_pair(cube_id, chunk_id));
+                        if (!dat) {
+                            req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/download: chunk read has been canceled or failed", "text/plain");
+                        } else {
+                            reply_chunk(req, dat);
                         }
-
-                        concurrency::streams::basic_istream<uint8_t> is = concurrency::streams::rawptr_stream<uint8_t>::open_istream(rawdata, 4 * sizeof(uint32_t) + dat->total_size_bytes());
-                        req.reply(web::http::status_codes::OK, is, 4 * sizeof(uint32_t) + dat->total_size_bytes(), "application/octet-stream").then([&is, &rawdata]() {
-                            is.close();
-                            std::free(rawdata); });
                     }
 
                 } else if (cmd == "status") {
                     GCBS_DEBUG("GET /cube/" + std::to_string(cube_id) + "/" + std::to_string(chunk_id) + "/status");
-                    if (_cubestore.find(cube_id) == _cubestore.end()) {
+                    std::shared_ptr<cube> c = get_cube(cube_id);
+                    if (!c) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/status: cube is not available", "text/plain");
-                    } else if (chunk_id >= _cubestore[cube_id]->count_chunks()) {
+                    } else if (chunk_id >= c->count_chunks()) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /GET /cube/{cube_id}/{chunk_id}/status: invalid chunk_id given", "text/plain");
-                    }
-
-                    if (server_chunk_cache::instance()->has(std::make_pair(cube_id, chunk_id))) {
-                        req.reply(web::http::status_codes::OK, "finished", "text/plain");
-                    } else if (_chunk_read_executing.find(std::make_pair(cube_id, chunk_id)) !=
-                               _chunk_read_executing.end()) {
-                        req.reply(web::http::status_codes::OK, "running", "text/plain");
-                    } else if (_chunk_read_requests_set.find(std::make_pair(cube_id, chunk_id)) != _chunk_read_requests_set.end()) {
-                        req.reply(web::http::status_codes::OK, "queued", "text/plain");
                     } else {
-                        req.reply(web::http::status_codes::OK, "notrequested", "text/plain");
+                        req.reply(web::http::status_codes::OK, chunk_status(std::make_pair(cube_id, chunk_id)), "text/plain");
                     }
 
                 } else {
@@ -164,6 +905,7 @@ void gdalcubes_server::handle_post(web::http::http_request req) {
         if (_whitelist.find(remote) == _whitelist.end()) {
             GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been blocked according to whitelist rule");
             req.reply(web::http::status_codes::NotFound);
+            return;
         }
         GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been accepted according to whitelist rule");
     } else {
@@ -176,7 +918,76 @@ void gdalcubes_server::handle_post(web::http::http_request req) {
     //    std::for_each(query_pars.begin(), query_pars.end(), [](std::pair<std::string, std::string> s) { std::cout << s.first << ":" << s.second << std::endl; });
 
     if (!path.empty()) {
-        if (path[0] == "file") {
+        if (path[0] == "file" && query_pars.find("offset") != query_pars.end()) {
+            GCBS_DEBUG("POST /file (resumable) " + req.remote_address());
+            if (query_pars.find("name") == query_pars.end() || query_pars.find("hash") == query_pars.end() || query_pars.find("size") == query_pars.end()) {
+                req.reply(web::http::status_codes::BadRequest, "ERROR in POST /file: missing name, hash, or size query parameter", "text/plain");
+                return;
+            }
+            std::string fname = filesystem::join(_workdir, query_pars["name"]);
+            std::string hash = query_pars["hash"];
+            if (!is_valid_hash(hash)) {
+                req.reply(web::http::status_codes::BadRequest, "ERROR in POST /file: invalid hash query parameter", "text/plain");
+                return;
+            }
+            uint64_t size, offset;
+            try {
+                size = std::stoull(query_pars["size"]);
+                offset = std::stoull(query_pars["offset"]);
+            } catch (...) {
+                req.reply(web::http::status_codes::BadRequest, "ERROR in POST /file: invalid size or offset query parameter", "text/plain");
+                return;
+            }
+            std::vector<unsigned char> part = req.extract_vector().get();
+
+            std::string part_path = upload_part_path(fname, hash);
+            std::unique_lock<std::mutex> lck(_mutex_files);
+            uint64_t cur_offset = filesystem::exists(part_path) ? filesystem::file_size(part_path) : 0;
+            if (offset != cur_offset || offset + part.size() > size) {
+                // client must continue at the current offset
+                web::http::http_response resp(web::http::status_codes::Conflict);
+                resp.headers().add("X-Gdalcubes-Upload-Offset", std::to_string(cur_offset));
+                req.reply(resp);
+                return;
+            }
+            if (cur_offset == 0) {
+                filesystem::mkdir_recursive(filesystem::parent(fname));
+            }
+            std::ofstream os(part_path, std::ofstream::out | std::ofstream::binary | std::ofstream::app);
+            os.write((const char*)part.data(), part.size());
+            os.close();
+            if (os.fail()) {
+                req.reply(web::http::status_codes::InternalError, "ERROR in POST /file: cannot write to '" + part_path + "'", "text/plain");
+                return;
+            }
+            cur_offset += part.size();
+            if (cur_offset < size) {
+                web::http::http_response resp(web::http::status_codes::Accepted);
+                resp.headers().add("X-Gdalcubes-Upload-Offset", std::to_string(cur_offset));
+                req.reply(resp);
+                return;
+            }
+            lck.unlock();
+
+            // upload complete, verify content before replacing the target file
+            std::string received_hash = xxhash64::file(part_path);
+            lck.lock();
+            if (received_hash != hash) {
+                filesystem::remove(part_path);
+                req.reply(web::http::status_codes::BadRequest, "ERROR in POST /file: content hash of uploaded file does not match", "text/plain");
+                return;
+            }
+            if (std::rename(part_path.c_str(), fname.c_str()) != 0) {
+                req.reply(web::http::status_codes::InternalError, "ERROR in POST /file: cannot move uploaded file to '" + fname + "'", "text/plain");
+                return;
+            }
+            file_hash_entry e;
+            e.size = size;
+            e.mtime = filesystem::last_write_time(fname);
+            e.hash = hash;
+            _file_hashes[fname] = e;
+            req.reply(web::http::status_codes::OK, fname.c_str(), "text/plain");
+        } else if (path[0] == "file") {
             GCBS_DEBUG("POST /file " + req.remote_address());
             std::string fname;
             if (query_pars.find("name") != query_pars.end()) {
@@ -217,14 +1028,51 @@ void gdalcubes_server::handle_post(web::http::http_request req) {
                 // we do not use cpprest JSON library here
                 uint32_t id;
                 req.extract_string(true).then([&id, this](std::string s) {
-                                            std::shared_ptr<cube> c = cube_factory::instance()->create_from_json(nlohmann::json::parse(s));
-                                            id = get_unique_id();
-                                            _mutex_cubestore.lock();
-                                            _cubestore.insert(std::make_pair(id, c));
-                                            _mutex_cubestore.unlock();
+                                            id = register_cube(s);
                                         })
                     .wait();
                 req.reply(web::http::status_codes::OK, std::to_string(id), "text/plain");
+            } else if (path.size() == 3 && path[2] == "start") {
+                uint32_t cube_id = std::stoi(path[1]);
+                GCBS_DEBUG("POST /cube/" + std::to_string(cube_id) + "/start");
+                std::shared_ptr<cube> c = get_cube(cube_id);
+                if (!c) {
+                    req.reply(web::http::status_codes::NotFound, "ERROR in /POST /cube/{cube_id}/start: cube is not available", "text/plain");
+                    return;
+                }
+                std::vector<uint32_t> chunk_ids;
+                try {
+                    chunk_ids = nlohmann::json::parse(req.extract_string(true).get()).get<std::vector<uint32_t>>();
+                } catch (...) {
+                    req.reply(web::http::status_codes::BadRequest, "ERROR in /POST /cube/{cube_id}/start: expected a JSON array of chunk ids", "text/plain");
+                    return;
+                }
+                std::string client = req.remote_address();
+                if (query_pars.find("client") != query_pars.end()) {
+                    client = query_pars["client"];
+                }
+                int32_t priority = 0;
+                try {
+                    if (client.empty()) {
+                        throw std::string("ERROR in /POST /cube/{cube_id}/start: empty client identifier");
+                    }
+                    if (query_pars.find("priority") != query_pars.end()) {
+                        priority = std::stoi(query_pars["priority"]);
+                    }
+                } catch (std::string s) {
+                    req.reply(web::http::status_codes::BadRequest, s, "text/plain");
+                    return;
+                } catch (...) {
+                    req.reply(web::http::status_codes::BadRequest, "ERROR in /POST /cube/{cube_id}/start: invalid priority", "text/plain");
+                    return;
+                }
+                uint32_t nchunks = c->count_chunks();
+                for (uint32_t i = 0; i < chunk_ids.size(); ++i) {
+                    if (chunk_ids[i] < nchunks) {
+                        start(std::make_pair(cube_id, chunk_ids[i]), client, priority);
+                    }
+                }
+                req.reply(web::http::status_codes::OK);
             } else if (path.size() == 4) {
                 uint32_t cube_id = std::stoi(path[1]);
                 uint32_t chunk_id = std::stoi(path[2]);
@@ -233,79 +1081,46 @@ void gdalcubes_server::handle_post(web::http::http_request req) {
                 if (cmd == "start") {
                     GCBS_DEBUG("POST /cube/" + std::to_string(cube_id) + "/" + std::to_string(chunk_id) + "/start");
 
-                    if (_cubestore.find(cube_id) == _cubestore.end()) {
+                    std::shared_ptr<cube> c = get_cube(cube_id);
+
+                    if (!c) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /POST /cube/{cube_id}/{chunk_id}/start: cube is not available", "text/plain");
-                    } else if (chunk_id >= _cubestore[cube_id]->count_chunks()) {
+                    } else if (chunk_id >= c->count_chunks()) {
                         req.reply(web::http::status_codes::NotFound, "ERROR in /POST /cube/{cube_id}/{chunk_id}/start: invalid chunk_id given", "text/plain");
-                    }
-
-                    // if already in queue, executing, or finished, do not compute again
-                    else if (server_chunk_cache::instance()->has(std::make_pair(cube_id, chunk_id)) ||
-                             _chunk_read_requests_set.find(std::make_pair(cube_id, chunk_id)) != _chunk_read_requests_set.end() ||
-                             _chunk_read_executing.find(std::make_pair(cube_id, chunk_id)) != _chunk_read_executing.end()) {
-                        req.reply(web::http::status_codes::OK);
                     } else {
-                        _mutex_worker_threads.lock();
-                        if (_worker_threads.size() < config::instance()->get_server_worker_threads_max()) {
-                            // immediately start a thread
-
-                            _worker_threads.push_back(std::thread([this, cube_id, chunk_id]() {
-                                _mutex_chunk_read_requests.lock();
-                                _chunk_read_requests.push_back(std::make_pair(cube_id, chunk_id));
-                                _chunk_read_requests_set.insert(std::make_pair(cube_id, chunk_id));
-                                _mutex_chunk_read_requests.unlock();
-                                while (1) {
-                                    _mutex_chunk_read_requests.lock();
-                                    while (!_chunk_read_requests.empty()) {
-                                        _mutex_chunk_read_executing.lock();
-                                        uint32_t xcube_id = _chunk_read_requests.front().first;
-                                        uint32_t xchunk_id = _chunk_read_requests.front().second;
-                                        _chunk_read_executing.insert(_chunk_read_requests.front());
-                                        _chunk_read_requests_set.erase(_chunk_read_requests.front());
-                                        _chunk_read_requests.pop_front();
-                                        _mutex_chunk_read_requests.unlock();
-                                        _mutex_chunk_read_executing.unlock();
-
-                                        _mutex_cubestore.lock();
-                                        std::shared_ptr<cube> c = _cubestore[xcube_id];
-                                        _mutex_cubestore.unlock();
-
-                                        std::shared_ptr<chunk_data> dat = c->read_chunk(xchunk_id);
-
-                                        server_chunk_cache::instance()->add(std::make_pair(xcube_id, xchunk_id), dat);
-
-                                        _mutex_chunk_read_executing.lock();
-                                        _chunk_read_executing.erase(std::make_pair(xcube_id, xchunk_id));
-                                        _mutex_chunk_read_executing.unlock();
-
-                                        // notify waiting download requests
-                                        if (_chunk_cond.find(std::make_pair(xcube_id, xchunk_id)) != _chunk_cond.end()) {
-                                            _chunk_cond[std::make_pair(xcube_id, xchunk_id)].first.notify_all();
-                                        }
-
-                                        _mutex_chunk_read_requests.lock();
-                                    }
-                                    _mutex_chunk_read_requests.unlock();
-
-                                    std::unique_lock<std::mutex> lock(_mutex_worker_cond);
-                                    _worker_cond.wait(lock);
-                                }
-                            }));
-
-                            _mutex_worker_threads.unlock();
-                            req.reply(web::http::status_codes::OK);
+                        // enqueue() ignores chunks that are already queued, running, or finished
+                        std::string client = req.remote_address();
+                        if (query_pars.find("client") != query_pars.end()) {
+                            client = query_pars["client"];
                         }
-
-                        else {
-                            _mutex_worker_threads.unlock();
-                            std::lock_guard<std::mutex> lock(_mutex_worker_cond);
-                            // add to queue
-                            _mutex_chunk_read_requests.lock();
-                            _chunk_read_requests.push_back(std::make_pair(cube_id, chunk_id));
-                            _mutex_chunk_read_requests.unlock();
-                            _worker_cond.notify_all();
-                            req.reply(web::http::status_codes::OK);
+                        int32_t priority = 0;
+                        try {
+                            if (client.empty()) {
+                                throw std::string("ERROR in /POST /cube/{cube_id}/{chunk_id}/start: empty client identifier");
+                            }
+                            if (query_pars.find("priority") != query_pars.end()) {
+                                priority = std::stoi(query_pars["priority"]);
+                            }
+                        } catch (std::string s) {
+                            req.reply(web::http::status_codes::BadRequest, s, "text/plain");
+                            return;
+                        } catch (...) {
+                            req.reply(web::http::status_codes::BadRequest, "ERROR in /POST /cube/{cube_id}/{chunk_id}/start: invalid priority", "text/plain");
+                            return;
                         }
+                        start(std::make_pair(cube_id, chunk_id), client, priority);
+                        req.reply(web::http::status_codes::OK);
+                    }
+                } else if (cmd == "cancel") {
+                    GCBS_DEBUG("POST /cube/" + std::to_string(cube_id) + "/" + std::to_string(chunk_id) + "/cancel");
+                    std::string client = req.remote_address();
+                    if (query_pars.find("client") != query_pars.end()) {
+                        client = query_pars["client"];
+                    }
+                    if (cancel(std::make_pair(cube_id, chunk_id), client)) {
+                        req.reply(web::http::status_codes::OK, "canceled", "text/plain");
+                    } else {
+                        req.reply(web::http::status_codes::OK, chunk_status(std::make_pair(cube_id, chunk_id)), "text/plain");
                     }
                 } else {
                     req.reply(web::http::status_codes::NotFound);
@@ -328,6 +1143,7 @@ void gdalcubes_server::handle_head(web::http::http_request req) {
         if (_whitelist.find(remote) == _whitelist.end()) {
             GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been blocked according to whitelist rule");
             req.reply(web::http::status_codes::NotFound);
+            return;
         }
         GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been accepted according to whitelist rule");
     } else {
@@ -342,19 +1158,32 @@ void gdalcubes_server::handle_head(web::http::http_request req) {
         if (query_pars.find("name") != query_pars.end()) {
             fname = query_pars["name"];
             fname = filesystem::join(_workdir, fname);
+            bool has_hash = query_pars.find("hash") != query_pars.end();
+            if (has_hash && !is_valid_hash(query_pars["hash"])) {
+                req.reply(web::http::status_codes::BadRequest);  // invalid content hash
+                return;
+            }
+            web::http::http_response resp;
+            if (has_hash) {
+                // offset of an unfinished resumable upload of the same content
+                std::lock_guard<std::mutex> lck(_mutex_files);
+                std::string part_path = upload_part_path(fname, query_pars["hash"]);
+                resp.headers().add("X-Gdalcubes-Upload-Offset", std::to_string(filesystem::exists(part_path) ? filesystem::file_size(part_path) : 0));
+            }
             if (filesystem::exists(fname)) {
                 if (query_pars.find("size") != query_pars.end()) {
-                    if (std::stoi(query_pars["size"]) == (int)filesystem::file_size(fname)) {
-                        req.reply(web::http::status_codes::OK);  // File exists and has the same size
+                    if (std::stoull(query_pars["size"]) == filesystem::file_size(fname) && (!has_hash || query_pars["hash"] == file_hash(fname))) {
+                        resp.set_status_code(web::http::status_codes::OK);  // File exists and has the same size (and content)
                     } else {
-                        req.reply(web::http::status_codes::Conflict);  // File exists but has different size
+                        resp.set_status_code(web::http::status_codes::Conflict);  // File exists but has different size or content
                     }
                 } else {
-                    req.reply(web::http::status_codes::BadRequest);  // File exists but Content Length missing for comparison
+                    resp.set_status_code(web::http::status_codes::BadRequest);  // File exists but Content Length missing for comparison
                 }
             } else {
-                req.reply(web::http::status_codes::NoContent);  // File does not exist yet
+                resp.set_status_code(web::http::status_codes::NoContent);  // File does not exist yet
             }
+            req.reply(resp);
 
         } else {
             req.reply(web::http::status_codes::BadRequest);  // no name given in request
@@ -364,6 +1193,33 @@ void gdalcubes_server::handle_head(web::http::http_request req) {
     }
 }
 
+void gdalcubes_server::handle_delete(web::http::http_request req) {
+    if (!_whitelist.empty()) {
+        std::string remote = req.remote_address();
+        if (_whitelist.find(remote) == _whitelist.end()) {
+            GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been blocked according to whitelist rule");
+            req.reply(web::http::status_codes::NotFound);
+            return;
+        }
+        GCBS_DEBUG("Incoming request from " + req.remote_address() + " has been accepted according to whitelist rule");
+    } else {
+        GCBS_DEBUG("Incoming request from " + req.remote_address());
+    }
+
+    std::vector<std::string> path = web::uri::split_path(web::uri::decode(req.relative_uri().path()));
+    if (path.size() == 2 && path[0] == "cube") {
+        uint32_t cube_id = std::stoi(path[1]);
+        GCBS_DEBUG("DELETE /cube/" + std::to_string(cube_id));
+        if (release_cube(cube_id, true)) {
+            req.reply(web::http::status_codes::OK);
+        } else {
+            req.reply(web::http::status_codes::NotFound, "ERROR in /DELETE /cube/{cube_id}: cube is not available", "text/plain");
+        }
+    } else {
+        req.reply(web::http::status_codes::NotFound);
+    }
+}
+
 }  // namespace gdalcubes
 
 void print_usage() {
@@ -375,10 +1231,11 @@ void print_usage() {
     std::cout << "Options:" << std::endl;
     std::cout << "  -b, --basepath              Base path for all API endpoints, defaults to /gdalcubes/api/" << std::endl;
     std::cout << "  -p, --port                  The port where gdalcubes_server is listening, defaults to 1111" << std::endl;
-    std::cout << "  -t, --worker_threads        Maximum number of threads perfoming chunk reads, defaults to 1" << std::endl;
+    std::cout << "  -t, --worker_threads        Number of worker threads perfoming chunk reads, defaults to 1" << std::endl;
     std::cout << "  -D, --dir                   Working directory where files are stored, defaults to {TEMPDIR}/gdalcubes" << std::endl;
     std::cout << "      --ssl                   Use HTTPS (currently not implemented)" << std::endl;
     std::cout << "  -w, --whitelist             Optional path to a whitelist text file with a list of acceptable clients" << std::endl;
+    std::cout << "      --cube_ttl              Seconds after which idle cubes are removed, defaults to 3600" << std::endl;
     std::cout << "  -d, --debug                 Print debug messages" << std::endl;
     std::cout << std::endl;
 }
@@ -393,7 +1250,7 @@ int main(int argc, char* argv[]) {
     // see https://stackoverflow.com/questions/15541498/how-to-implement-subcommands-using-boost-program-options
 
     po::options_description global_args("Options");
-    global_args.add_options()("help,h", "")("version", "")("debug,d", "")("basepath,b", po::value<std::string>()->default_value("/gdalcubes/api"), "")("port,p", po::value<uint16_t>()->default_value(1111), "")("ssl", "")("worker_threads,t", po::value<uint16_t>()->default_value(1), "")("dir,D", po::value<std::string>()->default_value((filesystem::join(filesystem::get_tempdir(), "gdalcubes")), ""))("whitelist,w", po::value<std::string>(), "");
+    global_args.add_options()("help,h", "")("version", "")("debug,d", "")("basepath,b", po::value<std::string>()->default_value("/gdalcubes/api"), "")("port,p", po::value<uint16_t>()->default_value(1111), "")("ssl", "")("worker_threads,t", po::value<uint16_t>()->default_value(1), "")("dir,D", po::value<std::string>()->default_value((filesystem::join(filesystem::get_tempdir(), "gdalcubes")), ""))("whitelist,w", po::value<std::string>(), "")("cube_ttl", po::value<uint32_t>()->default_value(3600), "");
 
     po::variables_map vm;
 
@@ -432,6 +1289,7 @@ int main(int argc, char* argv[]) {
                              vm["dir"].as<std::string>(), whitelist));
 
     config::instance()->set_server_worker_threads_max(vm["worker_threads"].as<uint16_t>());
+    srv->set_cube_ttl(vm["cube_ttl"].as<uint32_t>());
 
     srv->open().wait();
     std::cout << "gdalcubes_server waiting for incoming HTTP requests on " << srv->get_service_url() << "." << std::endl;
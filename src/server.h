@@ -27,9 +27,17 @@
 
 #include <cpprest/http_listener.h>
 #include <cpprest/uri_builder.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <future>
+#include <limits>
+#include <list>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
+#include <unordered_map>
 #include "cube.h"
 
 namespace gdalcubes {
@@ -37,10 +45,16 @@ namespace gdalcubes {
 /**
  * @brief An in-memory singleton cache for successfully read / computed chunks
  *
- * Chunks are identified by std::pair<cube_id, chunk_id>
+ * Chunks are identified by std::pair<cube_id, chunk_id>. Keys are hash-partitioned into a fixed number of shards,
+ * each with its own lock and LRU list. The maximum cache size as defined by config::get_server_chunkcache_max() is
+ * shared by all shards, i.e. eviction removes the least recently used chunk of any shard, such that skewed keys do not
+ * evict chunks early. Lookups are O(1) and concurrent requests for chunks that are currently computed wait for the
+ * running computation instead of computing the same chunk again (single-flight).
  */
 class server_chunk_cache {
    public:
+    typedef std::pair<uint32_t, uint32_t> key_type;
+
     /**
      * @brief Get the singleton instance
      * @return pointer to the singleton instance
@@ -57,127 +71,127 @@ class server_chunk_cache {
 
     /**
      * @brief Remove a chunk from the cache
-     * @param key
-     */
-    void remove(std::pair<uint32_t, uint32_t> key) {
-        _m.lock();
-        auto it = _cache.find(key);
-        if (it != _cache.end()) {
-            _size_bytes -= it->second->total_size_bytes();
-            _cache.erase(it);
-        }
-
-        auto it_2 = _prio_forward.find(key);
-        uint32_t p = it_2->second;
-        if (it_2 != _prio_forward.end()) {
-            _prio_forward.erase(it_2);
-        }
-
-        auto it_3 = _prio_backward.find(p);
-        if (it_3 != _prio_backward.end()) {
-            _prio_backward.erase(it_3);
-        }
-        _m.unlock();
-    }
+     * @param key chunk identifier (cube_id, chunk_id)
+     */
+    void remove(key_type key);
 
     /**
      * Add chunk data to the cache
+     *
+     * If needed, least recently used chunks of all shards are evicted until the total size fits into
+     * config::get_server_chunkcache_max(). Chunks larger than the maximum cache size are added nevertheless, as pending
+     * downloads depend on them.
+     *
      * @param key chunk identifier (cube_id, chunk_id)
      * @param value chunk data to add
      */
-    void add(std::pair<uint32_t, uint32_t> key, std::shared_ptr<chunk_data> value) {
-        if (!has(key)) {
-            _m.lock();
-            while (_size_bytes + value->total_size_bytes() > config::instance()->get_server_chunkcache_max()) {
-                auto it = _prio_backward.lower_bound(0);  // lowest value greater than or equal to 0
-
-                // remove it from the data
-                remove(it->second);
-            }
-
-            _cache[key] = value;
-            _size_bytes += value->total_size_bytes();
-
-            uint64_t p = inc_prio();  // synchronize?
-
-            _prio_forward[key] = p;
-            _prio_backward[p] = key;
-
-            _size_bytes += value->total_size_bytes();
-            _m.unlock();
-        }
-    }
+    void add(key_type key, std::shared_ptr<chunk_data> value);
 
     /**
      * Check whether a chunk is cached
      * @param key chunk key (cube_id, chunk_id)
      * @return true, if the chunk is cached
      */
-    inline bool has(std::pair<uint32_t, uint32_t> key) {
-        return _cache.find(key) != _cache.end();
-    }
+    bool has(key_type key);
 
     /**
      * Get chunk data from the cache
      * @param key chunk key (cube_id, chunk_id)
      * @return chunk data as shared_ptr
      */
-    std::shared_ptr<chunk_data> get(std::pair<uint32_t, uint32_t> key) {
-        if (!has(key)) {
-            throw std::string("ERROR: in server_chunk_cache::get(): requested chunk is not available");
-        }
-        _m.lock();
-        uint64_t pnew = inc_prio();
-        auto it_1 = _prio_forward.find(key);
-        if (it_1 != _prio_forward.end()) {
-            uint32_t pold = it_1->second;
-            it_1->second = pnew;
-
-            auto it_2 = _prio_backward.find(pold);
-            if (it_2 != _prio_backward.end()) {
-                _prio_backward.erase(it_2);  // remove old
-                _prio_backward[pnew] = key;  // add new
-            }
-        }
-        _m.unlock();
-        return _cache[key];
-    }
+    std::shared_ptr<chunk_data> get(key_type key);
+
+    /**
+     * Get chunk data from the cache if available
+     * @param key chunk key (cube_id, chunk_id)
+     * @param count_stats if false, the lookup is not counted as hit or miss, e.g. when polling for a chunk
+     * @return chunk data as shared_ptr, or nullptr if the chunk is not cached
+     */
+    std::shared_ptr<chunk_data> find(key_type key, bool count_stats = true);
+
+    /**
+     * Remove all chunks of a cube from the cache
+     * @param cube_id cube id
+     */
+    void remove_cube(uint32_t cube_id);
+
+    /**
+     * Get chunk data from the cache or compute it
+     *
+     * If the chunk is currently computed by another thread, this function waits for its result instead of computing
+     * it again. Exceptions thrown in f are passed to all waiting callers.
+     *
+     * @param key chunk key (cube_id, chunk_id)
+     * @param f function computing the chunk if it is not cached
+     * @return chunk data as shared_ptr
+     */
+    std::shared_ptr<chunk_data> get_or_compute(key_type key, std::function<std::shared_ptr<chunk_data>()> f);
 
     /**
      * @brief Get the total amount of memory currently consumed by the cache
      * @return Size of the cache in bytes
      */
-    inline uint32_t total_size_bytes() {
-        return _size_bytes;
-    }
+    uint64_t total_size_bytes();
+
+    /**
+     * @brief Get the number of cached chunks
+     */
+    uint64_t count();
+
+    /**
+     * @brief Get cache statistics (size, number of hits, misses, and evictions) as JSON object
+     */
+    nlohmann::json stats();
+
+    static const uint16_t NSHARDS = 16;
 
    private:
-    const uint64_t inc_prio() {
-        if (_cur_priority == std::numeric_limits<uint64_t>::max()) {
-            uint64_t newp = 0;
-            for (auto it = _prio_forward.begin(); it != _prio_forward.end(); ++it) {
-                it->second = newp++;
-                _prio_backward.insert(std::make_pair(it->second, it->first));
-            }
-            _cur_priority = newp;
-        } else {
-            ++_cur_priority;
+    struct key_hash {
+        std::size_t operator()(const key_type& k) const {
+            return std::hash<uint64_t>()((uint64_t(k.first) << 32) | uint64_t(k.second));
         }
-        return _cur_priority;
+    };
+
+    struct entry {
+        key_type key;
+        std::shared_ptr<chunk_data> value;
+        uint64_t last_use;  // value of _clock at the last access, used to find the least recently used entry of all shards
+    };
+
+    struct shard {
+        shard() : m(), lru(), index(), inflight() {}
+        std::mutex m;
+        std::list<entry> lru;  // most recently used first
+        std::unordered_map<key_type, std::list<entry>::iterator, key_hash> index;
+        std::unordered_map<key_type, std::shared_future<std::shared_ptr<chunk_data>>, key_hash> inflight;
+    };
+
+    inline shard& shard_of(key_type key) {
+        return _shards[key_hash()(key) % NSHARDS];
     }
 
-    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<chunk_data>> _cache;
-    std::map<uint64_t, std::pair<uint32_t, uint32_t>> _prio_backward;
-    std::map<std::pair<uint32_t, uint32_t>, uint64_t> _prio_forward;
+    // expects that s.m is locked
+    void add_locked(shard& s, key_type key, std::shared_ptr<chunk_data> value);
+
+    // expects that s.m is locked
+    void erase_locked(shard& s, std::list<entry>::iterator it);
 
-    std::mutex _m;
-    uint64_t _size_bytes;
+    // evict least recently used chunks of any shard until the cache fits into its maximum size, never evicts keep;
+    // expects that no shard is locked
+    void evict(key_type keep);
+
+    shard _shards[NSHARDS];
+
+    std::atomic<uint64_t> _size_bytes;
+    std::atomic<uint64_t> _clock;
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    std::atomic<uint64_t> _evictions;
 
     static std::mutex _singleton_mutex;
-    uint64_t _cur_priority;
 
    private:
-    server_chunk_cache() : _cache(), _prio_backward(), _prio_forward(), _m(), _size_bytes(0), _cur_priority(0) {}
+    server_chunk_cache() : _size_bytes(0), _clock(0), _hits(0), _misses(0), _evictions(0) {}
     ~server_chunk_cache() {}
     server_chunk_cache(const server_chunk_cache&) = delete;
     static server_chunk_cache* _instance;
@@ -207,8 +221,20 @@ class gdalcubes_server {
                                                                                                                                                                                                                                                        _ssl(ssl),
                                                                                                                                                                                                                                                        _workdir(workdir),
                                                                                                                                                                                                                                                        _cubestore(),
+                                                                                                                                                                                                                                                       _cube_ids_by_hash(),
+                                                                                                                                                                                                                                                       _cube_ttl(3600),
                                                                                                                                                                                                                                                        _cur_id(0),
-                                                                                                                                                                                                                                                       _chunk_cond(),
+                                                                                                                                                                                                                                                       _chunk_read_requests(),
+                                                                                                                                                                                                                                                       _chunk_read_requests_index(),
+                                                                                                                                                                                                                                                       _chunk_read_executing(),
+                                                                                                                                                                                                                                                       _chunk_read_requesters(),
+                                                                                                                                                                                                                                                       _client_round(),
+                                                                                                                                                                                                                                                       _cur_round(0),
+                                                                                                                                                                                                                                                       _cur_seq(0),
+                                                                                                                                                                                                                                                       _worker_threads(),
+                                                                                                                                                                                                                                                       _worker_shutdown(false),
+                                                                                                                                                                                                                                                       _chunk_finished(),
+                                                                                                                                                                                                                                                       _file_hashes(),
                                                                                                                                                                                                                                                        _whitelist(whitelist) {
         if (filesystem::exists(_workdir) && filesystem::is_directory(_workdir)) {
             // boost::filesystem::remove_all(_workdir); // TODO: uncomment after testing
@@ -228,18 +254,157 @@ class gdalcubes_server {
         _listener.support(web::http::methods::GET, std::bind(&gdalcubes_server::handle_get, this, std::placeholders::_1));
         _listener.support(web::http::methods::POST, std::bind(&gdalcubes_server::handle_post, this, std::placeholders::_1));
         _listener.support(web::http::methods::HEAD, std::bind(&gdalcubes_server::handle_head, this, std::placeholders::_1));
+        _listener.support(web::http::methods::DEL, std::bind(&gdalcubes_server::handle_delete, this, std::placeholders::_1));
+    }
+
+    ~gdalcubes_server() {
+        stop_workers();
     }
 
    public:
-    inline pplx::task<void> open() { return _listener.open(); }
-    inline pplx::task<void> close() { return _listener.close(); }
+    /**
+     * @brief Start worker threads and listen for incoming requests
+     * @details The number of worker threads is taken from config::get_server_worker_threads_max()
+     */
+    inline pplx::task<void> open() {
+        start_workers(config::instance()->get_server_worker_threads_max());
+        return _listener.open();
+    }
+    inline pplx::task<void> close() {
+        pplx::task<void> t = _listener.close();
+        stop_workers();
+        return t;
+    }
 
     inline std::string get_service_url() { return _listener.uri().to_string(); }
 
+    /**
+     * @brief Set the time after which idle cubes are removed
+     * @details Cubes that have been released by all clients are removed after min(60, seconds) seconds without
+     * requests.
+     * @param seconds idle time in seconds, defaults to 3600
+     */
+    inline void set_cube_ttl(uint32_t seconds) { _cube_ttl = seconds; }
+
    private:
+    /**
+     * @brief A queued chunk read request
+     *
+     * Requests are ordered by priority (higher first), the client's round, and submission order. Each request
+     * of a client is assigned to the next round of that client, but never earlier than the round of the most recently
+     * started request. Clients therefore are served in a round-robin fashion and a client submitting a few requests
+     * does not need to wait until all requests of a bulk export have been processed.
+     */
+    struct chunk_request {
+        std::pair<uint32_t, uint32_t> key;
+        std::string client;
+        int32_t priority;
+        uint64_t round;
+        uint64_t seq;
+
+        bool operator<(const chunk_request& other) const {
+            if (priority != other.priority) return priority > other.priority;
+            if (round != other.round) return round < other.round;
+            return seq < other.seq;
+        }
+    };
+
+    /**
+     * @brief Add a chunk read request to the queue
+     *
+     * If the chunk is already queued, the client is recorded as an additional requester of the existing request.
+     * @return false if the chunk is already cached, queued, or running
+     */
+    bool enqueue(std::pair<uint32_t, uint32_t> key, std::string client, int32_t priority);
+
+    /**
+     * @brief Withdraw a client's request of a queued chunk, running requests cannot be canceled
+     *
+     * The queued request is only removed if no other client has requested the same chunk.
+     * @return true if the request has been removed from the queue
+     */
+    bool cancel(std::pair<uint32_t, uint32_t> key, std::string client);
+
+    /**
+     * @brief Add a chunk read request to the queue, or emit a completion event if the chunk is already available
+     */
+    void start(std::pair<uint32_t, uint32_t> key, std::string client, int32_t priority);
+
+    /**
+     * @brief Record that a chunk read request finished (successfully or not) and wake up waiting requests
+     */
+    void notify_finished(std::pair<uint32_t, uint32_t> key, bool success);
+
+    /**
+     * @brief Wait until chunks of a cube have finished
+     * @param cube_id cube id
+     * @param since number of completion events of the cube that the caller has already seen
+     * @param timeout_ms maximum waiting time in milliseconds
+     * @return JSON object with ids of finished and failed chunks, and the number of events seen after this call
+     */
+    nlohmann::json wait_finished(uint32_t cube_id, uint64_t since, uint32_t timeout_ms);
+
+    /**
+     * @brief Wait until a requested chunk is available in the chunk cache
+     * @return chunk data or nullptr if the chunk read has been canceled or failed
+     */
+    std::shared_ptr<chunk_data> wait_chunk(std::pair<uint32_t, uint32_t> key);
+
+    /**
+     * @brief Send chunk data as response, encoded according to the X-Gdalcubes-Chunk-Encoding request header
+     */
+    void reply_chunk(web::http::http_request req, std::shared_ptr<chunk_data> dat);
+
+    /**
+     * @brief Compute and send a map tile, see GET /cube/{cube_id}/tiles/{t}/{z}/{x}/{y}.png
+     */
+    void handle_tile(web::http::http_request req, uint32_t cube_id, std::vector<std::string> path, std::map<std::string, std::string> query_pars);
+
+    /**
+     * @brief Get the status of a chunk ("finished", "running", "queued", or "notrequested")
+     */
+    std::string chunk_status(std::pair<uint32_t, uint32_t> key);
+
+    /**
+     * @brief Get the current queue depth, number of running requests, and number of workers as JSON object
+     */
+    nlohmann::json queue_stats();
+
+    /**
+     * @brief Get library counters (see metrics) and server queue and cache statistics in the Prometheus text format
+     */
+    std::string prometheus_metrics();
+
+    /**
+     * @brief Compute the content hash (xxhash64) of a file, hashes are cached until the file's size or modification time change
+     */
+    std::string file_hash(std::string fname);
+
+    /**
+     * @brief Check whether a string is a valid content hash (xxhash64), i.e. exactly 16 hexadecimal characters
+     */
+    static inline bool is_valid_hash(const std::string& hash) {
+        return hash.size() == 16 && std::all_of(hash.begin(), hash.end(), [](char x) { return std::isxdigit(static_cast<unsigned char>(x)) != 0; });
+    }
+
+    /**
+     * @brief Path of the partial file of a resumable upload, hash must be a valid content hash (see is_valid_hash())
+     */
+    inline std::string upload_part_path(std::string fname, std::string hash) {
+        if (!is_valid_hash(hash)) {
+            throw std::string("ERROR in gdalcubes_server::upload_part_path(): invalid content hash");
+        }
+        return fname + "." + hash + ".part";
+    }
+
+    void start_workers(uint16_t n);
+    void stop_workers();
+    void worker_loop();
+
     void handle_get(web::http::http_request req);
     void handle_post(web::http::http_request req);
     void handle_head(web::http::http_request req);
+    void handle_delete(web::http::http_request req);
 
     web::http::experimental::listener::http_listener _listener;
 
@@ -256,28 +421,96 @@ class gdalcubes_server {
     const bool _ssl;
     const std::string _workdir;
 
-    std::map<uint32_t, std::shared_ptr<cube>> _cubestore;
+    /**
+     * @brief A cube registered by one or more clients
+     */
+    struct cube_entry {
+        std::shared_ptr<cube> c;
+        std::string json;                 // canonical JSON representation
+        std::set<std::string> aliases;    // other JSON representations that resolved to this cube
+        std::vector<std::string> hashes;  // xxhash64 of json and aliases
+        uint32_t refs;     // number of clients that registered the cube and did not release it yet
+        std::chrono::steady_clock::time_point last_access;
+    };
+
+    /**
+     * @brief Register a cube from its JSON representation
+     * @details Cubes with identical canonical JSON representation share the same id and hence cached chunks.
+     * @return cube id
+     */
+    uint32_t register_cube(std::string json);
+
+    /**
+     * @brief Find a registered cube by its JSON representation and increment its reference count
+     * @details Must be called while holding _mutex_cubestore.
+     * @return cube id or NO_CUBE
+     */
+    uint32_t find_cube(std::string json);
+
+    /**
+     * @brief Make a cube findable by a JSON representation, must be called while holding _mutex_cubestore
+     */
+    void add_cube_hash(uint32_t cube_id, std::string json);
+
+    static const uint32_t NO_CUBE = std::numeric_limits<uint32_t>::max();
 
-    uint16_t _cur_id;
+    /**
+     * @brief Release a cube, such that it can be removed when it is no longer used
+     * @param purge_chunks if true and no other client uses the cube, cached chunks of the cube are removed immediately
+     * @return false if the cube is not available
+     */
+    bool release_cube(uint32_t cube_id, bool purge_chunks = false);
+
+    /**
+     * @brief Get a registered cube and mark it as recently used
+     * @return cube or nullptr if the cube is not available
+     */
+    std::shared_ptr<cube> get_cube(uint32_t cube_id);
+
+    /**
+     * @brief Remove idle cubes, see set_cube_ttl()
+     */
+    void expire_cubes();
+
+    std::map<uint32_t, cube_entry> _cubestore;
+    std::unordered_map<std::string, uint32_t> _cube_ids_by_hash;  // xxhash64 of canonical JSON to cube id
+    uint32_t _cube_ttl;
+
+    uint32_t _cur_id;
     std::mutex _mutex_id;
     std::mutex _mutex_cubestore;
 
-    uint16_t _worker_thread_count;
-
+    // _mutex_chunk_read_requests protects the queue, running requests, and round bookkeeping
     std::mutex _mutex_chunk_read_requests;
-    std::list<std::pair<uint32_t, uint32_t>> _chunk_read_requests;
-    std::set<std::pair<uint32_t, uint32_t>> _chunk_read_requests_set;
-
-    std::mutex _mutex_chunk_read_executing;
+    std::set<chunk_request> _chunk_read_requests;
+    std::map<std::pair<uint32_t, uint32_t>, std::set<chunk_request>::iterator> _chunk_read_requests_index;
     std::set<std::pair<uint32_t, uint32_t>> _chunk_read_executing;
+    std::map<std::pair<uint32_t, uint32_t>, std::set<std::string>> _chunk_read_requesters;  // clients per queued request
+    std::map<std::string, uint64_t> _client_round;
+    uint64_t _cur_round;
+    uint64_t _cur_seq;
 
     std::vector<std::thread> _worker_threads;
-    std::mutex _mutex_worker_threads;
-
     std::condition_variable _worker_cond;
-    std::mutex _mutex_worker_cond;
+    bool _worker_shutdown;
 
-    std::map<std::pair<uint32_t, uint32_t>, std::pair<std::condition_variable, std::mutex>> _chunk_cond;
+    struct chunk_events {
+        std::vector<std::pair<uint32_t, bool>> events;  // (chunk_id, success) in order of completion
+        std::set<uint32_t> finished;                    // chunks with a success event, to skip duplicates
+    };
+
+    // completion events per cube, removed when the cube is released by all clients or expires
+    std::map<uint32_t, chunk_events> _chunk_finished;
+    std::mutex _mutex_chunk_finished;
+    std::condition_variable _chunk_finished_cond;
+
+    struct file_hash_entry {
+        uint64_t size;
+        time_t mtime;
+        std::string hash;
+    };
+    std::map<std::string, file_hash_entry> _file_hashes;
+    std::mutex _mutex_files;  // protects _file_hashes and partial uploads
 
     std::set<std::string> _whitelist;
 };
@@ -25,11 +25,13 @@
 #include "stream.h"
 #include <stdlib.h>
 #include "external/tiny-process-library/process.hpp"
+#include "stream_shm.h"
 
 namespace gdalcubes {
 
 std::shared_ptr<chunk_data> stream_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("stream_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "stream", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks()) {
         // chunk is outside of the cube, we don't need to read anything.
@@ -37,7 +39,9 @@ std::shared_ptr<chunk_data> stream_cube::read_chunk(chunkid_t id) {
         return out;
     }
 
-    if (_file_streaming) {
+    if (_persistent) {
+        out = stream_chunk_pool(_in_cube->read_chunk(id), id);
+    } else if (_file_streaming) {
         out = stream_chunk_file(_in_cube->read_chunk(id), id);
     } else {
         out = stream_chunk_stdin(_in_cube->read_chunk(id), id);
@@ -46,6 +50,7 @@ std::shared_ptr<chunk_data> stream_cube::read_chunk(chunkid_t id) {
     if (out->empty()) {
         GCBS_DEBUG("Streaming returned empty chunk " + std::to_string(id));
     }
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -61,6 +66,8 @@ std::shared_ptr<chunk_data> stream_cube::stream_chunk_stdin(std::shared_ptr<chun
     std::string errstr;
     uint32_t databytes_read = 0;
 
+    /* setenv / _putenv is not thread-safe, we need to get a mutex until the child process has been started. */
+    stream_env_mutex().lock();
 #ifdef _WIN32
     _putenv("GDALCUBES_STREAMING=1");
     _putenv((std::string("GDALCUBES_STREAMING_CHUNK_ID") + "=" + std::to_string(id)).c_str());
@@ -94,31 +101,11 @@ std::shared_ptr<chunk_data> stream_cube::stream_chunk_stdin(std::shared_ptr<chun
         } }, [&errstr](const char *bytes, std::size_t n) {
     errstr = std::string(bytes, n);
     GCBS_DEBUG(errstr); }, true);
+    stream_env_mutex().unlock();
 
     // Write to stdin
-    std::string proj = _in_cube->st_reference()->srs();
-    process.write((char *)(size), sizeof(int) * 4);
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        int str_size = _in_cube->bands().get(i).name.size();
-        process.write((char *)(&str_size), sizeof(int));
-        process.write(_in_cube->bands().get(i).name.c_str(), sizeof(char) * str_size);
-    }
-    double *dims = (double *)std::calloc(size[1] + size[2] + size[3], sizeof(double));
-    for (int i = 0; i < size[1]; ++i) {
-        dims[i] = (_in_cube->st_reference()->t0() + _in_cube->st_reference()->dt() * i).to_double();
-    }
-    for (int i = size[1]; i < size[1] + size[2]; ++i) {
-        dims[i] = _in_cube->st_reference()->win().bottom + i * _in_cube->st_reference()->dy();
-    }
-    for (int i = size[1] + size[2]; i < size[1] + size[2] + size[3]; ++i) {
-        dims[i] = _in_cube->st_reference()->win().left + i * _in_cube->st_reference()->dx();
-    }
-    process.write((char *)(dims), sizeof(double) * (size[1] + size[2] + size[3]));
-    std::free(dims);
-
-    int str_size = proj.size();
-    process.write((char *)(&str_size), sizeof(int));
-    process.write(proj.c_str(), sizeof(char) * str_size);
+    std::string header = stream_header(data, id);
+    process.write(header.data(), header.size());
     process.write(((char *)(data->buf())), sizeof(double) * data->size()[0] * data->size()[1] * data->size()[2] * data->size()[3]);
 
     process.close_stdin();  // needed?
@@ -140,111 +127,118 @@ std::shared_ptr<chunk_data> stream_cube::stream_chunk_file(std::shared_ptr<chunk
         return out;
     }
 
-    // generate in and out filename
-    std::string f_in = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_", "_in"));
-    std::string f_out = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_", "_out"));
+    // shared memory (or temporary) files for input and output
+    stream_shm f_in("_in");
+    stream_shm f_out("_out");
 
     std::string errstr;  // capture error string
 
     // write input data
-    std::ofstream f_in_stream(f_in, std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!f_in_stream.is_open()) {
-        GCBS_ERROR("Cannot write streaming input data to file '" + f_in + "'");
-        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot write streaming input data to file '" + f_in + "'");
+    std::string header = stream_header(data, id);
+    if (!f_in.write(header.data(), header.size()) || !f_in.write(data->buf(), data->total_size_bytes())) {
+        GCBS_ERROR("Cannot write streaming input data to file '" + f_in.path() + "'");
+        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot write streaming input data to file '" + f_in.path() + "'");
     }
-
-    std::string proj = _in_cube->st_reference()->srs();
-    f_in_stream.write((char *)(size), sizeof(int) * 4);
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        int str_size = _in_cube->bands().get(i).name.size();
-        f_in_stream.write((char *)(&str_size), sizeof(int));
-        f_in_stream.write(_in_cube->bands().get(i).name.c_str(), sizeof(char) * str_size);
-    }
-
-    double *dims = (double *)std::calloc(size[1] + size[2] + size[3], sizeof(double));
-    int i = 0;
-    for (int it = 0; it < size[1]; ++it) {
-        dims[i] = (_in_cube->st_reference()->t0() + _in_cube->st_reference()->dt() * (it + _in_cube->chunk_size()[0] * _in_cube->chunk_limits(id).low[0])).to_double();
-        ++i;
-    }
-    bounds_st cextent = this->bounds_from_chunk(id);  // implemented in derived classes
-    for (int iy = 0; iy < size[2]; ++iy) {
-        dims[i] = cextent.s.bottom + chunk_size(id)[1] * st_reference()->dy() - (iy + 0.5) * st_reference()->dy();  // cell center
-        ++i;
-    }
-    for (int ix = 0; ix < size[3]; ++ix) {
-        dims[i] = cextent.s.left + (ix + 0.5) * st_reference()->dx();
-        ++i;
-    }
-
-    f_in_stream.write((char *)(dims), sizeof(double) * (size[1] + size[2] + size[3]));
-    std::free(dims);
-
-    int str_size = proj.size();
-    f_in_stream.write((char *)(&str_size), sizeof(int));
-    f_in_stream.write(proj.c_str(), sizeof(char) * str_size);
-    f_in_stream.write(((char *)(data->buf())), sizeof(double) * data->size()[0] * data->size()[1] * data->size()[2] * data->size()[3]);
-    f_in_stream.close();
+    f_in.close_write();
 
     /* setenv / _putenv is not thread-safe, we need to get a mutex until the child process has been started. */
-    static std::mutex mtx;
-    mtx.lock();
+    stream_env_mutex().lock();
 #ifdef _WIN32
     _putenv("GDALCUBES_STREAMING=1");
     //_putenv((std::string("GDALCUBES_STREAMING_DIR") + "=" + config::instance()->get_streaming_dir().c_str()).c_str());
     _putenv((std::string("GDALCUBES_STREAMING_CHUNK_ID") + "=" + std::to_string(id)).c_str());
-    _putenv((std::string("GDALCUBES_STREAMING_FILE_IN") + "=" + f_in.c_str()).c_str());
-    _putenv((std::string("GDALCUBES_STREAMING_FILE_OUT") + "=" + f_out.c_str()).c_str());
+    _putenv((std::string("GDALCUBES_STREAMING_FILE_IN") + "=" + f_in.path().c_str()).c_str());
+    _putenv((std::string("GDALCUBES_STREAMING_FILE_OUT") + "=" + f_out.path().c_str()).c_str());
 #else
     setenv("GDALCUBES_STREAMING", "1", 1);
     // setenv("GDALCUBES_STREAMING_DIR", config::instance()->get_streaming_dir().c_str(), 1);
     setenv("GDALCUBES_STREAMING_CHUNK_ID", std::to_string(id).c_str(), 1);
-    setenv("GDALCUBES_STREAMING_FILE_IN", f_in.c_str(), 1);
-    setenv("GDALCUBES_STREAMING_FILE_OUT", f_out.c_str(), 1);
+    setenv("GDALCUBES_STREAMING_FILE_IN", f_in.path().c_str(), 1);
+    setenv("GDALCUBES_STREAMING_FILE_OUT", f_out.path().c_str(), 1);
 #endif
 
     // start process
     TinyProcessLib::Process process(_cmd, "", [](const char *bytes, std::size_t n) {}, [&errstr](const char *bytes, std::size_t n) {
         errstr = std::string(bytes, n);
         GCBS_DEBUG(errstr); }, false);
-    mtx.unlock();
+    stream_env_mutex().unlock();
     auto exit_status = process.get_exit_status();
-    filesystem::remove(f_in);
     if (exit_status != 0) {
         GCBS_ERROR("Child process failed with exit code " + std::to_string(exit_status));
         GCBS_ERROR("Child process output: " + errstr);
-        if (filesystem::exists(f_out)) {
-            filesystem::remove(f_out);
-        }
         throw std::string("ERROR in stream_cube::read_chunk(): external program returned exit code " + std::to_string(exit_status));
     }
 
-    // read output data
-    std::ifstream f_out_stream(f_out, std::ios::in | std::ios::binary);
-    if (!f_out_stream.is_open()) {
-        GCBS_ERROR("Cannot read streaming output data from file '" + f_out + "'");
-        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot read streaming output data from file '" + f_out + "'");
+    // read output data directly into the result buffer
+    int out_size_int[4];
+    uint64_t length = f_out.size();
+    if (length < 4 * sizeof(int) || !f_out.read(0, out_size_int, 4 * sizeof(int))) {
+        GCBS_ERROR("Cannot read streaming output data from file '" + f_out.path() + "'");
+        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot read streaming output data from file '" + f_out.path() + "'");
     }
-
-    f_out_stream.seekg(0, f_out_stream.end);
-    int length = f_out_stream.tellg();
-    f_out_stream.seekg(0, f_out_stream.beg);
-    char *buffer = (char *)std::calloc(length, sizeof(char));
-    f_out_stream.read(buffer, length);
-    f_out_stream.close();
-
-    chunk_size_btyx out_size = {(uint32_t)(((int *)buffer)[0]), (uint32_t)(((int *)buffer)[1]),
-                                (uint32_t)(((int *)buffer)[2]), (uint32_t)(((int *)buffer)[3])};
+    chunk_size_btyx out_size = {(uint32_t)out_size_int[0], (uint32_t)out_size_int[1], (uint32_t)out_size_int[2], (uint32_t)out_size_int[3]};
     out->size(out_size);
     out->buf(std::calloc(out_size[0] * out_size[1] * out_size[2] * out_size[3], sizeof(double)));
-    std::memcpy(out->buf(), buffer + (4 * sizeof(int)), length - 4 * sizeof(int));
-    std::free(buffer);
+    f_out.read(4 * sizeof(int), out->buf(), std::min(length - 4 * sizeof(int), out->total_size_bytes()));
+
+    return out;
+}
 
-    if (filesystem::exists(f_out)) {
-        filesystem::remove(f_out);
+std::string stream_cube::stream_header(std::shared_ptr<chunk_data> data, chunkid_t id) {
+    std::string out;
+    int size[] = {(int)data->size()[0], (int)data->size()[1], (int)data->size()[2], (int)data->size()[3]};
+    out.append((char *)(size), sizeof(int) * 4);
+    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
+        int str_size = _in_cube->bands().get(i).name.size();
+        out.append((char *)(&str_size), sizeof(int));
+        out.append(_in_cube->bands().get(i).name);
+    }
+
+    std::vector<double> dims;
+    bounds_nd<uint32_t, 3> climits = _in_cube->chunk_limits(id);
+    for (int it = 0; it < size[1]; ++it) {
+        dims.push_back((_in_cube->st_reference()->t0() + _in_cube->st_reference()->dt() * (climits.low[0] + it)).to_double());
     }
+    bounds_st cextent = _in_cube->bounds_from_chunk(id);
+    for (int iy = 0; iy < size[2]; ++iy) {
+        dims.push_back(cextent.s.bottom + size[2] * _in_cube->st_reference()->dy() - (iy + 0.5) * _in_cube->st_reference()->dy());  // cell center
+    }
+    for (int ix = 0; ix < size[3]; ++ix) {
+        dims.push_back(cextent.s.left + (ix + 0.5) * _in_cube->st_reference()->dx());
+    }
+    out.append((char *)(dims.data()), sizeof(double) * dims.size());
 
+    std::string proj = _in_cube->st_reference()->srs();
+    int str_size = proj.size();
+    out.append((char *)(&str_size), sizeof(int));
+    out.append(proj);
     return out;
 }
 
-}  // namespace gdalcubes
\ No newline at end of file
+std::shared_ptr<chunk_data> stream_cube::stream_chunk_pool(std::shared_ptr<chunk_data> data, chunkid_t id) {
+    if (data->empty()) {
+        return std::make_shared<chunk_data>();
+    }
+
+    std::shared_ptr<stream_worker_pool> pool;
+    {
+        std::lock_guard<std::mutex> lck(_pool_mutex);
+        if (!_pool && !_pool_failed) {
+            // one process per thread of the chunk processor
+            uint32_t nproc = std::max(config::instance()->get_default_chunk_processor()->max_threads(), (uint32_t)1);
+            _pool = std::make_shared<stream_worker_pool>(_cmd, nproc);
+            if (!_pool->check()) {
+                GCBS_WARN("External program does not support persistent streaming, starting one process per chunk instead");
+                _pool = nullptr;
+                _pool_failed = true;
+            }
+        }
+        pool = _pool;
+    }
+    if (!pool) {
+        return _file_streaming ? stream_chunk_file(data, id) : stream_chunk_stdin(data, id);
+    }
+    return pool->process(id, stream_header(data, id), data);
+}
+
+}  // namespace gdalcubes
@@ -25,6 +25,7 @@
 #define STREAM_H
 
 #include "cube.h"
+#include "stream_pool.h"
 
 namespace gdalcubes {
 
@@ -48,16 +49,18 @@ class stream_cube : public cube {
      * @param cmd external program call
      * @param log_output what to to with the output of the external program, either empty, "stdout", "stderr", or a filename
      * @param file_streaming boolean, shall chunk data be shared as files (e.g. on /dev/shm) instead of using std streams?
+     * @param persistent boolean, shall chunks be streamed to a pool of long-lived processes using the framed protocol (see stream_worker_pool)?
+     * If the external program does not respond to the protocol, one process per chunk is started instead.
      * @return a shared pointer to the created data cube instance
      */
-    static std::shared_ptr<stream_cube> create(std::shared_ptr<cube> in_cube, std::string cmd, bool file_streaming = false) {
-        std::shared_ptr<stream_cube> out = std::make_shared<stream_cube>(in_cube, cmd, file_streaming);
+    static std::shared_ptr<stream_cube> create(std::shared_ptr<cube> in_cube, std::string cmd, bool file_streaming = false, bool persistent = false) {
+        std::shared_ptr<stream_cube> out = std::make_shared<stream_cube>(in_cube, cmd, file_streaming, persistent);
         in_cube->add_child_cube(out);
         out->add_parent_cube(in_cube);
         return out;
     }
 
-    stream_cube(std::shared_ptr<cube> in_cube, std::string cmd, bool file_streaming = false) : cube(std::make_shared<cube_st_reference>(*(in_cube->st_reference()))), _in_cube(in_cube), _cmd(cmd), _file_streaming(file_streaming), _keep_input_nt(false), _keep_input_ny(false), _keep_input_nx(false) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
+    stream_cube(std::shared_ptr<cube> in_cube, std::string cmd, bool file_streaming = false, bool persistent = false) : cube(std::make_shared<cube_st_reference>(*(in_cube->st_reference()))), _in_cube(in_cube), _cmd(cmd), _file_streaming(file_streaming), _persistent(persistent), _pool(nullptr), _pool_failed(false), _pool_mutex(), _keep_input_nt(false), _keep_input_ny(false), _keep_input_nx(false) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
         // Test CMD and find out what size comes out.
         cube_size_tyx tmp = _in_cube->chunk_size(0);
         cube_size_btyx csize_in = {_in_cube->bands().count(), tmp[0], tmp[1], tmp[2]};
@@ -68,7 +71,9 @@ class stream_cube : public cube {
         dummy_chunk->buf(std::calloc(csize_in[0] * csize_in[1] * csize_in[2] * csize_in[3], sizeof(double)));
 
         std::shared_ptr<chunk_data> c0;
-        if (_file_streaming) {
+        if (_persistent) {
+            c0 = stream_chunk_pool(dummy_chunk, 0);
+        } else if (_file_streaming) {
             c0 = stream_chunk_file(dummy_chunk, 0);
         } else {
             c0 = stream_chunk_stdin(dummy_chunk, 0);
@@ -117,6 +122,7 @@ class stream_cube : public cube {
         out["command"] = _cmd;
         out["in_cube"] = _in_cube->make_constructible_json();
         out["file_streaming"] = _file_streaming;
+        out["persistent"] = _persistent;
         return out;
     }
 
@@ -124,6 +130,11 @@ class stream_cube : public cube {
     std::shared_ptr<cube> _in_cube;
     std::string _cmd;
     bool _file_streaming;
+    bool _persistent;
+
+    std::shared_ptr<stream_worker_pool> _pool;
+    bool _pool_failed;
+    std::mutex _pool_mutex;
 
     // Variables to help deriving the size when view changes without testing with a dummy chunk
     bool _keep_input_nt;
@@ -135,6 +146,11 @@ class stream_cube : public cube {
 
     std::shared_ptr<chunk_data> stream_chunk_file(std::shared_ptr<chunk_data> data, chunkid_t id);
 
+    std::shared_ptr<chunk_data> stream_chunk_pool(std::shared_ptr<chunk_data> data, chunkid_t id);
+
+    // serialize size, band names, dimension values, and SRS of a chunk as expected by external programs
+    std::string stream_header(std::shared_ptr<chunk_data> data, chunkid_t id);
+
     virtual void set_st_reference(std::shared_ptr<cube_st_reference> stref) override {
         _st_ref->win() = stref->win();
         _st_ref->srs() = stref->srs();
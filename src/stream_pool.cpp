@@ -0,0 +1,244 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "stream_pool.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "external/tiny-process-library/process.hpp"
+
+namespace gdalcubes {
+
+std::mutex &stream_env_mutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+stream_worker::stream_worker(std::string cmd) : _process(nullptr), _exited(false), _buf(), _errstr(), _m(), _cv() {
+    std::lock_guard<std::mutex> lck(stream_env_mutex());
+#ifdef _WIN32
+    _putenv("GDALCUBES_STREAMING=1");
+    _putenv("GDALCUBES_STREAMING_PERSISTENT=1");
+#else
+    setenv("GDALCUBES_STREAMING", "1", 1);
+    setenv("GDALCUBES_STREAMING_PERSISTENT", "1", 1);
+#endif
+    _process = std::unique_ptr<TinyProcessLib::Process>(new TinyProcessLib::Process(
+        cmd, "", [this](const char *bytes, std::size_t n) {
+            std::lock_guard<std::mutex> lck(_m);
+            _buf.append(bytes, n);
+            _cv.notify_all(); }, [this](const char *bytes, std::size_t n) {
+            std::lock_guard<std::mutex> lck(_m);
+            _errstr = std::string(bytes, n);
+            GCBS_DEBUG(_errstr); }, true));
+
+    // other child processes must not inherit the variable
+#ifdef _WIN32
+    _putenv("GDALCUBES_STREAMING_PERSISTENT=");
+#else
+    unsetenv("GDALCUBES_STREAMING_PERSISTENT");
+#endif
+    if (_process->get_id() <= 0) {
+        _exited = true;
+    }
+}
+
+stream_worker::~stream_worker() {
+    if (!_exited) {
+        int32_t type = STREAM_MSG_EXIT;
+        uint64_t len = 0;
+        _process->write((char *)(&type), sizeof(int32_t));
+        _process->write((char *)(&len), sizeof(uint64_t));
+        _process->close_stdin();
+
+        // give the process some time to terminate gracefully
+        int status;
+        for (uint16_t i = 0; i < 10; ++i) {
+            if (_process->try_get_exit_status(status)) {
+                _exited = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        if (!_exited) {
+            _process->kill(true);
+            _process->get_exit_status();
+        }
+    }
+    _process.reset();
+}
+
+bool stream_worker::alive() {
+    if (_exited) return false;
+    int status;
+    if (_process->try_get_exit_status(status)) {
+        GCBS_DEBUG("Streaming process exited with exit code " + std::to_string(status));
+        _exited = true;
+    }
+    return !_exited;
+}
+
+bool stream_worker::request(int32_t type, const std::string &header, const void *data, uint64_t data_size,
+                            int32_t &response_type, std::string &response, uint32_t timeout_ms) {
+    if (!alive()) return false;
+    {
+        std::lock_guard<std::mutex> lck(_m);
+        _buf.clear();
+    }
+
+    uint64_t len = header.size() + data_size;
+    bool ok = _process->write((char *)(&type), sizeof(int32_t)) && _process->write((char *)(&len), sizeof(uint64_t));
+    if (ok && !header.empty()) ok = _process->write(header.data(), header.size());
+    if (ok && data_size > 0) ok = _process->write((const char *)data, data_size);
+    if (!ok) {
+        GCBS_DEBUG("Failed to write to streaming process");
+        return false;
+    }
+
+    const std::size_t hdr_size = sizeof(int32_t) + sizeof(uint64_t);
+    auto t_start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lck(_m);
+    while (true) {
+        if (_buf.size() >= hdr_size) {
+            uint64_t rlen;
+            std::memcpy(&rlen, _buf.data() + sizeof(int32_t), sizeof(uint64_t));
+            if (_buf.size() >= hdr_size + rlen) {
+                std::memcpy(&response_type, _buf.data(), sizeof(int32_t));
+                response = _buf.substr(hdr_size, rlen);
+                _buf.erase(0, hdr_size + rlen);
+                return true;
+            }
+        }
+        if (_exited) {
+            // all output of the process has been received, the response is incomplete
+            return false;
+        }
+        if (_cv.wait_for(lck, std::chrono::milliseconds(100)) == std::cv_status::timeout) {
+            // checking the exit status joins the thread reading stdout, which needs the lock
+            lck.unlock();
+            alive();
+            lck.lock();
+            if (timeout_ms > 0 && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_start).count() > timeout_ms) {
+                GCBS_DEBUG("Streaming process did not respond within " + std::to_string(timeout_ms) + " ms");
+                return false;
+            }
+        }
+    }
+}
+
+bool stream_worker_pool::start(uint16_t i) {
+    _workers[i].reset(new stream_worker(_cmd));
+    int32_t rtype;
+    std::string response;
+    if (!_workers[i]->request(STREAM_MSG_PING, "", nullptr, 0, rtype, response, START_TIMEOUT_MS) || rtype != STREAM_MSG_PING) {
+        GCBS_DEBUG("Streaming process does not respond to the persistent streaming protocol: " + _workers[i]->errstr());
+        _workers[i].reset();
+        return false;
+    }
+    return true;
+}
+
+uint16_t stream_worker_pool::acquire() {
+    std::unique_lock<std::mutex> lck(_m);
+    while (true) {
+        // prefer already running processes
+        for (uint16_t i = 0; i < _busy.size(); ++i) {
+            if (!_busy[i] && _workers[i]) {
+                _busy[i] = true;
+                return i;
+            }
+        }
+        for (uint16_t i = 0; i < _busy.size(); ++i) {
+            if (!_busy[i]) {
+                _busy[i] = true;
+                return i;
+            }
+        }
+        _cv.wait(lck);
+    }
+}
+
+void stream_worker_pool::release(uint16_t i) {
+    std::lock_guard<std::mutex> lck(_m);
+    _busy[i] = false;
+    _cv.notify_one();
+}
+
+bool stream_worker_pool::check() {
+    uint16_t i = acquire();
+    bool ok = (_workers[i] && _workers[i]->alive()) || start(i);
+    release(i);
+    return ok;
+}
+
+std::shared_ptr<chunk_data> stream_worker_pool::process(chunkid_t id, const std::string &header, std::shared_ptr<chunk_data> data) {
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+
+    int32_t cid = id;
+    std::string request_header = std::string((char *)(&cid), sizeof(int32_t)) + header;
+
+    uint16_t i = acquire();
+    int32_t rtype = STREAM_MSG_ERROR;
+    std::string response;
+    bool ok = false;
+    std::string errstr;
+    for (uint16_t attempt = 0; attempt < 2 && !ok; ++attempt) {
+        // health check, restart crashed processes
+        if (!_workers[i] || !_workers[i]->alive()) {
+            if (!start(i)) continue;
+        }
+        ok = _workers[i]->request(STREAM_MSG_CHUNK, request_header, data->buf(), data->total_size_bytes(), rtype, response);
+        if (!ok) {
+            errstr = _workers[i]->errstr();
+            _workers[i].reset();
+            GCBS_WARN("Streaming process failed while processing chunk " + std::to_string(id) + ", restarting");
+        }
+    }
+    release(i);
+
+    if (!ok) {
+        GCBS_ERROR("Streaming process output: " + errstr);
+        throw std::string("ERROR in stream_worker_pool::process(): streaming process failed for chunk " + std::to_string(id));
+    }
+    if (rtype == STREAM_MSG_ERROR) {
+        GCBS_ERROR("Streaming process output: " + response);
+        throw std::string("ERROR in stream_worker_pool::process(): external program failed for chunk " + std::to_string(id));
+    }
+    if (response.size() < 4 * sizeof(int)) {
+        GCBS_WARN("Cannot read streaming result, returning empty chunk");
+        return out;
+    }
+
+    chunk_size_btyx out_size = {(uint32_t)(((int *)response.data())[0]), (uint32_t)(((int *)response.data())[1]),
+                                (uint32_t)(((int *)response.data())[2]), (uint32_t)(((int *)response.data())[3])};
+    uint64_t nbytes = (uint64_t)out_size[0] * out_size[1] * out_size[2] * out_size[3] * sizeof(double);
+    out->size(out_size);
+    out->buf(std::calloc(out_size[0] * out_size[1] * out_size[2] * out_size[3], sizeof(double)));
+    std::memcpy(out->buf(), response.data() + 4 * sizeof(int), std::min(nbytes, (uint64_t)(response.size() - 4 * sizeof(int))));
+    return out;
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,166 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef STREAM_POOL_H
+#define STREAM_POOL_H
+
+#include <condition_variable>
+#include "cube.h"
+
+namespace TinyProcessLib {
+class Process;
+}
+
+namespace gdalcubes {
+
+/**
+ * @brief Get a mutex that must be locked while environment variables are set for and used by new child processes
+ *
+ * setenv / _putenv is not thread-safe and child processes inherit the environment at start.
+ */
+std::mutex &stream_env_mutex();
+
+/**
+ * @brief Message types of the framed protocol between gdalcubes and persistent streaming processes
+ *
+ * Each message consists of a 4 byte integer message type, an 8 byte unsigned integer length of the payload,
+ * and the payload itself.
+ *
+ * Requests (written to stdin of the child process):
+ * - STREAM_MSG_CHUNK: 4 byte integer chunk id followed by chunk data in the same format as in non-persistent streaming
+ *   (4 integers size, band names, dimension values, SRS, data values)
+ * - STREAM_MSG_PING: empty payload, the child must respond with STREAM_MSG_PING
+ * - STREAM_MSG_EXIT: empty payload, the child should terminate
+ *
+ * Responses (written to stdout of the child process):
+ * - STREAM_MSG_CHUNK: result chunk in the same format as in non-persistent streaming (4 integers size, data values)
+ * - STREAM_MSG_PING: empty payload
+ * - STREAM_MSG_ERROR: error message string
+ */
+enum stream_message_type : int32_t {
+    STREAM_MSG_EXIT = 0,
+    STREAM_MSG_CHUNK = 1,
+    STREAM_MSG_PING = 2,
+    STREAM_MSG_ERROR = 3
+};
+
+/**
+ * @brief A long-lived external process that processes many chunks using the framed streaming protocol
+ *
+ * The process is started with environment variables GDALCUBES_STREAMING=1 and
+ * GDALCUBES_STREAMING_PERSISTENT=1.
+ */
+class stream_worker {
+   public:
+    stream_worker(std::string cmd);
+    ~stream_worker();
+
+    /**
+     * @brief Check whether the process is still running
+     */
+    bool alive();
+
+    /**
+     * @brief Send a request and wait for the response
+     *
+     * The payload of the request consists of a header and an optional data buffer, which are written to the process without copies.
+     *
+     * @param type message type of the request
+     * @param header first part of the request payload
+     * @param data pointer to the second part of the request payload, may be nullptr
+     * @param data_size size of the second part of the request payload in bytes
+     * @param response_type message type of the response
+     * @param response response payload
+     * @param timeout_ms maximum time to wait for the response in milliseconds, 0 for no timeout
+     * @return false if the process died or did not respond in time, true otherwise
+     */
+    bool request(int32_t type, const std::string &header, const void *data, uint64_t data_size,
+                 int32_t &response_type, std::string &response, uint32_t timeout_ms = 0);
+
+    /**
+     * @brief Get the last output of the process on stderr
+     */
+    std::string errstr() {
+        std::lock_guard<std::mutex> lck(_m);
+        return _errstr;
+    }
+
+   private:
+    std::unique_ptr<TinyProcessLib::Process> _process;
+    bool _exited;
+    std::string _buf;  // received bytes of the current response
+    std::string _errstr;
+    std::mutex _m;
+    std::condition_variable _cv;
+};
+
+/**
+ * @brief A fixed-size pool of persistent external processes shared by all chunks of a cube
+ *
+ * Processes are started lazily, checked with a ping message on start, and restarted if they crashed.
+ */
+class stream_worker_pool {
+   public:
+    /**
+     * @brief Create a pool of external processes
+     * @param cmd external program call
+     * @param size maximum number of processes
+     */
+    stream_worker_pool(std::string cmd, uint16_t size) : _cmd(cmd), _workers(size), _busy(size, false), _m(), _cv() {}
+
+    /**
+     * @brief Send chunk data to a process of the pool and wait for the result
+     * @param id chunk id
+     * @param header chunk data header (size, band names, dimension values, SRS)
+     * @param data input chunk data
+     * @return result chunk
+     */
+    std::shared_ptr<chunk_data> process(chunkid_t id, const std::string &header, std::shared_ptr<chunk_data> data);
+
+    /**
+     * @brief Check whether a process can be started and responds to the streaming protocol
+     * @return true if a process of the pool is available
+     */
+    bool check();
+
+    /**
+     * @brief Maximum time to wait for responses of a newly started process in milliseconds, e.g. due to interpreter startup
+     */
+    static const uint32_t START_TIMEOUT_MS = 60000;
+
+   private:
+    std::string _cmd;
+    std::vector<std::unique_ptr<stream_worker>> _workers;
+    std::vector<bool> _busy;
+    std::mutex _m;
+    std::condition_variable _cv;
+
+    uint16_t acquire();
+    void release(uint16_t i);
+    bool start(uint16_t i);
+};
+
+}  // namespace gdalcubes
+
+#endif  //STREAM_POOL_H
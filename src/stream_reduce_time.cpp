@@ -1,10 +1,13 @@
 #include "stream_reduce_time.h"
 #include "external/tiny-process-library/process.hpp"
+#include "stream_pool.h"
+#include "stream_shm.h"
 
 namespace gdalcubes {
 
 std::shared_ptr<chunk_data> stream_reduce_time_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("stream_reduce_time_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "stream_reduce_time_cube", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
@@ -19,63 +22,26 @@ std::shared_ptr<chunk_data> stream_reduce_time_cube::read_chunk(chunkid_t id) {
     double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
     std::fill(begin, end, NAN);
 
-    // 1. read everything to input buffer (for first version, can be memory-intensive, same as rechunk_merge_time)
-    std::shared_ptr<chunk_data> inbuf = std::make_shared<chunk_data>();
     coords_nd<uint32_t, 4> in_size_btyx = {uint32_t(_in_cube->size_bands()), _in_cube->size_t(), size_tyx[1],
                                            size_tyx[2]};
-    inbuf->size(in_size_btyx);
-    inbuf->buf(std::calloc(in_size_btyx[0] * in_size_btyx[1] * in_size_btyx[2] * in_size_btyx[3], sizeof(double)));
-    double *inbegin = (double *)inbuf->buf();
-    double *inend =
-        ((double *)inbuf->buf()) + in_size_btyx[0] * in_size_btyx[1] * in_size_btyx[2] * in_size_btyx[3];
-    std::fill(inbegin, inend, NAN);
-
-    uint32_t ichunk = 0;
-    for (chunkid_t i = id;
-         i < _in_cube->count_chunks(); i += _in_cube->count_chunks_x() * _in_cube->count_chunks_y()) {
-        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(i);
-        for (uint16_t ib = 0; ib < x->size()[0]; ++ib) {
-            for (uint32_t it = 0; it < x->size()[1]; ++it) {
-                for (uint32_t ixy = 0; ixy < x->size()[2] * x->size()[3]; ++ixy) {
-                    ((double *)inbuf->buf())[ib * _in_cube->size_t() * x->size()[2] * x->size()[3] +
-                                             (it + ichunk * _in_cube->chunk_size()[0]) * x->size()[2] *
-                                                 x->size()[3] +
-                                             ixy] =
-                        ((double *)x->buf())[ib * x->size()[1] * x->size()[2] * x->size()[3] +
-                                             it * x->size()[2] * x->size()[3] + ixy];
-                }
-            }
-        }
-        ++ichunk;
-    }
 
-    // generate in and out filename
-    std::string f_in = filesystem::join(config::instance()->get_streaming_dir(),
-                                        utils::generate_unique_filename(12, ".stream_", "_in"));
-    std::string f_out = filesystem::join(config::instance()->get_streaming_dir(),
-                                         utils::generate_unique_filename(12, ".stream_", "_out"));
+    // shared memory (or temporary) files for input and output, long time series go to disk
+    stream_shm f_in("_in", uint64_t(in_size_btyx[0]) * in_size_btyx[1] * in_size_btyx[2] * in_size_btyx[3] * sizeof(double));
+    stream_shm f_out("_out");
 
     std::string errstr;  // capture error string
 
     // write input data
-    std::ofstream f_in_stream(f_in, std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!f_in_stream.is_open()) {
-        GCBS_ERROR("Cannot write streaming input data to file '" + f_in + "'");
-        throw std::string(
-            "ERROR in stream_reduce_time_cube::stream_chunk_file(): cannot write streaming input data to file '" + f_in +
-            "'");
-    }
-
     int size[] = {(int)in_size_btyx[0], (int)in_size_btyx[1], (int)in_size_btyx[2], (int)in_size_btyx[3]};
     if (size[0] * size[1] * size[2] * size[3] == 0) {
         return out;
     }
     std::string proj = _in_cube->st_reference()->srs();
-    f_in_stream.write((char *)(size), sizeof(int) * 4);
+    f_in.write((char *)(size), sizeof(int) * 4);
     for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
         int str_size = _in_cube->bands().get(i).name.size();
-        f_in_stream.write((char *)(&str_size), sizeof(int));
-        f_in_stream.write(_in_cube->bands().get(i).name.c_str(), sizeof(char) * str_size);
+        f_in.write((char *)(&str_size), sizeof(int));
+        f_in.write(_in_cube->bands().get(i).name.c_str(), sizeof(char) * str_size);
     }
     double *dims = (double *)std::calloc(size[1] + size[2] + size[3], sizeof(double));
     int i = 0;
@@ -92,31 +58,61 @@ std::shared_ptr<chunk_data> stream_reduce_time_cube::read_chunk(chunkid_t id) {
         dims[i] = cextent.s.left + (ix + 0.5) * st_reference()->dx();
         ++i;
     }
-    f_in_stream.write((char *)(dims), sizeof(double) * (size[1] + size[2] + size[3]));
+    f_in.write((char *)(dims), sizeof(double) * (size[1] + size[2] + size[3]));
     std::free(dims);
 
     int str_size = proj.size();
-    f_in_stream.write((char *)(&str_size), sizeof(int));
-    f_in_stream.write(proj.c_str(), sizeof(char) * str_size);
-    f_in_stream.write(((char *)(inbuf->buf())),
-                      sizeof(double) * inbuf->size()[0] * inbuf->size()[1] * inbuf->size()[2] * inbuf->size()[3]);
-    f_in_stream.close();
+    f_in.write((char *)(&str_size), sizeof(int));
+    f_in.write(proj.c_str(), sizeof(char) * str_size);
+
+    // Stream input chunks along the time axis directly to their position in the (band-major) input file,
+    // such that at most one input chunk must be kept in memory, independent of the length of the time series
+    uint64_t data_offset = f_in.position();
+    uint64_t nxy = uint64_t(size[2]) * uint64_t(size[3]);
+    std::vector<double> nan_buf;
+    uint32_t t_offset = 0;
+    for (chunkid_t ic = id; ic < _in_cube->count_chunks(); ic += _in_cube->count_chunks_x() * _in_cube->count_chunks_y()) {
+        std::shared_ptr<chunk_data> x = _in_cube->read_chunk(ic);
+        uint32_t nt = _in_cube->chunk_size(ic)[0];
+        for (uint16_t ib = 0; ib < size[0]; ++ib) {
+            const double *src;
+            if (x->empty()) {
+                if (nan_buf.size() < nt * nxy) {
+                    nan_buf.resize(nt * nxy, NAN);
+                }
+                src = nan_buf.data();
+            } else {
+                src = ((double *)x->buf()) + ib * nt * nxy;
+            }
+            f_in.write_at(data_offset + (uint64_t(ib) * size[1] + t_offset) * nxy * sizeof(double), src,
+                          nt * nxy * sizeof(double));
+        }
+        t_offset += nt;
+    }
+    if (!f_in.close_write()) {
+        GCBS_ERROR("Cannot write streaming input data to file '" + f_in.path() + "'");
+        throw std::string(
+            "ERROR in stream_reduce_time_cube::read_chunk(): cannot write streaming input data to file '" + f_in.path() +
+            "'");
+    }
+
+    // pre-sized output region that child processes may map
+    f_out.reserve(4 * sizeof(int) + uint64_t(size_btyx[0]) * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double));
 
     /* setenv / _putenv is not thread-safe, we need to get a mutex until the child process has been started. */
-    static std::mutex mtx;
-    mtx.lock();
+    stream_env_mutex().lock();
 #ifdef _WIN32
     _putenv("GDALCUBES_STREAMING=1");
     //_putenv((std::string("GDALCUBES_STREAMING_DIR") + "=" + config::instance()->get_streaming_dir().c_str()).c_str());
     _putenv((std::string("GDALCUBES_STREAMING_CHUNK_ID") + "=" + std::to_string(id)).c_str());
-    _putenv((std::string("GDALCUBES_STREAMING_FILE_IN") + "=" + f_in.c_str()).c_str());
-    _putenv((std::string("GDALCUBES_STREAMING_FILE_OUT") + "=" + f_out.c_str()).c_str());
+    _putenv((std::string("GDALCUBES_STREAMING_FILE_IN") + "=" + f_in.path().c_str()).c_str());
+    _putenv((std::string("GDALCUBES_STREAMING_FILE_OUT") + "=" + f_out.path().c_str()).c_str());
 #else
     setenv("GDALCUBES_STREAMING", "1", 1);
     // setenv("GDALCUBES_STREAMING_DIR", config::instance()->get_streaming_dir().c_str(), 1);
     setenv("GDALCUBES_STREAMING_CHUNK_ID", std::to_string(id).c_str(), 1);
-    setenv("GDALCUBES_STREAMING_FILE_IN", f_in.c_str(), 1);
-    setenv("GDALCUBES_STREAMING_FILE_OUT", f_out.c_str(), 1);
+    setenv("GDALCUBES_STREAMING_FILE_IN", f_in.path().c_str(), 1);
+    setenv("GDALCUBES_STREAMING_FILE_OUT", f_out.path().c_str(), 1);
 #endif
 
     // start process
@@ -126,43 +122,34 @@ std::shared_ptr<chunk_data> stream_reduce_time_cube::read_chunk(chunkid_t id) {
                                         GCBS_DEBUG(errstr);
                                     },
                                     false);
-    mtx.unlock();
+    stream_env_mutex().unlock();
     auto exit_status = process.get_exit_status();
-    filesystem::remove(f_in);
     if (exit_status != 0) {
         GCBS_ERROR("Child process failed with exit code " + std::to_string(exit_status));
         GCBS_ERROR("Child process output: " + errstr);
-        if (filesystem::exists(f_out)) {
-            filesystem::remove(f_out);
-        }
         throw std::string("ERROR in stream_reduce_time_cube::read_chunk(): external program returned exit code " +
                           std::to_string(exit_status));
     }
 
     // read output data
-    std::ifstream f_out_stream(f_out, std::ios::in | std::ios::binary);
-    if (!f_out_stream.is_open()) {
-        GCBS_ERROR("Cannot read streaming output data from file '" + f_out + "'");
+    int out_size_int[4] = {0, 0, 0, 0};
+    uint64_t length = f_out.size();
+    if (length < 4 * sizeof(int) || !f_out.read(0, out_size_int, 4 * sizeof(int)) || out_size_int[0] == 0) {
+        GCBS_ERROR("Cannot read streaming output data from file '" + f_out.path() + "'");
         throw std::string(
             "ERROR in stream_reduce_time_cube::read_chunk(): cannot read streaming output data from file '" +
-            f_out + "'");
+            f_out.path() + "'");
     }
 
-    f_out_stream.seekg(0, f_out_stream.end);
-    int length = f_out_stream.tellg();
-    f_out_stream.seekg(0, f_out_stream.beg);
-    char *buffer = (char *)std::calloc(length, sizeof(char));
-    f_out_stream.read(buffer, length);
-    f_out_stream.close();
-
     // Copy results to chunk buffer, at most the size of the output
-    std::memcpy(out->buf(), buffer + (4 * sizeof(int)), std::min(length - 4 * sizeof(int), size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double)));
-    std::free(buffer);
-
-    if (filesystem::exists(f_out)) {
-        filesystem::remove(f_out);
+    if (!f_out.read(4 * sizeof(int), out->buf(), std::min(length - 4 * sizeof(int), uint64_t(size_btyx[0]) * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double)))) {
+        GCBS_ERROR("Cannot read streaming output data from file '" + f_out.path() + "'");
+        throw std::string(
+            "ERROR in stream_reduce_time_cube::read_chunk(): cannot read streaming output data from file '" +
+            f_out.path() + "'");
     }
 
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
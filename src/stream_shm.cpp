@@ -0,0 +1,189 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "stream_shm.h"
+#include <cerrno>
+#include "config.h"
+#include "cube.h"
+#include "utils.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+
+namespace gdalcubes {
+
+uint64_t stream_shm::max_shm_size() {
+    uint32_t nthreads = std::max(config::instance()->get_default_chunk_processor()->max_threads(), (uint32_t)1);
+    return config::instance()->get_streaming_shm_max() / nthreads;
+}
+
+stream_shm::stream_shm(std::string suffix, uint64_t size_hint) : _fd(-1), _good(true), _pos(0), _path(), _os() {
+    std::string name = utils::generate_unique_filename(12, ".stream_", suffix);
+#if defined(__linux__) && defined(SYS_memfd_create)
+    if (size_hint <= max_shm_size()) {
+        _fd = syscall(SYS_memfd_create, name.c_str(), MFD_CLOEXEC);
+        if (_fd >= 0) {
+            _path = "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(_fd);
+            return;
+        }
+        GCBS_DEBUG("memfd_create() failed, using regular files for streaming");
+    }
+#endif
+    _path = filesystem::join(config::instance()->get_streaming_dir(), name);
+}
+
+stream_shm::~stream_shm() {
+#ifdef __linux__
+    if (_fd >= 0) {
+        close(_fd);
+        return;
+    }
+#endif
+    if (_os.is_open()) {
+        _os.close();
+    }
+    if (filesystem::exists(_path)) {
+        filesystem::remove(_path);
+    }
+}
+
+bool stream_shm::write(const void *data, uint64_t n) {
+    _pos += n;
+#ifdef __linux__
+    if (_fd >= 0) {
+        const char *p = (const char *)data;
+        while (n > 0) {
+            ssize_t k = ::write(_fd, p, n);
+            if (k < 0) {
+                if (errno == EINTR) continue;
+                _good = false;
+                return false;
+            }
+            p += k;
+            n -= k;
+        }
+        return true;
+    }
+#endif
+    if (!_os.is_open()) {
+        _os.open(_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+    _os.write((const char *)data, n);
+    _good = _good && _os.good();
+    return _os.good();
+}
+
+bool stream_shm::write_at(uint64_t offset, const void *data, uint64_t n) {
+#ifdef __linux__
+    if (_fd >= 0) {
+        const char *p = (const char *)data;
+        while (n > 0) {
+            ssize_t k = ::pwrite(_fd, p, n, offset);
+            if (k < 0) {
+                if (errno == EINTR) continue;
+                _good = false;
+                return false;
+            }
+            p += k;
+            n -= k;
+            offset += k;
+        }
+        return true;
+    }
+#endif
+    if (!_os.is_open()) {
+        _os.open(_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+    _os.seekp(offset, std::ios::beg);
+    _os.write((const char *)data, n);
+    _os.seekp(_pos, std::ios::beg);
+    _good = _good && _os.good();
+    return _os.good();
+}
+
+bool stream_shm::close_write() {
+    if (_os.is_open()) {
+        _os.close();
+        _good = _good && !_os.fail();
+    }
+    return _good;
+}
+
+void stream_shm::reserve(uint64_t n) {
+#ifdef __linux__
+    if (_fd >= 0) {
+        if (ftruncate(_fd, n) != 0) {
+            GCBS_DEBUG("Failed to resize shared memory file '" + _path + "'");
+        }
+    }
+#endif
+}
+
+uint64_t stream_shm::size() {
+#ifdef __linux__
+    if (_fd >= 0) {
+        struct stat s;
+        if (fstat(_fd, &s) != 0) return 0;
+        return s.st_size;
+    }
+#endif
+    std::ifstream is(_path, std::ios::in | std::ios::binary);
+    if (!is.is_open()) return 0;
+    is.seekg(0, is.end);
+    return is.tellg();
+}
+
+bool stream_shm::read(uint64_t offset, void *data, uint64_t n) {
+#ifdef __linux__
+    if (_fd >= 0) {
+        char *p = (char *)data;
+        while (n > 0) {
+            ssize_t k = ::pread(_fd, p, n, offset);
+            if (k < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (k == 0) return false;  // end of file
+            p += k;
+            n -= k;
+            offset += k;
+        }
+        return true;
+    }
+#endif
+    std::ifstream is(_path, std::ios::in | std::ios::binary);
+    if (!is.is_open()) return false;
+    is.seekg(offset, is.beg);
+    is.read((char *)data, n);
+    return is.good();
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,136 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef STREAM_SHM_H
+#define STREAM_SHM_H
+
+#include <fstream>
+#include <string>
+
+namespace gdalcubes {
+
+/**
+ * @brief A file that shares chunk data with external streaming processes
+ *
+ * On Linux, the file is an anonymous shared memory file (memfd_create), which child processes can open
+ * (and map) with the path /proc/<pid>/fd/<fd>, such that data never touches the filesystem. On other systems,
+ * or if shared memory files cannot be created, a regular file in config::get_streaming_dir() is used.
+ *
+ * Data is written sequentially and read at arbitrary offsets. Child processes may replace the content,
+ * e.g. to write results.
+ */
+class stream_shm {
+   public:
+    /**
+     * @brief Create a new, empty file
+     * @param suffix suffix used to name the file, e.g. "_in" or "_out"
+     * @param size_hint expected size in bytes, files larger than max_shm_size() are written to the streaming directory
+     * on disk instead of keeping them in memory
+     */
+    stream_shm(std::string suffix, uint64_t size_hint = 0);
+
+    /**
+     * @brief Maximum expected size of files that are kept in shared memory
+     *
+     * Worker threads may create files at the same time, the limit is config::get_streaming_shm_max() divided by the
+     * number of threads of the default chunk processor.
+     */
+    static uint64_t max_shm_size();
+    ~stream_shm();
+
+    stream_shm(const stream_shm &) = delete;
+    stream_shm &operator=(const stream_shm &) = delete;
+
+    /**
+     * @brief Path of the file that can be passed to child processes
+     */
+    inline std::string path() { return _path; }
+
+    /**
+     * @brief Check whether the file lives in shared memory
+     */
+    inline bool is_shm() { return _fd >= 0; }
+
+    /**
+     * @brief Append data to the file
+     * @param data pointer to data
+     * @param n number of bytes
+     * @return true if all bytes have been written
+     */
+    bool write(const void *data, uint64_t n);
+
+    /**
+     * @brief Write data at a given position without changing the append position
+     * @details Writing beyond the current end of the file is allowed, gaps are filled with zeros
+     * @param offset position of the first byte
+     * @param data pointer to data
+     * @param n number of bytes
+     * @return true if all bytes have been written
+     */
+    bool write_at(uint64_t offset, const void *data, uint64_t n);
+
+    /**
+     * @brief Get the number of bytes appended by write() so far
+     */
+    inline uint64_t position() { return _pos; }
+
+    /**
+     * @brief Finish sequential writes, must be called before the file is passed to a child process
+     * @return true if all previous writes succeeded
+     */
+    bool close_write();
+
+    /**
+     * @brief Set the size of the file, e.g. to provide a pre-sized output region that child processes can map
+     * @note This has no effect for regular files
+     * @param n size in bytes
+     */
+    void reserve(uint64_t n);
+
+    /**
+     * @brief Get the current size of the file
+     * @return size in bytes, 0 if the file does not exist
+     */
+    uint64_t size();
+
+    /**
+     * @brief Read data from the file
+     * @param offset position of the first byte
+     * @param data target buffer
+     * @param n number of bytes
+     * @return true if all bytes have been read
+     */
+    bool read(uint64_t offset, void *data, uint64_t n);
+
+   private:
+    int _fd;
+    bool _good;
+    uint64_t _pos;
+    std::string _path;
+    std::ofstream _os;
+};
+
+}  // namespace gdalcubes
+
+#endif  //STREAM_SHM_H
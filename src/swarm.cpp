@@ -23,14 +23,41 @@
 */
 
 #include "swarm.h"
+#include "chunk_codec.h"
+#include "hash.h"
+#include "partial_reduce.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <thread>
 
 namespace gdalcubes {
 
-size_t post_file_read_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
-    std::ifstream *is = ((std::ifstream *)userdata);
-    is->read(buffer, size * nitems);  // or use readsome() ?
-    return is->gcount();
+namespace {
+const uint64_t UPLOAD_PART_SIZE = 16 * 1024 * 1024;  // size of parts of resumable file uploads
+}  // namespace
+
+size_t post_file_header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    // extract the number of bytes already received by the server from the X-Gdalcubes-Upload-Offset header
+    static const std::string name = "x-gdalcubes-upload-offset:";
+    std::string line(buffer, size * nitems);
+    if (line.size() > name.size()) {
+        std::string key = line.substr(0, name.size());
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        if (key == name) {
+            *((int64_t *)userdata) = std::stoll(line.substr(name.size()));
+        }
+    }
+    return size * nitems;
+}
+
+size_t post_file_write_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    std::vector<char> *x = (std::vector<char> *)userdata;
+    x->insert(x->end(), buffer, buffer + (size * nitems));
+    return size * nitems;
 }
 
 std::shared_ptr<gdalcubes_swarm> gdalcubes_swarm::from_txtfile(std::string path) {
@@ -46,64 +73,107 @@ std::shared_ptr<gdalcubes_swarm> gdalcubes_swarm::from_txtfile(std::string path)
     return gdalcubes_swarm::from_urls(urllist);
 }
 
-void gdalcubes_swarm::post_file(std::string path, uint16_t server_index) {
-    if (_server_handles[server_index]) {
-        curl_easy_reset(_server_handles[server_index]);
+void gdalcubes_swarm::post_file(std::string path, std::string hash, uint16_t server_index, CURL *handle) {
+    uint64_t size = filesystem::file_size(path);
+    char *escaped_path = curl_easy_escape(handle, path.c_str(), path.size());
+    std::string url = _server_uris[server_index] + "/file?name=" + escaped_path + "&hash=" + hash + "&size=" + std::to_string(size);
+    curl_free(escaped_path);
 
-        // Step 1: send a HEAD HTTP request to check whether the file already exists on the server
-        curl_easy_setopt(_server_handles[server_index], CURLOPT_URL, (_server_uris[server_index] + "/file" + "?name=" + path + "&size=" + std::to_string(filesystem::file_size(path))).c_str());
-        curl_easy_setopt(_server_handles[server_index], CURLOPT_CUSTOMREQUEST, "HEAD");
-        curl_easy_setopt(_server_handles[server_index], CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
+    std::ifstream is(path, std::ifstream::in | std::ifstream::binary);
+    if (!is.is_open()) {
+        throw std::string("ERROR in gdalcubes_swarm::post_file(): cannot open file '" + path + "'");
+    }
 
-        CURLcode res = curl_easy_perform(_server_handles[server_index]);
-        long response_code;
+    struct curl_slist *header = NULL;
+    header = curl_slist_append(header, "Content-Type: application/octet-stream");
+    header = curl_slist_append(header, "Expect:");
+
+    std::vector<char> part;
+    std::vector<char> response_body;
+    std::string error;
+    const uint8_t max_attempts = 3;
+    for (uint8_t attempt = 0; attempt < max_attempts; ++attempt) {
+        // Step 1: send a HEAD HTTP request to check whether the file already exists on the server with the same content,
+        // or whether a previous upload can be resumed
+        int64_t offset = -1;
+        curl_easy_reset(handle);
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &post_file_header_callback);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &offset);
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(handle, CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
+
+        CURLcode res = curl_easy_perform(handle);
+        long response_code = 0;
         if (res != CURLE_OK) {
-            throw std::string("ERROR in gdalcubes_swarm::post_file(): HEAD /file?name='" + path + "' to '" + _server_uris[server_index] + "' failed");
-        } else {
-            curl_easy_getinfo(_server_handles[server_index], CURLINFO_RESPONSE_CODE, &response_code);
+            error = "HEAD /file failed: " + std::string(curl_easy_strerror(res));
+            continue;
         }
-
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
         if (response_code == 200) {
             // already exists on server
+            curl_slist_free_all(header);
             return;
-        } else if (response_code == 204 || response_code == 409) {
-            // file does not exist or has different size
-
-            // Step 2: if not upload
+        } else if (response_code != 204 && response_code != 409) {
+            curl_slist_free_all(header);
+            throw std::string("ERROR in gdalcubes_swarm::post_file(): HEAD /file?name='" + path + "' to '" + _server_uris[server_index] + "' returned HTTP code " + std::to_string(response_code));
+        }
 
-            std::ifstream is(path, std::ifstream::in | std::ifstream::binary);
-            if (!is.is_open()) {
-                throw std::string("ERROR in gdalcubes_swarm::push_execution_context(): cannot open file '" + path + "'");
+        // Step 2: upload missing parts
+        uint64_t pos = offset > 0 ? offset : 0;
+        bool done = false;
+        while (!done) {
+            uint64_t n = std::min(UPLOAD_PART_SIZE, size - std::min(pos, size));
+            part.resize(n);
+            is.clear();
+            is.seekg(pos);
+            is.read(part.data(), n);
+            if ((uint64_t)is.gcount() != n) {
+                curl_slist_free_all(header);
+                throw std::string("ERROR in gdalcubes_swarm::post_file(): cannot read file '" + path + "'");
             }
 
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_URL, (_server_uris[server_index] + "/file" + "?name=" + path).c_str());
-
-            //struct curl_slist *header = NULL;
-            //header = curl_slist_append(header, "Content-Type: application/octet-stream");
-            // curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
-
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_UPLOAD, 1L);
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_POST, 1L);
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_CUSTOMREQUEST, "POST");  // for whatever reason all requests are PUT if not set
-
-            // This will most likely work only as long as curl_easy_perform is synchronous, otherwise &is might become invalid
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_READDATA, &is);
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_READFUNCTION, &post_file_read_callback);
-
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_INFILESIZE_LARGE, (curl_off_t)filesystem::file_size(path));
-
-            curl_easy_setopt(_server_handles[server_index], CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
-
-            CURLcode res = curl_easy_perform(_server_handles[server_index]);
+            offset = -1;
+            response_body.clear();
+            std::string part_url = url + "&offset=" + std::to_string(pos);
+            curl_easy_reset(handle);
+            curl_easy_setopt(handle, CURLOPT_URL, part_url.c_str());
+            curl_easy_setopt(handle, CURLOPT_POST, 1L);
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, part.data());
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)n);
+            curl_easy_setopt(handle, CURLOPT_HTTPHEADER, header);
+            curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &post_file_header_callback);
+            curl_easy_setopt(handle, CURLOPT_HEADERDATA, &offset);
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &post_file_write_callback);
+            curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response_body);
+            curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(handle, CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
+
+            res = curl_easy_perform(handle);
             if (res != CURLE_OK) {
-                if (is.is_open()) is.close();
-                throw std::string("ERROR in gdalcubes_swarm::post_file(): uploading '" + path + "' to '" + _server_uris[server_index] + "' failed");
+                error = "POST /file failed: " + std::string(curl_easy_strerror(res));
+                break;
+            }
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+            if (response_code == 200) {
+                done = true;
+            } else if (response_code == 202 && offset >= 0 && (uint64_t)offset > pos) {
+                pos = offset;
+            } else if (response_code == 409 && offset >= 0) {
+                pos = offset;  // server expects a different part, e.g. after an interrupted request
+            } else {
+                error = "POST /file returned HTTP code " + std::to_string(response_code) + ": " + std::string(response_body.begin(), response_body.end());
+                break;
             }
-            if (is.is_open()) is.close();
-        } else {
-            throw std::string("ERROR in gdalcubes_swarm::post_file(): HEAD /file?name='" + path + "' to '" + _server_uris[server_index] + "' returned HTTP code " + std::to_string(response_code));
+        }
+        if (done) {
+            curl_slist_free_all(header);
+            return;
         }
     }
+    curl_slist_free_all(header);
+    throw std::string("ERROR in gdalcubes_swarm::post_file(): uploading '" + path + "' to '" + _server_uris[server_index] + "' failed after " + std::to_string(max_attempts) + " attempts; " + error);
 }
 
 void gdalcubes_swarm::push_execution_context(bool recursive) {
@@ -124,12 +194,51 @@ void gdalcubes_swarm::push_execution_context(bool recursive) {
         });
     }
 
-    // TODO: parallel upload
-    for (auto it_f = file_list.begin(); it_f != file_list.end(); ++it_f) {
-        for (uint16_t is = 0; is < _server_uris.size(); ++is) {
-            post_file(*it_f, is);
+    // run f(i, handle) for i = 0, ..., n-1 in up to _upload_threads threads, each thread uses its own curl handle
+    auto run_parallel = [this](uint32_t n, std::function<void(uint32_t, CURL *)> f) {
+        std::mutex mtx;
+        uint32_t next = 0;
+        std::string error;
+        std::vector<std::thread> workers;
+        for (uint32_t it = 0; it < std::min((uint32_t)_upload_threads, n); ++it) {
+            workers.push_back(std::thread([&mtx, &next, &error, n, &f]() {
+                CURL *handle = curl_easy_init();
+                while (true) {
+                    uint32_t i;
+                    {
+                        std::lock_guard<std::mutex> lck(mtx);
+                        if (next >= n || !error.empty()) break;
+                        i = next++;
+                    }
+                    try {
+                        f(i, handle);
+                    } catch (std::string s) {
+                        std::lock_guard<std::mutex> lck(mtx);
+                        if (error.empty()) error = s;
+                    }
+                }
+                curl_easy_cleanup(handle);
+            }));
         }
-    }
+        for (uint32_t it = 0; it < workers.size(); ++it) {
+            workers[it].join();
+        }
+        if (!error.empty()) {
+            throw error;
+        }
+    };
+
+    // content hashes are computed only once for all servers
+    std::vector<std::string> hashes(file_list.size());
+    run_parallel(file_list.size(), [&file_list, &hashes](uint32_t i, CURL *) {
+        hashes[i] = xxhash64::file(file_list[i]);
+    });
+
+    // consecutive tasks upload the same file to different servers
+    uint32_t nservers = _server_uris.size();
+    run_parallel(file_list.size() * nservers, [this, &file_list, &hashes, nservers](uint32_t i, CURL *handle) {
+        post_file(file_list[i / nservers], hashes[i / nservers], i % nservers, handle);
+    });
 }
 
 size_t post_cube_read_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
@@ -199,6 +308,21 @@ void gdalcubes_swarm::push_cube(std::shared_ptr<cube> c) {
     }
 }
 
+void gdalcubes_swarm::delete_cube(uint16_t server_index) {
+    if (_server_handles[server_index]) {
+        curl_easy_reset(_server_handles[server_index]);
+        curl_easy_setopt(_server_handles[server_index], CURLOPT_URL, (_server_uris[server_index] + "/cube/" + std::to_string(_cube_ids[server_index])).c_str());
+        curl_easy_setopt(_server_handles[server_index], CURLOPT_CUSTOMREQUEST, "DELETE");
+        curl_easy_setopt(_server_handles[server_index], CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
+
+        CURLcode res = curl_easy_perform(_server_handles[server_index]);
+        if (res != CURLE_OK) {
+            // not critical, servers remove idle cubes anyway
+            GCBS_WARN("DELETE /cube/{cube_id} to '" + _server_uris[server_index] + "' failed");
+        }
+    }
+}
+
 void gdalcubes_swarm::post_start(uint32_t chunk_id, uint16_t server_index) {
     if (_server_handles[server_index]) {
         // TODO: URLencode?
@@ -222,6 +346,28 @@ size_t get_download_callback(char *buffer, size_t size, size_t nitems, void *use
     return size * nitems;
 }
 
+// construct chunk_data from the body of a download response
+std::shared_ptr<chunk_data> chunk_from_response(const std::vector<char> &response_body_bytes, std::string content_type) {
+    if (content_type.compare(0, chunk_codec::MIME_TYPE.size(), chunk_codec::MIME_TYPE) == 0) {
+        return chunk_codec::decode(response_body_bytes.data(), response_body_bytes.size());
+    }
+    if (response_body_bytes.size() < 4 * sizeof(uint32_t)) {
+        throw std::string("ERROR in gdalcubes_swarm::get_download(): invalid response");
+    }
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    std::array<uint32_t, 4> size = {((uint32_t *)response_body_bytes.data())[0], ((uint32_t *)response_body_bytes.data())[1], ((uint32_t *)response_body_bytes.data())[2], ((uint32_t *)response_body_bytes.data())[3]};
+    out->size(size);
+    if (size[0] * size[1] * size[2] * size[3] > 0) {
+        if (response_body_bytes.size() < 4 * sizeof(uint32_t) + out->total_size_bytes()) {
+            throw std::string("ERROR in gdalcubes_swarm::get_download(): incomplete chunk data");
+        }
+        out->buf(std::malloc(out->total_size_bytes()));
+        std::copy(response_body_bytes.begin() + sizeof(std::array<uint32_t, 4>), response_body_bytes.begin() + sizeof(std::array<uint32_t, 4>) + out->total_size_bytes(),
+                  (char *)out->buf());
+    }
+    return out;
+}
+
 std::shared_ptr<chunk_data> gdalcubes_swarm::get_download(uint32_t chunk_id, uint16_t server_index) {
     if (_server_handles[server_index]) {
         // TODO: URLencode?
@@ -231,6 +377,10 @@ std::shared_ptr<chunk_data> gdalcubes_swarm::get_download(uint32_t chunk_id, uin
         curl_easy_setopt(_server_handles[server_index], CURLOPT_CUSTOMREQUEST, "GET");
         curl_easy_setopt(_server_handles[server_index], CURLOPT_WRITEFUNCTION, &get_download_callback);
 
+        struct curl_slist *header = NULL;
+        header = curl_slist_append(header, encoding_header().c_str());
+        curl_easy_setopt(_server_handles[server_index], CURLOPT_HTTPHEADER, header);
+
         // This will most likely work only as long as curl_easy_perform is synchronous, otherwise &response_body_bytes might become invalid
         std::vector<char> response_body_bytes;
         curl_easy_setopt(_server_handles[server_index], CURLOPT_WRITEDATA, &response_body_bytes);
@@ -238,26 +388,55 @@ std::shared_ptr<chunk_data> gdalcubes_swarm::get_download(uint32_t chunk_id, uin
         curl_easy_setopt(_server_handles[server_index], CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
 
         CURLcode res = curl_easy_perform(_server_handles[server_index]);
+        std::string content_type;
+        if (res == CURLE_OK) {
+            char *ct = nullptr;
+            curl_easy_getinfo(_server_handles[server_index], CURLINFO_CONTENT_TYPE, &ct);
+            if (ct) content_type = ct;
+        }
+        curl_slist_free_all(header);
         if (res != CURLE_OK) {
             throw std::string("ERROR in gdalcubes_swarm::get_download(): GET /cube/{cube_id}/{chunk_id}/download to '" + _server_uris[server_index] + "' failed");
         }
 
-        // construct chunk_data from byte vector
-        std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
-        std::array<uint32_t, 4> size = {((uint32_t *)response_body_bytes.data())[0], ((uint32_t *)response_body_bytes.data())[1], ((uint32_t *)response_body_bytes.data())[2], ((uint32_t *)response_body_bytes.data())[3]};
-        out->size(size);
-        if (size[0] * size[1] * size[2] * size[3] > 0) {
-            out->buf(std::malloc(out->size()[0] * out->size()[1] * out->size()[2] * out->size()[3] * sizeof(double)));
-            std::copy(response_body_bytes.begin() + sizeof(std::array<uint32_t, 4>), response_body_bytes.end(),
-                      (char *)out->buf());
-        }
-
-        return out;
+        return chunk_from_response(response_body_bytes, content_type);
     } else {
         throw std::string("ERROR in gdalcubes_swarm::get_download(): no connection with given server index available");
     }
 }
 
+struct swarm_assignment;
+
+/**
+ * A single asynchronous HTTP request of gdalcubes_swarm::apply()
+ */
+struct swarm_transfer {
+    enum transfer_type { START,
+                         POLL,
+                         DOWNLOAD,
+                         CANCEL };
+    transfer_type type;
+    uint16_t server_index;
+    std::string url;
+    std::string request_body;
+    std::vector<uint32_t> chunk_ids;  // started chunks (START only)
+    swarm_assignment *assignment;     // downloaded chunk (DOWNLOAD only)
+    CURL *handle;
+    std::vector<char> body;
+    std::string content_type;
+};
+
+/**
+ * Assignment of a chunk to a server in gdalcubes_swarm::apply()
+ */
+struct swarm_assignment {
+    uint32_t chunk_id;
+    uint16_t server_index;
+    std::chrono::steady_clock::time_point t_start;
+    bool speculative;          // true if another server already worked on the same chunk
+    swarm_transfer *download;  // active download request, if any
+};
+
 void gdalcubes_swarm::apply(std::shared_ptr<cube> c, std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
     uint32_t nthreads = 1;
     // try whether default chunk processor is multithread and read number of threads if successful
@@ -265,31 +444,458 @@ void gdalcubes_swarm::apply(std::shared_ptr<cube> c, std::function<void(chunkid_
         nthreads = std::dynamic_pointer_cast<chunk_processor_multithread>(config::instance()->get_default_chunk_processor())->get_threads();
     }
 
+    // Reductions with mergeable reducers are split into partial reductions over subsets of the input chunks, such that
+    // all servers contribute to each result chunk and only small partial states are downloaded and merged here
+    std::shared_ptr<partial_reduce_cube> pc = partial_reduce_cube::from_reduction(c, 2 * _server_uris.size() * _max_inflight);
+    if (pc) {
+        GCBS_DEBUG("Computing reduction as " + std::to_string(pc->count_chunks()) + " partial reductions on servers");
+        std::mutex merge_mutex;
+        std::vector<std::shared_ptr<chunk_data>> states(c->count_chunks());
+        std::vector<uint32_t> nreceived(c->count_chunks(), 0);
+        apply(pc, [&f, pc, &merge_mutex, &states, &nreceived](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+            chunkid_t out_id = pc->result_chunk(id);
+            std::shared_ptr<chunk_data> result;
+            {
+                std::lock_guard<std::mutex> lck(merge_mutex);
+                if (!states[out_id]) states[out_id] = std::make_shared<chunk_data>();
+                pc->merge(states[out_id], dat);
+                if (++nreceived[out_id] == pc->nparts()) {
+                    result = pc->finalize(states[out_id]);
+                    states[out_id].reset();
+                }
+            }
+            if (result) {
+                f(out_id, result, m);
+            }
+        });
+        return;
+    }
+
     push_execution_context(false);
     push_cube(c);
 
-    // TODO: what if servers fail?
-    std::map<uint16_t, std::vector<uint32_t>> chunk_distr;
+    // chunks that have not been assigned to any server yet
+    std::deque<uint32_t> pending;
     for (uint32_t i = 0; i < c->count_chunks(); ++i) {
-        post_start(i, i % _server_uris.size());  // start computations on remote servers
-        chunk_distr[i % _server_uris.size()].push_back(i);
+        pending.push_back(i);
     }
+
+    // Downloaded chunks are passed to nthreads threads calling f, such that slow callbacks do not block transfers.
+    // The first exception thrown by f stops all workers as well as further transfers and is rethrown at the end.
     std::mutex mutex;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cond;
+    std::deque<std::pair<uint32_t, std::shared_ptr<chunk_data>>> queue;
+    bool downloads_finished = false;
+    std::atomic<bool> worker_failed(false);
+    std::exception_ptr worker_error = nullptr;
     std::vector<std::thread> workers;
     for (uint16_t it = 0; it < nthreads; ++it) {
-        workers.push_back(std::thread([this, c, &chunk_distr, &f, it, &mutex](void) {
-            // One remote server is processed by a single thread for now, changing this will require to using the multi interface of curl
-            for (uint32_t iserver = it; iserver < _server_uris.size(); iserver += _server_uris.size()) {
-                for (uint32_t ichunk = 0; ichunk < chunk_distr[iserver].size(); ++ichunk) {
-                    std::shared_ptr<chunk_data> dat = get_download(chunk_distr[iserver][ichunk], iserver);
-                    f(chunk_distr[iserver][ichunk], dat, mutex);
+        workers.push_back(std::thread([&f, &mutex, &queue_mutex, &queue_cond, &queue, &downloads_finished, &worker_failed, &worker_error](void) {
+            while (true) {
+                std::unique_lock<std::mutex> lck(queue_mutex);
+                queue_cond.wait(lck, [&queue, &downloads_finished, &worker_failed]() { return downloads_finished || worker_failed || !queue.empty(); });
+                if (worker_failed || queue.empty()) {
+                    return;
+                }
+                std::pair<uint32_t, std::shared_ptr<chunk_data>> x = queue.front();
+                queue.pop_front();
+                lck.unlock();
+                queue_cond.notify_all();
+                try {
+                    f(x.first, x.second, mutex);
+                } catch (...) {
+                    lck.lock();
+                    if (!worker_failed) {
+                        worker_error = std::current_exception();
+                        worker_failed = true;
+                        queue.clear();
+                    }
+                    lck.unlock();
+                    queue_cond.notify_all();
+                    return;
                 }
             }
         }));
     }
+    // do not download much more than the workers are able to process
+    const uint32_t max_queue_size = std::max(uint32_t(4), 2 * nthreads);
+
+    // Chunks are started in batches with POST /cube/{cube_id}/start. The client then waits for completion events
+    // with a long-polling GET /cube/{cube_id}/finished per server and downloads chunks as soon as they have been computed.
+    // Servers pull chunks from pending, up to _max_inflight chunks per server are assigned concurrently, and all
+    // transfers are multiplexed in a single curl multi handle.
+    CURLM *multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    std::map<CURL *, swarm_transfer *> transfers;
+    std::map<uint32_t, std::vector<swarm_assignment *>> running;       // assignments per chunk
+    std::vector<std::map<uint32_t, swarm_assignment *>> assigned(_server_uris.size());  // assignments per server
+    std::vector<bool> poll_active(_server_uris.size(), false);
+    std::vector<uint64_t> poll_since(_server_uris.size(), 0);
+    std::vector<uint8_t> chunk_done(c->count_chunks(), 0);
+    std::vector<uint8_t> chunk_attempts(c->count_chunks(), 0);
+    const uint8_t max_attempts = 3;
+    const uint32_t poll_wait_ms = 10000;
+
+    _stats.clear();
+    for (uint16_t is = 0; is < _server_uris.size(); ++is) {
+        swarm_server_stats st;
+        st.url = _server_uris[is];
+        st.chunks = 0;
+        st.bytes = 0;
+        st.seconds = 0;
+        st.failures = 0;
+        st.speculative = 0;
+        st.available = true;
+        _stats.push_back(st);
+    }
+    double sum_duration = 0;  // sum of latencies of all delivered chunks
+    uint32_t nfinished = 0;
+    std::string error;
+
+    // all download requests ask for encoded (compressed) chunks
+    struct curl_slist *download_header = NULL;
+    download_header = curl_slist_append(download_header, encoding_header(std::dynamic_pointer_cast<partial_reduce_cube>(c) != nullptr).c_str());
+    struct curl_slist *json_header = NULL;
+    json_header = curl_slist_append(json_header, "Content-Type: application/json");
+    json_header = curl_slist_append(json_header, "Expect:");
+
+    auto cube_url = [this](uint16_t server_index) {
+        return _server_uris[server_index] + "/cube/" + std::to_string(_cube_ids[server_index]);
+    };
+
+    auto add_transfer = [multi, &transfers, download_header, json_header](swarm_transfer *t) {
+        CURL *e = curl_easy_init();
+        curl_easy_setopt(e, CURLOPT_URL, t->url.c_str());
+        if (t->type == swarm_transfer::START || t->type == swarm_transfer::CANCEL) {
+            curl_easy_setopt(e, CURLOPT_POST, 1L);
+            curl_easy_setopt(e, CURLOPT_POSTFIELDS, t->request_body.c_str());
+            curl_easy_setopt(e, CURLOPT_POSTFIELDSIZE, (long)t->request_body.size());
+            if (t->type == swarm_transfer::START) {
+                curl_easy_setopt(e, CURLOPT_HTTPHEADER, json_header);
+            }
+        } else {
+            curl_easy_setopt(e, CURLOPT_HTTPGET, 1L);
+            if (t->type == swarm_transfer::DOWNLOAD) {
+                curl_easy_setopt(e, CURLOPT_HTTPHEADER, download_header);
+            }
+        }
+        curl_easy_setopt(e, CURLOPT_WRITEFUNCTION, &get_download_callback);
+        curl_easy_setopt(e, CURLOPT_WRITEDATA, &t->body);
+        curl_easy_setopt(e, CURLOPT_PRIVATE, t);
+        curl_easy_setopt(e, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(e, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(e, CURLOPT_VERBOSE, config::instance()->get_swarm_curl_verbose() ? 1L : 0L);
+        t->handle = e;
+        transfers[e] = t;
+        curl_multi_add_handle(multi, e);
+    };
+
+    auto remove_transfer = [multi, &transfers](swarm_transfer *t) {
+        curl_multi_remove_handle(multi, t->handle);
+        curl_easy_cleanup(t->handle);
+        transfers.erase(t->handle);
+        delete t;
+    };
+
+    auto assign = [&running, &assigned](uint32_t chunk_id, uint16_t server_index) {
+        swarm_assignment *a = new swarm_assignment();
+        a->chunk_id = chunk_id;
+        a->server_index = server_index;
+        a->t_start = std::chrono::steady_clock::now();
+        a->speculative = running.find(chunk_id) != running.end();
+        a->download = nullptr;
+        running[chunk_id].push_back(a);
+        assigned[server_index][chunk_id] = a;
+    };
+
+    // remove an assignment including its download, returns true if no other server works on the same chunk
+    auto drop_assignment = [&running, &assigned, &remove_transfer](swarm_assignment *a) {
+        if (a->download) {
+            remove_transfer(a->download);
+        }
+        assigned[a->server_index].erase(a->chunk_id);
+        std::vector<swarm_assignment *> &r = running[a->chunk_id];
+        r.erase(std::remove(r.begin(), r.end(), a), r.end());
+        bool last = r.empty();
+        if (last) {
+            running.erase(a->chunk_id);
+        }
+        delete a;
+        return last;
+    };
+
+    // drop an assignment after failure and reassign the chunk if needed
+    auto fail_assignment = [this, &drop_assignment, &chunk_done, &chunk_attempts, &pending, &error, max_attempts](swarm_assignment *a) {
+        uint32_t chunk_id = a->chunk_id;
+        uint16_t server_index = a->server_index;
+        ++_stats[server_index].failures;
+        if (drop_assignment(a) && !chunk_done[chunk_id]) {
+            if (++chunk_attempts[chunk_id] >= max_attempts) {
+                error = "ERROR in gdalcubes_swarm::apply(): chunk " + std::to_string(chunk_id) + " failed on " + std::to_string(max_attempts) + " attempts, last attempt on '" + _server_uris[server_index] + "' failed";
+            } else {
+                pending.push_front(chunk_id);
+            }
+        }
+    };
+
+    auto mark_unavailable = [this, &assigned, &fail_assignment, &error](uint16_t server_index) {
+        if (_stats[server_index].available) {
+            GCBS_WARN("Server '" + _server_uris[server_index] + "' is not reachable, reassigning its chunks to other servers");
+            _stats[server_index].available = false;
+        }
+        std::map<uint32_t, swarm_assignment *> a = assigned[server_index];
+        for (auto it = a.begin(); it != a.end(); ++it) {
+            fail_assignment(it->second);
+        }
+        if (std::none_of(_stats.begin(), _stats.end(), [](const swarm_server_stats &st) { return st.available; })) {
+            error = "ERROR in gdalcubes_swarm::apply(): no server available";
+        }
+    };
+
+    // Find a chunk that is computed by exactly one other server for much longer than the average latency
+    auto find_straggler = [this, &running, &sum_duration, &nfinished](uint16_t server_index) -> int64_t {
+        if (nfinished < _server_uris.size()) return -1;  // not enough data to identify stragglers
+        double threshold = std::max(1.0, 2 * sum_duration / nfinished);
+        auto now = std::chrono::steady_clock::now();
+        int64_t out = -1;
+        double max_elapsed = threshold;
+        for (auto it = running.begin(); it != running.end(); ++it) {
+            if (it->second.size() != 1 || it->second[0]->server_index == server_index) continue;
+            double elapsed = std::chrono::duration<double>(now - it->second[0]->t_start).count();
+            if (elapsed > max_elapsed) {
+                max_elapsed = elapsed;
+                out = it->first;
+            }
+        }
+        return out;
+    };
+
+    while (nfinished < c->count_chunks() && error.empty() && !worker_failed) {
+        // servers with free slots pull further chunks
+        uint32_t queue_size;
+        {
+            std::lock_guard<std::mutex> lck(queue_mutex);
+            queue_size = queue.size();
+        }
+        for (uint16_t is = 0; is < _server_uris.size(); ++is) {
+            if (!_stats[is].available) continue;
+            std::vector<uint32_t> batch;
+            while (queue_size < max_queue_size && assigned[is].size() < _max_inflight) {
+                if (!pending.empty()) {
+                    uint32_t chunk_id = pending.front();
+                    pending.pop_front();
+                    if (chunk_done[chunk_id] || assigned[is].find(chunk_id) != assigned[is].end()) continue;
+                    assign(chunk_id, is);
+                    batch.push_back(chunk_id);
+                } else {
+                    int64_t chunk_id = find_straggler(is);
+                    if (chunk_id < 0) break;
+                    GCBS_DEBUG("Speculatively re-executing chunk " + std::to_string(chunk_id) + " on '" + _server_uris[is] + "'");
+                    assign(chunk_id, is);
+                    batch.push_back(chunk_id);
+                }
+            }
+            if (!batch.empty()) {
+                swarm_transfer *t = new swarm_transfer();
+                t->type = swarm_transfer::START;
+                t->server_index = is;
+                t->url = cube_url(is) + "/start";
+                t->request_body = nlohmann::json(batch).dump();
+                t->chunk_ids = batch;
+                t->assignment = nullptr;
+                add_transfer(t);
+            }
+
+            // listen for completion events as long as the server has chunks that are not yet downloaded
+            if (!poll_active[is] && std::any_of(assigned[is].begin(), assigned[is].end(), [](const std::pair<const uint32_t, swarm_assignment *> &x) { return x.second->download == nullptr; })) {
+                swarm_transfer *t = new swarm_transfer();
+                t->type = swarm_transfer::POLL;
+                t->server_index = is;
+                t->url = cube_url(is) + "/finished?since=" + std::to_string(poll_since[is]) + "&wait=" + std::to_string(poll_wait_ms);
+                t->assignment = nullptr;
+                poll_active[is] = true;
+                add_transfer(t);
+            }
+        }
+
+        int running_handles = 0;
+        curl_multi_perform(multi, &running_handles);
+
+        CURLMsg *msg;
+        int nmsg;
+        while ((msg = curl_multi_info_read(multi, &nmsg))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL *e = msg->easy_handle;
+            CURLcode res = msg->data.result;
+            long response_code = 0;
+            curl_easy_getinfo(e, CURLINFO_RESPONSE_CODE, &response_code);
+            swarm_transfer *t = transfers[e];
+            char *ct = nullptr;
+            curl_easy_getinfo(e, CURLINFO_CONTENT_TYPE, &ct);
+            t->content_type = ct ? ct : "";
+            bool ok = res == CURLE_OK && response_code == 200;
+            uint16_t is = t->server_index;
+
+            if (t->type == swarm_transfer::CANCEL) {
+                remove_transfer(t);
+            } else if (t->type == swarm_transfer::START) {
+                std::vector<uint32_t> chunk_ids = t->chunk_ids;
+                remove_transfer(t);
+                if (!ok) {
+                    if (res != CURLE_OK) {
+                        mark_unavailable(is);
+                    } else {
+                        for (uint32_t i = 0; i < chunk_ids.size(); ++i) {
+                            if (assigned[is].find(chunk_ids[i]) != assigned[is].end()) {
+                                fail_assignment(assigned[is][chunk_ids[i]]);
+                            }
+                        }
+                    }
+                }
+            } else if (t->type == swarm_transfer::POLL) {
+                poll_active[is] = false;
+                nlohmann::json events;
+                if (ok) {
+                    try {
+                        events = nlohmann::json::parse(std::string(t->body.begin(), t->body.end()));
+                    } catch (...) {
+                        ok = false;
+                    }
+                }
+                remove_transfer(t);
+                if (!ok) {
+                    ++_stats[is].failures;
+                    mark_unavailable(is);
+                    continue;
+                }
+                poll_since[is] = events["next"].get<uint64_t>();
+                std::vector<uint32_t> finished = events["finished"].get<std::vector<uint32_t>>();
+                std::vector<uint32_t> failed = events["failed"].get<std::vector<uint32_t>>();
+                for (uint32_t i = 0; i < finished.size(); ++i) {
+                    auto it = assigned[is].find(finished[i]);
+                    if (it == assigned[is].end() || it->second->download) continue;
+                    swarm_transfer *d = new swarm_transfer();
+                    d->type = swarm_transfer::DOWNLOAD;
+                    d->server_index = is;
+                    d->url = cube_url(is) + "/" + std::to_string(finished[i]) + "/download";
+                    d->assignment = it->second;
+                    it->second->download = d;
+                    add_transfer(d);
+                }
+                for (uint32_t i = 0; i < failed.size(); ++i) {
+                    auto it = assigned[is].find(failed[i]);
+                    if (it == assigned[is].end() || it->second->download) continue;
+                    fail_assignment(it->second);
+                }
+            } else {
+                // download completed
+                swarm_assignment *a = t->assignment;
+                a->download = nullptr;
+                std::vector<char> body;
+                body.swap(t->body);
+                std::string content_type = t->content_type;
+                remove_transfer(t);
+                if (!ok) {
+                    fail_assignment(a);
+                    if (res != CURLE_OK) {
+                        mark_unavailable(is);
+                    }
+                    continue;
+                }
+
+                uint32_t chunk_id = a->chunk_id;
+                try {
+                    std::shared_ptr<chunk_data> dat = chunk_from_response(body, content_type);
+                    {
+                        std::lock_guard<std::mutex> lck(queue_mutex);
+                        queue.push_back(std::make_pair(chunk_id, dat));
+                    }
+                    queue_cond.notify_all();
+                } catch (std::string s) {
+                    error = s;
+                    continue;
+                }
+                chunk_done[chunk_id] = 1;
+                ++nfinished;
+
+                double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - a->t_start).count();
+                sum_duration += duration;
+                ++_stats[is].chunks;
+                _stats[is].bytes += body.size();
+                metrics::instance()->count_bytes_downloaded(body.size());
+                _stats[is].seconds += duration;
+                if (a->speculative) ++_stats[is].speculative;
+
+                // abort duplicate requests of the same chunk on other servers
+                std::vector<swarm_assignment *> all = running[chunk_id];
+                for (uint16_t ia = 0; ia < all.size(); ++ia) {
+                    if (all[ia] != a) {
+                        swarm_transfer *cancel = new swarm_transfer();
+                        cancel->type = swarm_transfer::CANCEL;
+                        cancel->server_index = all[ia]->server_index;
+                        cancel->url = cube_url(all[ia]->server_index) + "/" + std::to_string(chunk_id) + "/cancel";
+                        cancel->assignment = nullptr;
+                        add_transfer(cancel);
+                    }
+                    drop_assignment(all[ia]);
+                }
+            }
+        }
+
+        if (running_handles > 0 || !transfers.empty()) {
+            curl_multi_wait(multi, NULL, 0, 100, NULL);
+        } else if (nfinished < c->count_chunks()) {
+            // wait until workers have processed chunks from the queue
+            std::unique_lock<std::mutex> lck(queue_mutex);
+            queue_cond.wait_for(lck, std::chrono::milliseconds(100), [&queue, max_queue_size, &worker_failed]() { return worker_failed || queue.size() < max_queue_size; });
+        }
+    }
+
+    for (auto it = running.begin(); it != running.end(); ++it) {
+        for (uint16_t ia = 0; ia < it->second.size(); ++ia) {
+            delete it->second[ia];
+        }
+    }
+    for (auto it = transfers.begin(); it != transfers.end(); ++it) {
+        curl_multi_remove_handle(multi, it->first);
+        curl_easy_cleanup(it->first);
+        delete it->second;
+    }
+    curl_multi_cleanup(multi);
+    curl_slist_free_all(download_header);
+    curl_slist_free_all(json_header);
+
+    {
+        std::lock_guard<std::mutex> lck(queue_mutex);
+        downloads_finished = true;
+    }
+    queue_cond.notify_all();
     for (uint16_t it = 0; it < nthreads; ++it) {
         workers[it].join();
     }
+
+    for (uint16_t is = 0; is < _stats.size(); ++is) {
+        GCBS_DEBUG("Server '" + _stats[is].url + "' delivered " + std::to_string(_stats[is].chunks) + " chunks (" +
+                   std::to_string(_stats[is].speculative) + " speculative, " + std::to_string(_stats[is].bytes) + " bytes, " +
+                   std::to_string(_stats[is].chunks > 0 ? _stats[is].seconds / _stats[is].chunks : 0) + " s per chunk), " +
+                   std::to_string(_stats[is].failures) + " failed requests");
+    }
+
+    // servers may remove the cube once all clients have released it
+    for (uint16_t is = 0; is < _server_uris.size(); ++is) {
+        if (_stats[is].available) {
+            delete_cube(is);
+        }
+    }
+
+    if (worker_error) {
+        std::rethrow_exception(worker_error);
+    }
+    if (!error.empty()) {
+        GCBS_ERROR(error);
+        throw error;
+    }
 }
 
 }  // namespace gdalcubes
\ No newline at end of file
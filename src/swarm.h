@@ -30,16 +30,32 @@
 
 namespace gdalcubes {
 
+/**
+ * @brief Per-server statistics of the last gdalcubes_swarm::apply() call
+ */
+struct swarm_server_stats {
+    std::string url;
+    uint32_t chunks;        // number of chunks successfully delivered by the server
+    uint64_t bytes;         // number of downloaded bytes
+    double seconds;         // sum of chunk latencies (start request until download completed) in seconds
+    uint32_t failures;      // number of failed requests
+    uint32_t speculative;   // number of speculatively re-executed chunks delivered by the server first
+    bool available;         // false if the server became unreachable
+};
+
 /**
  * @brief Chunk processor implementation for distributed processing by connecting to gdalcubes_server instances
  *
- * This class connects the several gdalcubes_server instances in order to distribute read_chunk() operations
+ * This class connects the several gdalcubes_server instances in order to distribute read_chunk() operations.
+ * Chunks are assigned dynamically: each server receives a small window of chunks and gets further chunks as soon as
+ * it delivers results. Chunks of unreachable servers are reassigned to the remaining servers and, once no unassigned
+ * chunks are left, idle servers speculatively re-execute straggling chunks.
  *
  * @todo implement add / remove method for workers
  */
 class gdalcubes_swarm : public chunk_processor {
    public:
-    gdalcubes_swarm(std::vector<std::string> urls) : _cube(nullptr), _cube_ids(), _server_handles(), _server_uris(urls), _nthreads(1) {
+    gdalcubes_swarm(std::vector<std::string> urls) : _cube(nullptr), _cube_ids(), _server_handles(), _server_uris(urls), _nthreads(1), _max_inflight(8), _stats(), _compression_level(1), _float32(false), _upload_threads(8) {
         for (uint16_t i = 0; i < _server_uris.size(); ++i)
             _server_handles.push_back(curl_easy_init());
     }
@@ -54,9 +70,22 @@ class gdalcubes_swarm : public chunk_processor {
     // Create from txt file where each line is a uri
     static std::shared_ptr<gdalcubes_swarm> from_txtfile(std::string path);
 
-    // upload execution context to all servers
+    /**
+     * @brief Upload all files of the current working directory to all servers
+     *
+     * Files are uploaded concurrently and in parts, which can be resumed after failures. Files that already exist
+     * on a server with the same content (compared by xxhash64 content hashes) are skipped.
+     *
+     * @param recursive if true, include files in subdirectories
+     */
     void push_execution_context(bool recursive = false);
 
+    /**
+     * @brief Set the number of concurrent uploads in push_execution_context()
+     * @param n number of threads, defaults to 8
+     */
+    inline void set_upload_threads(uint16_t n) { _upload_threads = n > 0 ? n : 1; }
+
     // create cube on all servers
     void push_cube(std::shared_ptr<cube> c);
 
@@ -71,13 +100,45 @@ class gdalcubes_swarm : public chunk_processor {
     }
     inline void set_threads(uint16_t threads) { _nthreads = threads; }
 
+    /**
+     * @brief Set the maximum number of chunks per server that are requested concurrently in apply() (window size)
+     * @param n number of concurrent chunk requests per server
+     */
+    inline void set_max_inflight(uint16_t n) { _max_inflight = n > 0 ? n : 1; }
+
+    /**
+     * @brief Set how chunks are encoded by servers before they are downloaded
+     *
+     * Servers always use a validity bitmask for chunks with many NaN values.
+     *
+     * @param compression_level deflate compression level (0 = no compression, 1-9), defaults to 1
+     * @param float32 if true, servers send values as float32 instead of float64 (lossy), defaults to false; partial
+     * reduction states are always sent as float64
+     */
+    inline void set_transfer_encoding(uint8_t compression_level, bool float32 = false) {
+        _compression_level = compression_level;
+        _float32 = float32;
+    }
+
+    /**
+     * @brief Get per-server statistics of the last call of apply()
+     */
+    inline std::vector<swarm_server_stats> server_stats() { return _stats; }
+
    private:
-    void post_file(std::string path, uint16_t server_index);
+    void post_file(std::string path, std::string hash, uint16_t server_index, CURL *handle);
 
     void post_start(uint32_t chunk_id, uint16_t server_index);
     std::shared_ptr<chunk_data> get_download(uint32_t chunk_id, uint16_t server_index);
 
     uint32_t post_cube(std::string json, uint16_t server_index);
+    void delete_cube(uint16_t server_index);
+
+    // HTTP header for download requests asking for encoded chunks, see chunk_codec; partial reduction states must not
+    // be converted to float32 because conversion errors would accumulate when merging them
+    inline std::string encoding_header(bool lossless = false) {
+        return "X-Gdalcubes-Chunk-Encoding: deflate=" + std::to_string(_compression_level) + (_float32 && !lossless ? ",float32" : "");
+    }
 
     std::shared_ptr<cube> _cube;
     std::vector<uint32_t> _cube_ids;  // IDs of the cube for each server
@@ -86,6 +147,14 @@ class gdalcubes_swarm : public chunk_processor {
     std::vector<std::string> _server_uris;
 
     uint16_t _nthreads;
+    uint16_t _max_inflight;
+
+    std::vector<swarm_server_stats> _stats;
+
+    uint8_t _compression_level;
+    bool _float32;
+
+    uint16_t _upload_threads;
 };
 
 }  // namespace gdalcubes
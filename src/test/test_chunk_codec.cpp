@@ -0,0 +1,79 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cmath>
+#include "../chunk_codec.h"
+#include "../external/catch.hpp"
+
+using namespace gdalcubes;
+
+TEST_CASE("Encode and decode chunks", "[chunk_codec]") {
+    std::shared_ptr<chunk_data> c = std::make_shared<chunk_data>();
+    c->size({2, 3, 10, 10});
+    double *buf = (double *)std::malloc(600 * sizeof(double));
+    for (uint32_t i = 0; i < 600; ++i) {
+        buf[i] = (i % 7 == 0) ? i * 0.5 : NAN;
+    }
+    c->buf(buf);
+
+    for (uint8_t level = 0; level <= 1; ++level) {
+        std::vector<uint8_t> e = chunk_codec::encode(c, level, false);
+        REQUIRE(e.size() < 600 * sizeof(double));
+        std::shared_ptr<chunk_data> d = chunk_codec::decode(e.data(), e.size());
+        REQUIRE(d->size() == c->size());
+        for (uint32_t i = 0; i < 600; ++i) {
+            double x = ((double *)d->buf())[i];
+            REQUIRE(((std::isnan(x) && std::isnan(buf[i])) || x == buf[i]));
+        }
+    }
+
+    REQUIRE(!c->has_validity());  // shared chunks are not modified by encode()
+
+    // both bands with the same missing values share one bitmask
+    std::shared_ptr<chunk_data> cs = std::make_shared<chunk_data>();
+    cs->size({2, 3, 10, 10});
+    double *bufs = (double *)std::malloc(600 * sizeof(double));
+    for (uint32_t i = 0; i < 600; ++i) {
+        bufs[i] = (i % 300) % 7 == 0 ? i : NAN;
+    }
+    cs->buf(bufs);
+    cs->compute_validity();
+    REQUIRE(cs->validity_shared());
+    std::vector<uint8_t> es = chunk_codec::encode(cs, 0, false);
+    REQUIRE((es[5] & chunk_codec::FLAG_MASK_SHARED));
+    std::shared_ptr<chunk_data> ds = chunk_codec::decode(es.data(), es.size());
+    for (uint32_t i = 0; i < 600; ++i) {
+        double x = ((double *)ds->buf())[i];
+        REQUIRE(((std::isnan(x) && std::isnan(bufs[i])) || x == bufs[i]));
+    }
+
+    std::vector<uint8_t> e32 = chunk_codec::encode(c, 0, true);
+    std::shared_ptr<chunk_data> d32 = chunk_codec::decode(e32.data(), e32.size());
+    REQUIRE(((double *)d32->buf())[7] == 3.5);
+    REQUIRE(std::isnan(((double *)d32->buf())[1]));
+
+    std::vector<uint8_t> e0 = chunk_codec::encode(std::make_shared<chunk_data>());
+    REQUIRE(chunk_codec::decode(e0.data(), e0.size())->empty());
+    REQUIRE_THROWS(chunk_codec::decode(e0.data(), 4));
+}
@@ -0,0 +1,83 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "../chunk_size_advisor.h"
+#include "../external/catch.hpp"
+
+using namespace gdalcubes;
+
+TEST_CASE("Chunk size advisor", "[chunk_size_advisor]") {
+    cube_view v;
+    v.srs() = "EPSG:32632";
+    v.left() = 300000;
+    v.right() = 300000 + 10980 * 10;
+    v.bottom() = 5000000;
+    v.top() = 5000000 + 10980 * 10;
+    v.nx() = 10980;
+    v.ny() = 10980;
+    v.t0() = datetime::from_string("2018-01-01");
+    v.t1() = datetime::from_string("2018-04-10");
+    v.nt(100);
+
+    source_layout src;
+    src.block_x = 512;
+    src.block_y = 512;
+    src.overviews = 4;
+    src.res_x = 10;
+    src.res_y = 10;
+    src.samples = 5;
+
+    SECTION("Chunks align with source blocks") {
+        cube_size_tyx s = chunk_size_advisor::suggest(src, v, 4, {}, 0);
+        REQUIRE(s[0] == 16);
+        REQUIRE(s[1] == 512);
+        REQUIRE(s[2] == 512);
+    }
+
+    SECTION("Overviews are considered for coarser views") {
+        v.nx() = 1830;
+        v.ny() = 1830;  // 60m, read from second overview level (40m)
+        cube_size_tyx s = chunk_size_advisor::suggest(src, v, 4, {}, 0);
+        REQUIRE(s[1] == 341);
+        REQUIRE(s[2] == 341);
+    }
+
+    SECTION("Time series operations get full time series within memory budget") {
+        uint64_t budget = (uint64_t)1024 * 1024 * 256;
+        cube_size_tyx s = chunk_size_advisor::suggest(src, v, 4, {"apply_pixel", "reduce_time"}, budget);
+        REQUIRE(s[0] == 100);
+        REQUIRE(s[1] == 256);
+        REQUIRE(s[2] == 256);
+        REQUIRE(chunk_size_advisor::chunk_memory(s, 4) <= budget);
+    }
+
+    SECTION("Unknown layout and small budget") {
+        src.samples = 0;
+        cube_size_tyx s = chunk_size_advisor::suggest(src, v, 1, {}, 0);
+        REQUIRE(s == cube_size_tyx{{16, 256, 256}});
+        s = chunk_size_advisor::suggest(src, v, 1, {}, 1024 * 1024);
+        REQUIRE(s[0] < 16);
+        REQUIRE(chunk_size_advisor::chunk_memory(s, 1) <= 1024 * 1024);
+    }
+}
@@ -0,0 +1,99 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "../apply_pixel.h"
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../join_bands.h"
+#include "../reduce_time.h"
+#include "../window_time.h"
+#include "test_helpers.h"
+
+using namespace gdalcubes;
+
+// counts calls of chunk_status()
+class counting_cube : public dummy_cube {
+   public:
+    counting_cube(cube_view v, double fill) : dummy_cube(v, 1, fill), ncalls(0) {}
+    chunk_status_type chunk_status(chunkid_t id) override {
+        ++ncalls;
+        return dummy_cube::chunk_status(id);
+    }
+    uint32_t ncalls;
+};
+
+TEST_CASE("Chunk status", "[chunk_status]") {
+    cube_view v = test_view(20, 10, 20);
+    std::shared_ptr<dummy_cube> empty = test_dummy_cube(v, {7, 10, 10}, 1, NAN);
+    std::shared_ptr<dummy_cube> full = test_dummy_cube(v, {7, 10, 10});
+
+    SECTION("Source cubes") {
+        REQUIRE(empty->chunk_is_empty(0));
+        REQUIRE(full->chunk_status(0) == chunk_status_type::NON_EMPTY);
+        REQUIRE(full->chunk_is_empty(full->count_chunks()));
+    }
+
+    SECTION("Operators propagate empty chunks") {
+        std::shared_ptr<cube> a = apply_pixel_cube::create(empty, {"band1 * 2"});
+        REQUIRE(a->chunk_is_empty(3));
+        REQUIRE(apply_pixel_cube::create(full, {"band1 * 2"})->chunk_status(3) == chunk_status_type::UNKNOWN);
+
+        std::shared_ptr<cube> r = reduce_time_cube::create(empty, {{"max", "band1"}, {"mean", "band1"}});
+        REQUIRE(r->chunk_is_empty(0));
+        REQUIRE(r->read_chunk(0)->empty());
+        REQUIRE(!reduce_time_cube::create(empty, {{"count", "band1"}})->chunk_is_empty(0));
+
+        std::shared_ptr<cube> w = window_time_cube::create(empty, {{"mean", "band1"}}, 2, 2);
+        REQUIRE(w->chunk_is_empty(2));
+        REQUIRE(w->read_chunk(2)->empty());
+
+        std::shared_ptr<cube> j = join_bands_cube::create(empty, full);
+        REQUIRE(j->chunk_status(0) == chunk_status_type::NON_EMPTY);
+    }
+
+    SECTION("Results of chunk_is_empty() are memoised") {
+        std::shared_ptr<counting_cube> c = std::make_shared<counting_cube>(v, NAN);
+        c->set_chunk_size(7, 10, 10);
+        std::shared_ptr<cube> r = reduce_time_cube::create(c, {{"max", "band1"}});
+        REQUIRE(r->chunk_is_empty(0));
+        uint32_t ncalls = c->ncalls;
+        REQUIRE(r->read_chunk(0)->empty());
+        REQUIRE(r->chunk_is_empty(0));
+        REQUIRE(c->ncalls == ncalls);
+        c->set_chunk_size(20, 10, 10);
+        REQUIRE(c->chunk_is_empty(0));
+        REQUIRE(c->ncalls == ncalls + 1);
+    }
+
+    SECTION("Chunk processors do not read empty chunks") {
+        uint64_t skipped = metrics::instance()->empty_chunks_skipped();
+        uint32_t n = 0;
+        chunk_processor_singlethread p;
+        p.apply(reduce_time_cube::create(empty, {{"median", "band1"}}), [&n](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+            if (dat->empty()) ++n;
+        });
+        REQUIRE(n == 2);
+        REQUIRE(metrics::instance()->empty_chunks_skipped() == skipped + 2);
+    }
+}
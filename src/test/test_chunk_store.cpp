@@ -0,0 +1,77 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include "../chunk_store.h"
+#include "../cube_factory.h"
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../filesystem.h"
+
+using namespace gdalcubes;
+
+TEST_CASE("Materialize and read", "[chunk_store]") {
+    cube_view v;
+    v.srs() = "EPSG:4326";
+    v.left() = 0;
+    v.right() = 10;
+    v.bottom() = 0;
+    v.top() = 10;
+    v.nx() = 50;
+    v.ny() = 40;
+    v.t0() = datetime::from_string("2018-01-01");
+    v.t1() = datetime::from_string("2018-01-10");
+    v.dt(duration::from_string("P1D"));
+
+    auto c = dummy_cube::create(v, 2, 3.0);
+    c->set_chunk_size(4, 16, 16);
+
+    std::string f1 = filesystem::join(filesystem::get_tempdir(), utils::generate_unique_filename(8, "test_", ".gcbs"));
+    c->materialize(f1);
+    auto s1 = chunk_store_cube::create(f1);
+    REQUIRE(s1->count_chunks() == c->count_chunks());
+    REQUIRE(s1->size_bands() == 2);
+    for (chunkid_t id = 0; id < s1->count_chunks(); ++id) {
+        std::shared_ptr<chunk_data> a = c->read_chunk(id);
+        std::shared_ptr<chunk_data> b = s1->read_chunk(id);
+        REQUIRE(a->size() == b->size());
+        for (uint32_t i = 0; i < a->count_bands() * a->count_values(); ++i) {
+            REQUIRE(((double *)a->buf())[i] == ((double *)b->buf())[i]);
+        }
+    }
+
+    std::string f2 = filesystem::join(filesystem::get_tempdir(), utils::generate_unique_filename(8, "test_", ".gcbs"));
+    c->materialize(f2, "float32", 6);
+    auto s2 = cube_factory::instance()->create_from_json(chunk_store_cube::create(f2)->make_constructible_json());
+    chunkid_t last = s2->count_chunks() - 1;
+    std::shared_ptr<chunk_data> b = s2->read_chunk(last);
+    REQUIRE(b->size()[0] == 2);
+    REQUIRE(b->size()[1] == c->chunk_size(last)[0]);
+    REQUIRE(b->size()[2] == c->chunk_size(last)[1]);
+    REQUIRE(b->size()[3] == c->chunk_size(last)[2]);
+    REQUIRE(((double *)b->buf())[0] == 3.0);
+
+    filesystem::remove(f1);
+    filesystem::remove(f2);
+}
@@ -0,0 +1,109 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "../cube.h"
+#include "../external/catch.hpp"
+
+using namespace gdalcubes;
+
+TEST_CASE("Chunk validity", "[chunk_validity]") {
+    // 2 bands, 3 time slices, 10 x 10 pixels
+    std::shared_ptr<chunk_data> c = std::make_shared<chunk_data>();
+    c->size({2, 3, 10, 10});
+    c->buf(std::calloc(2 * 3 * 100, sizeof(double)));
+    double *x = (double *)c->buf();
+    for (uint32_t i = 0; i < 2 * 3 * 100; ++i) {
+        x[i] = i % 100;
+    }
+    for (uint16_t ib = 0; ib < 2; ++ib) {
+        std::fill(x + ib * 300, x + ib * 300 + 100, NAN);  // t = 0 missing
+        for (uint32_t ixy = 0; ixy < 100; ixy += 7) {
+            x[ib * 300 + 200 + ixy] = NAN;  // t = 2 partially missing
+        }
+    }
+
+    REQUIRE(!c->has_validity());
+    REQUIRE(c->validity(0, 0) == chunk_data::slice_validity::UNKNOWN);
+
+    SECTION("Summaries and shared bitmask") {
+        c->compute_validity();
+        REQUIRE(c->has_validity());
+        REQUIRE(c->validity_shared());
+        REQUIRE(c->validity(1, 0) == chunk_data::slice_validity::ALL_MISSING);
+        REQUIRE(c->validity(1, 1) == chunk_data::slice_validity::ALL_VALID);
+        REQUIRE(c->validity(1, 2) == chunk_data::slice_validity::MIXED);
+        REQUIRE(!c->band_all_missing(0));
+        REQUIRE(c->validity_mask(0, 2)[0] == c->validity_mask(1, 2)[0]);
+        REQUIRE((c->validity_mask(0, 2)[0] & 1) == 0);
+        REQUIRE((c->validity_mask(0, 2)[0] & 2) == 2);
+        REQUIRE(c->validity_mask(0, 1)[1] == 0xFFFFFFFFFULL);  // bits 64..99 set
+
+        x[300 + 100 + 5] = NAN;
+        c->compute_validity();
+        REQUIRE(!c->validity_shared());
+        REQUIRE(c->validity(0, 1) == chunk_data::slice_validity::ALL_VALID);
+        REQUIRE(c->validity(1, 1) == chunk_data::slice_validity::MIXED);
+    }
+
+    SECTION("Iteration over valid values") {
+        uint32_t n_unknown = 0;
+        double sum_unknown = 0;
+        c->for_each_valid(1, [&](uint32_t it, uint32_t ixy, double v) {
+            ++n_unknown;
+            sum_unknown += v;
+        });
+
+        c->compute_validity();
+        uint32_t n = 0;
+        double sum = 0;
+        bool ok = true;
+        c->for_each_valid(1, [&](uint32_t it, uint32_t ixy, double v) {
+            ++n;
+            sum += v;
+            ok = ok && it > 0 && v == ixy && !(it == 2 && ixy % 7 == 0);
+        });
+        REQUIRE(ok);
+        REQUIRE(n == 100 + 85);
+        REQUIRE(n == n_unknown);
+        REQUIRE(sum == sum_unknown);
+    }
+
+    SECTION("Deferred computation") {
+        c->defer_validity();
+        REQUIRE(c->has_validity());
+        REQUIRE(c->validity(1, 0) == chunk_data::slice_validity::ALL_MISSING);
+        REQUIRE(c->validity_shared());
+        c->size({2, 3, 10, 10});
+        REQUIRE(!c->has_validity());
+        REQUIRE(c->validity(1, 0) == chunk_data::slice_validity::UNKNOWN);
+    }
+
+    SECTION("Changing the buffer discards validity") {
+        c->compute_validity();
+        c->buf(std::calloc(2 * 3 * 100, sizeof(double)));
+        REQUIRE(!c->has_validity());
+        c->compute_validity();
+        REQUIRE(c->validity(0, 0) == chunk_data::slice_validity::ALL_VALID);
+    }
+}
@@ -0,0 +1,64 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../reduce_time.h"
+#include "../window_time.h"
+#include "test_helpers.h"
+
+using namespace gdalcubes;
+
+TEST_CASE("Explain", "[explain]") {
+    std::shared_ptr<dummy_cube> in = test_dummy_cube(test_view(20, 10, 20), {7, 10, 10}, 2);  // 3 x 1 x 2 chunks
+
+    SECTION("Single cube") {
+        nlohmann::json e = in->explain();
+        REQUIRE(e["cubes"].size() == 1);
+        REQUIRE(e["cubes"][0]["cube_type"] == "dummy");
+        REQUIRE(e["cubes"][0]["chunks"] == 6);
+        REQUIRE(e["cubes"][0]["chunk_bytes"] == 2 * 7 * 10 * 10 * sizeof(double));
+        REQUIRE(e["summary"]["chunks"] == 6);
+        REQUIRE(e["summary"]["memory_per_chunk_bytes"] == 2 * 7 * 10 * 10 * sizeof(double));
+        REQUIRE(e["summary"]["recommended_threads"].get<uint32_t>() <= 6);
+    }
+
+    SECTION("Window and reduction over time") {
+        std::shared_ptr<cube> w = window_time_cube::create(in, {{"mean", "band1"}}, 2, 2);
+        std::shared_ptr<cube> r = reduce_time_cube::create(w, {{"max", "band1_mean"}});
+        nlohmann::json e = r->explain();
+        REQUIRE(e["cubes"].size() == 3);
+        REQUIRE(e["cubes"][0]["cube_type"] == "reduce_time");
+        REQUIRE(e["cubes"][0]["chunks"] == 2);
+        REQUIRE(e["cubes"][1]["cube_type"] == "window_time");
+        REQUIRE(e["cubes"][1]["chunk_reads"].get<double>() == Approx(6));
+        // the first and last chunk in time read one neighbor, the middle chunk reads two neighbors
+        REQUIRE(e["cubes"][2]["chunk_reads"].get<double>() == Approx(14));
+        REQUIRE(e["cubes"][2]["reread_factor"].get<double>() == Approx(14.0 / 6.0));
+
+        // memory budget for two chunks limits the number of threads
+        uint64_t m = e["summary"]["memory_per_chunk_bytes"].get<uint64_t>();
+        REQUIRE(r->explain(2 * m)["summary"]["recommended_threads"].get<uint32_t>() <= 2);
+    }
+}
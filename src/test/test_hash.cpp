@@ -0,0 +1,50 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cstring>
+#include "../external/catch.hpp"
+#include "../hash.h"
+
+using namespace gdalcubes;
+
+TEST_CASE("xxhash64", "[hash]") {
+    REQUIRE(xxhash64().hexdigest() == "ef46db3751d8e999");
+
+    xxhash64 h;
+    h.update("abc", 3);
+    REQUIRE(h.hexdigest() == "44bc2cf5ad770999");
+
+    // incremental updates must give the same result as a single update
+    std::vector<uint8_t> data(1000);
+    for (uint32_t i = 0; i < data.size(); ++i) {
+        data[i] = (i * 7) % 256;
+    }
+    xxhash64 h1;
+    h1.update(data.data(), data.size());
+    xxhash64 h2;
+    for (uint32_t i = 0; i < data.size(); i += 13) {
+        h2.update(data.data() + i, std::min<uint32_t>(13, data.size() - i));
+    }
+    REQUIRE(h1.digest() == h2.digest());
+}
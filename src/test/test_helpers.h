@@ -0,0 +1,70 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "../dummy.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Create a view with a 10 x 10 degree extent in EPSG:4326 and nt daily time slices starting on 2018-01-01
+ * @param nx number of cells in x direction
+ * @param ny number of cells in y direction
+ * @param nt number of days
+ * @return cube view
+ */
+inline cube_view test_view(uint32_t nx, uint32_t ny, uint32_t nt) {
+    cube_view v;
+    v.srs() = "EPSG:4326";
+    v.left() = 0;
+    v.right() = 10;
+    v.bottom() = 0;
+    v.top() = 10;
+    v.nx() = nx;
+    v.ny() = ny;
+    v.t0() = datetime::from_string("2018-01-01");
+    v.t1() = v.t0() + duration(nt - 1, datetime_unit::DAY);
+    v.nt(nt);
+    return v;
+}
+
+/**
+ * @brief Create a dummy cube with the given chunk size
+ * @param v cube view, e.g. from test_view()
+ * @param chunk_size chunk size in t, y, and x dimensions
+ * @param nbands number of bands
+ * @param fill value of all pixels, may be NAN to create a cube with empty chunks only
+ * @return a shared pointer to the created data cube instance
+ */
+inline std::shared_ptr<dummy_cube> test_dummy_cube(cube_view v, cube_size_tyx chunk_size, uint16_t nbands = 1, double fill = 1.0) {
+    std::shared_ptr<dummy_cube> out = dummy_cube::create(v, nbands, fill);
+    out->set_chunk_size(chunk_size[0], chunk_size[1], chunk_size[2]);
+    return out;
+}
+
+}  // namespace gdalcubes
+
+#endif  //TEST_HELPERS_H
@@ -0,0 +1,67 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <sstream>
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../metrics.h"
+#include "test_helpers.h"
+
+using namespace gdalcubes;
+
+TEST_CASE("Histogram buckets", "[metrics]") {
+    histogram h;
+    h.observe(0.0005);
+    h.observe(0.003);
+    h.observe(0.003);
+    h.observe(100);
+    REQUIRE(h.count() == 4);
+    REQUIRE(std::fabs(h.sum() - 100.0065) < 1e-6);
+
+    std::stringstream ss;
+    h.write_prometheus(ss, "x_seconds", "a=\"b\"");
+    std::string s = ss.str();
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"0.0001\"} 0\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"0.0005\"} 1\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"0.001\"} 1\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"0.0025\"} 1\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"0.005\"} 3\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"30\"} 3\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_bucket{a=\"b\",le=\"+Inf\"} 4\n") != std::string::npos);
+    REQUIRE(s.find("x_seconds_count{a=\"b\"} 4\n") != std::string::npos);
+}
+
+TEST_CASE("Chunk reads are counted per cube type", "[metrics]") {
+    std::shared_ptr<dummy_cube> c = test_dummy_cube(test_view(20, 20, 4), {2, 10, 10});
+
+    uint64_t before = metrics::instance()->chunk_read("dummy").count();
+    for (chunkid_t id = 0; id < c->count_chunks(); ++id) {
+        c->read_chunk(id);
+    }
+    REQUIRE(metrics::instance()->chunk_read("dummy").count() == before + c->count_chunks());
+
+    std::stringstream ss;
+    metrics::instance()->write_prometheus(ss);
+    REQUIRE(ss.str().find("gdalcubes_chunk_read_seconds_count{cube_type=\"dummy\"}") != std::string::npos);
+}
@@ -0,0 +1,104 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cmath>
+#include "../chunk_cache.h"
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../partial_reduce.h"
+#include "../reduce_space.h"
+#include "../reduce_time.h"
+#include "test_helpers.h"
+
+using namespace gdalcubes;
+
+// dummy cube with varying values and some NaNs
+struct varying_dummy_cube : public dummy_cube {
+    varying_dummy_cube(cube_view v) : dummy_cube(v, 2, 1.0) {}
+    std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override {
+        std::shared_ptr<chunk_data> c = dummy_cube::read_chunk(id);
+        double *buf = (double *)c->buf();
+        uint64_t n = c->size()[0] * c->size()[1] * c->size()[2] * c->size()[3];
+        for (uint64_t i = 0; i < n; ++i) {
+            buf[i] = ((i * 31 + id * 17) % 13 == 0) ? NAN : std::sin(i * 0.37 + id) * 10 + id;
+        }
+        return c;
+    }
+};
+
+TEST_CASE("Merged partial reductions equal reductions", "[partial_reduce]") {
+    cube_view v = test_view(37, 23, 20);
+    std::shared_ptr<varying_dummy_cube> in = std::make_shared<varying_dummy_cube>(v);
+    in->set_chunk_size(7, 8, 9);
+
+    std::vector<std::pair<std::string, std::string>> reducer_bands = {{"sum", "band1"}, {"mean", "band2"}, {"min", "band1"}, {"max", "band2"}, {"count", "band1"}, {"var", "band1"}, {"sd", "band2"}, {"prod", "band2"}};
+    std::vector<std::shared_ptr<cube>> reductions = {reduce_space_cube::create(in, reducer_bands), reduce_time_cube::create(in, reducer_bands)};
+    for (uint16_t ir = 0; ir < reductions.size(); ++ir) {
+        std::shared_ptr<cube> r = reductions[ir];
+        std::shared_ptr<partial_reduce_cube> p = partial_reduce_cube::from_reduction(r, 40);
+        REQUIRE(p != nullptr);
+        REQUIRE(p->nparts() > 1);
+
+        std::vector<std::shared_ptr<chunk_data>> states(r->count_chunks());
+        for (chunkid_t id = 0; id < p->count_chunks(); ++id) {
+            chunkid_t out_id = p->result_chunk(id);
+            if (!states[out_id]) states[out_id] = std::make_shared<chunk_data>();
+            p->merge(states[out_id], p->read_chunk(id));
+        }
+        for (chunkid_t id = 0; id < r->count_chunks(); ++id) {
+            std::shared_ptr<chunk_data> a = p->finalize(states[id]);
+            std::shared_ptr<chunk_data> b = r->read_chunk(id);
+            REQUIRE(a->size() == b->size());
+            for (uint32_t i = 0; i < a->size()[0] * a->size()[1] * a->size()[2] * a->size()[3]; ++i) {
+                double x = ((double *)a->buf())[i];
+                double y = ((double *)b->buf())[i];
+                REQUIRE(std::isnan(x) == std::isnan(y));
+                if (!std::isnan(x)) {
+                    REQUIRE((x == y || std::fabs(x - y) <= 1e-9 * std::max(1.0, std::fabs(y))));
+                }
+            }
+        }
+    }
+
+    // empty input results in empty chunks, as for local reductions
+    std::shared_ptr<dummy_cube> empty = test_dummy_cube(v, {7, 8, 9}, 1, NAN);
+    std::shared_ptr<cube> re = reduce_time_cube::create(empty, {{"mean", "band1"}, {"max", "band1"}});
+    std::shared_ptr<partial_reduce_cube> pe = partial_reduce_cube::from_reduction(re, 40);
+    REQUIRE(pe != nullptr);
+    std::shared_ptr<chunk_data> se = std::make_shared<chunk_data>();
+    for (chunkid_t id = 0; id < pe->count_chunks(); ++id) {
+        if (pe->result_chunk(id) == 0) pe->merge(se, pe->read_chunk(id));
+    }
+    REQUIRE(pe->finalize(se)->empty());
+    REQUIRE(re->read_chunk(0)->empty());
+
+    // median is not mergeable
+    REQUIRE(partial_reduce_cube::from_reduction(reduce_space_cube::create(in, {{"median", "band1"}}), 40) == nullptr);
+
+    // reductions are recognized behind transparent wrappers
+    std::shared_ptr<cube> cached = cached_cube::create(reduce_time_cube::create(in, {{"mean", "band1"}}));
+    REQUIRE(cached->unwrap() != cached);
+    REQUIRE(partial_reduce_cube::from_reduction(cached, 40) != nullptr);
+    REQUIRE(cached->explain()["cubes"].size() == 2);
+}
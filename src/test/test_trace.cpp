@@ -0,0 +1,64 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "../dummy.h"
+#include "../external/catch.hpp"
+#include "../reduce_time.h"
+#include "../trace.h"
+#include "test_helpers.h"
+
+using namespace gdalcubes;
+
+TEST_CASE("Nested chunk reads are traced", "[trace]") {
+    std::shared_ptr<dummy_cube> in = test_dummy_cube(test_view(20, 20, 4), {2, 20, 20});
+    std::shared_ptr<reduce_time_cube> r = reduce_time_cube::create(in, {{"mean", "band1"}});
+
+    r->read_chunk(0);
+    REQUIRE(trace::chrome_json()["traceEvents"].empty());
+
+    trace::start();
+    r->read_chunk(0);
+    trace::stop();
+    std::shared_ptr<chunk_data> c = r->read_chunk(0);
+
+    nlohmann::json events = trace::chrome_json()["traceEvents"];
+    nlohmann::json outer, inner;
+    uint16_t ninner = 0;
+    for (uint16_t i = 0; i < events.size(); ++i) {
+        REQUIRE(events[i]["ph"] == "X");
+        if (events[i]["name"] == "reduce_time") outer = events[i];
+        if (events[i]["name"] == "dummy") {
+            inner = events[i];
+            ++ninner;
+        }
+    }
+    REQUIRE(ninner == 2);
+    REQUIRE(outer["args"]["chunk"] == 0);
+    REQUIRE(outer["args"]["bytes"] == c->total_size_bytes());
+    REQUIRE(c->total_size_bytes() > 0);
+    REQUIRE(inner["tid"] == outer["tid"]);
+    REQUIRE(inner["ts"].get<uint64_t>() >= outer["ts"].get<uint64_t>());
+    REQUIRE(inner["ts"].get<uint64_t>() + inner["dur"].get<uint64_t>() <= outer["ts"].get<uint64_t>() + outer["dur"].get<uint64_t>());
+    trace::clear();
+}
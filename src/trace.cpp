@@ -0,0 +1,100 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "trace.h"
+
+#include <fstream>
+#include <map>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace gdalcubes {
+
+std::atomic<bool> trace::_enabled(false);
+std::mutex trace::_mutex;
+std::vector<trace_event> trace::_events;
+
+void trace::start() {
+    std::lock_guard<std::mutex> lck(_mutex);
+    _events.clear();
+    _enabled.store(true);
+}
+
+void trace::stop() {
+    _enabled.store(false);
+}
+
+void trace::clear() {
+    std::lock_guard<std::mutex> lck(_mutex);
+    _events.clear();
+}
+
+void trace::add(trace_event e) {
+    std::lock_guard<std::mutex> lck(_mutex);
+    _events.push_back(std::move(e));
+}
+
+nlohmann::json trace::chrome_json() {
+    std::lock_guard<std::mutex> lck(_mutex);
+    nlohmann::json events = nlohmann::json::array();
+    std::map<std::thread::id, uint32_t> tids;  // small sequential thread ids in order of appearance
+    int pid = getpid();
+    for (uint32_t i = 0; i < _events.size(); ++i) {
+        auto it = tids.find(_events[i].thread);
+        if (it == tids.end()) {
+            it = tids.insert(std::make_pair(_events[i].thread, (uint32_t)tids.size() + 1)).first;
+        }
+        nlohmann::json e;
+        e["name"] = _events[i].name;
+        e["cat"] = _events[i].category;
+        e["ph"] = "X";
+        e["ts"] = _events[i].ts;
+        e["dur"] = _events[i].dur;
+        e["pid"] = pid;
+        e["tid"] = it->second;
+        if (!_events[i].args.is_null()) {
+            e["args"] = _events[i].args;
+        }
+        events.push_back(e);
+    }
+    nlohmann::json out;
+    out["traceEvents"] = events;
+    out["displayTimeUnit"] = "ms";
+    return out;
+}
+
+void trace::write_chrome_json(std::string path) {
+    std::ofstream f(path);
+    if (!f.is_open()) {
+        throw std::string("ERROR in trace::write_chrome_json(): cannot open output file '" + path + "'");
+    }
+    f << chrome_json().dump();
+}
+
+}  // namespace gdalcubes
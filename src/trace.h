@@ -0,0 +1,156 @@
+/*
+    MIT License
+
+    Copyright (c) 2019 Marius Appel <marius.appel@uni-muenster.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "external/json.hpp"
+
+namespace gdalcubes {
+
+/**
+ * @brief A single complete event (span) of a trace
+ */
+struct trace_event {
+    const char *name;
+    const char *category;
+    uint64_t ts;   // start time in microseconds
+    uint64_t dur;  // duration in microseconds
+    std::thread::id thread;
+    nlohmann::json args;
+};
+
+/**
+ * @brief Process-wide recording of nested time spans, e.g. chunk reads of all cubes in a pipeline and internal phases
+ * such as SQL queries or GDALWarp calls
+ *
+ * Recording is disabled by default. If disabled, creating a trace_span costs a single relaxed atomic load. Spans of
+ * the same thread are nested by time, such that recorded traces can be viewed as flame charts with chrome://tracing
+ * or https://ui.perfetto.dev after exporting them with write_chrome_json().
+ */
+class trace {
+   public:
+    /**
+     * @brief Check whether spans are currently recorded
+     */
+    static inline bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Remove previously recorded events and start recording
+     */
+    static void start();
+
+    /**
+     * @brief Stop recording, recorded events are kept until the next call of start() or clear()
+     */
+    static void stop();
+
+    /**
+     * @brief Remove all recorded events
+     */
+    static void clear();
+
+    /**
+     * @brief Current time in microseconds since an arbitrary but fixed point in time
+     */
+    static inline uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Add a recorded span
+     */
+    static void add(trace_event e);
+
+    /**
+     * @brief Get recorded events in the Chrome trace event format
+     * @return JSON object with a traceEvents array
+     */
+    static nlohmann::json chrome_json();
+
+    /**
+     * @brief Write recorded events in the Chrome trace event format to a file
+     * @param path output file
+     */
+    static void write_chrome_json(std::string path);
+
+   private:
+    static std::atomic<bool> _enabled;
+    static std::mutex _mutex;
+    static std::vector<trace_event> _events;
+};
+
+/**
+ * @brief Records a span from construction until destruction, if tracing is enabled
+ *
+ * @code
+ * trace_span s("GDALWarp");
+ * s.arg("file", filename);
+ * @endcode
+ */
+class trace_span {
+   public:
+    /**
+     * @param name name of the span, must remain valid until program exit (e.g. a string literal)
+     * @param category category of the span, must remain valid until program exit (e.g. a string literal)
+     */
+    trace_span(const char *name, const char *category = "phase") : _active(trace::enabled()), _name(name), _category(category), _ts(_active ? trace::now() : 0), _args() {}
+
+    ~trace_span() { end(); }
+
+    /**
+     * @brief Finish the span before it goes out of scope
+     */
+    inline void end() {
+        if (_active) {
+            trace::add(trace_event{_name, _category, _ts, trace::now() - _ts, std::this_thread::get_id(), _args});
+            _active = false;
+        }
+    }
+
+    /**
+     * @brief Attach a key value pair to the span, ignored if tracing is disabled
+     */
+    template <typename T>
+    inline void arg(const char *key, T value) {
+        if (_active) _args[key] = value;
+    }
+
+   private:
+    bool _active;
+    const char *_name;
+    const char *_category;
+    uint64_t _ts;
+    nlohmann::json _args;
+};
+
+}  // namespace gdalcubes
+
+#endif  //TRACE_H
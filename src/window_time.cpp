@@ -117,11 +117,36 @@ std::function<double(double* buf, uint16_t n)> window_time_cube::get_kernel_redu
     });
 }
 
+chunk_status_type window_time_cube::chunk_status(chunkid_t id) {
+    if (id >= count_chunks()) return chunk_status_type::EMPTY;
+
+    // only kernels, mean, and median return NAN for windows without any data
+    if (_kernel.empty()) {
+        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+            if (_reducer_bands[i].first != "mean" && _reducer_bands[i].first != "median") {
+                return chunk_status_type::UNKNOWN;
+            }
+        }
+    }
+
+    uint32_t chunk_count_l = (uint32_t)std::ceil((double)_win_size_l / (double)(_in_cube->chunk_size()[0]));
+    uint32_t chunk_count_r = (uint32_t)std::ceil((double)_win_size_r / (double)(_in_cube->chunk_size()[0]));
+    int32_t nxy = _in_cube->count_chunks_x() * _in_cube->count_chunks_y();
+    for (int32_t tid = (int32_t)id - (int32_t)chunk_count_l * nxy; tid <= (int32_t)id + (int32_t)chunk_count_r * nxy; tid += nxy) {
+        if (tid < 0 || tid >= (int32_t)_in_cube->count_chunks()) continue;
+        if (!_in_cube->chunk_is_empty(tid)) return chunk_status_type::UNKNOWN;
+    }
+    return chunk_status_type::EMPTY;
+}
+
 std::shared_ptr<chunk_data> window_time_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("window_time_cube::read_chunk(" + std::to_string(id) + ")");
+    GCBS_CHUNK_READ_TIMER(tm, "window_time", id);
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     if (id >= count_chunks())
         return out;  // chunk is outside of the view, we don't need to read anything.
+    if (chunk_is_empty(id))
+        return out;
 
     coords_nd<uint32_t, 3> size_tyx = chunk_size(id);
 
@@ -232,6 +257,7 @@ std::shared_ptr<chunk_data> window_time_cube::read_chunk(chunkid_t id) {
         }
     }
     std::free(cur_ts);
+    tm.bytes(out->total_size_bytes());
     return out;
 }
 
@@ -119,6 +119,8 @@ class window_time_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_status_type chunk_status(chunkid_t id) override;
+
     nlohmann::json make_constructible_json() override {
         nlohmann::json out;
         out["cube_type"] = "window_time";
@@ -133,6 +135,22 @@ class window_time_cube : public cube {
         return out;
     }
 
+   protected:
+    nlohmann::json explain_node() override {
+        nlohmann::json out = cube::explain_node();
+        // each chunk reads adjacent input chunks in time that overlap with the window
+        uint32_t nt = _in_cube->count_chunks_t();
+        uint32_t chunk_count_l = (uint32_t)std::ceil((double)_win_size_l / (double)(_in_cube->chunk_size()[0]));
+        uint32_t chunk_count_r = (uint32_t)std::ceil((double)_win_size_r / (double)(_in_cube->chunk_size()[0]));
+        uint64_t reads = 0;
+        for (uint32_t ct = 0; ct < nt; ++ct) {
+            reads += 1 + std::min(chunk_count_l, ct) + std::min(chunk_count_r, nt - 1 - ct);
+        }
+        out["input_reads"] = reads * _in_cube->count_chunks_x() * _in_cube->count_chunks_y();
+        out["input_chunks_in_memory"] = std::min(nt, 1 + chunk_count_l + chunk_count_r);
+        return out;
+    }
+
    private:
     std::shared_ptr<cube> _in_cube;
     std::vector<std::pair<std::string, std::string>> _reducer_bands;